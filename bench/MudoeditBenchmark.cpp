@@ -0,0 +1,785 @@
+// Benchmark suite for mudoedit. Run through the run_mudoedit_bench target, or directly with
+// any QTest logger, e.g. "mudoedit_bench -o results.xml,xml" or "mudoedit_bench -csv"
+
+#include "MudoeditBenchmark.h"
+#include "MainWindow.h"
+#include "FileIO.h"
+#include "DocumentManager.h"
+#include "SettingsManagement.h"
+#include "SyntaxHighlighter.h"
+#include "SearchEngine.h"
+#include "QuickOpenManager.h"
+#include "WordIndex.h"
+#include "DocumentOutline.h"
+#include "LineOperations.h"
+#include "MultiCursor.h"
+#include "TextDiff.h"
+#include "EncodingDetector.h"
+#include <QtTest>
+#include <QApplication>
+#include <QTabWidget>
+#include <QSplitter>
+#include <QMdiArea>
+#include <QMdiSubWindow>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QFile>
+#include <KTextEdit>
+#include <algorithm>
+#include <memory>
+
+namespace {
+
+constexpr qint64 KB = 1024;
+constexpr qint64 MB = 1024 * KB;
+
+QMdiArea *mdiAreaOf(QTabWidget *tabWidget, int index)
+{
+    QSplitter *splitter = qobject_cast<QSplitter*>(tabWidget->widget(index));
+    return splitter ? qobject_cast<QMdiArea*>(splitter->widget(0)) : nullptr;
+}
+
+// Byte by byte references for the vectorized encoding checks
+qsizetype asciiPrefixReference(QByteArrayView bytes)
+{
+    qsizetype i = 0;
+    while (i < bytes.size() && uchar(bytes.at(i)) < 0x80) {
+        ++i;
+    }
+    return i;
+}
+
+bool isValidUtf8Reference(QByteArrayView bytes)
+{
+    // Decode every sequence and reject what does not round-trip to a single scalar value
+    static const char32_t minimum[] = {0, 0, 0x80, 0x800, 0x10000};
+    qsizetype i = 0;
+    while (i < bytes.size()) {
+        const uchar lead = uchar(bytes.at(i));
+        int length;
+        char32_t codePoint;
+        if (lead < 0x80) {
+            ++i;
+            continue;
+        } else if ((lead & 0xE0) == 0xC0) {
+            length = 2;
+            codePoint = lead & 0x1F;
+        } else if ((lead & 0xF0) == 0xE0) {
+            length = 3;
+            codePoint = lead & 0x0F;
+        } else if ((lead & 0xF8) == 0xF0) {
+            length = 4;
+            codePoint = lead & 0x07;
+        } else {
+            return false;
+        }
+
+        if (bytes.size() - i < length) return false;
+        for (int k = 1; k < length; ++k) {
+            const uchar byte = uchar(bytes.at(i + k));
+            if ((byte & 0xC0) != 0x80) return false;
+            codePoint = (codePoint << 6) | (byte & 0x3F);
+        }
+        if (codePoint < minimum[length] || (codePoint >= 0xD800 && codePoint <= 0xDFFF) || codePoint > 0x10FFFF) {
+            return false;
+        }
+        i += length;
+    }
+    return true;
+}
+
+void countLineBreaksReference(QStringView text, qsizetype *lineFeeds, qsizetype *crlfs)
+{
+    *lineFeeds = *crlfs = 0;
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        if (text.at(i) == u'\n') {
+            ++*lineFeeds;
+            if (i > 0 && text.at(i - 1) == u'\r') {
+                ++*crlfs;
+            }
+        }
+    }
+}
+
+}
+
+void MudoeditBenchmark::initTestCase()
+{
+    QVERIFY(m_dataDir.isValid());
+
+    m_mainWindow = new MainWindow;
+
+    // Give the document manager a tab widget of its own, laid out like MainWindow::addNewTab
+    m_tabWidget = new QTabWidget;
+    QSplitter *splitter = new QSplitter(Qt::Horizontal);
+    splitter->addWidget(new QMdiArea(splitter));
+    m_tabWidget->addTab(splitter, QStringLiteral("Default"));
+    m_tabWidget->resize(1024, 768);
+    m_tabWidget->show();
+
+    m_settings = new QSettings(QStringLiteral("erateth"), QStringLiteral("mudoedit"), this);
+    m_fileIO = new FileIO(this);
+    m_settingsManagement = new SettingsManagement(m_tabWidget, m_settings, this);
+    m_documentManager = new DocumentManager(m_mainWindow, m_tabWidget, m_fileIO, m_settingsManagement, this);
+}
+
+void MudoeditBenchmark::cleanupTestCase()
+{
+    closeAllDocuments();
+    delete m_tabWidget;
+    delete m_mainWindow;
+}
+
+void MudoeditBenchmark::cleanup()
+{
+    closeAllDocuments();
+}
+
+void MudoeditBenchmark::readFile_data()
+{
+    QTest::addColumn<QString>("path");
+
+    QTest::newRow("ascii-4KB") << writeSampleFile(QStringLiteral("read-ascii-4k.txt"), 4 * KB, false);
+    QTest::newRow("ascii-1MB") << writeSampleFile(QStringLiteral("read-ascii-1m.txt"), MB, false);
+    QTest::newRow("ascii-32MB") << writeSampleFile(QStringLiteral("read-ascii-32m.txt"), 32 * MB, false);
+    QTest::newRow("utf8-4KB") << writeSampleFile(QStringLiteral("read-utf8-4k.txt"), 4 * KB, true);
+    QTest::newRow("utf8-1MB") << writeSampleFile(QStringLiteral("read-utf8-1m.txt"), MB, true);
+    QTest::newRow("utf8-32MB") << writeSampleFile(QStringLiteral("read-utf8-32m.txt"), 32 * MB, true);
+}
+
+void MudoeditBenchmark::readFile()
+{
+    QFETCH(QString, path);
+
+    QString content;
+    QBENCHMARK {
+        content = m_fileIO->readFile(path);
+    }
+    QVERIFY(!content.isEmpty());
+}
+
+void MudoeditBenchmark::writeFile_data()
+{
+    readFile_data();
+}
+
+void MudoeditBenchmark::writeFile()
+{
+    QFETCH(QString, path);
+
+    const QString content = m_fileIO->readFile(path);
+    const QString target = m_dataDir.filePath(QStringLiteral("write-target.txt"));
+    QBENCHMARK {
+        QVERIFY(m_fileIO->writeFile(target, content));
+    }
+}
+
+void MudoeditBenchmark::writeDocument_data()
+{
+    readFile_data();
+}
+
+void MudoeditBenchmark::writeDocument()
+{
+    QFETCH(QString, path);
+
+    // Saving as the editor does, with CRLF line breaks and whitespace cleanup on the way out
+    const QTextDocument document(m_fileIO->readFile(path));
+    const QString target = m_dataDir.filePath(QStringLiteral("write-target.txt"));
+    EncodingDetector::Format format;
+    format.crlf = true;
+    FileIO::SaveOptions options;
+    options.trimTrailingWhitespace = true;
+    options.ensureFinalNewline = true;
+    QBENCHMARK {
+        QVERIFY(m_fileIO->writeDocument(target, &document, &format, options));
+    }
+}
+
+void MudoeditBenchmark::openFile_data()
+{
+    readFile_data();
+}
+
+void MudoeditBenchmark::openFile()
+{
+    QFETCH(QString, path);
+
+    // Each iteration opens a fresh window and closes it again, like a user round trip
+    QBENCHMARK {
+        QMdiSubWindow *window = m_documentManager->openFile(path);
+        QVERIFY(window);
+        delete window;
+    }
+}
+
+void MudoeditBenchmark::highlighter_data()
+{
+    QTest::addColumn<int>("lines");
+
+    QTest::newRow("1k-lines") << 1000;
+    QTest::newRow("10k-lines") << 10000;
+    QTest::newRow("50k-lines") << 50000;
+}
+
+void MudoeditBenchmark::highlighter()
+{
+    QFETCH(int, lines);
+
+    QTextDocument document;
+    document.setPlainText(sampleCode(lines));
+    SyntaxHighlighter syntaxHighlighter(&document);
+
+    QBENCHMARK {
+        syntaxHighlighter.rehighlight();
+    }
+}
+
+void MudoeditBenchmark::typingBurst_data()
+{
+    QTest::addColumn<int>("lines");
+    QTest::addColumn<bool>("outline");
+
+    QTest::newRow("empty") << 0 << false;
+    QTest::newRow("10k-lines") << 10000 << false;
+    QTest::newRow("50k-lines") << 50000 << false;
+    QTest::newRow("50k-lines-outline") << 50000 << true;
+}
+
+void MudoeditBenchmark::typingBurst()
+{
+    QFETCH(int, lines);
+    QFETCH(bool, outline);
+
+    KTextEdit editor;
+    editor.setPlainText(sampleCode(lines));
+    new SyntaxHighlighter(editor.document());
+    if (outline) {
+        DocumentOutline::forEditor(&editor);
+    }
+    editor.resize(800, 600);
+    editor.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&editor));
+
+    // Type in the middle of the document so the layout below the cursor is affected
+    QTextCursor cursor(editor.document()->findBlockByNumber(lines / 2));
+    editor.setTextCursor(cursor);
+
+    const QString burst = QStringLiteral("if (value > 0) { result = compute(value); }\n");
+    QBENCHMARK {
+        QTest::keyClicks(&editor, burst);
+    }
+}
+
+void MudoeditBenchmark::reopenDocuments_data()
+{
+    QTest::addColumn<int>("files");
+
+    QTest::newRow("10-files") << 10;
+    QTest::newRow("50-files") << 50;
+    QTest::newRow("200-files") << 200;
+}
+
+void MudoeditBenchmark::reopenDocuments()
+{
+    QFETCH(int, files);
+
+    const QStringList paths = writeSmallFiles(files);
+    QList<int> tabIndices;
+    for (int i = 0; i < files; ++i) {
+        tabIndices << 0;
+    }
+
+    QSettings settings(QStringLiteral("erateth"), QStringLiteral("mudoedit"));
+    settings.setValue(QStringLiteral("openFiles"), paths);
+    settings.setValue(QStringLiteral("windowGeometries"), QVariantList());
+    settings.setValue(QStringLiteral("tabIndices"), QVariant::fromValue(tabIndices));
+    settings.sync();
+
+    // Closing the restored windows is part of each iteration
+    QBENCHMARK {
+        m_documentManager->reopenDocuments();
+        closeAllDocuments();
+    }
+}
+
+void MudoeditBenchmark::applySettings_data()
+{
+    QTest::addColumn<int>("windows");
+
+    QTest::newRow("10-windows") << 10;
+    QTest::newRow("100-windows") << 100;
+}
+
+void MudoeditBenchmark::applySettings()
+{
+    QFETCH(int, windows);
+
+    openFiles(writeSmallFiles(windows));
+
+    QBENCHMARK {
+        m_settingsManagement->applySettings();
+    }
+}
+
+void MudoeditBenchmark::searchLiteral_data()
+{
+    QTest::addColumn<QString>("needle");
+    QTest::addColumn<bool>("caseSensitive");
+
+    QTest::newRow("short-case-sensitive") << QStringLiteral("ERROR") << true;
+    QTest::newRow("long-case-sensitive") << QStringLiteral("connection reset by peer") << true;
+    QTest::newRow("short-case-insensitive") << QStringLiteral("error") << false;
+    QTest::newRow("long-case-insensitive") << QStringLiteral("Connection Reset By Peer") << false;
+}
+
+void MudoeditBenchmark::searchLiteral()
+{
+    QFETCH(QString, needle);
+    QFETCH(bool, caseSensitive);
+
+    // 64 MB of UTF-16 log text without a match, so every search scans the whole buffer
+    const QString text = m_fileIO->readFile(writeSampleFile(QStringLiteral("search-32m.txt"), 32 * MB, false));
+    const Qt::CaseSensitivity caseSensitivity = caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
+
+    qsizetype position = 0;
+    QBENCHMARK {
+        position = SearchEngine::findLiteral(text, needle, 0, caseSensitivity);
+    }
+    QCOMPARE(position, qsizetype(-1));
+}
+
+void MudoeditBenchmark::replaceAll_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<QString>("replacement");
+    QTest::addColumn<bool>("regularExpression");
+
+    QTest::newRow("literal") << QStringLiteral("INFO") << QStringLiteral("NOTICE") << false;
+    QTest::newRow("regex-captures") << QStringLiteral("worker\\[(\\d+)\\]") << QStringLiteral("thread-\\1") << true;
+}
+
+void MudoeditBenchmark::replaceAll()
+{
+    QFETCH(QString, pattern);
+    QFETCH(QString, replacement);
+    QFETCH(bool, regularExpression);
+
+    // One match per line, about 120000 in total
+    const QString text = m_fileIO->readFile(writeSampleFile(QStringLiteral("replace-8m.txt"), 8 * MB, false));
+    SearchOptions options;
+    options.caseSensitivity = Qt::CaseSensitive;
+    options.regularExpression = regularExpression;
+
+    ReplaceResult result;
+    QBENCHMARK {
+        result = SearchEngine::replaceAll(text, pattern, options, replacement);
+    }
+    QVERIFY(result.count > 100000);
+    QVERIFY(result.ranges.size() > 1);
+
+    // The ranges, applied last to first, give what QString makes of it
+    QString replaced = text;
+    for (auto range = result.ranges.crbegin(); range != result.ranges.crend(); ++range) {
+        replaced.replace(range->start, range->end - range->start, range->text);
+    }
+    QString expected = text;
+    if (regularExpression) {
+        expected.replace(QRegularExpression(pattern), replacement);
+    } else {
+        expected.replace(pattern, replacement);
+    }
+    QCOMPARE(replaced, expected);
+}
+
+void MudoeditBenchmark::quickOpenRanking_data()
+{
+    QTest::addColumn<QString>("query");
+
+    QTest::newRow("file-name") << QStringLiteral("docmgr");
+    QTest::newRow("path") << QStringLiteral("src/core/view");
+    QTest::newRow("rare") << QStringLiteral("zqx");
+}
+
+void MudoeditBenchmark::quickOpenRanking()
+{
+    QFETCH(QString, query);
+
+    // 500k paths shaped like a deep source tree
+    static const QStringList folders = {QStringLiteral("src"), QStringLiteral("core"), QStringLiteral("view"),
+                                        QStringLiteral("widgets"), QStringLiteral("tests"), QStringLiteral("docs"),
+                                        QStringLiteral("plugins"), QStringLiteral("3rdparty")};
+    static const QStringList names = {QStringLiteral("DocumentManager"), QStringLiteral("MainWindow"),
+                                      QStringLiteral("SearchEngine"), QStringLiteral("ViewCache"),
+                                      QStringLiteral("settings_dialog"), QStringLiteral("file-io")};
+    QStringList paths;
+    std::vector<quint64> masks;
+    std::vector<int> nameStarts;
+    paths.reserve(500000);
+    for (int i = 0; i < 500000; ++i) {
+        QString path = QStringLiteral("/home/user/project");
+        for (int depth = 0; depth < 2 + i % 5; ++depth) {
+            path += QLatin1Char('/') + folders.at((i >> (depth * 3)) % folders.size());
+        }
+        path += QLatin1Char('/');
+        nameStarts.push_back(int(path.size()));
+        path += names.at(i % names.size()) + QString::number(i) + QStringLiteral(".cpp");
+        masks.push_back(QuickOpenManager::characterMask(path));
+        paths.append(path);
+    }
+
+    // The same two steps as the palette: mask prefilter, then scoring of the survivors
+    int best = -1;
+    QBENCHMARK {
+        best = -1;
+        const quint64 queryMask = QuickOpenManager::characterMask(query);
+        for (size_t i = 0; i < masks.size(); ++i) {
+            if ((masks[i] & queryMask) == queryMask) {
+                best = qMax(best, QuickOpenManager::fuzzyScore(paths.at(qsizetype(i)), nameStarts[i], query));
+            }
+        }
+    }
+    QVERIFY(best >= -1);
+}
+
+void MudoeditBenchmark::wordCompletion_data()
+{
+    QTest::addColumn<QString>("prefix");
+
+    QTest::newRow("one-letter") << QStringLiteral("i");
+    QTest::newRow("three-letters") << QStringLiteral("ide");
+    QTest::newRow("no-match") << QStringLiteral("zqx");
+}
+
+void MudoeditBenchmark::wordCompletion()
+{
+    QFETCH(QString, prefix);
+
+    // Ten documents of source with 100k distinct identifiers between them
+    WordIndex wordIndex;
+    std::vector<std::unique_ptr<QTextDocument>> documents;
+    for (int i = 0; i < 10; ++i) {
+        QString text = sampleCode(20000);
+        for (int j = 0; j < 10000; ++j) {
+            text += QStringLiteral("identifier%1 = value%2;\n").arg(i * 10000 + j).arg(j % 100);
+        }
+        documents.push_back(std::make_unique<QTextDocument>());
+        documents.back()->setPlainText(text);
+
+        QSignalSpy indexed(&wordIndex, &WordIndex::documentIndexed);
+        wordIndex.addDocument(documents.back().get());
+        QVERIFY(indexed.wait(60000));
+    }
+    QVERIFY(wordIndex.wordCount() > 100000);
+
+    QBENCHMARK {
+        wordIndex.completions(prefix, 50);
+    }
+}
+
+void MudoeditBenchmark::lineOperations_data()
+{
+    QTest::addColumn<int>("operation");
+    QTest::addColumn<QString>("pattern");
+
+    QTest::newRow("sort") << int(LineOperation::Sort) << QString();
+    QTest::newRow("sort-numerically") << int(LineOperation::SortNumerically) << QString();
+    QTest::newRow("sort-by-field") << int(LineOperation::SortByField) << QString();
+    QTest::newRow("unique") << int(LineOperation::Unique) << QString();
+    QTest::newRow("keep-matching") << int(LineOperation::KeepMatching) << QStringLiteral("worker\\[[0-3]\\]");
+}
+
+void MudoeditBenchmark::lineOperations()
+{
+    QFETCH(int, operation);
+    QFETCH(QString, pattern);
+
+    // 2M log lines with repeating ids, so unique has work to do
+    QString text;
+    text.reserve(2000000 * 64);
+    for (int i = 0; i < 2000000; ++i) {
+        const int id = int((quint64(i) * 2654435761u) % 1000000);
+        text += QString::number(id) + QStringLiteral(" 2024-01-01 INFO worker[") + QString::number(i % 16)
+              + QStringLiteral("] request ") + QString::number(id % 5000) + QLatin1Char('\n');
+    }
+
+    LineOperations::Options options;
+    options.operation = LineOperation(operation);
+    options.field = 6;
+    options.pattern = QRegularExpression(pattern);
+
+    LineOperations::Result result;
+    QBENCHMARK {
+        result = LineOperations::process(text, options);
+    }
+    QCOMPARE(result.linesBefore, qsizetype(2000000));
+    QVERIFY(result.linesAfter > 0);
+}
+
+void MudoeditBenchmark::multiCursorTyping_data()
+{
+    QTest::addColumn<int>("cursors");
+
+    QTest::newRow("100") << 100;
+    QTest::newRow("10k") << 10000;
+}
+
+void MudoeditBenchmark::multiCursorTyping()
+{
+    QFETCH(int, cursors);
+
+    KTextEdit textEdit;
+    textEdit.resize(800, 600);
+    QString text;
+    for (int i = 0; i < cursors; ++i) {
+        text += QStringLiteral("    result += compute(item, %1);\n").arg(i);
+    }
+    textEdit.setPlainText(text);
+
+    // One cursor per occurrence, as after Select All Occurrences on "item"
+    QTextCursor cursor(textEdit.document());
+    cursor.setPosition(int(text.indexOf(QStringLiteral("item"))));
+    textEdit.setTextCursor(cursor);
+    MultiCursor *multiCursor = MultiCursor::forEditor(&textEdit);
+    multiCursor->selectAllOccurrences();
+    QCOMPARE(multiCursor->cursorCount(), cursors);
+
+    // Every keystroke is one edit block over all cursors
+    QBENCHMARK {
+        multiCursor->insertText(QStringLiteral("x"));
+    }
+    QCOMPARE(multiCursor->cursorCount(), cursors);
+}
+
+void MudoeditBenchmark::textDiff_data()
+{
+    QTest::addColumn<int>("edits");
+    QTest::addColumn<int>("reversed");
+
+    QTest::newRow("10 edits") << 10 << 0;
+    QTest::newRow("10k edits") << 10000 << 0;
+
+    // Lines that occur on both sides in another order go through Myers' algorithm, and a
+    // long reversed run costs more than one split may spend
+    QTest::newRow("reversed block") << 0 << 5000;
+}
+
+void MudoeditBenchmark::textDiff()
+{
+    QFETCH(int, edits);
+    QFETCH(int, reversed);
+
+    // 1M distinct lines, then the same with lines changed, inserted and removed all over
+    std::vector<size_t> oldLines;
+    oldLines.reserve(1000000);
+    for (int i = 0; i < 1000000; ++i) {
+        oldLines.push_back(TextDiff::hashLine(QStringLiteral("line %1 of the old text").arg(i)));
+    }
+    std::vector<size_t> newLines = oldLines;
+    for (int i = 0; i < edits; ++i) {
+        const size_t position = size_t((quint64(i) * 2654435761u) % newLines.size());
+        if (i % 3 == 0) {
+            newLines[position] = TextDiff::hashLine(QStringLiteral("changed line %1").arg(i));
+        } else if (i % 3 == 1) {
+            newLines.insert(newLines.begin() + qsizetype(position), TextDiff::hashLine(QStringLiteral("new line %1").arg(i)));
+        } else {
+            newLines.erase(newLines.begin() + qsizetype(position));
+        }
+    }
+    std::reverse(newLines.begin() + 500000, newLines.begin() + 500000 + reversed);
+
+    QList<TextDiff::Hunk> hunks;
+    QBENCHMARK {
+        hunks = TextDiff::compute(oldLines, newLines);
+    }
+    QVERIFY(!hunks.isEmpty());
+    QVERIFY(hunks.size() <= edits + reversed);
+
+    // Replacing the hunks must turn the old lines into the new ones, so the lines between
+    // them have to be the same on both sides
+    std::vector<size_t> applied;
+    applied.reserve(newLines.size());
+    int oldLine = 0;
+    for (const TextDiff::Hunk &hunk : std::as_const(hunks)) {
+        QVERIFY(hunk.oldStart >= oldLine);
+        applied.insert(applied.end(), oldLines.begin() + oldLine, oldLines.begin() + hunk.oldStart);
+        QCOMPARE(qsizetype(applied.size()), qsizetype(hunk.newStart));
+        applied.insert(applied.end(), newLines.begin() + hunk.newStart, newLines.begin() + hunk.newStart + hunk.newCount);
+        oldLine = hunk.oldStart + hunk.oldCount;
+    }
+    QVERIFY(oldLine <= int(oldLines.size()));
+    applied.insert(applied.end(), oldLines.begin() + oldLine, oldLines.end());
+    QVERIFY(applied == newLines);
+}
+
+void MudoeditBenchmark::asciiPrefix()
+{
+    // One byte with the top bit set at every position of buffers a few vectors long, or none
+    for (int size = 0; size <= 70; ++size) {
+        for (int position = -1; position < size; ++position) {
+            QByteArray bytes(size, 'a');
+            if (position >= 0) {
+                bytes[position] = char(0x80 | (position & 0x7F));
+            }
+            QCOMPARE(EncodingDetector::asciiPrefix(bytes), asciiPrefixReference(bytes));
+            QCOMPARE(EncodingDetector::asciiPrefix(bytes), qsizetype(position >= 0 ? position : size));
+        }
+    }
+}
+
+void MudoeditBenchmark::validUtf8_data()
+{
+    QTest::addColumn<QByteArray>("sequence");
+    QTest::addColumn<bool>("valid");
+
+    QTest::newRow("two bytes") << QByteArray("\xC3\xA9") << true;
+    QTest::newRow("three bytes") << QByteArray("\xE2\x82\xAC") << true;
+    QTest::newRow("four bytes") << QByteArray("\xF0\x9F\x98\x80") << true;
+    QTest::newRow("last code point") << QByteArray("\xF4\x8F\xBF\xBF") << true;
+    QTest::newRow("before surrogates") << QByteArray("\xED\x9F\xBF") << true;
+    QTest::newRow("after surrogates") << QByteArray("\xEE\x80\x80") << true;
+    QTest::newRow("overlong two bytes") << QByteArray("\xC0\xAF") << false;
+    QTest::newRow("overlong two bytes, highest") << QByteArray("\xC1\xBF") << false;
+    QTest::newRow("overlong three bytes") << QByteArray("\xE0\x80\xAF") << false;
+    QTest::newRow("overlong three bytes, highest") << QByteArray("\xE0\x9F\xBF") << false;
+    QTest::newRow("overlong four bytes") << QByteArray("\xF0\x80\x80\xAF") << false;
+    QTest::newRow("overlong four bytes, highest") << QByteArray("\xF0\x8F\xBF\xBF") << false;
+    QTest::newRow("first surrogate") << QByteArray("\xED\xA0\x80") << false;
+    QTest::newRow("last surrogate") << QByteArray("\xED\xBF\xBF") << false;
+    QTest::newRow("past last code point") << QByteArray("\xF4\x90\x80\x80") << false;
+    QTest::newRow("lead byte F5") << QByteArray("\xF5\x80\x80\x80") << false;
+    QTest::newRow("lone continuation") << QByteArray("\x80") << false;
+    QTest::newRow("bad continuation") << QByteArray("\xE2\x28\xA1") << false;
+    QTest::newRow("truncated two bytes") << QByteArray("\xC3") << false;
+    QTest::newRow("truncated three bytes") << QByteArray("\xE2\x82") << false;
+    QTest::newRow("truncated four bytes") << QByteArray("\xF0\x9F\x98") << false;
+}
+
+void MudoeditBenchmark::validUtf8()
+{
+    QFETCH(QByteArray, sequence);
+    QFETCH(bool, valid);
+
+    // Behind ASCII of every length, so the sequence starts in every lane and straddles vectors;
+    // at the very end for truncated sequences, and followed by more ASCII
+    for (int padding = 0; padding <= 40; ++padding) {
+        const QByteArray atEnd = QByteArray(padding, 'a') + sequence;
+        QCOMPARE(EncodingDetector::isValidUtf8(atEnd), valid);
+        QCOMPARE(EncodingDetector::isValidUtf8(atEnd), isValidUtf8Reference(atEnd));
+        QCOMPARE(EncodingDetector::asciiPrefix(atEnd), asciiPrefixReference(atEnd));
+
+        const QByteArray inside = atEnd + QByteArray(padding, 'b');
+        QCOMPARE(EncodingDetector::isValidUtf8(inside), isValidUtf8Reference(inside));
+    }
+}
+
+void MudoeditBenchmark::countLineBreaks()
+{
+    // Line breaks at every offset, so a CRLF falls on both sides of every lane boundary
+    const QString breaks[] = {
+        QStringLiteral("\r\n"), QStringLiteral("\n"), QStringLiteral("\r"), QStringLiteral("\r\r\n"),
+        QStringLiteral("\n\r"), QStringLiteral("\r\n\r\n"), QStringLiteral("\n\n\r\n")
+    };
+    for (const QString &lineBreak : breaks) {
+        for (int before = 0; before <= 40; ++before) {
+            for (int after = 0; after <= 20; ++after) {
+                const QString text = QString(before, QLatin1Char('x')) + lineBreak + QString(after, QLatin1Char('y'));
+                qsizetype lineFeeds = -1;
+                qsizetype crlfs = -1;
+                qsizetype expectedLineFeeds = -1;
+                qsizetype expectedCrlfs = -1;
+                EncodingDetector::countLineBreaks(text, &lineFeeds, &crlfs);
+                countLineBreaksReference(text, &expectedLineFeeds, &expectedCrlfs);
+                QCOMPARE(lineFeeds, expectedLineFeeds);
+                QCOMPARE(crlfs, expectedCrlfs);
+            }
+        }
+    }
+}
+
+QString MudoeditBenchmark::writeSampleFile(const QString &name, qint64 bytes, bool unicode)
+{
+    const QString path = m_dataDir.filePath(name);
+    if (QFile::exists(path)) {
+        return path;
+    }
+
+    const QByteArray line = unicode
+        ? QByteArrayLiteral("Grüße aus Zürich — 東京 ログ行 ünïcødé payload 0123456789\n")
+        : QByteArrayLiteral("2024-01-01 12:00:00 INFO worker[42] processed request id=0123456789\n");
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not create sample file" << path;
+        return path;
+    }
+    for (qint64 written = 0; written < bytes; written += line.size()) {
+        file.write(line);
+    }
+    return path;
+}
+
+QStringList MudoeditBenchmark::writeSmallFiles(int count)
+{
+    QStringList paths;
+    for (int i = 0; i < count; ++i) {
+        paths << writeSampleFile(QStringLiteral("small-%1.txt").arg(i), 16 * KB, false);
+    }
+    return paths;
+}
+
+void MudoeditBenchmark::openFiles(const QStringList &paths)
+{
+    for (const QString &path : paths) {
+        QVERIFY(m_documentManager->openFile(path));
+    }
+}
+
+void MudoeditBenchmark::closeAllDocuments()
+{
+    for (int i = 0; i < m_tabWidget->count(); ++i) {
+        if (QMdiArea *mdiArea = mdiAreaOf(m_tabWidget, i)) {
+            qDeleteAll(mdiArea->subWindowList());
+        }
+    }
+}
+
+QString MudoeditBenchmark::sampleCode(int lines)
+{
+    static const QString snippet[] = {
+        QStringLiteral("#include <QString>"),
+        QStringLiteral("class Parser : public QObject // parses input"),
+        QStringLiteral("{"),
+        QStringLiteral("public:"),
+        QStringLiteral("    explicit Parser(const QString &name);"),
+        QStringLiteral("    static int parse(const char *input) { return decode(\"value\", input); }"),
+        QStringLiteral("};"),
+        QString()
+    };
+    constexpr int snippetLines = sizeof(snippet) / sizeof(snippet[0]);
+
+    QString text;
+    for (int i = 0; i < lines; ++i) {
+        text += snippet[i % snippetLines];
+        text += QLatin1Char('\n');
+    }
+    return text;
+}
+
+int main(int argc, char *argv[])
+{
+    // Keep the benchmarks away from the user's session, settings and display
+    QTemporaryDir configDir;
+    qputenv("XDG_CONFIG_HOME", configDir.path().toLocal8Bit());
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+    QStandardPaths::setTestModeEnabled(true);
+
+    MudoeditBenchmark benchmark;
+    return QTest::qExec(&benchmark, argc, argv);
+}
@@ -0,0 +1,104 @@
+#ifndef MUDOEDITBENCHMARK_H
+#define MUDOEDITBENCHMARK_H
+
+#include <QObject>
+#include <QTemporaryDir>
+#include <QStringList>
+
+class QTabWidget;
+class QSettings;
+class MainWindow;
+class FileIO;
+class DocumentManager;
+class SettingsManagement;
+
+// QTest benchmarks for the hot paths of the editor: file I/O, opening documents,
+// highlighting, typing, session restore and applying settings, with correctness
+// checks for the vectorized code they rely on
+class MudoeditBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    // Create the sample files and the editor components under test
+    void initTestCase();
+    void cleanupTestCase();
+
+    // Close every document opened by the previous benchmark
+    void cleanup();
+
+    void readFile_data();
+    void readFile();
+
+    void writeFile_data();
+    void writeFile();
+
+    void writeDocument_data();
+    void writeDocument();
+
+    void openFile_data();
+    void openFile();
+
+    void highlighter_data();
+    void highlighter();
+
+    void typingBurst_data();
+    void typingBurst();
+
+    void reopenDocuments_data();
+    void reopenDocuments();
+
+    void applySettings_data();
+    void applySettings();
+
+    void searchLiteral_data();
+    void searchLiteral();
+
+    void replaceAll_data();
+    void replaceAll();
+
+    void quickOpenRanking_data();
+    void quickOpenRanking();
+
+    void wordCompletion_data();
+    void wordCompletion();
+
+    void lineOperations_data();
+    void lineOperations();
+
+    void multiCursorTyping_data();
+    void multiCursorTyping();
+
+    void textDiff_data();
+    void textDiff();
+
+    // The vectorized encoding checks against byte by byte references, at every alignment
+    void asciiPrefix();
+    void validUtf8_data();
+    void validUtf8();
+    void countLineBreaks();
+
+private:
+    // Write a sample text file of roughly the given size and return its path
+    QString writeSampleFile(const QString &name, qint64 bytes, bool unicode);
+
+    // Open the given number of small files in the first tab
+    QStringList writeSmallFiles(int count);
+    void openFiles(const QStringList &paths);
+
+    // Close all documents in all tabs
+    void closeAllDocuments();
+
+    // Generate source-like text for highlighting and typing benchmarks
+    static QString sampleCode(int lines);
+
+    QTemporaryDir m_dataDir;
+    MainWindow *m_mainWindow = nullptr;
+    QTabWidget *m_tabWidget = nullptr;
+    QSettings *m_settings = nullptr;
+    FileIO *m_fileIO = nullptr;
+    SettingsManagement *m_settingsManagement = nullptr;
+    DocumentManager *m_documentManager = nullptr;
+};
+
+#endif // MUDOEDITBENCHMARK_H
@@ -1,5 +1,6 @@
 #include "AutoSaveManager.h"
 #include "DocumentManager.h"
+#include "ClipboardTransfer.h"
 #include <QTabWidget>
 #include <QMdiArea>
 #include <QMdiSubWindow>
@@ -72,10 +73,24 @@ void AutoSaveManager::autoSave()
             KTextEdit *textEdit = qobject_cast<KTextEdit*>(window->widget());
             if (textEdit && textEdit->document()->isModified())
             {
+                // Leave files changed on disk to the user rather than overwrite them
+                if (window->property("externallyModified").toBool())
+                {
+                    qCDebug(autoSaveLog) << "Skipping file changed on disk:" << window->property("fullFilePath").toString();
+                    continue;
+                }
+
+                // Saved on the next round, once the paste is done
+                if (ClipboardTransfer::isPasting(textEdit))
+                {
+                    qCDebug(autoSaveLog) << "Skipping file being pasted into:" << window->property("fullFilePath").toString();
+                    continue;
+                }
+
                 QString filePath = window->property("fullFilePath").toString();
                 if (!filePath.isEmpty() && filePath != i18n("Untitled"))
                 {
-                    if (m_documentManager->saveFile())
+                    if (m_documentManager->saveWindow(window))
                     {
                         qCDebug(autoSaveLog) << "Autosaved file:" << filePath;
                     }
@@ -0,0 +1,46 @@
+#include "BlockChange.h"
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+
+BlockChange BlockChange::fromEdit(const QTextDocument *document, int position, int charsAdded, int oldBlockCount)
+{
+    const int first = document->findBlock(position).blockNumber();
+    const QTextBlock lastBlock = document->findBlock(position + charsAdded);
+    const int lastNew = lastBlock.isValid() ? lastBlock.blockNumber() : document->blockCount() - 1;
+    const int newCount = lastNew - first + 1;
+    const int oldCount = newCount - (document->blockCount() - oldBlockCount);
+
+    BlockChange change;
+    if (first >= 0 && newCount >= 1 && oldCount >= 1 && first + oldCount <= oldBlockCount) {
+        change.m_first = first;
+        change.m_oldCount = oldCount;
+        change.m_newCount = newCount;
+    }
+    return change;
+}
+
+QString BlockChange::copyBlocks(const QTextBlock &first, const QTextBlock &last)
+{
+    QTextCursor cursor(first);
+    cursor.setPosition(last.position() + last.length() - 1, QTextCursor::KeepAnchor);
+    return cursor.selectedText();
+}
+
+int BlockChange::mapBlock(int block) const
+{
+    if (block < m_first) return block;
+    if (block >= m_first + m_oldCount) return block + delta();
+    return qMin(block, lastNew());
+}
+
+void BlockChange::mergeDirty(int *dirtyFirst, int *dirtyLast) const
+{
+    if (*dirtyFirst < 0) {
+        *dirtyFirst = m_first;
+        *dirtyLast = lastNew();
+    } else {
+        *dirtyFirst = qMin(mapBlock(*dirtyFirst), m_first);
+        *dirtyLast = qMax(mapBlock(*dirtyLast), lastNew());
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef BLOCKCHANGE_H
+#define BLOCKCHANGE_H
+
+#include <QString>
+#include <vector>
+
+class QTextBlock;
+class QTextDocument;
+
+// This class describes an edit of a document by the blocks it replaced: the old blocks from
+// the first one on became the new blocks up to the last one. Views that keep state per block
+// use it to splice that state and to move the blocks waiting for a scan along with the edit,
+// so only the edited blocks are copied and scanned again
+class BlockChange
+{
+public:
+    // The change of a contentsChange signal of a document that had oldBlockCount blocks
+    // before it; invalid if the blocks cannot be matched up and the whole document needs a scan
+    static BlockChange fromEdit(const QTextDocument *document, int position, int charsAdded, int oldBlockCount);
+
+    // Copy the text of the blocks from first to last. Block separators come out as paragraph
+    // separators, so the copy splits into its blocks with QStringView::split
+    static QString copyBlocks(const QTextBlock &first, const QTextBlock &last);
+
+    bool isValid() const { return m_first >= 0; }
+    int first() const { return m_first; }
+    int oldCount() const { return m_oldCount; }
+    int lastNew() const { return m_first + m_newCount - 1; }
+    int delta() const { return m_newCount - m_oldCount; }
+
+    // Where a block is after the edit; blocks within the edit stay within it
+    int mapBlock(int block) const;
+
+    // Move a range of blocks waiting for a scan, or -1, along with the edit and add the edited blocks
+    void mergeDirty(int *dirtyFirst, int *dirtyLast) const;
+
+    // Insert or remove per-block values at the edit, so they line up with the blocks again
+    template<typename T>
+    void splice(std::vector<T> &values) const
+    {
+        const auto first = values.begin() + m_first;
+        if (delta() > 0) {
+            values.insert(first, size_t(delta()), T());
+        } else if (delta() < 0) {
+            values.erase(first, first + (-delta()));
+        }
+    }
+
+private:
+    int m_first = -1;
+    int m_oldCount = 0;
+    int m_newCount = 0;
+};
+
+#endif // BLOCKCHANGE_H
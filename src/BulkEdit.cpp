@@ -0,0 +1,71 @@
+#include "BulkEdit.h"
+#include "ClipboardTransfer.h"
+#include <QScrollBar>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QLoggingCategory>
+#include <KTextEdit>
+
+Q_LOGGING_CATEGORY(bulkEditLog, "mudoedit.bulkedit")
+
+bool BulkEdit::replaceRange(KTextEdit *textEdit, int start, int end, const QString &text)
+{
+    return replaceRanges(textEdit, {{start, end, text}});
+}
+
+bool BulkEdit::replaceRanges(KTextEdit *textEdit, const std::vector<Replacement> &replacements)
+{
+    // The paste holds an edit block open; an edit now would land inside its undo step
+    if (ClipboardTransfer::isPasting(textEdit)) {
+        qCDebug(bulkEditLog) << "Not replacing while a paste is running";
+        return false;
+    }
+    if (replacements.empty()) return true;
+
+    QTextDocument *document = textEdit->document();
+    const int cursorPosition = textEdit->textCursor().position();
+    const int scrollPosition = textEdit->verticalScrollBar()->value();
+
+    // Repainting in between would only show a half-applied edit
+    textEdit->setUpdatesEnabled(false);
+
+    // Last to first, so the positions of the ranges still to come stay valid
+    ClipboardTransfer::detach(document);
+    QTextCursor cursor(document);
+    cursor.beginEditBlock();
+    for (auto replacement = replacements.crbegin(); replacement != replacements.crend(); ++replacement) {
+        cursor.setPosition(replacement->start);
+        cursor.setPosition(replacement->end, QTextCursor::KeepAnchor);
+        cursor.insertText(replacement->text);
+    }
+    cursor.endEditBlock();
+
+    // Keep the cursor on the same text: ranges before it move it by their change in length,
+    // and inside a range it goes to the end of the new text
+    int newPosition = cursorPosition;
+    qint64 replaced = 0;
+    qint64 inserted = 0;
+    for (const Replacement &replacement : replacements) {
+        if (cursorPosition >= replacement.end) {
+            newPosition += int(replacement.text.size()) - (replacement.end - replacement.start);
+        } else if (cursorPosition > replacement.start) {
+            newPosition = replacement.start + int(replacement.text.size()) + (newPosition - cursorPosition);
+            break;
+        } else {
+            break;
+        }
+    }
+    for (const Replacement &replacement : replacements) {
+        replaced += replacement.end - replacement.start;
+        inserted += replacement.text.size();
+    }
+    QTextCursor newCursor(document);
+    newCursor.setPosition(qBound(0, newPosition, document->characterCount() - 1));
+    textEdit->setTextCursor(newCursor);
+    textEdit->verticalScrollBar()->setValue(scrollPosition);
+
+    textEdit->setUpdatesEnabled(true);
+
+    qCDebug(bulkEditLog) << "Replaced" << replaced << "characters in" << replacements.size() << "ranges with" << inserted;
+    return true;
+}
@@ -0,0 +1,31 @@
+#ifndef BULKEDIT_H
+#define BULKEDIT_H
+
+#include <QString>
+#include <vector>
+
+class KTextEdit;
+
+// This class applies edits that change large parts of a document at once. Each range
+// of new text is inserted with a single cursor operation, all in one edit block, so the
+// document is laid out once and the whole change is one undo step
+class BulkEdit
+{
+public:
+    // Characters between start and end that are replaced by text
+    struct Replacement {
+        int start;
+        int end;
+        QString text;
+    };
+
+    // Replace the characters between start and end with new text, keeping the cursor
+    // and the scroll position as close as possible to where they were. Nothing is
+    // changed, and false returned, while a paste is running in the editor
+    static bool replaceRange(KTextEdit *textEdit, int start, int end, const QString &text);
+
+    // The same for several ranges in order that do not overlap
+    static bool replaceRanges(KTextEdit *textEdit, const std::vector<Replacement> &replacements);
+};
+
+#endif // BULKEDIT_H
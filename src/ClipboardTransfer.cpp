@@ -0,0 +1,328 @@
+#include "ClipboardTransfer.h"
+#include <QApplication>
+#include <QClipboard>
+#include <QKeyEvent>
+#include <QMimeData>
+#include <QMouseEvent>
+#include <QProgressDialog>
+#include <QTextDocument>
+#include <QTimer>
+#include <QLoggingCategory>
+#include <KLocalizedString>
+#include <KTextEdit>
+
+Q_LOGGING_CATEGORY(clipboardTransferLog, "mudoedit.clipboardtransfer")
+
+namespace {
+
+// The text of a range as a copy from the editor would have it
+QString plainText(QTextDocument *document, int start, int end)
+{
+    QTextCursor cursor(document);
+    cursor.setPosition(start);
+    cursor.setPosition(end, QTextCursor::KeepAnchor);
+    QString text = cursor.selectedText();
+    for (QChar &character : text) {
+        if (character == QChar::ParagraphSeparator || character == QChar::LineSeparator) {
+            character = QLatin1Char('\n');
+        } else if (character == QChar::Nbsp) {
+            character = QLatin1Char(' ');
+        }
+    }
+    return text;
+}
+
+// Clipboard data that reads a range of a document only when another application or a
+// paste asks for it. It offers plain text only; rich formats of a huge selection are
+// rarely wanted and would each be another full copy
+class LazyMimeData : public QMimeData
+{
+public:
+    LazyMimeData(QTextDocument *document, int start, int end)
+        : m_document(document),
+          m_start(start),
+          m_end(end),
+          m_revision(document->revision())
+    {
+    }
+
+    QTextDocument* document() const { return m_document; }
+
+    QStringList formats() const override
+    {
+        return QStringList() << QStringLiteral("text/plain;charset=utf-8") << QStringLiteral("text/plain");
+    }
+
+    bool hasFormat(const QString &mimeType) const override
+    {
+        return formats().contains(mimeType);
+    }
+
+    // Copy the text out of the document; after this the document may change freely
+    void detach() const
+    {
+        if (!m_document) return;
+
+        // A change that nobody detached us for; better no text than the wrong one
+        if (m_document->revision() != m_revision) {
+            qCWarning(clipboardTransferLog) << "The copied document changed before the clipboard was detached";
+        } else {
+            m_text = plainText(m_document, m_start, m_end);
+        }
+        m_document = nullptr;
+    }
+
+protected:
+    QVariant retrieveData(const QString &mimeType, QMetaType type) const override
+    {
+        Q_UNUSED(type)
+        if (!hasFormat(mimeType)) return QVariant();
+
+        // Asked for while the document is unchanged: read it without keeping a copy
+        if (m_document && m_document->revision() == m_revision) {
+            return plainText(m_document, m_start, m_end);
+        }
+        detach();
+        return m_text;
+    }
+
+private:
+    mutable QPointer<QTextDocument> m_document;
+    int m_start;
+    int m_end;
+    int m_revision;
+    mutable QString m_text;
+};
+
+// Whether a key changes the text of the editor that receives it
+bool editsText(QKeyEvent *event)
+{
+    if (event->matches(QKeySequence::Copy)) return false;
+    if (event->matches(QKeySequence::Cut) || event->matches(QKeySequence::Paste)
+        || event->matches(QKeySequence::Undo) || event->matches(QKeySequence::Redo)) {
+        return true;
+    }
+    switch (event->key()) {
+    case Qt::Key_Backspace:
+    case Qt::Key_Delete:
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+    case Qt::Key_Tab:
+    case Qt::Key_Backtab:
+        return true;
+    default:
+        break;
+    }
+    const QString text = event->text();
+    return !text.isEmpty() && text.at(0).isPrint();
+}
+
+} // namespace
+
+void ClipboardTransfer::attach(KTextEdit *textEdit)
+{
+    forEditor(textEdit);
+}
+
+ClipboardTransfer* ClipboardTransfer::forEditor(KTextEdit *textEdit)
+{
+    ClipboardTransfer *transfer = textEdit->findChild<ClipboardTransfer*>(QString(), Qt::FindDirectChildrenOnly);
+    if (!transfer) {
+        transfer = new ClipboardTransfer(textEdit);
+    }
+    return transfer;
+}
+
+bool ClipboardTransfer::isPasting(const KTextEdit *textEdit)
+{
+    const ClipboardTransfer *transfer = textEdit->findChild<ClipboardTransfer*>(QString(), Qt::FindDirectChildrenOnly);
+    return transfer && transfer->isPasting();
+}
+
+void ClipboardTransfer::detach(QTextDocument *document)
+{
+    const LazyMimeData *mimeData = dynamic_cast<const LazyMimeData*>(QApplication::clipboard()->mimeData());
+    if (mimeData && mimeData->document() == document) {
+        QElapsedTimer timer;
+        timer.start();
+        mimeData->detach();
+        qCDebug(clipboardTransferLog) << "Detached the clipboard from its document in" << timer.elapsed() << "ms";
+    }
+}
+
+ClipboardTransfer::ClipboardTransfer(KTextEdit *textEdit)
+    : QObject(textEdit),
+      m_textEdit(textEdit),
+      m_pastePosition(0),
+      m_wasReadOnly(false)
+{
+    m_textEdit->installEventFilter(this);
+    m_textEdit->viewport()->installEventFilter(this);
+}
+
+ClipboardTransfer::~ClipboardTransfer()
+{
+    delete m_progressDialog;
+}
+
+void ClipboardTransfer::copy()
+{
+    const QTextCursor cursor = m_textEdit->textCursor();
+    if (cursor.selectionEnd() - cursor.selectionStart() < LARGE_TEXT_CHARACTERS) {
+        m_textEdit->copy();
+        return;
+    }
+
+    // Whatever an earlier copy left on the clipboard is replaced, so it needs no detaching
+    QApplication::clipboard()->setMimeData(new LazyMimeData(m_textEdit->document(), cursor.selectionStart(),
+                                                            cursor.selectionEnd()));
+    qCDebug(clipboardTransferLog) << "Copied" << (cursor.selectionEnd() - cursor.selectionStart())
+                                  << "characters on request";
+}
+
+void ClipboardTransfer::cut()
+{
+    QTextCursor cursor = m_textEdit->textCursor();
+    if (m_textEdit->isReadOnly() || cursor.selectionEnd() - cursor.selectionStart() < LARGE_TEXT_CHARACTERS) {
+        m_textEdit->cut();
+        return;
+    }
+
+    // The text is about to go, so it is copied now, but as plain text only
+    detach(m_textEdit->document());
+    QMimeData *mimeData = new QMimeData;
+    mimeData->setText(plainText(m_textEdit->document(), cursor.selectionStart(), cursor.selectionEnd()));
+    QApplication::clipboard()->setMimeData(mimeData);
+    cursor.removeSelectedText();
+    m_textEdit->setTextCursor(cursor);
+}
+
+void ClipboardTransfer::paste()
+{
+    if (isPasting() || m_textEdit->isReadOnly()) return;
+
+    // Text copied from this document has to be taken out before it changes anyway
+    detach(m_textEdit->document());
+
+    // Images and other data are left to the editor
+    const QMimeData *mimeData = QApplication::clipboard()->mimeData();
+    if (!mimeData || !mimeData->hasText()) {
+        m_textEdit->paste();
+        return;
+    }
+    QString text = mimeData->text();
+    if (text.size() < LARGE_TEXT_CHARACTERS) {
+        m_textEdit->paste();
+        return;
+    }
+
+    m_pasteText = std::move(text);
+    m_pastePosition = 0;
+    m_timer.start();
+
+    // Nothing may paint or type into the document while the edit block is open
+    m_wasReadOnly = m_textEdit->isReadOnly();
+    m_textEdit->setReadOnly(true);
+    m_textEdit->setUpdatesEnabled(false);
+    m_pasteCursor = m_textEdit->textCursor();
+    m_pasteCursor.beginEditBlock();
+    m_pasteCursor.removeSelectedText();
+
+    m_progressDialog = new QProgressDialog(i18n("Pasting %1 characters...", QLocale().toString(m_pasteText.size())),
+                                           i18n("Cancel"), 0, 1000, m_textEdit->window());
+    m_progressDialog->setWindowTitle(i18n("Paste"));
+    // Keep the user from saving, closing or editing the window until the paste is done
+    m_progressDialog->setWindowModality(Qt::WindowModal);
+    m_progressDialog->setMinimumDuration(300);
+    m_progressDialog->setAutoClose(false);
+    m_progressDialog->setAutoReset(false);
+    m_progressDialog->setValue(0);
+    connect(m_progressDialog, &QProgressDialog::canceled, this, [this]() {
+        finishPaste(true);
+    });
+
+    QTimer::singleShot(0, this, &ClipboardTransfer::pasteNextChunk);
+}
+
+void ClipboardTransfer::pasteNextChunk()
+{
+    if (!isPasting()) return;
+
+    const qsizetype size = m_pasteText.size();
+    qsizetype length = qMin<qsizetype>(PASTE_CHUNK_CHARACTERS, size - m_pastePosition);
+
+    // Keep a surrogate pair, and a \r\n line break, within one chunk
+    if (m_pastePosition + length < size) {
+        const QChar last = m_pasteText.at(m_pastePosition + length - 1);
+        if (last.isHighSurrogate() || last == QLatin1Char('\r')) {
+            ++length;
+        }
+    }
+    m_pasteCursor.insertText(m_pasteText.mid(m_pastePosition, length));
+    m_pastePosition += length;
+
+    if (m_progressDialog) {
+        m_progressDialog->setValue(int(m_pastePosition * 1000 / size));
+    }
+    if (m_pastePosition < size) {
+        QTimer::singleShot(0, this, &ClipboardTransfer::pasteNextChunk);
+    } else {
+        finishPaste(false);
+    }
+}
+
+void ClipboardTransfer::finishPaste(bool cancelled)
+{
+    if (!isPasting()) return;
+
+    m_pasteCursor.endEditBlock();
+    if (cancelled) {
+        m_textEdit->document()->undo();
+    }
+    m_textEdit->setReadOnly(m_wasReadOnly);
+    m_textEdit->setUpdatesEnabled(true);
+    if (!cancelled) {
+        m_textEdit->setTextCursor(m_pasteCursor);
+        m_textEdit->ensureCursorVisible();
+    }
+
+    qCDebug(clipboardTransferLog) << (cancelled ? "Cancelled paste after" : "Pasted") << m_pastePosition
+                                  << "characters in" << m_timer.elapsed() << "ms";
+
+    if (m_progressDialog) {
+        m_progressDialog->hide();
+        m_progressDialog->deleteLater();
+    }
+    m_pasteText = QString();
+    m_pasteCursor = QTextCursor();
+}
+
+bool ClipboardTransfer::eventFilter(QObject *watched, QEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::KeyPress:
+        if (watched == m_textEdit && editsText(static_cast<QKeyEvent*>(event))) {
+            detach(m_textEdit->document());
+        }
+        break;
+    case QEvent::InputMethod:
+    case QEvent::Drop:
+        detach(m_textEdit->document());
+        break;
+    case QEvent::MouseButtonRelease:
+        // Pasting the selection with the middle button
+        if (static_cast<QMouseEvent*>(event)->button() == Qt::MiddleButton) {
+            detach(m_textEdit->document());
+        }
+        break;
+    case QEvent::Hide:
+        // Hidden documents may be closed, reloaded or unloaded without passing through here
+        if (watched == m_textEdit) {
+            detach(m_textEdit->document());
+        }
+        break;
+    default:
+        break;
+    }
+    return QObject::eventFilter(watched, event);
+}
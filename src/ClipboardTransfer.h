@@ -0,0 +1,79 @@
+#ifndef CLIPBOARDTRANSFER_H
+#define CLIPBOARDTRANSFER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QString>
+#include <QTextCursor>
+
+class QProgressDialog;
+class QTextDocument;
+class KTextEdit;
+
+// This class moves large texts between an editor and the clipboard. A large selection is
+// not copied up front: the clipboard gets data that reads the text from the document
+// when it is asked for, and only copies it out once the document is about to change.
+// A large paste is inserted as plain text in chunks, with progress, in one edit block,
+// so it is one undo step and the document is laid out once at the end
+class ClipboardTransfer : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Handle the clipboard of an editor; does nothing if it is already handled
+    static void attach(KTextEdit *textEdit);
+
+    // Get the clipboard handling of an editor, creating it on first use
+    static ClipboardTransfer* forEditor(KTextEdit *textEdit);
+
+    // Copy the text of whatever the clipboard holds from a document before it changes;
+    // every edit made outside the editor's own key handling calls this first
+    static void detach(QTextDocument *document);
+
+    // Whether a chunked paste is running in an editor, without creating its handling. The
+    // paste keeps an edit block open, so the document must not be saved, unloaded, reloaded
+    // or edited by anything else until it is done
+    static bool isPasting(const KTextEdit *textEdit);
+
+    ~ClipboardTransfer() override;
+
+    // Small selections and pastes go through the editor as usual
+    void copy();
+    void cut();
+    void paste();
+
+    // Whether a chunked paste is running
+    bool isPasting() const { return !m_pasteText.isNull(); }
+
+protected:
+    // Detach the clipboard before typing, dropping or hiding the editor changes the document
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    explicit ClipboardTransfer(KTextEdit *textEdit);
+
+    // Insert the next chunk of the paste, then yield to the event loop
+    void pasteNextChunk();
+
+    // Close the edit block of the paste; a cancelled paste is undone as a whole
+    void finishPaste(bool cancelled);
+
+    KTextEdit *m_textEdit;
+
+    // The paste that is running, where it got to and where it goes
+    QString m_pasteText;
+    qsizetype m_pastePosition;
+    QTextCursor m_pasteCursor;
+    QPointer<QProgressDialog> m_progressDialog;
+    bool m_wasReadOnly;
+    QElapsedTimer m_timer;
+
+    // Selections and pastes from this size on take the large path
+    static const int LARGE_TEXT_CHARACTERS = 1 << 20;
+
+    // Characters inserted per chunk of a paste
+    static const int PASTE_CHUNK_CHARACTERS = 1 << 20;
+};
+
+#endif // CLIPBOARDTRANSFER_H
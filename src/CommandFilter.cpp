@@ -0,0 +1,301 @@
+#include "CommandFilter.h"
+#include "BulkEdit.h"
+#include "ClipboardTransfer.h"
+#include "MemoryBudgetManager.h"
+#include <QFileInfo>
+#include <QInputDialog>
+#include <QLocale>
+#include <QLoggingCategory>
+#include <QMdiArea>
+#include <QMdiSubWindow>
+#include <QProgressDialog>
+#include <QSettings>
+#include <QSplitter>
+#include <QTabWidget>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <KLocalizedString>
+#include <KMessageBox>
+#include <KTextEdit>
+
+Q_LOGGING_CATEGORY(commandFilterLog, "mudoedit.commandfilter")
+
+CommandFilter::CommandFilter(QTabWidget *tabWidget, QObject *parent)
+    : QObject(parent),
+      m_tabWidget(tabWidget),
+      m_process(nullptr),
+      m_progressDialog(nullptr),
+      m_start(0),
+      m_end(0),
+      m_inputPosition(0),
+      m_revision(0),
+      m_wasReadOnly(false),
+      m_inputEndsWithNewline(false),
+      m_bytesWritten(0),
+      m_lastProgressUpdate(0),
+      m_decoder(QStringDecoder::Utf8)
+{
+}
+
+CommandFilter::~CommandFilter()
+{
+    cancel();
+}
+
+void CommandFilter::filterThroughCommand()
+{
+    QMdiArea *mdiArea = getActiveMdiArea();
+    if (!mdiArea || !mdiArea->activeSubWindow()) return;
+    KTextEdit *textEdit = qobject_cast<KTextEdit*>(mdiArea->activeSubWindow()->widget());
+    if (!textEdit) return;
+
+    if (m_process) {
+        KMessageBox::information(m_tabWidget, i18n("Another command is still running."));
+        return;
+    }
+    if (ClipboardTransfer::isPasting(textEdit)) {
+        KMessageBox::information(m_tabWidget, i18n("Wait for the paste to finish before filtering the document."));
+        return;
+    }
+
+    QSettings settings(QStringLiteral("erateth"), QStringLiteral("mudoedit"));
+    const QStringList history = settings.value(QStringLiteral("filterCommandHistory")).toStringList();
+
+    bool ok = false;
+    const QString command = QInputDialog::getItem(m_tabWidget, i18n("Filter Through Command"),
+                                                  textEdit->textCursor().hasSelection()
+                                                      ? i18n("Replace the selection with the output of:")
+                                                      : i18n("Replace the document with the output of:"),
+                                                  history, 0, true, &ok).trimmed();
+    if (!ok || command.isEmpty()) return;
+
+    addToHistory(command);
+
+    // Run next to the file so relative paths in the command work
+    const QString filePath = mdiArea->activeSubWindow()->property("fullFilePath").toString();
+    start(textEdit, command, filePath.isEmpty() ? QString() : QFileInfo(filePath).absolutePath());
+}
+
+void CommandFilter::start(KTextEdit *textEdit, const QString &command, const QString &workingDirectory)
+{
+    if (!MemoryBudgetManager::ensureResident(textEdit)) return;
+
+    QTextDocument *document = textEdit->document();
+    const QTextCursor selection = textEdit->textCursor();
+    if (selection.hasSelection()) {
+        m_start = selection.selectionStart();
+        m_end = selection.selectionEnd();
+    } else {
+        m_start = 0;
+        m_end = document->characterCount() - 1;
+    }
+
+    m_textEdit = textEdit;
+    m_command = command;
+    m_inputPosition = m_start;
+    m_revision = document->revision();
+    m_inputEndsWithNewline = false;
+    m_bytesWritten = 0;
+    m_lastProgressUpdate = 0;
+    m_decoder.resetState();
+    m_output.clear();
+    m_errorOutput.clear();
+    m_timer.start();
+
+    // The range is read straight from the document while the command runs, so it must not
+    // change or be unloaded
+    m_wasReadOnly = textEdit->isReadOnly();
+    textEdit->setReadOnly(true);
+    MemoryBudgetManager::pin(textEdit);
+    connect(textEdit, &QObject::destroyed, this, &CommandFilter::cancel);
+
+    m_process = new QProcess(this);
+    if (!workingDirectory.isEmpty()) {
+        m_process->setWorkingDirectory(workingDirectory);
+    }
+    connect(m_process, &QProcess::bytesWritten, this, [this](qint64 bytes) {
+        m_bytesWritten += bytes;
+        feedInput();
+    });
+    connect(m_process, &QProcess::readyReadStandardOutput, this, &CommandFilter::readOutput);
+    connect(m_process, &QProcess::readyReadStandardError, this, [this]() {
+        const QByteArray error = m_process->readAllStandardError();
+        m_errorOutput.append(error.left(MAX_ERROR_BYTES - m_errorOutput.size()));
+    });
+    connect(m_process, &QProcess::finished, this, &CommandFilter::processFinished);
+    connect(m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error != QProcess::FailedToStart) return;
+        const QString message = m_process->errorString();
+        finish();
+        KMessageBox::error(m_tabWidget, i18n("The command could not be started: %1", message));
+    });
+
+    // Only slow commands get a dialog
+    m_progressDialog = new QProgressDialog(i18n("Running %1", command), i18n("Cancel"), 0, 1000, m_tabWidget);
+    m_progressDialog->setWindowTitle(i18n("Filter Through Command"));
+    m_progressDialog->setMinimumDuration(500);
+    m_progressDialog->setAutoClose(false);
+    m_progressDialog->setAutoReset(false);
+    m_progressDialog->setValue(0);
+    connect(m_progressDialog, &QProgressDialog::canceled, this, &CommandFilter::cancel);
+
+    qCDebug(commandFilterLog) << "Filtering" << (m_end - m_start) << "characters through" << command;
+
+    m_process->start(QStringLiteral("/bin/sh"), QStringList() << QStringLiteral("-c") << command);
+    feedInput();
+}
+
+void CommandFilter::feedInput()
+{
+    if (!m_process || !m_textEdit) return;
+
+    // Encode the next chunks only while the command keeps reading, so at most a few
+    // megabytes of the range exist outside the document at any time
+    QTextDocument *document = m_textEdit->document();
+    while (m_inputPosition < m_end && m_process->bytesToWrite() < MAX_PENDING_BYTES) {
+        int chunkEnd = qMin(m_end, m_inputPosition + CHUNK_CHARACTERS);
+        QTextCursor cursor(document);
+        cursor.setPosition(m_inputPosition);
+        cursor.setPosition(chunkEnd, QTextCursor::KeepAnchor);
+        QString chunk = cursor.selectedText();
+
+        // Keep a surrogate pair together for the next chunk
+        if (chunkEnd < m_end && !chunk.isEmpty() && chunk.back().isHighSurrogate()) {
+            chunk.chop(1);
+            --chunkEnd;
+        }
+        for (QChar &character : chunk) {
+            if (character == QChar::ParagraphSeparator || character == QChar::LineSeparator) {
+                character = QLatin1Char('\n');
+            }
+        }
+        if (!chunk.isEmpty()) {
+            m_inputEndsWithNewline = chunk.back() == QLatin1Char('\n');
+        }
+
+        m_process->write(chunk.toUtf8());
+        m_inputPosition = chunkEnd;
+    }
+
+    if (m_inputPosition >= m_end) {
+        disconnect(m_process, &QProcess::bytesWritten, this, nullptr);
+        m_process->closeWriteChannel();
+    }
+    updateProgress();
+}
+
+void CommandFilter::readOutput()
+{
+    if (!m_process) return;
+
+    // Decoding as the output arrives keeps only the text, never the raw bytes as well
+    m_output.append(m_decoder.decode(m_process->readAllStandardOutput()));
+    updateProgress();
+}
+
+void CommandFilter::processFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    if (!m_process) return;
+    readOutput();
+
+    KTextEdit *textEdit = m_textEdit;
+    const QString command = m_command;
+    const QString errorOutput = QString::fromUtf8(m_errorOutput).trimmed();
+    QString output = std::move(m_output);
+    const int start = m_start;
+    const int end = m_end;
+    const bool unchanged = textEdit && textEdit->document()->revision() == m_revision;
+    const bool inputEndsWithNewline = m_inputEndsWithNewline;
+
+    qCDebug(commandFilterLog) << command << "finished with" << exitCode << "after" << m_timer.elapsed() << "ms,"
+                              << output.size() << "characters of output";
+    finish();
+    if (!textEdit) return;
+
+    if (exitStatus != QProcess::NormalExit || exitCode != 0) {
+        const QString reason = exitStatus != QProcess::NormalExit
+                                   ? i18n("The command %1 crashed.", command)
+                                   : i18n("The command %1 failed with exit code %2.", command, exitCode);
+        KMessageBox::detailedError(m_tabWidget, i18n("%1 The document was not changed.", reason), errorOutput);
+        return;
+    }
+    if (!unchanged) {
+        KMessageBox::error(m_tabWidget, i18n("The document changed while %1 was running. Its output was not applied.", command));
+        return;
+    }
+
+    // Most tools end their output with a newline; don't add one the text did not have
+    if (!inputEndsWithNewline && output.endsWith(QLatin1Char('\n'))) {
+        output.chop(1);
+    }
+    if (!BulkEdit::replaceRange(textEdit, start, end, output)) {
+        KMessageBox::error(m_tabWidget, i18n("A paste was running when %1 finished. Its output was not applied.", command));
+    }
+}
+
+void CommandFilter::cancel()
+{
+    if (!m_process) return;
+
+    qCDebug(commandFilterLog) << "Cancelled" << m_command;
+    m_process->kill();
+    finish();
+}
+
+void CommandFilter::updateProgress()
+{
+    if (!m_progressDialog || m_timer.elapsed() - m_lastProgressUpdate < 100) return;
+    m_lastProgressUpdate = m_timer.elapsed();
+
+    const int total = m_end - m_start;
+    m_progressDialog->setValue(total > 0 ? int(qint64(m_inputPosition - m_start) * 1000 / total) : 1000);
+    const QLocale locale;
+    m_progressDialog->setLabelText(i18n("Running %1\n%2 written, %3 read", m_command,
+                                        locale.formattedDataSize(m_bytesWritten),
+                                        locale.formattedDataSize(m_output.size() * qint64(sizeof(QChar)))));
+}
+
+void CommandFilter::finish()
+{
+    if (m_process) {
+        disconnect(m_process, nullptr, this, nullptr);
+        m_process->deleteLater();
+        m_process = nullptr;
+    }
+    if (m_progressDialog) {
+        disconnect(m_progressDialog, nullptr, this, nullptr);
+        m_progressDialog->hide();
+        m_progressDialog->deleteLater();
+        m_progressDialog = nullptr;
+    }
+    if (m_textEdit) {
+        disconnect(m_textEdit, &QObject::destroyed, this, nullptr);
+        m_textEdit->setReadOnly(m_wasReadOnly);
+        MemoryBudgetManager::unpin(m_textEdit);
+    }
+    m_textEdit = nullptr;
+    m_output.clear();
+    m_output.squeeze();
+    m_errorOutput.clear();
+}
+
+void CommandFilter::addToHistory(const QString &command)
+{
+    QSettings settings(QStringLiteral("erateth"), QStringLiteral("mudoedit"));
+    QStringList history = settings.value(QStringLiteral("filterCommandHistory")).toStringList();
+    history.removeAll(command);
+    history.prepend(command);
+    while (history.size() > MAX_HISTORY) {
+        history.removeLast();
+    }
+    settings.setValue(QStringLiteral("filterCommandHistory"), history);
+}
+
+QMdiArea* CommandFilter::getActiveMdiArea() const
+{
+    QSplitter *splitter = qobject_cast<QSplitter*>(m_tabWidget->currentWidget());
+    if (splitter) {
+        return qobject_cast<QMdiArea*>(splitter->widget(0));
+    }
+    return nullptr;
+}
@@ -0,0 +1,92 @@
+#ifndef COMMANDFILTER_H
+#define COMMANDFILTER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QProcess>
+#include <QString>
+#include <QStringDecoder>
+
+class QTabWidget;
+class QMdiArea;
+class QProgressDialog;
+class KTextEdit;
+
+// This class pipes the selection or the whole document through a shell command and
+// replaces it with the output. The text is handed to the command in chunks as it
+// reads them and the output is decoded as it arrives, so neither side is held twice;
+// the editor stays read-only until the output is applied as one undo step
+class CommandFilter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CommandFilter(QTabWidget *tabWidget, QObject *parent = nullptr);
+    ~CommandFilter() override;
+
+    // Whether a command is running
+    bool isRunning() const { return m_process != nullptr; }
+public Q_SLOTS:
+    // Ask for a command and filter the selection or document of the active editor
+    void filterThroughCommand();
+
+    // Stop the running command and leave the document as it was
+    void cancel();
+
+private:
+    // Start a command on the selection of an editor, or on all of it
+    void start(KTextEdit *textEdit, const QString &command, const QString &workingDirectory);
+
+    // Write the next chunks of the range while the command keeps up
+    void feedInput();
+
+    // Decode what the command has written so far
+    void readOutput();
+
+    // Apply the output, or report why not
+    void processFinished(int exitCode, QProcess::ExitStatus exitStatus);
+
+    // Show how far the command got
+    void updateProgress();
+
+    // Make the editor writable again and drop the process
+    void finish();
+
+    // Remember a command for the next time
+    void addToHistory(const QString &command);
+
+    QMdiArea* getActiveMdiArea() const;
+
+    QTabWidget *m_tabWidget;
+    QPointer<KTextEdit> m_textEdit;
+    QProcess *m_process;
+    QProgressDialog *m_progressDialog;
+    QString m_command;
+
+    // The range being filtered and how much of it has been written
+    int m_start;
+    int m_end;
+    int m_inputPosition;
+    int m_revision;
+    bool m_wasReadOnly;
+    bool m_inputEndsWithNewline;
+    qint64 m_bytesWritten;
+    qint64 m_lastProgressUpdate;
+
+    QStringDecoder m_decoder;
+    QString m_output;
+    QByteArray m_errorOutput;
+    QElapsedTimer m_timer;
+
+    // Characters encoded per write, and bytes allowed to wait for the command to read them
+    static const int CHUNK_CHARACTERS = 1 << 20;
+    static const qint64 MAX_PENDING_BYTES = 4 << 20;
+
+    // Commands remembered, and the first part of the error output shown on failure
+    static const int MAX_HISTORY = 20;
+    static const int MAX_ERROR_BYTES = 16 << 10;
+};
+
+#endif // COMMANDFILTER_H
@@ -0,0 +1,107 @@
+#include "DeferredLayout.h"
+#include "SyntaxHighlighter.h"
+#include <QEvent>
+#include <QLoggingCategory>
+#include <KTextEdit>
+
+Q_LOGGING_CATEGORY(deferredLayoutLog, "mudoedit.deferredlayout")
+
+DeferredLayout::DeferredLayout(KTextEdit *textEdit)
+    : QObject(textEdit),
+      m_textEdit(textEdit)
+{
+    m_textEdit->installEventFilter(this);
+}
+
+DeferredLayout* DeferredLayout::forEditor(KTextEdit *textEdit)
+{
+    DeferredLayout *deferredLayout = textEdit->findChild<DeferredLayout*>(QString(), Qt::FindDirectChildrenOnly);
+    if (!deferredLayout) {
+        deferredLayout = new DeferredLayout(textEdit);
+    }
+    return deferredLayout;
+}
+
+void DeferredLayout::setFont(const QFont &font)
+{
+    if (font == m_textEdit->font()) {
+        m_pendingFont.reset();
+        return;
+    }
+    m_pendingFont = font;
+    applyIfVisible();
+}
+
+QFont DeferredLayout::font() const
+{
+    return m_pendingFont.value_or(m_textEdit->font());
+}
+
+void DeferredLayout::setSpellCheckingEnabled(bool enabled)
+{
+    if (enabled == m_textEdit->checkSpellingEnabled()) {
+        m_pendingSpellChecking.reset();
+        return;
+    }
+    m_pendingSpellChecking = enabled;
+    applyIfVisible();
+}
+
+void DeferredLayout::setSyntaxHighlightingEnabled(bool enabled)
+{
+    const bool current = m_textEdit->findChild<SyntaxHighlighter*>() != nullptr;
+    if (enabled == current) {
+        m_pendingSyntaxHighlighting.reset();
+        return;
+    }
+    m_pendingSyntaxHighlighting = enabled;
+    applyIfVisible();
+}
+
+bool DeferredLayout::hasPendingChanges() const
+{
+    return m_pendingFont || m_pendingSpellChecking || m_pendingSyntaxHighlighting;
+}
+
+void DeferredLayout::flush()
+{
+    if (!hasPendingChanges()) return;
+
+    if (m_pendingSpellChecking) {
+        m_textEdit->setCheckSpellingEnabled(*m_pendingSpellChecking);
+    }
+
+    if (m_pendingSyntaxHighlighting) {
+        SyntaxHighlighter *highlighter = m_textEdit->findChild<SyntaxHighlighter*>();
+        if (*m_pendingSyntaxHighlighting && !highlighter) {
+            new SyntaxHighlighter(m_textEdit->document());
+        } else if (!*m_pendingSyntaxHighlighting && highlighter) {
+            delete highlighter;
+        }
+    }
+
+    // The font goes last so the document is laid out once with the final formats
+    if (m_pendingFont) {
+        m_textEdit->setFont(*m_pendingFont);
+    }
+
+    m_pendingFont.reset();
+    m_pendingSpellChecking.reset();
+    m_pendingSyntaxHighlighting.reset();
+}
+
+bool DeferredLayout::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_textEdit && event->type() == QEvent::Show && hasPendingChanges()) {
+        qCDebug(deferredLayoutLog) << "Applying deferred layout changes to a newly visible editor";
+        flush();
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void DeferredLayout::applyIfVisible()
+{
+    if (m_textEdit->isVisible()) {
+        flush();
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef DEFERREDLAYOUT_H
+#define DEFERREDLAYOUT_H
+
+#include <QObject>
+#include <QFont>
+#include <optional>
+
+class KTextEdit;
+
+// This class holds back layout-affecting changes to an editor the user cannot see
+// (inactive tab, minimized subwindow) and applies them in one go when it is shown
+class DeferredLayout : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Get the deferral helper of an editor, creating it on first use
+    static DeferredLayout* forEditor(KTextEdit *textEdit);
+
+    // Change the editor font, now if visible or else once it is shown
+    void setFont(const QFont &font);
+
+    // Font the editor has or will have once pending changes are applied
+    QFont font() const;
+
+    // Toggle spell checking and syntax highlighting, which both rehighlight the whole document
+    void setSpellCheckingEnabled(bool enabled);
+    void setSyntaxHighlightingEnabled(bool enabled);
+
+    // Whether changes are waiting for the editor to become visible
+    bool hasPendingChanges() const;
+
+    // Apply all pending changes immediately
+    void flush();
+
+protected:
+    // Apply pending changes when the editor is shown
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    explicit DeferredLayout(KTextEdit *textEdit);
+
+    // Apply changes now if the editor is visible
+    void applyIfVisible();
+
+    KTextEdit *m_textEdit;
+    std::optional<QFont> m_pendingFont;
+    std::optional<bool> m_pendingSpellChecking;
+    std::optional<bool> m_pendingSyntaxHighlighting;
+};
+
+#endif // DEFERREDLAYOUT_H
@@ -0,0 +1,164 @@
+#include "DiffManager.h"
+#include "DiffView.h"
+#include "MemoryBudgetManager.h"
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QInputDialog>
+#include <QLabel>
+#include <QMdiArea>
+#include <QMdiSubWindow>
+#include <QPushButton>
+#include <QSplitter>
+#include <QTabWidget>
+#include <QVBoxLayout>
+#include <KLocalizedString>
+#include <KMessageBox>
+#include <KTextEdit>
+
+DiffManager::DiffManager(QTabWidget *tabWidget, QObject *parent)
+    : QObject(parent),
+      m_tabWidget(tabWidget)
+{
+}
+
+QMdiArea* DiffManager::getActiveMdiArea() const
+{
+    QSplitter *splitter = qobject_cast<QSplitter*>(m_tabWidget->currentWidget());
+    if (splitter) {
+        return qobject_cast<QMdiArea*>(splitter->widget(0));
+    }
+    return nullptr;
+}
+
+KTextEdit* DiffManager::activeEditor(QString *title) const
+{
+    QMdiArea *mdiArea = getActiveMdiArea();
+    if (!mdiArea || !mdiArea->activeSubWindow()) return nullptr;
+    *title = mdiArea->activeSubWindow()->windowTitle();
+    return qobject_cast<KTextEdit*>(mdiArea->activeSubWindow()->widget());
+}
+
+void DiffManager::compareWithSaved()
+{
+    QString title;
+    KTextEdit *textEdit = activeEditor(&title);
+    if (!textEdit) return;
+
+    const QString filePath = getActiveMdiArea()->activeSubWindow()->property("fullFilePath").toString();
+    if (filePath.isEmpty() || !QFileInfo(filePath).isReadable()) {
+        KMessageBox::information(m_tabWidget, i18n("This document has no saved version to compare with."));
+        return;
+    }
+    if (!MemoryBudgetManager::ensureResident(textEdit)) {
+        KMessageBox::error(m_tabWidget, i18n("The document could not be reloaded for comparison."));
+        return;
+    }
+
+    DiffView *view = new DiffView;
+    view->setFileAndDocument(filePath, textEdit->document());
+    showWindow(view, i18n("%1 (saved)", QFileInfo(filePath).fileName()), title, nullptr, textEdit);
+}
+
+void DiffManager::compareWithDocument()
+{
+    QString title;
+    KTextEdit *textEdit = activeEditor(&title);
+    if (!textEdit) return;
+
+    // Every other document of every tab
+    QStringList titles;
+    QList<KTextEdit*> editors;
+    for (int i = 0; i < m_tabWidget->count(); ++i) {
+        QSplitter *splitter = qobject_cast<QSplitter*>(m_tabWidget->widget(i));
+        QMdiArea *mdiArea = splitter ? qobject_cast<QMdiArea*>(splitter->widget(0)) : nullptr;
+        if (!mdiArea) continue;
+        for (QMdiSubWindow *window : mdiArea->subWindowList()) {
+            KTextEdit *editor = qobject_cast<KTextEdit*>(window->widget());
+            if (editor && editor != textEdit) {
+                titles.append(i18nc("document title (tab name)", "%1 (%2)", window->windowTitle(), m_tabWidget->tabText(i)));
+                editors.append(editor);
+            }
+        }
+    }
+    if (editors.isEmpty()) {
+        KMessageBox::information(m_tabWidget, i18n("There is no other open document to compare with."));
+        return;
+    }
+
+    bool ok = false;
+    const QString choice = QInputDialog::getItem(m_tabWidget, i18n("Compare With Document"),
+                                                 i18n("Compare %1 with:", title), titles, 0, false, &ok);
+    if (!ok) return;
+    KTextEdit *other = editors.value(titles.indexOf(choice));
+    if (!other) return;
+
+    if (!MemoryBudgetManager::ensureResident(textEdit) || !MemoryBudgetManager::ensureResident(other)) {
+        KMessageBox::error(m_tabWidget, i18n("The documents could not be reloaded for comparison."));
+        return;
+    }
+
+    DiffView *view = new DiffView;
+    view->setDocuments(other->document(), textEdit->document());
+    showWindow(view, choice, title, other, textEdit);
+}
+
+void DiffManager::showWindow(DiffView *view, const QString &leftTitle, const QString &rightTitle,
+                             KTextEdit *left, KTextEdit *right)
+{
+    QWidget *window = new QWidget(m_tabWidget, Qt::Window);
+    window->setWindowTitle(i18n("Compare %1 and %2", leftTitle, rightTitle));
+    window->setAttribute(Qt::WA_DeleteOnClose);
+    window->resize(1000, 700);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(window);
+
+    QHBoxLayout *titleLayout = new QHBoxLayout;
+    titleLayout->addWidget(new QLabel(leftTitle), 1);
+    titleLayout->addWidget(new QLabel(rightTitle), 1);
+    mainLayout->addLayout(titleLayout);
+    mainLayout->addWidget(view, 1);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout;
+    QPushButton *previousButton = new QPushButton(QIcon::fromTheme(QStringLiteral("go-up")), i18n("&Previous Difference"));
+    QPushButton *nextButton = new QPushButton(QIcon::fromTheme(QStringLiteral("go-down")), i18n("&Next Difference"));
+    QPushButton *closeButton = new QPushButton(i18n("Close"));
+    previousButton->setShortcut(QKeySequence(Qt::ALT | Qt::Key_Up));
+    nextButton->setShortcut(QKeySequence(Qt::ALT | Qt::Key_Down));
+    QLabel *summaryLabel = new QLabel(i18n("Comparing..."));
+
+    connect(previousButton, &QPushButton::clicked, view, &DiffView::previousHunk);
+    connect(nextButton, &QPushButton::clicked, view, &DiffView::nextHunk);
+    connect(closeButton, &QPushButton::clicked, window, &QWidget::close);
+    connect(view, &DiffView::diffUpdated, summaryLabel, [view, summaryLabel](qint64 milliseconds) {
+        if (view->hunkCount() == 0) {
+            summaryLabel->setText(i18n("No differences, compared in %1 ms", milliseconds));
+        } else {
+            summaryLabel->setText(i18np("%1 difference, compared in %2 ms", "%1 differences, compared in %2 ms",
+                                        view->hunkCount(), milliseconds));
+        }
+    });
+    connect(view, &DiffView::currentHunkChanged, summaryLabel, [view, summaryLabel](int hunk) {
+        summaryLabel->setText(i18n("Difference %1 of %2", hunk + 1, view->hunkCount()));
+    });
+
+    buttonLayout->addWidget(previousButton);
+    buttonLayout->addWidget(nextButton);
+    buttonLayout->addWidget(summaryLabel, 1);
+    buttonLayout->addWidget(closeButton);
+    mainLayout->addLayout(buttonLayout);
+
+    // A compare window is no use once one of its documents is closed, and its documents
+    // must not be unloaded while it is open
+    for (KTextEdit *textEdit : {left, right}) {
+        if (textEdit) {
+            MemoryBudgetManager::pin(textEdit);
+            connect(textEdit, &QObject::destroyed, window, &QWidget::close);
+            connect(window, &QObject::destroyed, textEdit, [textEdit]() {
+                MemoryBudgetManager::unpin(textEdit);
+            });
+        }
+    }
+
+    window->show();
+    view->setFocus();
+}
@@ -0,0 +1,43 @@
+#ifndef DIFFMANAGER_H
+#define DIFFMANAGER_H
+
+#include <QObject>
+#include <QString>
+
+class QTabWidget;
+class QMdiArea;
+class QWidget;
+class KTextEdit;
+class DiffView;
+
+// This class opens compare windows for the active document, against its file on disk
+// or against another open document. The windows follow the documents as they are
+// edited and close with them
+class DiffManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DiffManager(QTabWidget *tabWidget, QObject *parent = nullptr);
+
+public Q_SLOTS:
+    // Compare the active document with the file it was opened from
+    void compareWithSaved();
+
+    // Ask for another open document and compare the active one with it
+    void compareWithDocument();
+
+private:
+    // Show a compare window around a view; it closes when either editor goes away
+    void showWindow(DiffView *view, const QString &leftTitle, const QString &rightTitle,
+                    KTextEdit *left, KTextEdit *right);
+
+    // The active editor and the title of its window
+    KTextEdit* activeEditor(QString *title) const;
+
+    QMdiArea* getActiveMdiArea() const;
+
+    QTabWidget *m_tabWidget;
+};
+
+#endif // DIFFMANAGER_H
@@ -0,0 +1,391 @@
+#include "DiffView.h"
+#include "BlockChange.h"
+#include "EncodingDetector.h"
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFontDatabase>
+#include <QLoggingCategory>
+#include <QPainter>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QThreadPool>
+#include <QTimer>
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(diffViewLog, "mudoedit.diffview")
+
+namespace {
+
+// Nobody scrolls further right than this within one line
+const int MAX_PAINTED_CHARACTERS = 4096;
+
+} // namespace
+
+DiffView::DiffView(QWidget *parent)
+    : QAbstractScrollArea(parent),
+      m_currentHunk(-1),
+      m_diffTimer(new QTimer(this)),
+      m_diffRunning(false),
+      m_lineCount{0, 0}
+{
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    setFocusPolicy(Qt::StrongFocus);
+
+    m_diffTimer->setSingleShot(true);
+    m_diffTimer->setInterval(DIFF_DELAY);
+    connect(m_diffTimer, &QTimer::timeout, this, &DiffView::startDiff);
+}
+
+DiffView::~DiffView()
+{
+}
+
+void DiffView::setDocuments(QTextDocument *left, QTextDocument *right)
+{
+    setDocument(0, left);
+    setDocument(1, right);
+    startDiff();
+}
+
+void DiffView::setFileAndDocument(const QString &filePath, QTextDocument *right)
+{
+    m_sides[0].filePath = filePath;
+    setDocument(1, right);
+    startDiff();
+}
+
+void DiffView::setDocument(int side, QTextDocument *document)
+{
+    m_sides[side].document = document;
+    connect(document, &QTextDocument::contentsChange, this, [this, side](int position, int charsRemoved, int charsAdded) {
+        contentsChanged(side, position, charsRemoved, charsAdded);
+    });
+    resetSide(side);
+}
+
+void DiffView::resetSide(int side)
+{
+    Side &current = m_sides[side];
+    current.hashes.assign(size_t(current.document->blockCount()), 0);
+    current.dirtyFirst = 0;
+    current.dirtyLast = int(current.hashes.size()) - 1;
+}
+
+void DiffView::contentsChanged(int side, int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved)
+    Side &current = m_sides[side];
+    const BlockChange change = BlockChange::fromEdit(current.document, position, charsAdded, int(current.hashes.size()));
+    m_diffTimer->start();
+    if (!change.isValid()) {
+        qCDebug(diffViewLog) << "Could not match up the edited blocks, hashing the document again";
+        resetSide(side);
+        return;
+    }
+
+    change.splice(current.hashes);
+    change.mergeDirty(&current.dirtyFirst, &current.dirtyLast);
+}
+
+void DiffView::startDiff()
+{
+    // One diff at a time; the next one picks up whatever changed meanwhile
+    if (m_diffRunning) {
+        m_diffTimer->start();
+        return;
+    }
+
+    struct Input {
+        std::vector<size_t> hashes;
+        int dirtyFirst = -1;
+        QString dirtyText;
+        int revision = 0;
+        QString filePath;
+    };
+    Input inputs[2];
+
+    for (int side = 0; side < 2; ++side) {
+        const Side &current = m_sides[side];
+        Input &input = inputs[side];
+        if (!current.document) {
+            if (current.filePath.isEmpty()) return;
+            if (!current.loaded) {
+                input.filePath = current.filePath;
+            } else {
+                input.hashes = current.hashes;
+            }
+            continue;
+        }
+
+        // Only the edited lines are copied
+        input.hashes = current.hashes;
+        input.revision = current.document->revision();
+        if (current.dirtyFirst >= 0) {
+            input.dirtyFirst = current.dirtyFirst;
+            input.dirtyText = BlockChange::copyBlocks(current.document->findBlockByNumber(current.dirtyFirst),
+                                                      current.document->findBlockByNumber(current.dirtyLast));
+        }
+    }
+    m_diffRunning = true;
+
+    QPointer<DiffView> self(this);
+    QThreadPool::globalInstance()->start([self, inputs]() {
+        QElapsedTimer timer;
+        timer.start();
+
+        Result result;
+        for (int side = 0; side < 2; ++side) {
+            const Input &input = inputs[side];
+            std::vector<size_t> &hashes = result.hashes[side];
+            result.revisions[side] = input.revision;
+
+            if (!input.filePath.isEmpty()) {
+                QFile file(input.filePath);
+                QString content;
+                if (file.open(QIODevice::ReadOnly)) {
+                    content = EncodingDetector::decode(file.readAll());
+                } else {
+                    qCWarning(diffViewLog) << "Could not read" << input.filePath << "for comparison";
+                }
+                result.fileLines = content.split(QLatin1Char('\n'));
+                hashes.reserve(size_t(result.fileLines.size()));
+                for (const QString &line : std::as_const(result.fileLines)) {
+                    hashes.push_back(TextDiff::hashLine(line));
+                }
+                continue;
+            }
+
+            hashes = input.hashes;
+            if (input.dirtyFirst >= 0) {
+                size_t line = size_t(input.dirtyFirst);
+                for (QStringView text : QStringView(input.dirtyText).split(QChar::ParagraphSeparator)) {
+                    hashes[line++] = TextDiff::hashLine(text);
+                }
+            }
+        }
+        result.hunks = TextDiff::compute(result.hashes[0], result.hashes[1]);
+        result.milliseconds = timer.elapsed();
+
+        QMetaObject::invokeMethod(qApp, [self, result]() {
+            if (self) {
+                self->applyDiff(result);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void DiffView::applyDiff(const Result &result)
+{
+    m_diffRunning = false;
+
+    // The file is read once, whether or not the documents have changed since
+    Side &left = m_sides[0];
+    if (!left.document && !left.loaded) {
+        left.lines = result.fileLines;
+        left.hashes = result.hashes[0];
+        left.loaded = true;
+    }
+
+    // The lines have moved since; the edit has marked them again and restarted the timer
+    for (int side = 0; side < 2; ++side) {
+        const Side &current = m_sides[side];
+        if (current.document && current.document->revision() != result.revisions[side]) return;
+    }
+    for (int side = 0; side < 2; ++side) {
+        Side &current = m_sides[side];
+        if (current.document) {
+            current.hashes = result.hashes[side];
+            current.dirtyFirst = current.dirtyLast = -1;
+        }
+    }
+
+    buildRows(result.hunks, int(result.hashes[0].size()), int(result.hashes[1].size()));
+    qCDebug(diffViewLog) << "Diffed" << m_lineCount[0] << "and" << m_lineCount[1] << "lines into"
+                         << result.hunks.size() << "hunks in" << result.milliseconds << "ms";
+    Q_EMIT diffUpdated(result.milliseconds);
+}
+
+void DiffView::buildRows(const QList<TextDiff::Hunk> &hunks, int leftCount, int rightCount)
+{
+    m_rows.clear();
+    m_hunkRows.clear();
+    m_rows.reserve(size_t(qMax(leftCount, rightCount)));
+    m_hunkRows.reserve(size_t(hunks.size()));
+
+    // Changed lines face each other; the longer side of a hunk continues against nothing
+    int left = 0;
+    int right = 0;
+    for (const TextDiff::Hunk &hunk : hunks) {
+        while (left < hunk.oldStart) {
+            m_rows.push_back({left++, right++, RowKind::Equal});
+        }
+        m_hunkRows.push_back(int(m_rows.size()));
+        const int common = qMin(hunk.oldCount, hunk.newCount);
+        for (int i = 0; i < common; ++i) {
+            m_rows.push_back({left++, right++, RowKind::Changed});
+        }
+        for (int i = common; i < hunk.oldCount; ++i) {
+            m_rows.push_back({left++, -1, RowKind::Removed});
+        }
+        for (int i = common; i < hunk.newCount; ++i) {
+            m_rows.push_back({-1, right++, RowKind::Added});
+        }
+    }
+    while (left < leftCount && right < rightCount) {
+        m_rows.push_back({left++, right++, RowKind::Equal});
+    }
+
+    m_lineCount[0] = leftCount;
+    m_lineCount[1] = rightCount;
+    m_currentHunk = -1;
+    updateScrollBars();
+    viewport()->update();
+}
+
+QString DiffView::lineText(int side, int line) const
+{
+    const Side &current = m_sides[side];
+    QString text;
+    if (current.document) {
+        // A document edited since the diff shows its current lines until the next one
+        text = current.document->findBlockByNumber(line).text();
+    } else {
+        text = current.lines.value(line);
+    }
+    text.truncate(MAX_PAINTED_CHARACTERS);
+    return text.replace(QLatin1Char('\t'), QStringLiteral("    "));
+}
+
+void DiffView::updateScrollBars()
+{
+    const QFontMetrics metrics = fontMetrics();
+    const int visibleRows = qMax(1, viewport()->height() / metrics.lineSpacing());
+    verticalScrollBar()->setRange(0, qMax(0, int(m_rows.size()) - visibleRows));
+    verticalScrollBar()->setPageStep(visibleRows);
+    verticalScrollBar()->setSingleStep(1);
+    horizontalScrollBar()->setPageStep(viewport()->width() / 2);
+    horizontalScrollBar()->setSingleStep(metrics.horizontalAdvance(QLatin1Char('0')) * 4);
+}
+
+void DiffView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void DiffView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+    QPainter painter(viewport());
+    const QPalette palette = viewport()->palette();
+    painter.fillRect(viewport()->rect(), palette.color(QPalette::Base));
+
+    const QFontMetrics metrics = fontMetrics();
+    const int lineHeight = metrics.lineSpacing();
+    const int digitWidth = metrics.horizontalAdvance(QLatin1Char('0'));
+    const int gutterWidth = digitWidth * int(QString::number(qMax(m_lineCount[0], m_lineCount[1])).size() + 2);
+    const int halfWidth = viewport()->width() / 2;
+    const int scrollX = horizontalScrollBar()->value();
+
+    const QColor changed(220, 170, 40, 70);
+    const QColor removed(220, 60, 60, 70);
+    const QColor added(60, 180, 60, 70);
+    const QColor filler = palette.color(QPalette::AlternateBase);
+    const QColor marker = palette.color(QPalette::Highlight);
+
+    // The rows of the current hunk are marked next to the line numbers
+    int currentFirst = -1;
+    int currentEnd = -1;
+    if (m_currentHunk >= 0) {
+        currentFirst = m_hunkRows[size_t(m_currentHunk)];
+        currentEnd = currentFirst;
+        while (currentEnd < int(m_rows.size()) && m_rows[size_t(currentEnd)].kind != RowKind::Equal) {
+            ++currentEnd;
+        }
+    }
+
+    int widest = 0;
+    int y = 0;
+    for (int row = verticalScrollBar()->value(); row < int(m_rows.size()) && y < viewport()->height(); ++row) {
+        const Row &current = m_rows[size_t(row)];
+        for (int side = 0; side < 2; ++side) {
+            const int line = side == 0 ? current.left : current.right;
+            const QRect rect(side * halfWidth, y, halfWidth, lineHeight);
+            if (line < 0) {
+                painter.fillRect(rect, filler);
+                continue;
+            }
+            if (current.kind == RowKind::Changed) {
+                painter.fillRect(rect, changed);
+            } else if (current.kind == RowKind::Removed) {
+                painter.fillRect(rect, removed);
+            } else if (current.kind == RowKind::Added) {
+                painter.fillRect(rect, added);
+            }
+            if (row >= currentFirst && row < currentEnd) {
+                painter.fillRect(QRect(rect.x(), y, 3, lineHeight), marker);
+            }
+
+            painter.setPen(palette.color(QPalette::PlaceholderText));
+            painter.drawText(QRect(rect.x(), y, gutterWidth - digitWidth, lineHeight),
+                             Qt::AlignRight | Qt::AlignVCenter, QString::number(line + 1));
+
+            const QString text = lineText(side, line);
+            const QRect textRect(rect.x() + gutterWidth, y, halfWidth - gutterWidth, lineHeight);
+            painter.save();
+            painter.setClipRect(textRect);
+            painter.setPen(palette.color(QPalette::Text));
+            painter.drawText(textRect.x() - scrollX, y + metrics.ascent(), text);
+            painter.restore();
+            widest = qMax(widest, metrics.horizontalAdvance(text));
+        }
+        y += lineHeight;
+    }
+
+    painter.setPen(palette.color(QPalette::Mid));
+    painter.drawLine(halfWidth, 0, halfWidth, viewport()->height());
+
+    // Only the lines in view are measured, so the range grows as wider ones scroll in
+    const int maximum = widest + digitWidth - (halfWidth - gutterWidth);
+    if (maximum > horizontalScrollBar()->maximum()) {
+        horizontalScrollBar()->setMaximum(maximum);
+    }
+}
+
+int DiffView::anchorRow() const
+{
+    const int top = verticalScrollBar()->value();
+    const int visibleRows = verticalScrollBar()->pageStep();
+    if (m_currentHunk >= 0) {
+        const int row = m_hunkRows[size_t(m_currentHunk)];
+        if (row >= top && row < top + visibleRows) return row;
+    }
+    return top + visibleRows / 3;
+}
+
+void DiffView::nextHunk()
+{
+    const auto next = std::upper_bound(m_hunkRows.cbegin(), m_hunkRows.cend(), anchorRow());
+    if (next != m_hunkRows.cend()) {
+        scrollToHunk(int(next - m_hunkRows.cbegin()));
+    }
+}
+
+void DiffView::previousHunk()
+{
+    const auto next = std::lower_bound(m_hunkRows.cbegin(), m_hunkRows.cend(), anchorRow());
+    if (next != m_hunkRows.cbegin()) {
+        scrollToHunk(int(next - m_hunkRows.cbegin()) - 1);
+    }
+}
+
+void DiffView::scrollToHunk(int hunk)
+{
+    m_currentHunk = hunk;
+    verticalScrollBar()->setValue(m_hunkRows[size_t(hunk)] - verticalScrollBar()->pageStep() / 3);
+    horizontalScrollBar()->setValue(0);
+    viewport()->update();
+    Q_EMIT currentHunkChanged(hunk);
+}
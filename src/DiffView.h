@@ -0,0 +1,125 @@
+#ifndef DIFFVIEW_H
+#define DIFFVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QList>
+#include <QPointer>
+#include <QStringList>
+#include <vector>
+#include "TextDiff.h"
+
+class QTextDocument;
+class QTimer;
+
+// This class shows two texts side by side with their differences. Either side is an
+// open document, followed as it is edited, or a file as saved on disk. The line hashes
+// of a document are kept per block and only the edited blocks are hashed again, so the
+// diff itself runs on the thread pool over hashes alone. Only the rows in view are painted
+class DiffView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit DiffView(QWidget *parent = nullptr);
+    ~DiffView() override;
+
+    // Set the left side to a document or to the lines of a file, and the right side to a document
+    void setDocuments(QTextDocument *left, QTextDocument *right);
+    void setFileAndDocument(const QString &filePath, QTextDocument *right);
+
+    int hunkCount() const { return int(m_hunkRows.size()); }
+    int currentHunk() const { return m_currentHunk; }
+
+public Q_SLOTS:
+    // Scroll to the next or previous difference below or above the middle of the view
+    void nextHunk();
+    void previousHunk();
+
+Q_SIGNALS:
+    // Emitted whenever a new diff is shown, with the time it took on the worker
+    void diffUpdated(qint64 milliseconds);
+
+    // Emitted when navigating to a difference, counted from 0
+    void currentHunkChanged(int hunk);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    enum class RowKind : quint8 {
+        Equal,
+        Changed,
+        Removed,
+        Added
+    };
+
+    // One row of the view: a line on either side, or -1 where the other side has lines
+    struct Row {
+        int left;
+        int right;
+        RowKind kind;
+    };
+
+    // One side of the comparison
+    struct Side {
+        QPointer<QTextDocument> document;
+        QString filePath;
+        QStringList lines;
+        bool loaded = false;
+
+        // Hash of every line, and the lines that need hashing, or -1
+        std::vector<size_t> hashes;
+        int dirtyFirst = -1;
+        int dirtyLast = -1;
+    };
+
+    // What a diff on the worker produced
+    struct Result {
+        std::vector<size_t> hashes[2];
+        int revisions[2];
+        QStringList fileLines;
+        QList<TextDiff::Hunk> hunks;
+        qint64 milliseconds;
+    };
+
+    // Follow a document on one side
+    void setDocument(int side, QTextDocument *document);
+
+    // Keep the hashes of a side aligned with its blocks and mark the edited ones
+    void contentsChanged(int side, int position, int charsRemoved, int charsAdded);
+
+    // Mark every line of a side for hashing
+    void resetSide(int side);
+
+    // Hash the marked lines and diff on the thread pool
+    void startDiff();
+
+    // Show a diff if neither document has changed since it was started
+    void applyDiff(const Result &result);
+
+    // Line up the lines of both sides around the hunks
+    void buildRows(const QList<TextDiff::Hunk> &hunks, int leftCount, int rightCount);
+
+    void updateScrollBars();
+    void scrollToHunk(int hunk);
+
+    // The text of a line of a side as it is painted
+    QString lineText(int side, int line) const;
+
+    // The row in the middle of the view that navigation starts from
+    int anchorRow() const;
+
+    Side m_sides[2];
+    std::vector<Row> m_rows;
+    std::vector<int> m_hunkRows;
+    int m_currentHunk;
+    QTimer *m_diffTimer;
+    bool m_diffRunning;
+    int m_lineCount[2];
+
+    // Diff once typing has paused for this long
+    static const int DIFF_DELAY = 300;
+};
+
+#endif // DIFFVIEW_H
@@ -8,6 +8,8 @@
 #include <QSplitter>
 #include <QStyle>
 #include <QTabWidget>
+#include <QTextBlock>
+#include <QTextCursor>
 #include <QMimeDatabase>
 #include <QMimeType>
 #include <QVBoxLayout>
@@ -33,6 +35,11 @@
 #include "MainWindow.h"
 #include "SettingsManagement.h"
 #include "CustomMdiSubWindow.h"
+#include "HexView.h"
+#include "HugeFileView.h"
+#include "MemoryBudgetManager.h"
+#include "ZoomManager.h"
+#include "ClipboardTransfer.h"
 
 Q_LOGGING_CATEGORY(docManagerLog, "mudoedit.documentmanager")
 
@@ -76,7 +83,19 @@ QMdiSubWindow* DocumentManager::openFile(const QString &filePath)
         return nullptr;
     }
 
-    QString content = m_fileIO->readFile(filePath);
+    // Binary files are shown as bytes rather than decoded into a document
+    if (FileIO::isBinaryFile(filePath)) {
+        return openBinaryFile(filePath);
+    }
+
+    // Files too large to load as a document are only viewed
+    const qint64 hugeFileThreshold = qint64(m_settingsManagement->hugeFileThreshold()) * 1024 * 1024;
+    if (hugeFileThreshold > 0 && QFileInfo(filePath).size() >= hugeFileThreshold) {
+        return openHugeFile(filePath);
+    }
+
+    EncodingDetector::Format format;
+    QString content = m_fileIO->readFile(filePath, &format);
 
     QMdiArea *mdiArea = getActiveMdiArea();
     if (!mdiArea) {
@@ -96,13 +115,141 @@ QMdiSubWindow* DocumentManager::openFile(const QString &filePath)
     subWindow->show();
     textEdit->document()->setModified(false);
     subWindow->setProperty("fullFilePath", filePath);
+    EncodingDetector::setFormat(subWindow, format);
     
-    qCDebug(docManagerLog) << "File opened successfully:" << filePath;
+    if (format.mixedLineEndings) {
+        qCInfo(docManagerLog) << filePath << "mixes line endings; it will be saved with"
+                              << (format.crlf ? "CRLF" : "LF") << "throughout";
+    }
+    qCDebug(docManagerLog) << "File opened successfully:" << filePath << "as" << format.encoding;
     
     Q_EMIT fileOpened(filePath);
     
     return subWindow;
 }
+
+QMdiSubWindow* DocumentManager::openHugeFile(const QString &filePath)
+{
+    QMdiArea *mdiArea = getActiveMdiArea();
+    if (!mdiArea) {
+        qCCritical(docManagerLog) << "No active MDI area. Cannot open file.";
+        return nullptr;
+    }
+
+    HugeFileView *view = new HugeFileView;
+    if (!view->openFile(filePath)) {
+        delete view;
+        KMessageBox::error(m_tabWidget, i18n("Could not open file %1", filePath));
+        return nullptr;
+    }
+    view->setFont(m_settingsManagement->currentFont());
+
+    CustomMdiSubWindow *subWindow = new CustomMdiSubWindow(m_mainWindow, mdiArea);
+    subWindow->setWidget(view);
+    mdiArea->addSubWindow(subWindow);
+    setupSubWindow(subWindow);
+    subWindow->setWindowTitle(i18n("%1 (read-only)", QFileInfo(filePath).fileName()));
+    subWindow->setProperty("fullFilePath", filePath);
+    subWindow->resize(600, 400);
+    subWindow->show();
+
+    qCDebug(docManagerLog) << "Huge file opened read-only:" << filePath;
+
+    Q_EMIT fileOpened(filePath);
+
+    return subWindow;
+}
+
+QMdiSubWindow* DocumentManager::openBinaryFile(const QString &filePath)
+{
+    QMdiArea *mdiArea = getActiveMdiArea();
+    if (!mdiArea) {
+        qCCritical(docManagerLog) << "No active MDI area. Cannot open file.";
+        return nullptr;
+    }
+
+    HexView *view = new HexView;
+    if (!view->openFile(filePath)) {
+        delete view;
+        KMessageBox::error(m_tabWidget, i18n("Could not open file %1", filePath));
+        return nullptr;
+    }
+    view->setFont(m_settingsManagement->currentFont());
+
+    CustomMdiSubWindow *subWindow = new CustomMdiSubWindow(m_mainWindow, mdiArea);
+    subWindow->setWidget(view);
+    mdiArea->addSubWindow(subWindow);
+    setupSubWindow(subWindow);
+    subWindow->setWindowTitle(i18n("%1 (hex)", QFileInfo(filePath).fileName()));
+    subWindow->setProperty("fullFilePath", filePath);
+    subWindow->resize(700, 400);
+    subWindow->show();
+
+    qCDebug(docManagerLog) << "Binary file opened in the hex viewer:" << filePath;
+
+    Q_EMIT fileOpened(filePath);
+
+    return subWindow;
+}
+
+QMdiSubWindow* DocumentManager::findOpenDocument(const QString &filePath) const
+{
+    const QString cleanPath = QDir::cleanPath(filePath);
+    for (int i = 0; i < m_tabWidget->count(); ++i) {
+        QMdiArea *mdiArea = getActiveMdiArea(i);
+        if (!mdiArea) continue;
+
+        for (QMdiSubWindow *window : mdiArea->subWindowList()) {
+            if (QDir::cleanPath(window->property("fullFilePath").toString()) == cleanPath) {
+                return window;
+            }
+        }
+    }
+    return nullptr;
+}
+
+QMdiSubWindow* DocumentManager::openOrFocusFile(const QString &filePath)
+{
+    QMdiSubWindow *subWindow = findOpenDocument(filePath);
+    if (!subWindow) {
+        return openFile(filePath);
+    }
+
+    // Bring the tab and the window of the open document to the front
+    for (int i = 0; i < m_tabWidget->count(); ++i) {
+        QMdiArea *mdiArea = getActiveMdiArea(i);
+        if (mdiArea && mdiArea->subWindowList().contains(subWindow)) {
+            m_tabWidget->setCurrentIndex(i);
+            mdiArea->setActiveSubWindow(subWindow);
+            break;
+        }
+    }
+    return subWindow;
+}
+
+QMdiSubWindow* DocumentManager::openFileAtLine(const QString &filePath, int line, int column, int length)
+{
+    QMdiSubWindow *subWindow = openOrFocusFile(filePath);
+    if (!subWindow) return nullptr;
+
+    KTextEdit *textEdit = qobject_cast<KTextEdit*>(subWindow->widget());
+    if (!textEdit || !MemoryBudgetManager::ensureResident(textEdit)) return subWindow;
+
+    QTextBlock block = textEdit->document()->findBlockByNumber(qMax(0, line - 1));
+    if (!block.isValid()) {
+        block = textEdit->document()->lastBlock();
+    }
+    QTextCursor cursor(block);
+    cursor.setPosition(block.position() + qBound(0, column, block.length() - 1));
+    if (length > 0) {
+        cursor.setPosition(qMin(cursor.position() + length, block.position() + block.length() - 1), QTextCursor::KeepAnchor);
+    }
+    textEdit->setTextCursor(cursor);
+    textEdit->ensureCursorVisible();
+    textEdit->setFocus();
+    return subWindow;
+}
+
 void DocumentManager::openFile()
 {
     // Create a QFileDialog with the parent set to m_tabWidget
@@ -151,32 +298,65 @@ void DocumentManager::openFile()
 bool DocumentManager::saveFile()
 {
     QMdiArea *mdiArea = getActiveMdiArea();
-    if (!mdiArea) {
+    if (!mdiArea || !mdiArea->activeSubWindow()) {
         qCCritical(docManagerLog) << QStringLiteral("No active MDI area. Cannot save file.");
         return false;
     }
+    return saveWindow(mdiArea->activeSubWindow());
+}
 
-    KTextEdit *textEdit = qobject_cast<KTextEdit*>(mdiArea->activeSubWindow()->widget());
+bool DocumentManager::saveWindow(QMdiSubWindow *subWindow)
+{
+    KTextEdit *textEdit = qobject_cast<KTextEdit*>(subWindow->widget());
     if (!textEdit) return false;
 
-    QString filePath = mdiArea->activeSubWindow()->property("fullFilePath").toString();
+    // Half a paste is not worth writing, and the open edit block would end up in the file
+    if (ClipboardTransfer::isPasting(textEdit)) {
+        KMessageBox::information(m_tabWidget, i18n("Wait for the paste to finish before saving."));
+        return false;
+    }
+
+    // Never write the placeholder of an unloaded document over the real file
+    if (!MemoryBudgetManager::ensureResident(textEdit)) {
+        KMessageBox::error(m_tabWidget, i18n("The document could not be reloaded and was not saved."));
+        return false;
+    }
+
+    QString filePath = subWindow->property("fullFilePath").toString();
     
     if (filePath.isEmpty() || filePath == i18n("Untitled")) {
         filePath = QFileDialog::getSaveFileName(m_tabWidget, i18n("Save File"), 
                                                 QDir::homePath(),
                                                 i18n("Text Files (*.txt);;All Files (*)"));
         if (filePath.isEmpty()) return false;
+    } else if (subWindow->property("externallyModified").toBool()) {
+        // Someone else wrote the file since it was loaded; don't throw their version away unasked
+        const int ret = KMessageBox::warningContinueCancel(m_tabWidget,
+            i18n("The file %1 was changed on disk after it was loaded. Overwrite it with this document?", filePath),
+            i18n("File Changed on Disk"), KStandardGuiItem::overwrite());
+        if (ret != KMessageBox::Continue) return false;
     }
 
-    if (m_fileIO->writeFile(filePath, textEdit->toPlainText())) {
-        textEdit->document()->setModified(false);
-        QMdiSubWindow* window = qobject_cast<QMdiSubWindow*>(textEdit->parent());
-        if (window) {
-            window->setWindowTitle(QFileInfo(filePath).fileName());
-            window->setProperty("fullFilePath", filePath);
+    // Written back in the encoding and with the line breaks it was read with
+    EncodingDetector::Format format = EncodingDetector::formatOf(subWindow);
+    FileIO::SaveOptions options;
+    options.trimTrailingWhitespace = m_settingsManagement->trimTrailingWhitespace();
+    options.ensureFinalNewline = m_settingsManagement->ensureFinalNewline();
+    const QByteArray encoding = format.encoding;
+    if (m_fileIO->writeDocument(filePath, textEdit->document(), &format, options)) {
+        if (format.encoding != encoding) {
+            Q_EMIT statusMessage(i18n("%1 cannot hold all of the text, so %2 was saved as %3",
+                                      QString::fromLatin1(encoding), QFileInfo(filePath).fileName(),
+                                      QString::fromLatin1(format.encoding)));
         }
+        EncodingDetector::setFormat(subWindow, format);
+        textEdit->document()->setModified(false);
+        subWindow->setWindowTitle(QFileInfo(filePath).fileName());
+        subWindow->setProperty("fullFilePath", filePath);
+        subWindow->setProperty("externallyModified", false);
         logDocumentState(textEdit, QStringLiteral("saveFile"));
         logAllDocumentStates(QStringLiteral("After saveFile"));
+        Q_EMIT fileSaved(filePath);
         return true;
     }
     return false;
@@ -240,6 +420,7 @@ void DocumentManager::saveOpenDocuments()
     QStringList openFiles;
     QVariantList windowGeometries;
     QList<int> tabIndices;
+    QList<int> zoomLevels;
 
     for (int i = 0; i < m_tabWidget->count(); ++i) {
         QMdiArea *mdiArea = getActiveMdiArea(i);
@@ -253,7 +434,13 @@ void DocumentManager::saveOpenDocuments()
                     openFiles << filePath;
                     windowGeometries << window->saveGeometry();
                     tabIndices << i;
+                    zoomLevels << ZoomManager::zoomLevel(textEdit);
                 }
+            } else if (qobject_cast<HugeFileView*>(window->widget()) || qobject_cast<HexView*>(window->widget())) {
+                openFiles << window->property("fullFilePath").toString();
+                windowGeometries << window->saveGeometry();
+                tabIndices << i;
+                zoomLevels << 0;
             }
         }
     }
@@ -263,6 +450,7 @@ void DocumentManager::saveOpenDocuments()
     settings.setValue(QStringLiteral("openFiles"), openFiles);
     settings.setValue(QStringLiteral("windowGeometries"), windowGeometries);
     settings.setValue(QStringLiteral("tabIndices"), QVariant::fromValue(tabIndices));
+    settings.setValue(QStringLiteral("zoomLevels"), QVariant::fromValue(zoomLevels));
     
     qCDebug(docManagerLog) << "Saved" << openFiles.size() << "open documents";
     logAllDocumentStates(QStringLiteral("After saveOpenDocuments"));
@@ -274,6 +462,7 @@ void DocumentManager::reopenDocuments()
     QStringList openFiles = settings.value(QStringLiteral("openFiles")).toStringList();
     QVariantList windowGeometries = settings.value(QStringLiteral("windowGeometries")).toList();
     QList<int> tabIndices = settings.value(QStringLiteral("tabIndices")).value<QList<int>>();
+    QList<int> zoomLevels = settings.value(QStringLiteral("zoomLevels")).value<QList<int>>();
     
     qCDebug(docManagerLog) << "Attempting to reopen" << openFiles.size() << "documents";
     
@@ -292,6 +481,11 @@ void DocumentManager::reopenDocuments()
         
         m_tabWidget->setCurrentIndex(tabIndex);
         QMdiSubWindow *window = openFile(filePath);
+        if (window && i < zoomLevels.size()) {
+            if (KTextEdit *textEdit = qobject_cast<KTextEdit*>(window->widget())) {
+                ZoomManager::restoreZoomLevel(textEdit, zoomLevels[i]);
+            }
+        }
         if (window && i < windowGeometries.size()) {
             window->restoreGeometry(windowGeometries[i].toByteArray());
             qCDebug(docManagerLog) << "Restored geometry for" << filePath;
@@ -389,6 +583,7 @@ void DocumentManager::setupTextEdit(KTextEdit* textEdit, const QString& filePath
     }
 
     logDocumentState(textEdit, QStringLiteral("setupTextEdit"));
+    Q_EMIT editorCreated(textEdit);
 }
 
 void DocumentManager::setupSubWindow(QMdiSubWindow *subWindow)
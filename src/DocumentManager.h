@@ -24,9 +24,27 @@ public:
     // Open an existing file
     QMdiSubWindow* openFile(const QString &filePath);
 
+    // Open a file in the read-only viewer for files too large to load
+    QMdiSubWindow* openHugeFile(const QString &filePath);
+
+    // Open a file in the read-only hex viewer
+    QMdiSubWindow* openBinaryFile(const QString &filePath);
+
+    // Find the window showing a file in any tab, or nullptr if it is not open
+    QMdiSubWindow* findOpenDocument(const QString &filePath) const;
+
+    // Open a file, or bring its window to the front if it is already open
+    QMdiSubWindow* openOrFocusFile(const QString &filePath);
+
+    // Open a file, or focus it if it is already open, and select a range on a 1-based line
+    QMdiSubWindow* openFileAtLine(const QString &filePath, int line, int column = 0, int length = 0);
+
     // Save the current document
     bool saveFile();
 
+    // Save the document of a window, asking before overwriting a file changed on disk
+    bool saveWindow(QMdiSubWindow *subWindow);
+
     // Save all open documents
     void saveAllFiles();
 
@@ -56,6 +74,15 @@ Q_SIGNALS:
     // Signal emitted when a file is successfully opened
     void fileOpened(const QString &filePath);
 
+    // Signal emitted when a document has been written to a file
+    void fileSaved(const QString &filePath);
+
+    // Signal emitted when an editor has been set up for a new or opened document
+    void editorCreated(KTextEdit *textEdit);
+
+    // Signal emitted with a message for the status bar, e.g. when a file had to be saved in another encoding
+    void statusMessage(const QString &message);
+
 private:
     void setupTextEdit(KTextEdit* textEdit, const QString& filePath = QString());
     void setupSubWindow(QMdiSubWindow* subWindow);
@@ -0,0 +1,142 @@
+#include "DocumentOutline.h"
+#include "BlockChange.h"
+#include <QApplication>
+#include <QLoggingCategory>
+#include <QPointer>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QThreadPool>
+#include <QTimer>
+#include <KTextEdit>
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(outlineLog, "mudoedit.outline")
+
+namespace {
+
+// Scan once typing has paused for this long
+const int SCAN_DELAY = 250;
+
+} // namespace
+
+DocumentOutline* DocumentOutline::forEditor(KTextEdit *textEdit)
+{
+    DocumentOutline *outline = textEdit->findChild<DocumentOutline*>(QString(), Qt::FindDirectChildrenOnly);
+    if (!outline) {
+        outline = new DocumentOutline(textEdit);
+    }
+    return outline;
+}
+
+DocumentOutline::DocumentOutline(KTextEdit *textEdit)
+    : QObject(textEdit),
+      m_textEdit(textEdit),
+      m_scanTimer(new QTimer(this)),
+      m_dirtyFirst(-1),
+      m_dirtyLast(-1),
+      m_scanRunning(false)
+{
+    m_scanTimer->setSingleShot(true);
+    m_scanTimer->setInterval(SCAN_DELAY);
+    connect(m_scanTimer, &QTimer::timeout, this, &DocumentOutline::startScan);
+    connect(m_textEdit->document(), &QTextDocument::contentsChange, this, &DocumentOutline::contentsChanged);
+
+    resetAll();
+    startScan();
+}
+
+void DocumentOutline::resetAll()
+{
+    m_lines.assign(size_t(m_textEdit->document()->blockCount()), QList<SymbolScanner::Symbol>());
+    m_dirtyFirst = 0;
+    m_dirtyLast = int(m_lines.size()) - 1;
+}
+
+void DocumentOutline::contentsChanged(int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved)
+    const BlockChange change = BlockChange::fromEdit(m_textEdit->document(), position, charsAdded, int(m_lines.size()));
+    if (!change.isValid()) {
+        qCDebug(outlineLog) << "Could not match up the edited blocks, rescanning the document";
+        resetAll();
+        m_scanTimer->start();
+        return;
+    }
+
+    change.splice(m_lines);
+    change.mergeDirty(&m_dirtyFirst, &m_dirtyLast);
+    m_scanTimer->start();
+}
+
+void DocumentOutline::startScan()
+{
+    if (m_dirtyFirst < 0) return;
+
+    // One scan at a time; the next one picks up whatever changed meanwhile
+    if (m_scanRunning) {
+        m_scanTimer->start();
+        return;
+    }
+
+    QTextDocument *document = m_textEdit->document();
+    const QTextBlock first = document->findBlockByNumber(m_dirtyFirst);
+    const QTextBlock last = document->findBlockByNumber(m_dirtyLast);
+    if (!first.isValid() || !last.isValid()) {
+        resetAll();
+        m_scanTimer->start();
+        return;
+    }
+
+    // Only the marked blocks are copied
+    const QString text = BlockChange::copyBlocks(first, last);
+    const int revision = document->revision();
+    const int firstBlock = m_dirtyFirst;
+    const int blockCount = m_dirtyLast - m_dirtyFirst + 1;
+    m_scanRunning = true;
+
+    QPointer<DocumentOutline> self(this);
+    QThreadPool::globalInstance()->start([self, text, revision, firstBlock, blockCount]() {
+        std::vector<QList<SymbolScanner::Symbol>> lines;
+        lines.reserve(size_t(blockCount));
+
+        for (QStringView line : QStringView(text).split(QChar::ParagraphSeparator)) {
+            lines.push_back(SymbolScanner::scanLine(line));
+        }
+
+        QMetaObject::invokeMethod(qApp, [self, revision, firstBlock, lines]() {
+            if (self) {
+                self->applyScan(revision, firstBlock, lines);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void DocumentOutline::applyScan(int revision, int firstBlock, const std::vector<QList<SymbolScanner::Symbol>> &lines)
+{
+    m_scanRunning = false;
+
+    // The blocks have moved since; the edit has marked them again and restarted the timer
+    if (m_textEdit->document()->revision() != revision) return;
+
+    std::copy(lines.begin(), lines.end(), m_lines.begin() + firstBlock);
+    m_dirtyFirst = m_dirtyLast = -1;
+
+    // Flatten for the panel; edits that only move symbols to other lines count as changes too
+    QList<SymbolScanner::Symbol> symbols;
+    for (size_t i = 0; i < m_lines.size(); ++i) {
+        for (SymbolScanner::Symbol symbol : std::as_const(m_lines[i])) {
+            symbol.line = int(i);
+            symbols.append(symbol);
+        }
+    }
+    const bool changed = symbols.size() != m_symbols.size()
+        || !std::equal(symbols.cbegin(), symbols.cend(), m_symbols.cbegin(),
+                       [](const SymbolScanner::Symbol &a, const SymbolScanner::Symbol &b) {
+                           return a.line == b.line && a.column == b.column && a.kind == b.kind && a.name == b.name;
+                       });
+    if (!changed) return;
+
+    m_symbols = symbols;
+    qCDebug(outlineLog) << "Outline has" << m_symbols.size() << "symbols";
+    Q_EMIT symbolsChanged();
+}
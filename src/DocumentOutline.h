@@ -0,0 +1,61 @@
+#ifndef DOCUMENTOUTLINE_H
+#define DOCUMENTOUTLINE_H
+
+#include <QObject>
+#include <QList>
+#include <vector>
+#include "SymbolScanner.h"
+
+class QTimer;
+class KTextEdit;
+
+// This class keeps the symbols of an editor's document. The symbols are stored per
+// block and spliced as blocks are inserted and removed, so an edit only marks a range
+// of blocks for scanning; the range is scanned on the thread pool once typing pauses
+class DocumentOutline : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Get the outline of an editor, creating it on first use
+    static DocumentOutline* forEditor(KTextEdit *textEdit);
+
+    // All symbols in document order
+    const QList<SymbolScanner::Symbol> &symbols() const { return m_symbols; }
+
+    KTextEdit *textEdit() const { return m_textEdit; }
+
+Q_SIGNALS:
+    // Emitted when a scan has changed the symbols
+    void symbolsChanged();
+
+private:
+    explicit DocumentOutline(KTextEdit *textEdit);
+
+    // Keep the per-block symbols aligned with the blocks and mark the edited ones
+    void contentsChanged(int position, int charsRemoved, int charsAdded);
+
+    // Mark every block for scanning, e.g. when the blocks can no longer be matched up
+    void resetAll();
+
+    // Scan the marked blocks on the thread pool
+    void startScan();
+
+    // Store the result of a scan if the document has not changed since
+    void applyScan(int revision, int firstBlock, const std::vector<QList<SymbolScanner::Symbol>> &lines);
+
+    KTextEdit *m_textEdit;
+    QTimer *m_scanTimer;
+
+    // Symbols of every block, and all of them in order for the panel
+    std::vector<QList<SymbolScanner::Symbol>> m_lines;
+    QList<SymbolScanner::Symbol> m_symbols;
+
+    // Blocks that need scanning, or -1
+    int m_dirtyFirst;
+    int m_dirtyLast;
+
+    bool m_scanRunning;
+};
+
+#endif // DOCUMENTOUTLINE_H
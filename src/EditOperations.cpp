@@ -1,4 +1,6 @@
 #include "EditOperations.h"
+#include "MultiCursor.h"
+#include "ClipboardTransfer.h"
 #include <QTabWidget>
 #include <QMdiArea>
 #include <QMdiSubWindow>
@@ -24,6 +26,7 @@ void EditOperations::undo()
     QMdiArea *mdiArea = getActiveMdiArea();
     if (mdiArea && mdiArea->activeSubWindow()) {
         if (KTextEdit* editor = qobject_cast<KTextEdit*>(mdiArea->activeSubWindow()->widget())) {
+            ClipboardTransfer::detach(editor->document());
             editor->undo();
         }
     }
@@ -34,6 +37,7 @@ void EditOperations::redo()
     QMdiArea *mdiArea = getActiveMdiArea();
     if (mdiArea && mdiArea->activeSubWindow()) {
         if (KTextEdit* editor = qobject_cast<KTextEdit*>(mdiArea->activeSubWindow()->widget())) {
+            ClipboardTransfer::detach(editor->document());
             editor->redo();
         }
     }
@@ -44,7 +48,7 @@ void EditOperations::cut()
     QMdiArea *mdiArea = getActiveMdiArea();
     if (mdiArea && mdiArea->activeSubWindow()) {
         if (KTextEdit* editor = qobject_cast<KTextEdit*>(mdiArea->activeSubWindow()->widget())) {
-            editor->cut();
+            MultiCursor::forEditor(editor)->cut();
         }
     }
 }
@@ -54,7 +58,7 @@ void EditOperations::copy()
     QMdiArea *mdiArea = getActiveMdiArea();
     if (mdiArea && mdiArea->activeSubWindow()) {
         if (KTextEdit* editor = qobject_cast<KTextEdit*>(mdiArea->activeSubWindow()->widget())) {
-            editor->copy();
+            MultiCursor::forEditor(editor)->copy();
         }
     }
 }
@@ -64,7 +68,37 @@ void EditOperations::paste()
     QMdiArea *mdiArea = getActiveMdiArea();
     if (mdiArea && mdiArea->activeSubWindow()) {
         if (KTextEdit* editor = qobject_cast<KTextEdit*>(mdiArea->activeSubWindow()->widget())) {
-            editor->paste();
+            MultiCursor::forEditor(editor)->paste();
         }
     }
-}
\ No newline at end of file
+}
+
+void EditOperations::selectAllOccurrences()
+{
+    QMdiArea *mdiArea = getActiveMdiArea();
+    if (mdiArea && mdiArea->activeSubWindow()) {
+        if (KTextEdit* editor = qobject_cast<KTextEdit*>(mdiArea->activeSubWindow()->widget())) {
+            MultiCursor::forEditor(editor)->selectAllOccurrences();
+        }
+    }
+}
+
+void EditOperations::addCursorAbove()
+{
+    QMdiArea *mdiArea = getActiveMdiArea();
+    if (mdiArea && mdiArea->activeSubWindow()) {
+        if (KTextEdit* editor = qobject_cast<KTextEdit*>(mdiArea->activeSubWindow()->widget())) {
+            MultiCursor::forEditor(editor)->addCursorAbove();
+        }
+    }
+}
+
+void EditOperations::addCursorBelow()
+{
+    QMdiArea *mdiArea = getActiveMdiArea();
+    if (mdiArea && mdiArea->activeSubWindow()) {
+        if (KTextEdit* editor = qobject_cast<KTextEdit*>(mdiArea->activeSubWindow()->widget())) {
+            MultiCursor::forEditor(editor)->addCursorBelow();
+        }
+    }
+}
@@ -6,7 +6,8 @@
 class QTabWidget;
 class QMdiArea;
 
-// This class handles editing operations like undo, redo, cut, copy, and paste
+// This class handles editing operations like undo, redo, cut, copy, and paste, and
+// adds cursors to the active editor
 class EditOperations : public QObject
 {
     Q_OBJECT
@@ -23,6 +24,11 @@ public Q_SLOTS:
     void copy();
     void paste();
 
+    // Multiple cursors; cut, copy and paste above apply to all of them
+    void selectAllOccurrences();
+    void addCursorAbove();
+    void addCursorBelow();
+
 private:
     // Helper function to get the active MDI area
     QMdiArea* getActiveMdiArea() const;
@@ -0,0 +1,229 @@
+#include "EncodingDetector.h"
+#include <QLoggingCategory>
+#include <QObject>
+#include <QStringDecoder>
+#include <QtAlgorithms>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MUDOEDIT_ENCODING_SSE2
+#endif
+
+Q_LOGGING_CATEGORY(encodingLog, "mudoedit.encoding")
+
+namespace {
+
+// The legacy encoding assumed for text that is not UTF-8
+const char LEGACY_ENCODING[] = "windows-1252";
+
+// Where the format of a file is kept on its window
+const char ENCODING_PROPERTY[] = "fileEncoding";
+const char BYTE_ORDER_MARK_PROPERTY[] = "fileByteOrderMark";
+const char CRLF_PROPERTY[] = "fileCrlf";
+
+QByteArray encodingName(QStringConverter::Encoding encoding)
+{
+    return QByteArray(QStringConverter::nameForEncoding(encoding));
+}
+
+} // namespace
+
+qsizetype EncodingDetector::asciiPrefix(QByteArrayView bytes)
+{
+    const uchar *data = reinterpret_cast<const uchar*>(bytes.data());
+    const qsizetype size = bytes.size();
+    qsizetype i = 0;
+
+#ifdef MUDOEDIT_ENCODING_SSE2
+    // A byte is ASCII when its top bit is clear, and movemask collects the top bits
+    for (; i + 16 <= size; i += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const uint mask = uint(_mm_movemask_epi8(block));
+        if (mask) {
+            return i + qCountTrailingZeroBits(mask);
+        }
+    }
+#endif
+
+    while (i < size && data[i] < 0x80) {
+        ++i;
+    }
+    return i;
+}
+
+bool EncodingDetector::isValidUtf8(QByteArrayView bytes)
+{
+    const uchar *data = reinterpret_cast<const uchar*>(bytes.data());
+    const qsizetype size = bytes.size();
+    qsizetype i = 0;
+    while (i < size) {
+        // Runs of ASCII are skipped vectorized; only multibyte sequences are looked at one by one
+        if (data[i] < 0x80) {
+            i += asciiPrefix(bytes.sliced(i));
+            continue;
+        }
+
+        const uchar lead = data[i];
+        int length;
+        uchar low = 0x80;
+        uchar high = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            if (lead == 0xE0) {
+                low = 0xA0;
+            } else if (lead == 0xED) {
+                high = 0x9F;
+            }
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            if (lead == 0xF0) {
+                low = 0x90;
+            } else if (lead == 0xF4) {
+                high = 0x8F;
+            }
+        } else {
+            return false;
+        }
+
+        if (size - i < length) return false;
+        if (data[i + 1] < low || data[i + 1] > high) return false;
+        for (int k = 2; k < length; ++k) {
+            if ((data[i + k] & 0xC0) != 0x80) return false;
+        }
+        i += length;
+    }
+    return true;
+}
+
+EncodingDetector::Format EncodingDetector::detect(QByteArrayView bytes)
+{
+    Format detected;
+    if (bytes.startsWith("\xEF\xBB\xBF")) {
+        detected.byteOrderMark = true;
+    } else if (bytes.startsWith("\xFF\xFE") || bytes.startsWith("\xFE\xFF")) {
+        detected.encoding = encodingName(bytes.startsWith("\xFF\xFE") ? QStringConverter::Utf16LE : QStringConverter::Utf16BE);
+        detected.byteOrderMark = true;
+    } else {
+        const qsizetype ascii = asciiPrefix(bytes);
+        if (ascii < bytes.size() && !isValidUtf8(bytes.sliced(ascii))) {
+            detected.encoding = QStringDecoder(LEGACY_ENCODING).isValid()
+                ? QByteArray(LEGACY_ENCODING) : encodingName(QStringConverter::Latin1);
+            qCDebug(encodingLog) << "Not UTF-8 from offset" << ascii << "on, taken as" << detected.encoding;
+        }
+    }
+    return detected;
+}
+
+QString EncodingDetector::decode(QByteArrayView bytes, Format *format)
+{
+    Format detected = detect(bytes);
+    QString text;
+
+    const bool utf8 = detected.encoding == encodingName(QStringConverter::Utf8);
+    if (detected.byteOrderMark) {
+        QStringDecoder decoder(detected.encoding.constData(), QStringDecoder::Flag::Stateless);
+        text = decoder.decode(bytes.sliced(utf8 ? 3 : 2));
+    } else if (utf8) {
+        // ASCII is Latin-1 as well, which only needs widening
+        text = asciiPrefix(bytes) == bytes.size() ? QString::fromLatin1(bytes) : QString::fromUtf8(bytes);
+    } else {
+        QStringDecoder decoder(detected.encoding.constData());
+        text = decoder.decode(bytes);
+    }
+
+    qsizetype lineFeeds = 0;
+    qsizetype crlfs = 0;
+    countLineBreaks(text, &lineFeeds, &crlfs);
+    if (crlfs > 0) {
+        text.replace(QStringLiteral("\r\n"), QStringLiteral("\n"));
+        detected.crlf = crlfs * 2 >= lineFeeds;
+        detected.mixedLineEndings = crlfs < lineFeeds;
+    }
+
+    if (format) {
+        *format = detected;
+    }
+    return text;
+}
+
+QByteArray EncodingDetector::encode(QStringView text, Format *format)
+{
+    QString converted;
+    if (format->crlf) {
+        converted = text.toString().replace(QLatin1Char('\n'), QStringLiteral("\r\n"));
+        text = converted;
+    }
+
+    QStringEncoder encoder = encoderFor(*format);
+    if (encoder.isValid()) {
+        QByteArray bytes = encoder.encode(text);
+        if (!encoder.hasError()) return bytes;
+    }
+
+    qCWarning(encodingLog) << "Text cannot be written as" << format->encoding << "- writing UTF-8 instead";
+    format->encoding = encodingName(QStringConverter::Utf8);
+    QStringEncoder utf8 = encoderFor(*format);
+    return utf8.encode(text);
+}
+
+QStringEncoder EncodingDetector::encoderFor(const Format &format)
+{
+    const QStringEncoder::Flags flags = format.byteOrderMark ? QStringEncoder::Flag::WriteBom : QStringEncoder::Flag::Default;
+    return QStringEncoder(format.encoding.constData(), flags);
+}
+
+void EncodingDetector::countLineBreaks(QStringView text, qsizetype *lineFeeds, qsizetype *crlfs)
+{
+    const char16_t *data = text.utf16();
+    const qsizetype size = text.size();
+    qsizetype feeds = 0;
+    qsizetype pairs = 0;
+    qsizetype i = 0;
+
+#ifdef MUDOEDIT_ENCODING_SSE2
+    // A CRLF is a carriage return in one lane and a line feed in the same lane one unit on.
+    // movemask yields two bits per UTF-16 lane, so the counts are halved
+    const __m128i lineFeed = _mm_set1_epi16(short('\n'));
+    const __m128i carriageReturn = _mm_set1_epi16(short('\r'));
+    for (; i + 9 <= size; i += 8) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1));
+        const __m128i feedsHere = _mm_cmpeq_epi16(block, lineFeed);
+        const __m128i pairsHere = _mm_and_si128(_mm_cmpeq_epi16(block, carriageReturn), _mm_cmpeq_epi16(next, lineFeed));
+        feeds += qPopulationCount(uint(_mm_movemask_epi8(feedsHere))) / 2;
+        pairs += qPopulationCount(uint(_mm_movemask_epi8(pairsHere))) / 2;
+    }
+#endif
+
+    for (; i < size; ++i) {
+        if (data[i] == u'\n') {
+            ++feeds;
+        } else if (data[i] == u'\r' && i + 1 < size && data[i + 1] == u'\n') {
+            ++pairs;
+        }
+    }
+
+    *lineFeeds = feeds;
+    *crlfs = pairs;
+}
+
+EncodingDetector::Format EncodingDetector::formatOf(const QObject *window)
+{
+    Format format;
+    const QByteArray encoding = window->property(ENCODING_PROPERTY).toByteArray();
+    if (!encoding.isEmpty()) {
+        format.encoding = encoding;
+    }
+    format.byteOrderMark = window->property(BYTE_ORDER_MARK_PROPERTY).toBool();
+    format.crlf = window->property(CRLF_PROPERTY).toBool();
+    return format;
+}
+
+void EncodingDetector::setFormat(QObject *window, const Format &format)
+{
+    window->setProperty(ENCODING_PROPERTY, format.encoding);
+    window->setProperty(BYTE_ORDER_MARK_PROPERTY, format.byteOrderMark);
+    window->setProperty(CRLF_PROPERTY, format.crlf);
+}
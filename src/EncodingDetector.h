@@ -0,0 +1,58 @@
+#ifndef ENCODINGDETECTOR_H
+#define ENCODINGDETECTOR_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <QStringEncoder>
+#include <QStringView>
+
+class QObject;
+
+// This class finds out how a text file is encoded, so it can be decoded correctly and
+// written back the same way. A byte order mark decides it; otherwise the leading ASCII is
+// skipped a vector at a time and the rest is validated as UTF-8. Text that is not UTF-8
+// is taken to be in the legacy 8-bit encoding of Windows, or Latin-1 where that is not
+// available. Pure ASCII is widened without decoding at all. Line breaks are counted a
+// vector at a time too, and the style most of them use is kept
+class EncodingDetector
+{
+public:
+    // How a file was stored
+    struct Format {
+        QByteArray encoding = "UTF-8";
+        bool byteOrderMark = false;
+        bool crlf = false;
+
+        // Both kinds of line breaks were found; crlf tells which most of them were
+        bool mixedLineEndings = false;
+    };
+
+    // Find out how raw bytes are encoded, without decoding them; line breaks are not looked at
+    static Format detect(QByteArrayView bytes);
+
+    // Decode the raw bytes of a file, turning CRLF line breaks into \n, and tell how it was stored
+    static QString decode(QByteArrayView bytes, Format *format = nullptr);
+
+    // An encoder for the encoding of a format, writing its byte order mark if it has one
+    static QStringEncoder encoderFor(const Format &format);
+
+    // Count the line feeds in a text, and how many of them follow a carriage return
+    static void countLineBreaks(QStringView text, qsizetype *lineFeeds, qsizetype *crlfs);
+
+    // Encode text for a file, with CRLF line breaks if the format has them. Text the
+    // encoding cannot hold is written as UTF-8 instead, and the format says so
+    static QByteArray encode(QStringView text, Format *format);
+
+    // Length of the run of ASCII bytes a buffer starts with
+    static qsizetype asciiPrefix(QByteArrayView bytes);
+
+    // Whether a buffer is well-formed UTF-8, without overlong forms or surrogates
+    static bool isValidUtf8(QByteArrayView bytes);
+
+    // The format of the file shown in a window, kept in its properties
+    static Format formatOf(const QObject *window);
+    static void setFormat(QObject *window, const Format &format);
+};
+
+#endif // ENCODINGDETECTOR_H
@@ -0,0 +1,14 @@
+#include "ExtraSelections.h"
+#include <KTextEdit>
+
+void ExtraSelections::replace(KTextEdit *textEdit, int property, const QList<QTextEdit::ExtraSelection> &selections)
+{
+    QList<QTextEdit::ExtraSelection> merged;
+    for (const QTextEdit::ExtraSelection &selection : textEdit->extraSelections()) {
+        if (!selection.format.hasProperty(property)) {
+            merged.append(selection);
+        }
+    }
+    merged += selections;
+    textEdit->setExtraSelections(merged);
+}
@@ -0,0 +1,18 @@
+#ifndef EXTRASELECTIONS_H
+#define EXTRASELECTIONS_H
+
+#include <QList>
+#include <QTextEdit>
+
+class KTextEdit;
+
+// This class lets several helpers share the extra selections of an editor. Every helper
+// marks its selections with its own format property and only ever replaces those
+class ExtraSelections
+{
+public:
+    // Replace the selections marked with a property, keeping those of others
+    static void replace(KTextEdit *textEdit, int property, const QList<QTextEdit::ExtraSelection> &selections);
+};
+
+#endif // EXTRASELECTIONS_H
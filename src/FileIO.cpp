@@ -1,40 +1,141 @@
 #include "FileIO.h"
 #include <QFile>
-#include <QTextStream>
 #include <QFileInfo>
+#include <QTextBlock>
+#include <QTextDocument>
 
 FileIO::FileIO(QObject *parent) : QObject(parent)
 {
 }
 
-QString FileIO::readFile(const QString &filePath)
+QString FileIO::readFile(const QString &filePath, EncodingDetector::Format *format)
 {
     QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (!file.open(QIODevice::ReadOnly)) {
         errorOccurred(QStringLiteral("Could not open file for reading: %1").arg(filePath));
         return QString();
     }
 
-    QTextStream in(&file);
-    QString content = in.readAll();
+    const QByteArray bytes = file.readAll();
     file.close();
-    return content;
+    return EncodingDetector::decode(bytes, format);
 }
 
-bool FileIO::writeFile(const QString &filePath, const QString &content)
+bool FileIO::writeFile(const QString &filePath, const QString &content, EncodingDetector::Format *format)
 {
     QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    if (!file.open(QIODevice::WriteOnly)) {
         errorOccurred(QStringLiteral("Could not open file for writing: %1").arg(filePath));
         return false;
     }
 
-    QTextStream out(&file);
-    out << content;
+    EncodingDetector::Format defaultFormat;
+    if (file.write(EncodingDetector::encode(content, format ? format : &defaultFormat)) < 0) {
+        errorOccurred(QStringLiteral("Could not write file: %1").arg(filePath));
+        return false;
+    }
+    file.close();
+    return true;
+}
+
+bool FileIO::writeDocument(const QString &filePath, const QTextDocument *document, EncodingDetector::Format *format,
+                           const SaveOptions &options)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        errorOccurred(QStringLiteral("Could not open file for writing: %1").arg(filePath));
+        return false;
+    }
+
+    bool encodingFailed = false;
+    bool written = writeLines(&file, document, *format, options, &encodingFailed);
+    if (!written && encodingFailed) {
+        // Start over in an encoding that holds everything
+        format->encoding = QByteArray(QStringConverter::nameForEncoding(QStringConverter::Utf8));
+        written = file.resize(0) && file.seek(0) && writeLines(&file, document, *format, options, &encodingFailed);
+    }
+    if (!written) {
+        errorOccurred(QStringLiteral("Could not write file: %1").arg(filePath));
+        return false;
+    }
     file.close();
     return true;
 }
 
+bool FileIO::writeLines(QFile *file, const QTextDocument *document, const EncodingDetector::Format &format,
+                        const SaveOptions &options, bool *encodingFailed)
+{
+    QStringEncoder encoder = EncodingDetector::encoderFor(format);
+    if (!encoder.isValid()) {
+        *encodingFailed = true;
+        return false;
+    }
+
+    const QString lineBreak = format.crlf ? QStringLiteral("\r\n") : QStringLiteral("\n");
+    QString buffer;
+    buffer.reserve(WRITE_CHUNK_CHARACTERS + 1024);
+    const auto flush = [&]() {
+        const QByteArray bytes = encoder.encode(buffer);
+        buffer.resize(0);
+        if (encoder.hasError()) {
+            *encodingFailed = true;
+            return false;
+        }
+        return file->write(bytes) == bytes.size();
+    };
+
+    // Blocks are written as they are, so the document is never copied whole
+    bool lastLineEmpty = true;
+    for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+        const QString text = block.text();
+        bool firstSegment = true;
+        for (QStringView segment : QStringView(text).split(QChar::LineSeparator)) {
+            if (!firstSegment) {
+                buffer += lineBreak;
+            }
+            firstSegment = false;
+            if (options.trimTrailingWhitespace) {
+                while (!segment.isEmpty() && (segment.back() == QLatin1Char(' ') || segment.back() == QLatin1Char('\t'))) {
+                    segment.chop(1);
+                }
+            }
+            buffer += segment;
+            lastLineEmpty = segment.isEmpty();
+        }
+        if (block.next().isValid()) {
+            buffer += lineBreak;
+        }
+        if (buffer.size() >= WRITE_CHUNK_CHARACTERS && !flush()) return false;
+    }
+
+    // An empty last line means the text already ends with a line break
+    if (options.ensureFinalNewline && !lastLineEmpty) {
+        buffer += lineBreak;
+    }
+    return flush();
+}
+
+bool FileIO::isBinaryFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    const QByteArray sample = file.read(BINARY_SAMPLE_BYTES);
+
+    // UTF-16 text is full of zero bytes but says so up front
+    if (sample.startsWith("\xFF\xFE") || sample.startsWith("\xFE\xFF")) return false;
+
+    // Text has no zero bytes and few control characters besides whitespace and escapes
+    qsizetype controls = 0;
+    for (const char byte : sample) {
+        const uchar value = uchar(byte);
+        if (value == 0) return true;
+        if (value < 0x20 && value != '\t' && value != '\n' && value != '\r' && value != '\f' && value != 0x1B) {
+            ++controls;
+        }
+    }
+    return controls * 10 > sample.size();
+}
+
 bool FileIO::isFileReadable(const QString &filePath)
 {
     QFileInfo fileInfo(filePath);
@@ -1,9 +1,11 @@
 #ifndef FILEIO_H
 #define FILEIO_H
 
+#include "EncodingDetector.h"
 #include <QString>
 #include <QObject>
 
+class QFile;
 class QTextDocument;
 
 // This class handles file reading and writing operations
@@ -14,18 +16,44 @@ class FileIO : public QObject
 public:
     explicit FileIO(QObject *parent = nullptr);
 
-    // Read the contents of a file
-    QString readFile(const QString &filePath);
+    // Read the contents of a file, detecting how it is encoded
+    QString readFile(const QString &filePath, EncodingDetector::Format *format = nullptr);
 
-    // Write content to a file
-    bool writeFile(const QString &filePath, const QString &content);
+    // Write content to a file in a format; UTF-8 with \n line breaks if none is given
+    bool writeFile(const QString &filePath, const QString &content, EncodingDetector::Format *format = nullptr);
+
+    // Whitespace cleanup done to lines as they are written; the document is left as it is
+    struct SaveOptions {
+        bool trimTrailingWhitespace = false;
+        bool ensureFinalNewline = false;
+    };
+
+    // Write a document line by line in a format. Text the encoding cannot hold is
+    // written as UTF-8 instead, and the format says so
+    bool writeDocument(const QString &filePath, const QTextDocument *document, EncodingDetector::Format *format,
+                       const SaveOptions &options = SaveOptions());
 
     // Check if a file exists and is readable
     bool isFileReadable(const QString &filePath);
 
+    // Guess from the first bytes of a file whether it is binary rather than text
+    static bool isBinaryFile(const QString &filePath);
+
 Q_SIGNALS:
     // Signal emitted when a file operation encounters an error
     void errorOccurred(const QString &errorMessage);
+
+private:
+    // Write the lines of a document through an encoder; false with encodingFailed set if
+    // the encoding cannot hold some of the text
+    bool writeLines(QFile *file, const QTextDocument *document, const EncodingDetector::Format &format,
+                    const SaveOptions &options, bool *encodingFailed);
+
+    // Bytes looked at to tell binary files from text
+    static const int BINARY_SAMPLE_BYTES = 8192;
+
+    // Characters collected before they are encoded and written
+    static const int WRITE_CHUNK_CHARACTERS = 1 << 16;
 };
 
 #endif // FILEIO_H
\ No newline at end of file
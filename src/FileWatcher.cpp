@@ -0,0 +1,459 @@
+#include "FileWatcher.h"
+#include "ClipboardTransfer.h"
+#include "DocumentManager.h"
+#include "LogFollower.h"
+#include "MemoryBudgetManager.h"
+#include <QApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QLoggingCategory>
+#include <QMdiArea>
+#include <QMdiSubWindow>
+#include <QPointer>
+#include <QScrollBar>
+#include <QSplitter>
+#include <QTabWidget>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QThreadPool>
+#include <QTimer>
+#include <KLocalizedString>
+#include <KMessageBox>
+#include <KTextEdit>
+#include <utility>
+
+Q_LOGGING_CATEGORY(fileWatcherLog, "mudoedit.filewatcher")
+
+namespace {
+
+// Bytes hashed per read
+const qint64 HASH_CHUNK_BYTES = 1 << 20;
+
+// Where following a file stopped, kept on its window
+const char FOLLOW_OFFSET_PROPERTY[] = "followOffset";
+const char FOLLOW_REVISION_PROPERTY[] = "followRevision";
+
+} // namespace
+
+FileWatcher::FileWatcher(QTabWidget *tabWidget, DocumentManager *documentManager, QObject *parent)
+    : QObject(parent),
+      m_tabWidget(tabWidget),
+      m_documentManager(documentManager),
+      m_watcher(new QFileSystemWatcher(this)),
+      m_checkTimer(new QTimer(this))
+{
+    m_checkTimer->setSingleShot(true);
+    m_checkTimer->setInterval(CHECK_DELAY);
+    connect(m_checkTimer, &QTimer::timeout, this, &FileWatcher::checkPending);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &FileWatcher::pathChanged);
+
+    // Only the directories of missing files are watched, for the files to come back
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, [this](const QString &directory) {
+        for (auto it = m_baselines.cbegin(); it != m_baselines.cend(); ++it) {
+            if (it->missing && QFileInfo(it.key()).absolutePath() == directory) {
+                pathChanged(it.key());
+            }
+        }
+    });
+}
+
+quint64 FileWatcher::hashFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return 0;
+
+    quint64 hash = 0;
+    while (!file.atEnd()) {
+        const QByteArray chunk = file.read(HASH_CHUNK_BYTES);
+        if (chunk.isEmpty()) break;
+        hash = qHashBits(chunk.constData(), size_t(chunk.size()), size_t(hash));
+    }
+    return hash;
+}
+
+void FileWatcher::watchFile(const QString &path)
+{
+    const QString filePath = QDir::cleanPath(path);
+
+    // Files shown by a viewer are never loaded, so there is nothing to keep in step; the
+    // viewers watch their file themselves and open it again when it is cut short
+    QMdiSubWindow *window = m_documentManager->findOpenDocument(filePath);
+    if (window && !qobject_cast<KTextEdit*>(window->widget())) return;
+
+    const QFileInfo info(filePath);
+    Baseline baseline;
+    baseline.size = info.size();
+    baseline.modified = info.lastModified();
+    baseline.missing = !info.exists();
+    m_baselines.insert(filePath, baseline);
+    if (!baseline.missing && !m_watcher->files().contains(filePath)) {
+        m_watcher->addPath(filePath);
+    }
+    updateDirectories();
+
+    if (window) {
+        connect(window, &QObject::destroyed, this, &FileWatcher::pruneClosed,
+                Qt::ConnectionType(Qt::QueuedConnection | Qt::UniqueConnection));
+    }
+
+    // The hash is only needed once the file changes, so it may take its time
+    QPointer<FileWatcher> self(this);
+    QThreadPool::globalInstance()->start([self, filePath, baseline]() {
+        const quint64 hash = hashFile(filePath);
+        QMetaObject::invokeMethod(qApp, [self, filePath, baseline, hash]() {
+            if (!self) return;
+            auto it = self->m_baselines.find(filePath);
+            if (it != self->m_baselines.end() && it->size == baseline.size && it->modified == baseline.modified) {
+                it->hash = hash;
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void FileWatcher::pathChanged(const QString &path)
+{
+    m_pending.insert(path);
+    m_checkTimer->start();
+}
+
+void FileWatcher::checkPending()
+{
+    const QSet<QString> pending = std::exchange(m_pending, QSet<QString>());
+    for (const QString &filePath : pending) {
+        auto it = m_baselines.find(filePath);
+        if (it == m_baselines.end()) continue;
+        QMdiSubWindow *window = m_documentManager->findOpenDocument(filePath);
+        if (!window) {
+            unwatch(filePath);
+            continue;
+        }
+
+        // A followed file is read as it grows; hashing it on every write would be wasted
+        if (window->property("following").toBool()) continue;
+
+        const QFileInfo info(filePath);
+        if (!info.exists()) {
+            if (!it->missing) {
+                it->missing = true;
+                updateDirectories();
+                Q_EMIT statusMessage(i18n("%1 was deleted or moved on disk", info.fileName()));
+            }
+            continue;
+        }
+
+        // A file replaced by a rename is a new file to the watcher
+        if (!m_watcher->files().contains(filePath)) {
+            m_watcher->addPath(filePath);
+        }
+
+        Baseline current;
+        current.size = info.size();
+        current.modified = info.lastModified();
+        if (!it->missing && current.size == it->size && current.modified == it->modified) continue;
+
+        QPointer<FileWatcher> self(this);
+        QThreadPool::globalInstance()->start([self, filePath, current]() mutable {
+            current.hash = hashFile(filePath);
+            QMetaObject::invokeMethod(qApp, [self, filePath, current]() {
+                if (self) {
+                    self->hashed(filePath, current);
+                }
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void FileWatcher::hashed(const QString &filePath, const Baseline &current)
+{
+    auto it = m_baselines.find(filePath);
+    if (it == m_baselines.end()) return;
+
+    // Touched, or written again with the same content
+    const bool sameContent = current.hash != 0 && current.hash == it->hash;
+    *it = current;
+    updateDirectories();
+    if (sameContent) {
+        qCDebug(fileWatcherLog) << "Content of" << filePath << "is unchanged";
+        return;
+    }
+    fileChanged(filePath);
+}
+
+void FileWatcher::fileChanged(const QString &filePath)
+{
+    QPointer<QMdiSubWindow> window = m_documentManager->findOpenDocument(filePath);
+    KTextEdit *textEdit = window ? qobject_cast<KTextEdit*>(window->widget()) : nullptr;
+    if (!textEdit) {
+        unwatch(filePath);
+        return;
+    }
+    if (window->property("following").toBool()) return;
+
+    // A reload would edit inside the open edit block of the paste; decide once it is done,
+    // when the document is modified by the paste and the user gets asked
+    if (ClipboardTransfer::isPasting(textEdit)) {
+        QTimer::singleShot(PASTE_RETRY_DELAY, this, [this, filePath]() {
+            fileChanged(filePath);
+        });
+        return;
+    }
+
+    const QString fileName = QFileInfo(filePath).fileName();
+    qCDebug(fileWatcherLog) << filePath << "was changed on disk";
+
+    if (!textEdit->document()->isModified()) {
+        // An unloaded document is read from disk anyway when it is shown again
+        if (MemoryBudgetManager::isEvicted(textEdit)) {
+            Q_EMIT statusMessage(i18n("%1 was changed on disk", fileName));
+            return;
+        }
+        reload(window);
+        return;
+    }
+
+    if (m_asking.contains(filePath)) return;
+    m_asking.insert(filePath);
+    const int ret = KMessageBox::questionTwoActions(m_tabWidget,
+        i18n("The file %1 was changed on disk, and the document has unsaved changes. "
+             "Reload it from disk and lose your changes?", filePath),
+        i18n("File Changed on Disk"),
+        KGuiItem(i18n("&Reload"), QStringLiteral("view-refresh")),
+        KGuiItem(i18n("&Keep My Changes"), QStringLiteral("document-edit")));
+    m_asking.remove(filePath);
+    if (!window) return;
+
+    if (ret == KMessageBox::PrimaryAction) {
+        reload(window);
+    } else {
+        window->setProperty("externallyModified", true);
+        Q_EMIT statusMessage(i18n("%1 was changed on disk; saving will ask before overwriting it", fileName));
+    }
+}
+
+void FileWatcher::reload(QMdiSubWindow *subWindow)
+{
+    KTextEdit *textEdit = qobject_cast<KTextEdit*>(subWindow->widget());
+    const QString filePath = QDir::cleanPath(subWindow->property("fullFilePath").toString());
+    if (!textEdit || filePath.isEmpty() || !MemoryBudgetManager::ensureResident(textEdit)) return;
+
+    // Raw text keeps the paragraph separators between blocks and non-breaking spaces as they are
+    QTextDocument *document = textEdit->document();
+    const QString oldText = document->toRawText();
+    const int revision = document->revision();
+
+    QPointer<FileWatcher> self(this);
+    QPointer<QMdiSubWindow> window(subWindow);
+    QThreadPool::globalInstance()->start([self, window, filePath, oldText, revision]() {
+        ReloadResult result;
+        result.revision = revision;
+        const QFileInfo info(filePath);
+        result.baseline.size = info.size();
+        result.baseline.modified = info.lastModified();
+        result.baseline.hash = hashFile(filePath);
+
+        QFile file(filePath);
+        result.readable = file.open(QIODevice::ReadOnly);
+        if (result.readable) {
+            result.newLines = EncodingDetector::decode(file.readAll(), &result.format).split(QLatin1Char('\n'));
+
+            std::vector<size_t> oldHashes;
+            std::vector<size_t> newHashes;
+            for (QStringView line : QStringView(oldText).split(QChar::ParagraphSeparator)) {
+                oldHashes.push_back(TextDiff::hashLine(line));
+            }
+            newHashes.reserve(size_t(result.newLines.size()));
+            for (const QString &line : std::as_const(result.newLines)) {
+                newHashes.push_back(TextDiff::hashLine(line));
+            }
+            result.hunks = TextDiff::compute(oldHashes, newHashes);
+        }
+
+        QMetaObject::invokeMethod(qApp, [self, window, filePath, result]() {
+            if (self && window) {
+                self->applyReload(window, filePath, result);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void FileWatcher::applyReload(QMdiSubWindow *subWindow, const QString &filePath, const ReloadResult &result)
+{
+    KTextEdit *textEdit = qobject_cast<KTextEdit*>(subWindow->widget());
+    if (!textEdit) return;
+
+    // Followed again meanwhile; the follower keeps the document in step itself
+    if (subWindow->property("following").toBool()) return;
+
+    const QString fileName = QFileInfo(filePath).fileName();
+    if (!result.readable) {
+        Q_EMIT statusMessage(i18n("%1 could not be read to reload it", fileName));
+        return;
+    }
+
+    // A paste started meanwhile; whether to reload is decided again once it is done
+    if (ClipboardTransfer::isPasting(textEdit)) {
+        fileChanged(filePath);
+        return;
+    }
+
+    // Typed into meanwhile; the hunks no longer fit, so diff again
+    QTextDocument *document = textEdit->document();
+    if (document->revision() != result.revision) {
+        reload(subWindow);
+        return;
+    }
+
+    ClipboardTransfer::detach(document);
+    const int scrollPosition = textEdit->verticalScrollBar()->value();
+
+    // Last to first, so the line numbers of the hunks still to come stay valid. Whole
+    // lines are replaced; removed lines take one line break with them
+    QTextCursor cursor(document);
+    cursor.beginEditBlock();
+    for (auto hunk = result.hunks.crbegin(); hunk != result.hunks.crend(); ++hunk) {
+        const QString text = result.newLines.mid(hunk->newStart, hunk->newCount).join(QLatin1Char('\n'));
+        if (hunk->oldCount == 0) {
+            const QTextBlock before = document->findBlockByNumber(hunk->oldStart);
+            if (before.isValid()) {
+                cursor.setPosition(before.position());
+                cursor.insertText(text + QLatin1Char('\n'));
+            } else {
+                cursor.movePosition(QTextCursor::End);
+                cursor.insertText(QLatin1Char('\n') + text);
+            }
+            continue;
+        }
+
+        const QTextBlock first = document->findBlockByNumber(hunk->oldStart);
+        const QTextBlock last = document->findBlockByNumber(hunk->oldStart + hunk->oldCount - 1);
+        int start = first.position();
+        int end = last.position() + last.length() - 1;
+        if (hunk->newCount == 0) {
+            if (last.next().isValid()) {
+                end = last.next().position();
+            } else if (first.previous().isValid()) {
+                start = first.previous().position() + first.previous().length() - 1;
+            }
+        }
+        cursor.setPosition(start);
+        cursor.setPosition(end, QTextCursor::KeepAnchor);
+        cursor.insertText(text);
+    }
+    cursor.endEditBlock();
+
+    textEdit->verticalScrollBar()->setValue(scrollPosition);
+    document->setModified(false);
+    subWindow->setProperty("externallyModified", false);
+    EncodingDetector::setFormat(subWindow, result.format);
+    m_baselines.insert(filePath, result.baseline);
+
+    qCDebug(fileWatcherLog) << "Reloaded" << filePath << "with" << result.hunks.size() << "changed regions";
+    Q_EMIT statusMessage(i18np("Reloaded %2 from disk: %1 region changed", "Reloaded %2 from disk: %1 regions changed",
+                               int(result.hunks.size()), fileName));
+}
+
+void FileWatcher::toggleFollow()
+{
+    QMdiArea *mdiArea = getActiveMdiArea();
+    QMdiSubWindow *window = mdiArea ? mdiArea->activeSubWindow() : nullptr;
+    KTextEdit *textEdit = window ? qobject_cast<KTextEdit*>(window->widget()) : nullptr;
+    if (!textEdit) return;
+
+    const QString filePath = QDir::cleanPath(window->property("fullFilePath").toString());
+    const QString fileName = QFileInfo(filePath).fileName();
+    if (LogFollower *follower = LogFollower::forWindow(window)) {
+        const qint64 offset = follower->offset();
+        delete follower;
+
+        // Following again goes on from where the follower stopped, as long as the document
+        // was not changed in between
+        window->setProperty(FOLLOW_OFFSET_PROPERTY, offset);
+        window->setProperty(FOLLOW_REVISION_PROPERTY, textEdit->document()->revision());
+
+        // Whatever came after the last read is a change on disk from now on, and is
+        // reloaded like one
+        watchFile(filePath);
+        auto it = m_baselines.find(filePath);
+        if (it != m_baselines.end() && !it->missing && it->size != offset) {
+            it->size = offset;
+            pathChanged(filePath);
+        }
+        Q_EMIT statusMessage(i18n("Stopped following %1", fileName));
+        return;
+    }
+
+    if (filePath.isEmpty()) {
+        KMessageBox::information(m_tabWidget, i18n("Only a document opened from a file can follow it."));
+        return;
+    }
+    if (textEdit->document()->isModified() || ClipboardTransfer::isPasting(textEdit)) {
+        KMessageBox::information(m_tabWidget, i18n("Save or reload %1 before following it.", fileName));
+        return;
+    }
+
+    // The document holds the file as it was last read or written; follow on from there
+    const auto it = m_baselines.constFind(filePath);
+    qint64 offset = it != m_baselines.cend() && !it->missing ? it->size : QFileInfo(filePath).size();
+    const QVariant followOffset = window->property(FOLLOW_OFFSET_PROPERTY);
+    if (followOffset.isValid() && window->property(FOLLOW_REVISION_PROPERTY).toInt() == textEdit->document()->revision()) {
+        offset = followOffset.toLongLong();
+    }
+    LogFollower *follower = LogFollower::follow(window, offset);
+    if (!follower) return;
+    connect(follower, &LogFollower::statusMessage, this, &FileWatcher::statusMessage);
+    Q_EMIT statusMessage(i18n("Following %1", fileName));
+}
+
+void FileWatcher::unwatch(const QString &filePath)
+{
+    m_baselines.remove(filePath);
+    m_pending.remove(filePath);
+    if (m_watcher->files().contains(filePath)) {
+        m_watcher->removePath(filePath);
+    }
+    updateDirectories();
+    qCDebug(fileWatcherLog) << "Stopped watching" << filePath;
+}
+
+void FileWatcher::pruneClosed()
+{
+    const QStringList filePaths = m_baselines.keys();
+    for (const QString &filePath : filePaths) {
+        if (!m_documentManager->findOpenDocument(filePath)) {
+            unwatch(filePath);
+        }
+    }
+}
+
+QMdiArea* FileWatcher::getActiveMdiArea() const
+{
+    QSplitter *splitter = qobject_cast<QSplitter*>(m_tabWidget->currentWidget());
+    if (splitter) {
+        return qobject_cast<QMdiArea*>(splitter->widget(0));
+    }
+    return nullptr;
+}
+
+void FileWatcher::updateDirectories()
+{
+    QSet<QString> wanted;
+    for (auto it = m_baselines.cbegin(); it != m_baselines.cend(); ++it) {
+        if (it->missing) {
+            wanted.insert(QFileInfo(it.key()).absolutePath());
+        }
+    }
+    const QStringList watched = m_watcher->directories();
+    for (const QString &directory : watched) {
+        if (!wanted.contains(directory)) {
+            m_watcher->removePath(directory);
+        }
+    }
+    for (const QString &directory : std::as_const(wanted)) {
+        if (!watched.contains(directory) && QFileInfo::exists(directory)) {
+            m_watcher->addPath(directory);
+        }
+    }
+}
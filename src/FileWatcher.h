@@ -0,0 +1,115 @@
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include "EncodingDetector.h"
+#include "TextDiff.h"
+
+class QFileSystemWatcher;
+class QMdiArea;
+class QMdiSubWindow;
+class QTabWidget;
+class QTimer;
+class KTextEdit;
+class DocumentManager;
+
+// This class notices when the files of open documents are changed by other programs.
+// A change notification is checked against the size and modification time recorded
+// when the file was loaded or saved, and only then against a hash of its content, so
+// touching a file or saving it ourselves is not a change. An unmodified document is
+// reloaded by applying only the lines that differ as one undo step, which keeps the
+// cursor, the scroll position and the highlighting of everything else; a modified one
+// is marked so that saving it asks first and autosave leaves it alone
+class FileWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FileWatcher(QTabWidget *tabWidget, DocumentManager *documentManager, QObject *parent = nullptr);
+
+    // Hash of a file's content, or 0 if it cannot be read
+    static quint64 hashFile(const QString &filePath);
+
+public Q_SLOTS:
+    // Record the file as loaded or saved by us and start watching it
+    void watchFile(const QString &filePath);
+
+    // Replace the document of a window with its file, changing only the lines that differ
+    void reload(QMdiSubWindow *subWindow);
+
+    // Start or stop appending what is written to the file of the active document
+    void toggleFollow();
+
+Q_SIGNALS:
+    // Emitted when a document was reloaded or followed, or its file changed or disappeared
+    void statusMessage(const QString &message);
+
+private:
+    // What a file looked like when we last read or wrote it
+    struct Baseline {
+        qint64 size = -1;
+        QDateTime modified;
+        quint64 hash = 0;
+        bool missing = false;
+    };
+
+    // What a reload computed on the worker
+    struct ReloadResult {
+        QList<TextDiff::Hunk> hunks;
+        QStringList newLines;
+        int revision = 0;
+        Baseline baseline;
+        EncodingDetector::Format format;
+        bool readable = false;
+    };
+
+    // Collect notifications, which tend to come in bursts while a file is written
+    void pathChanged(const QString &path);
+
+    // Look at the files that were reported since the last check
+    void checkPending();
+
+    // Compare the hash of a changed file with the recorded one
+    void hashed(const QString &filePath, const Baseline &current);
+
+    // Reload or mark the document of a file whose content really changed
+    void fileChanged(const QString &filePath);
+
+    // Apply the lines that differ, if the document has not changed since the reload started
+    void applyReload(QMdiSubWindow *subWindow, const QString &filePath, const ReloadResult &result);
+
+    // Stop watching a file no open document shows any more
+    void unwatch(const QString &filePath);
+
+    // Stop watching the files of closed documents
+    void pruneClosed();
+
+    // Watch the directories of missing files, to see them come back
+    void updateDirectories();
+
+    QMdiArea* getActiveMdiArea() const;
+
+    QTabWidget *m_tabWidget;
+    DocumentManager *m_documentManager;
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_checkTimer;
+    QHash<QString, Baseline> m_baselines;
+    QSet<QString> m_pending;
+
+    // Files whose change is being asked about, so a burst of notifications asks once
+    QSet<QString> m_asking;
+
+    // Wait this long after the last notification before looking at a file
+    static const int CHECK_DELAY = 200;
+
+    // How often to look again at a change that came in during a paste
+    static const int PASTE_RETRY_DELAY = 500;
+};
+
+#endif // FILEWATCHER_H
@@ -0,0 +1,174 @@
+#include "FilterManager.h"
+#include "FilterView.h"
+#include "HexView.h"
+#include "HugeFileView.h"
+#include "MemoryBudgetManager.h"
+#include <QCheckBox>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QMdiArea>
+#include <QMdiSubWindow>
+#include <QPointer>
+#include <QPushButton>
+#include <QRegularExpression>
+#include <QSpinBox>
+#include <QSplitter>
+#include <QTabWidget>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTimer>
+#include <QVBoxLayout>
+#include <KLocalizedString>
+#include <KMessageBox>
+#include <KTextEdit>
+
+FilterManager::FilterManager(QTabWidget *tabWidget, QObject *parent)
+    : QObject(parent),
+      m_tabWidget(tabWidget)
+{
+}
+
+QMdiArea* FilterManager::getActiveMdiArea() const
+{
+    QSplitter *splitter = qobject_cast<QSplitter*>(m_tabWidget->currentWidget());
+    if (splitter) {
+        return qobject_cast<QMdiArea*>(splitter->widget(0));
+    }
+    return nullptr;
+}
+
+void FilterManager::showFilter()
+{
+    QMdiArea *mdiArea = getActiveMdiArea();
+    QMdiSubWindow *subWindow = mdiArea ? mdiArea->activeSubWindow() : nullptr;
+    KTextEdit *textEdit = subWindow ? qobject_cast<KTextEdit*>(subWindow->widget()) : nullptr;
+
+    // The viewers never load their file, so there are no lines to filter
+    if (subWindow && qobject_cast<HugeFileView*>(subWindow->widget())) {
+        KMessageBox::information(m_tabWidget,
+            i18n("%1 is too large to load and is shown read-only, so it cannot be filtered. "
+                 "Raise \"Open read-only from file size\" in the settings to open it as a document.",
+                 subWindow->property("fullFilePath").toString()));
+        return;
+    }
+    if (subWindow && qobject_cast<HexView*>(subWindow->widget())) {
+        KMessageBox::information(m_tabWidget, i18n("Binary files cannot be filtered."));
+        return;
+    }
+    if (!textEdit || !MemoryBudgetManager::ensureResident(textEdit)) return;
+
+    // A selection within one line is what the user wants to see more of
+    QString initialPattern;
+    const QString selection = textEdit->textCursor().selectedText();
+    if (!selection.isEmpty() && !selection.contains(QChar::ParagraphSeparator)) {
+        initialPattern = QRegularExpression::escape(selection);
+    }
+
+    QWidget *window = new QWidget(m_tabWidget, Qt::Window);
+    window->setWindowTitle(i18n("Filter %1", subWindow->windowTitle()));
+    window->setAttribute(Qt::WA_DeleteOnClose);
+    window->resize(900, 600);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(window);
+
+    QHBoxLayout *patternLayout = new QHBoxLayout;
+    QLineEdit *patternEdit = new QLineEdit(initialPattern);
+    patternEdit->setPlaceholderText(i18n("Regular expression"));
+    patternEdit->setClearButtonEnabled(true);
+    QCheckBox *caseCheckBox = new QCheckBox(i18n("Match &case"));
+    QSpinBox *contextSpinBox = new QSpinBox;
+    contextSpinBox->setRange(0, 100);
+    contextSpinBox->setPrefix(i18n("Context: "));
+    contextSpinBox->setSuffix(i18n(" lines"));
+    patternLayout->addWidget(new QLabel(i18n("Show lines matching:")));
+    patternLayout->addWidget(patternEdit, 1);
+    patternLayout->addWidget(caseCheckBox);
+    patternLayout->addWidget(contextSpinBox);
+    mainLayout->addLayout(patternLayout);
+
+    FilterView *view = new FilterView;
+    view->setDocument(textEdit->document());
+    mainLayout->addWidget(view, 1);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout;
+    QLabel *summaryLabel = new QLabel;
+    QPushButton *closeButton = new QPushButton(i18n("Close"));
+    buttonLayout->addWidget(summaryLabel, 1);
+    buttonLayout->addWidget(closeButton);
+    mainLayout->addLayout(buttonLayout);
+
+    QTimer *patternTimer = new QTimer(window);
+    patternTimer->setSingleShot(true);
+    patternTimer->setInterval(PATTERN_DELAY);
+
+    const auto updateSummary = [view, summaryLabel]() {
+        const QString matches = i18np("%1 matching line of %2", "%1 matching lines of %2", view->matchCount(), view->lineCount());
+        summaryLabel->setText(view->isScanning() ? i18n("%1, searching...", matches) : matches);
+    };
+    const auto applyPattern = [view, patternEdit, caseCheckBox, summaryLabel, updateSummary]() {
+        QRegularExpression pattern(patternEdit->text());
+        if (!caseCheckBox->isChecked()) {
+            pattern.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
+        }
+        if (!pattern.isValid()) {
+            view->setPattern(QRegularExpression());
+            summaryLabel->setText(i18n("The regular expression is not valid: %1", pattern.errorString()));
+            return;
+        }
+        view->setPattern(pattern);
+        updateSummary();
+    };
+
+    connect(patternEdit, &QLineEdit::textChanged, patternTimer, qOverload<>(&QTimer::start));
+    connect(patternEdit, &QLineEdit::returnPressed, window, [patternTimer, applyPattern]() {
+        patternTimer->stop();
+        applyPattern();
+    });
+    connect(patternTimer, &QTimer::timeout, window, applyPattern);
+    connect(caseCheckBox, &QCheckBox::toggled, window, applyPattern);
+    connect(contextSpinBox, &QSpinBox::valueChanged, view, &FilterView::setContextLines);
+    connect(view, &FilterView::filterUpdated, summaryLabel, updateSummary);
+    connect(closeButton, &QPushButton::clicked, window, &QWidget::close);
+
+    QPointer<QMdiSubWindow> source(subWindow);
+    connect(view, &FilterView::lineActivated, this, [this, source](int line) {
+        if (source) {
+            goToLine(source, line);
+        }
+    });
+
+    // The window is no use once its document is closed, and the document must stay loaded for it
+    MemoryBudgetManager::pin(textEdit);
+    connect(textEdit, &QObject::destroyed, window, &QWidget::close);
+    connect(window, &QObject::destroyed, textEdit, [textEdit]() {
+        MemoryBudgetManager::unpin(textEdit);
+    });
+
+    applyPattern();
+    window->show();
+    patternEdit->setFocus();
+}
+
+void FilterManager::goToLine(QMdiSubWindow *subWindow, int line)
+{
+    KTextEdit *textEdit = qobject_cast<KTextEdit*>(subWindow->widget());
+    if (!textEdit) return;
+
+    // Bring up the tab holding the document first
+    for (int i = 0; i < m_tabWidget->count(); ++i) {
+        QSplitter *splitter = qobject_cast<QSplitter*>(m_tabWidget->widget(i));
+        if (splitter && splitter->widget(0) == subWindow->mdiArea()) {
+            m_tabWidget->setCurrentIndex(i);
+            break;
+        }
+    }
+    subWindow->mdiArea()->setActiveSubWindow(subWindow);
+
+    const QTextBlock block = textEdit->document()->findBlockByNumber(line);
+    if (!block.isValid()) return;
+    textEdit->setTextCursor(QTextCursor(block));
+    textEdit->ensureCursorVisible();
+    m_tabWidget->window()->activateWindow();
+    textEdit->setFocus();
+}
@@ -0,0 +1,37 @@
+#ifndef FILTERMANAGER_H
+#define FILTERMANAGER_H
+
+#include <QObject>
+
+class QTabWidget;
+class QMdiArea;
+class QMdiSubWindow;
+class KTextEdit;
+
+// This class opens filter windows that show only the lines of the active document
+// matching a regular expression. The windows follow the document as it is edited or
+// grows, jump to a line in the document when it is activated and close with it
+class FilterManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FilterManager(QTabWidget *tabWidget, QObject *parent = nullptr);
+
+public Q_SLOTS:
+    // Open a filter window for the active document, starting from the selected text
+    void showFilter();
+
+private:
+    // Show a line of a document in its editor
+    void goToLine(QMdiSubWindow *subWindow, int line);
+
+    QMdiArea* getActiveMdiArea() const;
+
+    QTabWidget *m_tabWidget;
+
+    // Match again once typing in the pattern has paused for this long
+    static const int PATTERN_DELAY = 300;
+};
+
+#endif // FILTERMANAGER_H
@@ -0,0 +1,415 @@
+#include "FilterView.h"
+#include "BlockChange.h"
+#include <QApplication>
+#include <QFontDatabase>
+#include <QKeyEvent>
+#include <QLoggingCategory>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(filterViewLog, "mudoedit.filterview")
+
+namespace {
+
+// Nobody scrolls further right than this within one line
+const int MAX_PAINTED_CHARACTERS = 4096;
+
+// A line as it is painted
+QString expandTabs(QString text)
+{
+    return text.replace(QLatin1Char('\t'), QStringLiteral("    "));
+}
+
+} // namespace
+
+FilterView::FilterView(QWidget *parent)
+    : QAbstractScrollArea(parent),
+      m_contextLines(0),
+      m_blockCount(0),
+      m_currentRow(-1),
+      m_dirtyFirst(-1),
+      m_dirtyLast(-1),
+      m_nextSlice(0),
+      m_scanTimer(new QTimer(this)),
+      m_rowsTimer(new QTimer(this))
+{
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    setFocusPolicy(Qt::StrongFocus);
+
+    m_scanTimer->setSingleShot(true);
+    m_scanTimer->setInterval(SCAN_DELAY);
+    connect(m_scanTimer, &QTimer::timeout, this, &FilterView::startScan);
+    m_rowsTimer->setSingleShot(true);
+    m_rowsTimer->setInterval(ROWS_DELAY);
+    connect(m_rowsTimer, &QTimer::timeout, this, &FilterView::buildRows);
+}
+
+FilterView::~FilterView()
+{
+}
+
+void FilterView::setDocument(QTextDocument *document)
+{
+    m_document = document;
+    connect(document, &QTextDocument::contentsChange, this, &FilterView::contentsChanged);
+    resetAll();
+    startScan();
+}
+
+void FilterView::setPattern(const QRegularExpression &pattern)
+{
+    m_pattern = pattern;
+    m_pattern.optimize();
+    resetAll();
+    buildRows();
+    startScan();
+}
+
+void FilterView::setContextLines(int lines)
+{
+    if (lines == m_contextLines) return;
+    m_contextLines = lines;
+    buildRows();
+}
+
+void FilterView::resetAll()
+{
+    // Slices still running find themselves gone and are dropped
+    m_slices.clear();
+    m_matches.clear();
+    m_blockCount = m_document ? m_document->blockCount() : 0;
+    m_dirtyFirst = m_dirtyLast = -1;
+    if (m_document && !m_pattern.pattern().isEmpty() && m_pattern.isValid()) {
+        markDirty(0, m_blockCount - 1);
+    }
+}
+
+void FilterView::markDirty(int first, int last)
+{
+    if (m_dirtyFirst < 0) {
+        m_dirtyFirst = first;
+        m_dirtyLast = last;
+    } else {
+        m_dirtyFirst = qMin(m_dirtyFirst, first);
+        m_dirtyLast = qMax(m_dirtyLast, last);
+    }
+}
+
+void FilterView::contentsChanged(int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved)
+    const BlockChange change = BlockChange::fromEdit(m_document, position, charsAdded, m_blockCount);
+    m_rowsTimer->start();
+    if (!change.isValid()) {
+        qCDebug(filterViewLog) << "Could not match up the edited blocks, matching the document again";
+        resetAll();
+        m_scanTimer->start();
+        return;
+    }
+    m_blockCount = m_document->blockCount();
+    if (m_pattern.pattern().isEmpty() || !m_pattern.isValid()) return;
+
+    // The edited blocks lose their matches until they are matched again; later ones move along
+    const auto begin = std::lower_bound(m_matches.begin(), m_matches.end(), change.first());
+    const auto end = std::lower_bound(begin, m_matches.end(), change.first() + change.oldCount());
+    if (change.delta() != 0) {
+        for (auto it = end; it != m_matches.end(); ++it) {
+            *it += change.delta();
+        }
+    }
+    m_matches.erase(begin, end);
+    change.mergeDirty(&m_dirtyFirst, &m_dirtyLast);
+
+    // Slices before or after the edit still fit once moved; one it went through is matched again
+    for (Slice &slice : m_slices) {
+        if (!slice.valid || slice.first + slice.count <= change.first()) continue;
+        if (slice.first >= change.first() + change.oldCount()) {
+            slice.first += change.delta();
+            continue;
+        }
+        slice.valid = false;
+        markDirty(change.mapBlock(slice.first), change.mapBlock(slice.first + slice.count - 1));
+    }
+    m_scanTimer->start();
+}
+
+void FilterView::startScan()
+{
+    if (!m_document) return;
+
+    while (m_dirtyFirst >= 0 && m_slices.size() < QThread::idealThreadCount()) {
+        const QTextBlock first = m_document->findBlockByNumber(m_dirtyFirst);
+        const int lastBlock = qMin(m_dirtyLast, m_dirtyFirst + SLICE_BLOCKS - 1);
+        const QTextBlock last = m_document->findBlockByNumber(lastBlock);
+        if (!first.isValid() || !last.isValid()) {
+            resetAll();
+            continue;
+        }
+
+        // Only this slice is copied
+        const QString text = BlockChange::copyBlocks(first, last);
+
+        const int id = m_nextSlice++;
+        m_slices.insert(id, Slice{m_dirtyFirst, lastBlock - m_dirtyFirst + 1, true});
+        if (lastBlock >= m_dirtyLast) {
+            m_dirtyFirst = m_dirtyLast = -1;
+        } else {
+            m_dirtyFirst = lastBlock + 1;
+        }
+
+        QPointer<FilterView> self(this);
+        const QRegularExpression pattern = m_pattern;
+        QThreadPool::globalInstance()->start([self, id, text, pattern]() {
+            std::vector<int> matches;
+            int line = 0;
+            for (QStringView lineText : QStringView(text).split(QChar::ParagraphSeparator)) {
+                if (pattern.match(lineText).hasMatch()) {
+                    matches.push_back(line);
+                }
+                ++line;
+            }
+
+            QMetaObject::invokeMethod(qApp, [self, id, matches]() {
+                if (self) {
+                    self->applySlice(id, matches);
+                }
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void FilterView::applySlice(int id, const std::vector<int> &matches)
+{
+    const auto it = m_slices.constFind(id);
+    if (it == m_slices.cend()) return;
+    const Slice slice = *it;
+    m_slices.erase(it);
+
+    if (slice.valid) {
+        const auto begin = std::lower_bound(m_matches.begin(), m_matches.end(), slice.first);
+        const auto end = std::lower_bound(begin, m_matches.end(), slice.first + slice.count);
+        const auto position = m_matches.erase(begin, end);
+        std::vector<int> lines;
+        lines.reserve(matches.size());
+        for (int match : matches) {
+            lines.push_back(slice.first + match);
+        }
+        m_matches.insert(position, lines.cbegin(), lines.cend());
+    }
+
+    startScan();
+    if (!isScanning()) {
+        buildRows();
+    } else if (!m_rowsTimer->isActive()) {
+        m_rowsTimer->start();
+    }
+}
+
+void FilterView::buildRows()
+{
+    m_rowsTimer->stop();
+    const int previousLine = m_currentRow >= 0 && m_currentRow < int(m_rows.size())
+        ? m_rows[size_t(m_currentRow)].line : -1;
+    const bool atEnd = verticalScrollBar()->value() > 0 && verticalScrollBar()->value() >= verticalScrollBar()->maximum();
+
+    // Context runs up to the next match's context, so no line is shown twice
+    m_rows.clear();
+    int shown = -1;
+    int trailing = -1;
+    bool gap = false;
+    const auto addRow = [&](int line, bool match) {
+        m_rows.push_back(Row{line, match, gap});
+        gap = false;
+        shown = line;
+    };
+    for (int match : m_matches) {
+        while (shown < qMin(trailing, match - 1)) {
+            addRow(shown + 1, false);
+        }
+        const int from = qMax(match - m_contextLines, shown + 1);
+        gap = m_contextLines > 0 && shown >= 0 && from > shown + 1;
+        for (int line = from; line < match; ++line) {
+            addRow(line, false);
+        }
+        addRow(match, true);
+        trailing = qMin(match + m_contextLines, m_blockCount - 1);
+    }
+    while (shown < trailing) {
+        addRow(shown + 1, false);
+    }
+
+    // Keep the selection on its line, and the end in view while a log grows
+    m_currentRow = -1;
+    if (previousLine >= 0) {
+        const auto row = std::lower_bound(m_rows.cbegin(), m_rows.cend(), previousLine,
+                                          [](const Row &row, int line) { return row.line < line; });
+        if (row != m_rows.cend() && row->line == previousLine) {
+            m_currentRow = int(row - m_rows.cbegin());
+        }
+    }
+    updateScrollBars();
+    if (atEnd) {
+        verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+    }
+    viewport()->update();
+    Q_EMIT filterUpdated();
+}
+
+void FilterView::updateScrollBars()
+{
+    const QFontMetrics metrics = fontMetrics();
+    const int visibleRows = qMax(1, viewport()->height() / metrics.lineSpacing());
+    verticalScrollBar()->setRange(0, qMax(0, int(m_rows.size()) - visibleRows));
+    verticalScrollBar()->setPageStep(visibleRows);
+    verticalScrollBar()->setSingleStep(1);
+    horizontalScrollBar()->setPageStep(viewport()->width() / 2);
+    horizontalScrollBar()->setSingleStep(metrics.horizontalAdvance(QLatin1Char('0')) * 4);
+}
+
+void FilterView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void FilterView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+    QPainter painter(viewport());
+    const QPalette palette = viewport()->palette();
+    painter.fillRect(viewport()->rect(), palette.color(QPalette::Base));
+    if (!m_document) return;
+
+    const QFontMetrics metrics = fontMetrics();
+    const int lineHeight = metrics.lineSpacing();
+    const int digitWidth = metrics.horizontalAdvance(QLatin1Char('0'));
+    const int gutterWidth = digitWidth * int(QString::number(m_blockCount).size() + 2);
+    const int width = viewport()->width();
+    const int scrollX = horizontalScrollBar()->value();
+    const QColor matchColor(220, 170, 40, 90);
+
+    int widest = 0;
+    int y = 0;
+    for (int row = verticalScrollBar()->value(); row < int(m_rows.size()) && y < viewport()->height(); ++row) {
+        const Row &current = m_rows[size_t(row)];
+        if (row == m_currentRow) {
+            painter.fillRect(QRect(0, y, width, lineHeight), palette.color(QPalette::AlternateBase));
+        }
+        if (current.gapBefore) {
+            painter.setPen(palette.color(QPalette::Mid));
+            painter.drawLine(0, y, width, y);
+        }
+
+        painter.setPen(palette.color(QPalette::PlaceholderText));
+        painter.drawText(QRect(0, y, gutterWidth - digitWidth, lineHeight),
+                         Qt::AlignRight | Qt::AlignVCenter, QString::number(current.line + 1));
+
+        // Edited lines show as they are now until they are matched again
+        QString text = m_document->findBlockByNumber(current.line).text();
+        text.truncate(MAX_PAINTED_CHARACTERS);
+        const QString painted = expandTabs(text);
+        const QRect textRect(gutterWidth, y, width - gutterWidth, lineHeight);
+        painter.save();
+        painter.setClipRect(textRect);
+        if (current.match) {
+            QRegularExpressionMatchIterator matches = m_pattern.globalMatch(text);
+            while (matches.hasNext()) {
+                const QRegularExpressionMatch match = matches.next();
+                if (match.capturedLength() == 0) continue;
+                const int start = metrics.horizontalAdvance(expandTabs(text.left(match.capturedStart())));
+                const int end = metrics.horizontalAdvance(expandTabs(text.left(match.capturedEnd())));
+                painter.fillRect(QRect(textRect.x() - scrollX + start, y, end - start, lineHeight), matchColor);
+            }
+        }
+        painter.setPen(palette.color(current.match ? QPalette::Text : QPalette::PlaceholderText));
+        painter.drawText(textRect.x() - scrollX, y + metrics.ascent(), painted);
+        painter.restore();
+        widest = qMax(widest, metrics.horizontalAdvance(painted));
+        y += lineHeight;
+    }
+
+    // Only the lines in view are measured, so the range grows as wider ones scroll in
+    const int maximum = widest + digitWidth - (width - gutterWidth);
+    if (maximum > horizontalScrollBar()->maximum()) {
+        horizontalScrollBar()->setMaximum(maximum);
+    }
+}
+
+int FilterView::rowAt(const QPoint &position) const
+{
+    const int row = verticalScrollBar()->value() + position.y() / fontMetrics().lineSpacing();
+    return row < int(m_rows.size()) ? row : -1;
+}
+
+void FilterView::setCurrentRow(int row)
+{
+    if (m_rows.empty()) return;
+    m_currentRow = qBound(0, row, int(m_rows.size()) - 1);
+    const int top = verticalScrollBar()->value();
+    const int visibleRows = verticalScrollBar()->pageStep();
+    if (m_currentRow < top) {
+        verticalScrollBar()->setValue(m_currentRow);
+    } else if (m_currentRow >= top + visibleRows) {
+        verticalScrollBar()->setValue(m_currentRow - visibleRows + 1);
+    }
+    viewport()->update();
+}
+
+void FilterView::keyPressEvent(QKeyEvent *event)
+{
+    const int pageRows = qMax(1, verticalScrollBar()->pageStep() - 1);
+    switch (event->key()) {
+    case Qt::Key_Up:
+        setCurrentRow(m_currentRow - 1);
+        break;
+    case Qt::Key_Down:
+        setCurrentRow(m_currentRow + 1);
+        break;
+    case Qt::Key_PageUp:
+        setCurrentRow(m_currentRow - pageRows);
+        break;
+    case Qt::Key_PageDown:
+        setCurrentRow(m_currentRow + pageRows);
+        break;
+    case Qt::Key_Home:
+        setCurrentRow(0);
+        break;
+    case Qt::Key_End:
+        setCurrentRow(int(m_rows.size()) - 1);
+        break;
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        if (m_currentRow >= 0) {
+            Q_EMIT lineActivated(m_rows[size_t(m_currentRow)].line);
+        }
+        break;
+    default:
+        QAbstractScrollArea::keyPressEvent(event);
+        return;
+    }
+    event->accept();
+}
+
+void FilterView::mousePressEvent(QMouseEvent *event)
+{
+    const int row = rowAt(event->position().toPoint());
+    if (row >= 0) {
+        setCurrentRow(row);
+    }
+}
+
+void FilterView::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    const int row = rowAt(event->position().toPoint());
+    if (row >= 0) {
+        setCurrentRow(row);
+        Q_EMIT lineActivated(m_rows[size_t(row)].line);
+    }
+}
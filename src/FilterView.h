@@ -0,0 +1,124 @@
+#ifndef FILTERVIEW_H
+#define FILTERVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QHash>
+#include <QPointer>
+#include <QRegularExpression>
+#include <vector>
+
+class QTextDocument;
+class QTimer;
+
+// This class shows only the lines of a document that match a pattern, with optional
+// context lines around them, like grep in place. It keeps nothing of the text but the
+// numbers of the matching blocks; what is painted is read from the document. Edits move
+// the numbers along and mark the edited blocks for matching again, so a growing log is
+// only matched where it grew. Matching runs in slices of blocks, several at a time on
+// the thread pool, each on a copy of its own slice only
+class FilterView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit FilterView(QWidget *parent = nullptr);
+    ~FilterView() override;
+
+    // Follow a document; its lines are matched against the pattern as it changes
+    void setDocument(QTextDocument *document);
+
+    // Match every line against a new pattern; an empty pattern matches nothing
+    void setPattern(const QRegularExpression &pattern);
+
+    // Show this many lines before and after each matching line
+    void setContextLines(int lines);
+
+    int matchCount() const { return int(m_matches.size()); }
+    int lineCount() const { return m_blockCount; }
+
+    // Whether lines are still being matched
+    bool isScanning() const { return m_dirtyFirst >= 0 || !m_slices.isEmpty(); }
+
+Q_SIGNALS:
+    // Emitted when the shown lines changed
+    void filterUpdated();
+
+    // Emitted when a line is double-clicked or Return is pressed on it, with its block number
+    void lineActivated(int line);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+
+private:
+    // One shown line; gapBefore marks where lines were left out above it
+    struct Row {
+        int line;
+        bool match;
+        bool gapBefore;
+    };
+
+    // Blocks being matched on the worker; invalid once an edit went through them
+    struct Slice {
+        int first;
+        int count;
+        bool valid;
+    };
+
+    // Move the matches along with an edit and mark the edited blocks
+    void contentsChanged(int position, int charsRemoved, int charsAdded);
+
+    // Mark every block for matching
+    void resetAll();
+
+    // Add blocks to the range waiting for matching
+    void markDirty(int first, int last);
+
+    // Start slices of the marked blocks until every pool thread has one
+    void startScan();
+
+    // Store the matches of a slice unless an edit went through it
+    void applySlice(int id, const std::vector<int> &matches);
+
+    // Lay out the matches and their context as rows
+    void buildRows();
+
+    void updateScrollBars();
+    void setCurrentRow(int row);
+
+    // The row under a point of the viewport, or -1
+    int rowAt(const QPoint &position) const;
+
+    QPointer<QTextDocument> m_document;
+    QRegularExpression m_pattern;
+    int m_contextLines;
+    int m_blockCount;
+
+    // Matching blocks in order, and the rows shown for them
+    std::vector<int> m_matches;
+    std::vector<Row> m_rows;
+    int m_currentRow;
+
+    // Blocks waiting for matching, or -1, and the slices being matched
+    int m_dirtyFirst;
+    int m_dirtyLast;
+    QHash<int, Slice> m_slices;
+    int m_nextSlice;
+
+    QTimer *m_scanTimer;
+    QTimer *m_rowsTimer;
+
+    // Match once typing has paused for this long
+    static const int SCAN_DELAY = 150;
+
+    // Lay out new rows at most this often while a large document is matched
+    static const int ROWS_DELAY = 100;
+
+    // Blocks matched by one job on the worker
+    static const int SLICE_BLOCKS = 65536;
+};
+
+#endif // FILTERVIEW_H
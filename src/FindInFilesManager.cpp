@@ -0,0 +1,662 @@
+#include "FindInFilesManager.h"
+#include "DocumentManager.h"
+#include "EncodingDetector.h"
+#include "MemoryBudgetManager.h"
+#include "TrigramIndex.h"
+#include <QTabWidget>
+#include <QMdiArea>
+#include <QMdiSubWindow>
+#include <QSplitter>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+#include <QDialog>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
+#include <QLineEdit>
+#include <QCheckBox>
+#include <QLabel>
+#include <QListView>
+#include <QPushButton>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <QDirIterator>
+#include <QRegularExpression>
+#include <QSet>
+#include <QStringDecoder>
+#include <QLoggingCategory>
+#include <KTextEdit>
+#include <KLocalizedString>
+#include <KFormat>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+Q_LOGGING_CATEGORY(findInFilesLog, "mudoedit.findinfilesmanager")
+
+namespace {
+
+// Stop collecting hits after this many, the list is meant to be read by a person
+const int MAX_HITS = 100000;
+
+// Hits are posted to the GUI thread in batches of this size
+const int HIT_BATCH_SIZE = 256;
+
+// Files containing a NUL byte in their first bytes are treated as binary and skipped
+const qint64 BINARY_SAMPLE_SIZE = 8192;
+
+// Files that need decoding are decoded in chunks of about this size, split at line ends
+const qsizetype DECODE_CHUNK_SIZE = 4 * 1024 * 1024;
+
+// Longest line text kept for display
+const int MAX_LINE_TEXT = 400;
+
+FileSearchHit makeHit(const QString &filePath, int line, QStringView lineText, qsizetype column, qsizetype length)
+{
+    if (lineText.endsWith(u'\r')) {
+        lineText.chop(1);
+    }
+
+    FileSearchHit hit;
+    hit.filePath = filePath;
+    hit.line = line;
+    hit.column = int(column);
+    hit.length = int(length);
+    hit.lineText = lineText.left(MAX_LINE_TEXT).toString();
+    return hit;
+}
+
+} // namespace
+
+// State of one search, shared between the GUI thread and the tasks on the thread pool
+struct FindInFilesJob
+{
+    quint64 id = 0;
+    QString rootPath;
+    QStringList nameFilters;
+    QString pattern;
+    SearchOptions options;
+
+    // Case-sensitive literal searches run directly on the mapped bytes of UTF-8 files
+    bool byteScan = false;
+    QByteArray utf8Pattern;
+
+    // Canonical paths of open documents that were searched in memory instead of on disk
+    QSet<QString> skipPaths;
+
+    // Files the folder index found as candidates, searched instead of walking the folder
+    bool useCandidates = false;
+    QStringList candidateFiles;
+
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> truncated{false};
+    std::atomic<int> pendingTasks{0};
+    std::atomic<int> filesQueued{0};
+    std::atomic<int> filesSearched{0};
+    std::atomic<int> filesMatched{0};
+    std::atomic<int> hitCount{0};
+    std::atomic<qint64> bytesSearched{0};
+
+    // Only touched in the GUI thread
+    bool finished = false;
+};
+
+FindInFilesManager::FindInFilesManager(QTabWidget *tabWidget, DocumentManager *documentManager, QObject *parent)
+    : QObject(parent),
+      m_tabWidget(tabWidget),
+      m_documentManager(documentManager),
+      m_threadPool(new QThreadPool(this)),
+      m_progressTimer(new QTimer(this)),
+      m_model(new SearchResultModel(this)),
+      m_nextJobId(1),
+      m_dialog(nullptr),
+      m_patternEdit(nullptr),
+      m_folderEdit(nullptr),
+      m_filterEdit(nullptr),
+      m_caseSensitiveCheckBox(nullptr),
+      m_wholeWordsCheckBox(nullptr),
+      m_regexCheckBox(nullptr),
+      m_openDocumentsCheckBox(nullptr),
+      m_useIndexCheckBox(nullptr),
+      m_searchButton(nullptr),
+      m_cancelButton(nullptr),
+      m_progressLabel(nullptr),
+      m_resultView(nullptr)
+{
+    // A pool of our own, so a long search does not starve other background work
+    m_threadPool->setMaxThreadCount(QThread::idealThreadCount());
+
+    m_progressTimer->setInterval(100);
+    connect(m_progressTimer, &QTimer::timeout, this, &FindInFilesManager::updateProgress);
+}
+
+FindInFilesManager::~FindInFilesManager()
+{
+    // The tasks post back to this object, so they must be gone before it is
+    if (m_job) {
+        m_job->cancelled = true;
+    }
+    m_threadPool->clear();
+    m_threadPool->waitForDone();
+}
+
+bool FindInFilesManager::isSearching() const
+{
+    return m_job && !m_job->finished;
+}
+
+void FindInFilesManager::showDialog()
+{
+    createDialog();
+
+    // Default to the folder of the active document
+    if (m_folderEdit->text().isEmpty()) {
+        QString folder = QDir::homePath();
+        QMdiArea *mdiArea = getMdiArea(m_tabWidget->currentIndex());
+        if (mdiArea && mdiArea->activeSubWindow()) {
+            const QString filePath = mdiArea->activeSubWindow()->property("fullFilePath").toString();
+            if (!filePath.isEmpty()) {
+                folder = QFileInfo(filePath).absolutePath();
+            }
+        }
+        m_folderEdit->setText(folder);
+    }
+
+    m_dialog->show();
+    m_dialog->raise();
+    m_dialog->activateWindow();
+    m_patternEdit->setFocus();
+    m_patternEdit->selectAll();
+}
+
+void FindInFilesManager::startSearch()
+{
+    createDialog();
+    if (isSearching()) {
+        cancelSearch();
+    }
+
+    const QString pattern = m_patternEdit->text();
+    if (pattern.isEmpty()) return;
+
+    auto job = std::make_shared<FindInFilesJob>();
+    job->id = m_nextJobId++;
+    job->rootPath = QDir::cleanPath(QDir(m_folderEdit->text()).absolutePath());
+    job->nameFilters = m_filterEdit->text().split(QRegularExpression(QStringLiteral("[\\s,;]+")), Qt::SkipEmptyParts);
+    job->pattern = pattern;
+    job->options.caseSensitivity = m_caseSensitiveCheckBox->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    job->options.wholeWords = m_wholeWordsCheckBox->isChecked();
+    job->options.regularExpression = m_regexCheckBox->isChecked();
+    job->byteScan = !job->options.regularExpression && !job->options.wholeWords
+        && job->options.caseSensitivity == Qt::CaseSensitive;
+    job->utf8Pattern = pattern.toUtf8();
+
+    if (job->options.regularExpression) {
+        const QRegularExpression regex = SearchEngine::regularExpression(pattern, job->options);
+        if (!regex.isValid()) {
+            m_progressLabel->setText(i18n("Invalid regular expression: %1", regex.errorString()));
+            return;
+        }
+    }
+
+    qCDebug(findInFilesLog) << "Searching" << job->rootPath << job->nameFilters << "for" << pattern;
+
+    m_model->clear();
+    m_model->setRootPath(job->rootPath);
+    m_job = job;
+    m_elapsed.start();
+
+    // Let the folder index narrow down the files; while it is being built, walk the folder
+    if (m_useIndexCheckBox->isChecked()) {
+        TrigramIndex *index = indexForFolder(job->rootPath);
+        if (index->isReady()) {
+            if (std::optional<QStringList> candidates = index->candidateFiles(pattern, job->options)) {
+                job->useCandidates = true;
+                job->candidateFiles = std::move(*candidates);
+            }
+        }
+    }
+
+    // The folder walk is one task; it queues the file tasks as it goes
+    job->pendingTasks = 1;
+    if (m_openDocumentsCheckBox->isChecked()) {
+        const QStringList searched = searchOpenDocuments(job);
+        job->skipPaths = QSet<QString>(searched.cbegin(), searched.cend());
+    }
+    if (QFileInfo(job->rootPath).isDir()) {
+        m_threadPool->start([this, job]() {
+            enumerateFiles(job);
+            taskDone(job);
+        });
+    } else {
+        taskDone(job);
+    }
+
+    m_searchButton->setEnabled(false);
+    m_cancelButton->setEnabled(true);
+    m_progressTimer->start();
+    updateProgress();
+}
+
+void FindInFilesManager::cancelSearch()
+{
+    if (!isSearching()) return;
+
+    qCDebug(findInFilesLog) << "Search cancelled";
+    m_job->cancelled = true;
+
+    // Drop the file tasks that have not started; running ones notice the flag
+    m_threadPool->clear();
+    finishSearch(m_job->id);
+}
+
+QStringList FindInFilesManager::searchOpenDocuments(const std::shared_ptr<FindInFilesJob> &job)
+{
+    // Paths are compared canonically, so symlinks and relative paths name the file once
+    const QString root = QFileInfo(job->rootPath).canonicalFilePath();
+    if (root.isEmpty()) return QStringList();
+    const bool rootIsFolder = QFileInfo(root).isDir();
+
+    QStringList searched;
+    for (int i = 0; i < m_tabWidget->count(); ++i) {
+        QMdiArea *mdiArea = getMdiArea(i);
+        if (!mdiArea) continue;
+
+        for (QMdiSubWindow *window : mdiArea->subWindowList()) {
+            KTextEdit *textEdit = qobject_cast<KTextEdit*>(window->widget());
+            const QString filePath = window->property("fullFilePath").toString();
+            // Unloaded documents are only a placeholder; their file is searched on disk
+            if (!textEdit || filePath.isEmpty() || MemoryBudgetManager::isEvicted(textEdit)) continue;
+
+            // Only documents the folder walk would have searched, before anything is copied
+            const QFileInfo info(filePath);
+            const QString canonicalPath = info.canonicalFilePath();
+            if (canonicalPath.isEmpty()) continue;
+            if (rootIsFolder ? !canonicalPath.startsWith(root + QLatin1Char('/')) : canonicalPath != root) continue;
+            if (!job->nameFilters.isEmpty() && !QDir::match(job->nameFilters, info.fileName())) continue;
+
+            // Take the snapshot here, the document itself must not be touched off the GUI thread
+            const QString text = textEdit->toPlainText();
+            searched.append(canonicalPath);
+            job->pendingTasks++;
+            job->filesQueued++;
+            m_threadPool->start([this, job, filePath, text]() {
+                if (!job->cancelled) {
+                    QList<FileSearchHit> hits;
+                    bool lineHasHit = false;
+                    if (searchText(filePath, text, 1, 0, job, hits, &lineHasHit) > 0) {
+                        job->filesMatched++;
+                    }
+                    postHits(job, hits);
+                    job->filesSearched++;
+                    job->bytesSearched += text.size() * qint64(sizeof(QChar));
+                }
+                taskDone(job);
+            });
+        }
+    }
+    return searched;
+}
+
+void FindInFilesManager::enumerateFiles(const std::shared_ptr<FindInFilesJob> &job)
+{
+    auto queueFile = [this, &job](const QString &filePath) {
+        if (!job->skipPaths.isEmpty() && job->skipPaths.contains(QFileInfo(filePath).canonicalFilePath())) return;
+
+        job->pendingTasks++;
+        job->filesQueued++;
+        m_threadPool->start([this, job, filePath]() {
+            if (!job->cancelled) {
+                searchFile(filePath, job);
+            }
+            taskDone(job);
+        });
+    };
+
+    if (job->useCandidates) {
+        // The index knows every file below the folder, so the name filter still applies
+        for (const QString &filePath : std::as_const(job->candidateFiles)) {
+            if (job->cancelled) break;
+            if (job->nameFilters.isEmpty() || QDir::match(job->nameFilters, QFileInfo(filePath).fileName())) {
+                queueFile(filePath);
+            }
+        }
+        return;
+    }
+
+    QDirIterator it(job->rootPath, job->nameFilters, QDir::Files | QDir::Readable, QDirIterator::Subdirectories);
+    while (it.hasNext() && !job->cancelled) {
+        queueFile(it.next());
+    }
+}
+
+void FindInFilesManager::searchFile(const QString &filePath, const std::shared_ptr<FindInFilesJob> &job)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCDebug(findInFilesLog) << "Skipping unreadable file" << filePath;
+        job->filesSearched++;
+        return;
+    }
+
+    const qint64 size = file.size();
+    if (size == 0) {
+        job->filesSearched++;
+        return;
+    }
+
+    // Map the file; fall back to reading it for files that cannot be mapped
+    QByteArray buffer;
+    const char *data = reinterpret_cast<const char*>(file.map(0, size));
+    qint64 dataSize = size;
+    if (!data) {
+        buffer = file.readAll();
+        data = buffer.constData();
+        dataSize = buffer.size();
+    }
+    QByteArrayView bytes(data, dataSize);
+
+    // ASCII files are taken as UTF-8 too. UTF-16 holds NUL bytes, so only other files are checked for them
+    const EncodingDetector::Format format = EncodingDetector::detect(bytes);
+    const bool utf8 = format.encoding == QByteArrayLiteral("UTF-8");
+    const bool utf16 = format.byteOrderMark && !utf8;
+    if (!utf16 && std::memchr(data, 0, size_t(qMin(dataSize, BINARY_SAMPLE_SIZE)))) {
+        job->filesSearched++;
+        job->bytesSearched += dataSize;
+        return;
+    }
+
+    QList<FileSearchHit> hits;
+    int fileHits = 0;
+
+    if (job->byteScan && utf8) {
+        // UTF-8 is self-synchronizing, so a byte match of the encoded pattern is a real match
+        if (format.byteOrderMark) {
+            bytes = bytes.sliced(3);
+        }
+        int line = 1;
+        qsizetype counted = 0;
+        qsizetype position = 0;
+        while (!job->cancelled && (position = SearchEngine::findBytes(bytes, job->utf8Pattern, position)) >= 0) {
+            if (job->hitCount.fetch_add(1) >= MAX_HITS) {
+                job->truncated = true;
+                break;
+            }
+
+            line += int(std::count(bytes.begin() + counted, bytes.begin() + position, '\n'));
+            counted = position;
+            const qsizetype lineStart = bytes.first(position).lastIndexOf('\n') + 1;
+            qsizetype lineEnd = bytes.indexOf('\n', position);
+            if (lineEnd < 0) lineEnd = bytes.size();
+
+            const QString prefix = QString::fromUtf8(bytes.sliced(lineStart, position - lineStart));
+            const QString lineText = QString::fromUtf8(bytes.sliced(lineStart, qMin<qsizetype>(lineEnd - lineStart, MAX_LINE_TEXT * 4)));
+            hits.append(makeHit(filePath, line, lineText, prefix.size(), job->pattern.size()));
+            ++fileHits;
+            if (hits.size() >= HIT_BATCH_SIZE) {
+                postHits(job, hits);
+            }
+
+            // One hit per line
+            position = lineEnd + 1;
+        }
+    } else {
+        // Decode in chunks, so memory stays bounded for large files. The decoder keeps a
+        // sequence cut at the end of a chunk for the next one, and the decoded text is
+        // searched up to its last line break
+        QStringDecoder decoder(format.encoding.constData());
+        const qsizetype overlap = qMax<qsizetype>(0, job->pattern.size() - 1);
+        QString pending;
+        int firstLine = 1;
+        qsizetype firstColumn = 0;
+        bool lineHasHit = false;
+        qsizetype chunkStart = 0;
+        while (chunkStart < dataSize && !job->cancelled && !job->truncated) {
+            const qsizetype chunkEnd = qMin(dataSize, chunkStart + DECODE_CHUNK_SIZE);
+            pending += decoder.decode(bytes.sliced(chunkStart, chunkEnd - chunkStart));
+            chunkStart = chunkEnd;
+
+            // A line longer than a chunk is split where the text ends, and the end of it is
+            // searched again with the next chunk, so a match across the split is still found
+            qsizetype end = pending.size();
+            qsizetype keep = end;
+            if (chunkStart < dataSize) {
+                keep = end = pending.lastIndexOf(u'\n') + 1;
+                if (end == 0) {
+                    if (pending.size() < DECODE_CHUNK_SIZE) continue;
+                    end = pending.size();
+                    keep = end - qMin(overlap, end);
+                    if (keep > 0 && keep < end && pending.at(keep).isLowSurrogate()) {
+                        --keep;
+                    }
+                }
+            }
+
+            const QStringView text = QStringView(pending).first(end);
+            fileHits += searchText(filePath, text, firstLine, firstColumn, job, hits, &lineHasHit);
+
+            // Where the text kept for the next chunk starts
+            const QStringView searched = text.first(keep);
+            const qsizetype lastBreak = searched.lastIndexOf(u'\n');
+            firstLine += int(std::count(searched.begin(), searched.end(), QChar(u'\n')));
+            firstColumn = lastBreak < 0 ? firstColumn + keep : keep - lastBreak - 1;
+            pending.remove(0, keep);
+        }
+    }
+
+    postHits(job, hits);
+    if (fileHits > 0) {
+        job->filesMatched++;
+    }
+    job->filesSearched++;
+    job->bytesSearched += dataSize;
+}
+
+int FindInFilesManager::searchText(const QString &filePath, QStringView text, int firstLine, qsizetype firstColumn,
+                                   const std::shared_ptr<FindInFilesJob> &job, QList<FileSearchHit> &hits,
+                                   bool *lineHasHit)
+{
+    int found = 0;
+    int line = firstLine;
+    qsizetype counted = 0;
+    qsizetype nextLineStart = 0;
+    if (*lineHasHit) {
+        const qsizetype lineEnd = text.indexOf(u'\n');
+        nextLineStart = lineEnd < 0 ? text.size() + 1 : lineEnd + 1;
+    }
+    SearchEngine::forEachMatch(text, job->pattern, job->options, [&](const SearchMatch &match) {
+        // One hit per line
+        if (match.start < nextLineStart) return !job->cancelled;
+        if (job->hitCount.fetch_add(1) >= MAX_HITS) {
+            job->truncated = true;
+            return false;
+        }
+
+        line += int(std::count(text.begin() + counted, text.begin() + match.start, QChar(u'\n')));
+        counted = match.start;
+        const qsizetype lineStart = text.first(match.start).lastIndexOf(u'\n') + 1;
+        qsizetype lineEnd = text.indexOf(u'\n', match.start);
+        if (lineEnd < 0) lineEnd = text.size();
+
+        const qsizetype column = match.start - lineStart + (lineStart == 0 ? firstColumn : 0);
+        hits.append(makeHit(filePath, line, text.sliced(lineStart, lineEnd - lineStart), column, match.length));
+        ++found;
+        if (hits.size() >= HIT_BATCH_SIZE) {
+            postHits(job, hits);
+        }
+
+        nextLineStart = lineEnd + 1;
+        return !job->cancelled;
+    });
+    *lineHasHit = nextLineStart > text.size();
+    return found;
+}
+
+void FindInFilesManager::postHits(const std::shared_ptr<FindInFilesJob> &job, QList<FileSearchHit> &hits)
+{
+    if (hits.isEmpty()) return;
+
+    QMetaObject::invokeMethod(this, [this, id = job->id, batch = std::move(hits)]() {
+        if (m_job && m_job->id == id && !m_job->cancelled) {
+            m_model->appendHits(batch);
+        }
+    }, Qt::QueuedConnection);
+    hits.clear();
+}
+
+void FindInFilesManager::taskDone(const std::shared_ptr<FindInFilesJob> &job)
+{
+    if (--job->pendingTasks == 0) {
+        QMetaObject::invokeMethod(this, [this, id = job->id]() {
+            finishSearch(id);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void FindInFilesManager::finishSearch(quint64 jobId)
+{
+    if (!m_job || m_job->id != jobId || m_job->finished) return;
+
+    m_job->finished = true;
+    m_progressTimer->stop();
+    m_searchButton->setEnabled(true);
+    m_cancelButton->setEnabled(false);
+    updateProgress();
+
+    qCDebug(findInFilesLog) << "Search finished:" << m_job->filesSearched << "files,"
+                            << m_job->bytesSearched << "bytes," << m_model->rowCount() << "hits in"
+                            << m_elapsed.elapsed() << "ms";
+}
+
+void FindInFilesManager::updateProgress()
+{
+    if (!m_job || !m_progressLabel) return;
+
+    const QString bytes = KFormat().formatByteSize(double(m_job->bytesSearched.load()));
+    QString text = i18n("Searched %1 of %2 files (%3), %4 matching lines in %5 files",
+                        m_job->filesSearched.load(), m_job->filesQueued.load(), bytes,
+                        m_model->rowCount(), m_job->filesMatched.load());
+    if (m_job->finished) {
+        if (m_job->cancelled) {
+            text += i18n(" - cancelled");
+        } else {
+            text += i18n(" - done in %1", KFormat().formatDuration(quint64(m_elapsed.elapsed())));
+        }
+    }
+    if (m_job->useCandidates) {
+        text += i18n(" - narrowed down by the folder index");
+    }
+    if (m_job->truncated) {
+        text += i18n(" - stopped after %1 matches", MAX_HITS);
+    }
+    m_progressLabel->setText(text);
+}
+
+void FindInFilesManager::activateHit(const QModelIndex &index)
+{
+    if (!index.isValid()) return;
+
+    const FileSearchHit &hit = m_model->hit(index.row());
+    m_documentManager->openFileAtLine(hit.filePath, hit.line, hit.column, hit.length);
+}
+
+void FindInFilesManager::createDialog()
+{
+    if (m_dialog) return;
+
+    m_dialog = new QDialog(m_tabWidget);
+    m_dialog->setWindowTitle(i18n("Find in Files"));
+    m_dialog->resize(800, 500);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(m_dialog);
+
+    // Pattern, folder and file name filter
+    QFormLayout *fieldLayout = new QFormLayout;
+    m_patternEdit = new QLineEdit;
+    m_folderEdit = new QLineEdit;
+    m_filterEdit = new QLineEdit(QStringLiteral("*"));
+    m_filterEdit->setToolTip(i18n("File name patterns separated by spaces, for example *.log *.conf"));
+    QPushButton *browseButton = new QPushButton(i18n("Browse..."));
+    QHBoxLayout *folderLayout = new QHBoxLayout;
+    folderLayout->addWidget(m_folderEdit);
+    folderLayout->addWidget(browseButton);
+    fieldLayout->addRow(i18n("Find:"), m_patternEdit);
+    fieldLayout->addRow(i18n("Folder:"), folderLayout);
+    fieldLayout->addRow(i18n("File names:"), m_filterEdit);
+    mainLayout->addLayout(fieldLayout);
+
+    // Search options
+    QHBoxLayout *optionLayout = new QHBoxLayout;
+    m_caseSensitiveCheckBox = new QCheckBox(i18n("Match case"));
+    m_wholeWordsCheckBox = new QCheckBox(i18n("Whole words"));
+    m_regexCheckBox = new QCheckBox(i18n("Regular expression"));
+    m_openDocumentsCheckBox = new QCheckBox(i18n("Open documents"));
+    m_openDocumentsCheckBox->setToolTip(i18n("Also search the open documents, including unsaved changes"));
+    m_openDocumentsCheckBox->setChecked(true);
+    m_useIndexCheckBox = new QCheckBox(i18n("Use folder index"));
+    m_useIndexCheckBox->setToolTip(i18n("Keep an index of the folder on disk, so later searches only read the files that can match"));
+    optionLayout->addWidget(m_caseSensitiveCheckBox);
+    optionLayout->addWidget(m_wholeWordsCheckBox);
+    optionLayout->addWidget(m_regexCheckBox);
+    optionLayout->addWidget(m_openDocumentsCheckBox);
+    optionLayout->addWidget(m_useIndexCheckBox);
+    optionLayout->addStretch();
+    mainLayout->addLayout(optionLayout);
+
+    // Results; uniform item sizes let the view skip measuring rows it does not show
+    m_resultView = new QListView;
+    m_resultView->setModel(m_model);
+    m_resultView->setUniformItemSizes(true);
+    m_resultView->setLayoutMode(QListView::Batched);
+    m_resultView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    mainLayout->addWidget(m_resultView, 1);
+
+    m_progressLabel = new QLabel;
+    mainLayout->addWidget(m_progressLabel);
+
+    // Buttons
+    QHBoxLayout *buttonLayout = new QHBoxLayout;
+    m_searchButton = new QPushButton(i18n("&Search"));
+    m_cancelButton = new QPushButton(i18n("C&ancel"));
+    QPushButton *closeButton = new QPushButton(i18n("Close"));
+    m_searchButton->setDefault(true);
+    m_cancelButton->setEnabled(false);
+    buttonLayout->addWidget(m_searchButton);
+    buttonLayout->addWidget(m_cancelButton);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(closeButton);
+    mainLayout->addLayout(buttonLayout);
+
+    connect(browseButton, &QPushButton::clicked, this, [this]() {
+        const QString folder = QFileDialog::getExistingDirectory(m_dialog, i18n("Select Folder"), m_folderEdit->text());
+        if (!folder.isEmpty()) {
+            m_folderEdit->setText(folder);
+        }
+    });
+    connect(m_searchButton, &QPushButton::clicked, this, &FindInFilesManager::startSearch);
+    connect(m_cancelButton, &QPushButton::clicked, this, &FindInFilesManager::cancelSearch);
+    connect(closeButton, &QPushButton::clicked, m_dialog, &QDialog::hide);
+    connect(m_resultView, &QListView::activated, this, &FindInFilesManager::activateHit);
+}
+
+TrigramIndex* FindInFilesManager::indexForFolder(const QString &rootPath)
+{
+    TrigramIndex *index = m_indexes.value(rootPath);
+    if (!index) {
+        index = new TrigramIndex(rootPath, this);
+        m_indexes.insert(rootPath, index);
+    }
+    return index;
+}
+
+QMdiArea* FindInFilesManager::getMdiArea(int index) const
+{
+    QSplitter *splitter = qobject_cast<QSplitter*>(m_tabWidget->widget(index));
+    if (splitter) {
+        return qobject_cast<QMdiArea*>(splitter->widget(0));
+    }
+    return nullptr;
+}
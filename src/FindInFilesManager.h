@@ -0,0 +1,113 @@
+#ifndef FINDINFILESMANAGER_H
+#define FINDINFILESMANAGER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringView>
+#include <memory>
+#include "SearchEngine.h"
+#include "SearchResultModel.h"
+
+class QTabWidget;
+class QMdiArea;
+class QThreadPool;
+class QTimer;
+class QDialog;
+class QLineEdit;
+class QCheckBox;
+class QLabel;
+class QListView;
+class QPushButton;
+class DocumentManager;
+class TrigramIndex;
+struct FindInFilesJob;
+
+// This class searches a directory tree and the open documents for a pattern.
+// Every file is searched by its own task on a thread pool, and hits stream into
+// the result list while the search is still running
+class FindInFilesManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FindInFilesManager(QTabWidget *tabWidget, DocumentManager *documentManager, QObject *parent = nullptr);
+    ~FindInFilesManager() override;
+
+    // Whether a search is running
+    bool isSearching() const;
+
+public Q_SLOTS:
+    // Show the find in files dialog
+    void showDialog();
+
+    // Start a search with the pattern, folder and options from the dialog
+    void startSearch();
+
+    // Stop the running search, keeping the hits found so far
+    void cancelSearch();
+
+private:
+    // Create the dialog on first use
+    void createDialog();
+
+    // Search the open documents below the folder that match the name filters, which may
+    // differ from their files on disk. Returns the canonical paths not to search on disk again
+    QStringList searchOpenDocuments(const std::shared_ptr<FindInFilesJob> &job);
+
+    // Walk the folder and queue one task per file (runs on the thread pool)
+    void enumerateFiles(const std::shared_ptr<FindInFilesJob> &job);
+
+    // Search one file (runs on the thread pool)
+    void searchFile(const QString &filePath, const std::shared_ptr<FindInFilesJob> &job);
+
+    // Search decoded text whose first line has the given number and may start at a column of
+    // a longer line, returns the number of hits (runs on the thread pool). lineHasHit tells
+    // whether that line had a hit already, and comes back telling it of the unfinished last line
+    int searchText(const QString &filePath, QStringView text, int firstLine, qsizetype firstColumn,
+                   const std::shared_ptr<FindInFilesJob> &job, QList<FileSearchHit> &hits, bool *lineHasHit);
+
+    // Post hits to the result list and finish the job when the last task is done
+    void postHits(const std::shared_ptr<FindInFilesJob> &job, QList<FileSearchHit> &hits);
+    void taskDone(const std::shared_ptr<FindInFilesJob> &job);
+
+    // Called in the GUI thread
+    void finishSearch(quint64 jobId);
+    void updateProgress();
+    void activateHit(const QModelIndex &index);
+
+    // Get the index of a folder, creating it (and starting its build) on first use
+    TrigramIndex* indexForFolder(const QString &rootPath);
+
+    // Helper function to get an MDI area by tab index
+    QMdiArea* getMdiArea(int index) const;
+
+    QTabWidget *m_tabWidget;
+    DocumentManager *m_documentManager;
+    QThreadPool *m_threadPool;
+    QTimer *m_progressTimer;
+    SearchResultModel *m_model;
+
+    std::shared_ptr<FindInFilesJob> m_job;
+    QHash<QString, TrigramIndex*> m_indexes;
+    quint64 m_nextJobId;
+    QElapsedTimer m_elapsed;
+
+    QDialog *m_dialog;
+    QLineEdit *m_patternEdit;
+    QLineEdit *m_folderEdit;
+    QLineEdit *m_filterEdit;
+    QCheckBox *m_caseSensitiveCheckBox;
+    QCheckBox *m_wholeWordsCheckBox;
+    QCheckBox *m_regexCheckBox;
+    QCheckBox *m_openDocumentsCheckBox;
+    QCheckBox *m_useIndexCheckBox;
+    QPushButton *m_searchButton;
+    QPushButton *m_cancelButton;
+    QLabel *m_progressLabel;
+    QListView *m_resultView;
+};
+
+#endif // FINDINFILESMANAGER_H
@@ -0,0 +1,507 @@
+#include "FindReplaceManager.h"
+#include "MatchHighlighter.h"
+#include "BulkEdit.h"
+#include "ClipboardTransfer.h"
+#include <QApplication>
+#include <QTabWidget>
+#include <QMdiArea>
+#include <QMdiSubWindow>
+#include <QSplitter>
+#include <QDialog>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
+#include <QLineEdit>
+#include <QCheckBox>
+#include <QLabel>
+#include <QPushButton>
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QTextBlock>
+#include <QStringList>
+#include <QTimer>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <KTextEdit>
+#include <KLocalizedString>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+Q_LOGGING_CATEGORY(findReplaceLog, "mudoedit.findreplacemanager")
+
+namespace {
+// Literal matches never cross a line break, so literal searches read whole blocks
+// about this many characters at a time
+const int FIND_CHUNK_CHARACTERS = 1 << 20;
+
+// How long the snapshot for regular expressions is kept after the last search
+const int SNAPSHOT_IDLE_MSEC = 10000;
+
+// Text of a block as toPlainText gives it
+QString blockText(const QTextBlock &block)
+{
+    QString text = block.text();
+    text.replace(QChar::Nbsp, QLatin1Char(' '));
+    return text;
+}
+}
+
+FindReplaceManager::FindReplaceManager(QTabWidget *tabWidget, QObject *parent)
+    : QObject(parent),
+      m_tabWidget(tabWidget),
+      m_cacheValid(false),
+      m_releaseTimer(new QTimer(this)),
+      m_replaceAllRunning(false),
+      m_dialog(nullptr),
+      m_findEdit(nullptr),
+      m_replaceEdit(nullptr),
+      m_caseSensitiveCheckBox(nullptr),
+      m_wholeWordsCheckBox(nullptr),
+      m_regexCheckBox(nullptr),
+      m_statusLabel(nullptr)
+{
+    // Follow the user to another document while the dialog is open
+    connect(qApp, &QApplication::focusChanged, this, [this](QWidget *, QWidget *now) {
+        if (qobject_cast<KTextEdit*>(now)) {
+            // The MDI area activates the subwindow after the focus moves
+            QTimer::singleShot(0, this, &FindReplaceManager::updateHighlights);
+        }
+    });
+
+    m_releaseTimer->setSingleShot(true);
+    connect(m_releaseTimer, &QTimer::timeout, this, &FindReplaceManager::releaseSnapshot);
+}
+
+void FindReplaceManager::showFindDialog()
+{
+    createDialog();
+
+    // Start from the selection, as most editors do
+    KTextEdit *textEdit = getActiveEditor();
+    if (textEdit && textEdit->textCursor().hasSelection()) {
+        const QString selection = textEdit->textCursor().selectedText();
+        if (!selection.contains(QChar::ParagraphSeparator)) {
+            m_findEdit->setText(selection);
+        }
+    }
+
+    m_dialog->show();
+    m_dialog->raise();
+    m_dialog->activateWindow();
+    m_findEdit->setFocus();
+    m_findEdit->selectAll();
+    updateHighlights();
+}
+
+void FindReplaceManager::showReplaceDialog()
+{
+    showFindDialog();
+    m_replaceEdit->setFocus();
+    m_replaceEdit->selectAll();
+}
+
+void FindReplaceManager::findNext()
+{
+    KTextEdit *textEdit = getActiveEditor();
+    if (!textEdit) return;
+    if (m_pattern.isEmpty()) {
+        showFindDialog();
+        return;
+    }
+
+    QTextDocument *document = textEdit->document();
+    SearchMatch match = find(document, textEdit->textCursor().selectionEnd());
+    if (!match.isValid()) {
+        match = find(document, 0);
+        if (match.isValid()) {
+            showStatus(i18n("Search wrapped around to the beginning"));
+        }
+    } else {
+        showStatus(QString());
+    }
+
+    if (!match.isValid()) {
+        showStatus(i18n("No matches for \"%1\"", m_pattern));
+        return;
+    }
+    selectMatch(textEdit, match);
+}
+
+void FindReplaceManager::findPrevious()
+{
+    KTextEdit *textEdit = getActiveEditor();
+    if (!textEdit) return;
+    if (m_pattern.isEmpty()) {
+        showFindDialog();
+        return;
+    }
+
+    QTextDocument *document = textEdit->document();
+    SearchMatch match = find(document, textEdit->textCursor().selectionStart(), true);
+    if (!match.isValid()) {
+        match = find(document, document->characterCount() - 1, true);
+        if (match.isValid()) {
+            showStatus(i18n("Search wrapped around to the end"));
+        }
+    } else {
+        showStatus(QString());
+    }
+
+    if (!match.isValid()) {
+        showStatus(i18n("No matches for \"%1\"", m_pattern));
+        return;
+    }
+    selectMatch(textEdit, match);
+}
+
+void FindReplaceManager::replace()
+{
+    KTextEdit *textEdit = getActiveEditor();
+    if (!textEdit || m_pattern.isEmpty() || textEdit->isReadOnly()) return;
+
+    QTextCursor cursor = textEdit->textCursor();
+    if (cursor.hasSelection()) {
+        const qsizetype start = cursor.selectionStart();
+        const qsizetype length = cursor.selectionEnd() - start;
+
+        // Only replace the selection if it is a match itself; a literal one lies within its block
+        QString replacement;
+        bool isMatch = false;
+        if (m_options.regularExpression) {
+            const QRegularExpression regex = SearchEngine::regularExpression(m_pattern, m_options);
+            const QRegularExpressionMatch match = regex.match(documentText(textEdit->document()), start,
+                                                              QRegularExpression::NormalMatch,
+                                                              QRegularExpression::AnchorAtOffsetMatchOption);
+            isMatch = match.hasMatch() && match.capturedStart() == start && match.capturedLength() == length;
+            if (isMatch) replacement = SearchEngine::expandReplacement(match, m_replacement);
+        } else {
+            const QTextBlock block = textEdit->document()->findBlock(int(start));
+            const SearchMatch match = SearchEngine::find(blockText(block), m_pattern, m_options,
+                                                         start - block.position());
+            isMatch = match.isValid() && block.position() + match.start == start && match.length == length;
+            replacement = m_replacement;
+        }
+        if (isMatch) {
+            ClipboardTransfer::detach(cursor.document());
+            cursor.insertText(replacement);
+        }
+    }
+    findNext();
+}
+
+void FindReplaceManager::replaceAll()
+{
+    KTextEdit *textEdit = getActiveEditor();
+    if (!textEdit || m_pattern.isEmpty() || textEdit->isReadOnly() || m_replaceAllRunning) return;
+    if (m_options.regularExpression && !SearchEngine::regularExpression(m_pattern, m_options).isValid()) return;
+
+    // Build the new text on the thread pool from a snapshot; the string is shared, not copied
+    QTextDocument *document = textEdit->document();
+    const QString text = documentSnapshot(document);
+    const int revision = document->revision();
+    const QString pattern = m_pattern;
+    const QString replacement = m_replacement;
+    const SearchOptions options = m_options;
+
+    m_replaceAllRunning = true;
+    showStatus(i18n("Replacing..."));
+    QElapsedTimer timer;
+    timer.start();
+
+    QPointer<FindReplaceManager> self(this);
+    QPointer<KTextEdit> editor(textEdit);
+    QThreadPool::globalInstance()->start([self, editor, text, revision, pattern, replacement, options, timer]() {
+        ReplaceResult result = SearchEngine::replaceAll(text, pattern, options, replacement);
+        QMetaObject::invokeMethod(qApp, [self, editor, revision, pattern, timer, result = std::move(result)]() mutable {
+            if (!self) return;
+            self->m_replaceAllRunning = false;
+            if (!editor) return;
+
+            // The matches were found in a snapshot, which is useless if the user typed since
+            if (editor->document()->revision() != revision) {
+                self->showStatus(i18n("The document changed while replacing; nothing was replaced"));
+                return;
+            }
+            if (result.isEmpty()) {
+                self->showStatus(i18n("No matches for \"%1\"", pattern));
+                return;
+            }
+
+            // Cursor positions are int; a document that large cannot be edited through them
+            if (result.ranges.back().end > std::numeric_limits<int>::max()) {
+                self->showStatus(i18n("The document is too large to replace in; nothing was replaced"));
+                return;
+            }
+            std::vector<BulkEdit::Replacement> replacements;
+            replacements.reserve(result.ranges.size());
+            for (ReplacedRange &range : result.ranges) {
+                replacements.push_back({int(range.start), int(range.end), std::move(range.text)});
+            }
+            if (!BulkEdit::replaceRanges(editor, replacements)) {
+                self->showStatus(i18n("A paste is running; nothing was replaced"));
+                return;
+            }
+
+            qCDebug(findReplaceLog) << "Replaced" << result.count << "matches of" << pattern
+                                    << "in" << timer.elapsed() << "ms";
+            self->showStatus(i18np("Replaced %1 occurrence in %2 ms", "Replaced %1 occurrences in %2 ms",
+                                   result.count, timer.elapsed()));
+        }, Qt::QueuedConnection);
+    });
+}
+
+void FindReplaceManager::countMatches()
+{
+    KTextEdit *textEdit = getActiveEditor();
+    if (!textEdit || m_pattern.isEmpty()) return;
+
+    // Count on the thread pool from a snapshot, as the match highlighter does
+    QTextDocument *document = textEdit->document();
+    const QString text = documentSnapshot(document);
+    const int revision = document->revision();
+    const QString pattern = m_pattern;
+    const SearchOptions options = m_options;
+    showStatus(i18n("Counting..."));
+
+    QPointer<FindReplaceManager> self(this);
+    QPointer<QTextDocument> counted(document);
+    QThreadPool::globalInstance()->start([self, counted, text, revision, pattern, options]() {
+        const qsizetype count = SearchEngine::countMatches(text, pattern, options);
+        QMetaObject::invokeMethod(qApp, [self, counted, revision, count]() {
+            // A count of an older text would be wrong
+            if (!self || !counted || counted->revision() != revision) return;
+            self->showStatus(i18np("%1 match", "%1 matches", count));
+        }, Qt::QueuedConnection);
+    });
+}
+
+void FindReplaceManager::createDialog()
+{
+    if (m_dialog) return;
+
+    m_dialog = new QDialog(m_tabWidget);
+    m_dialog->setWindowTitle(i18n("Find and Replace"));
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(m_dialog);
+
+    // Pattern fields
+    QFormLayout *fieldLayout = new QFormLayout;
+    m_findEdit = new QLineEdit;
+    m_replaceEdit = new QLineEdit;
+    fieldLayout->addRow(i18n("Find:"), m_findEdit);
+    fieldLayout->addRow(i18n("Replace with:"), m_replaceEdit);
+    mainLayout->addLayout(fieldLayout);
+
+    // Search options
+    QHBoxLayout *optionLayout = new QHBoxLayout;
+    m_caseSensitiveCheckBox = new QCheckBox(i18n("Match case"));
+    m_wholeWordsCheckBox = new QCheckBox(i18n("Whole words"));
+    m_regexCheckBox = new QCheckBox(i18n("Regular expression"));
+    optionLayout->addWidget(m_caseSensitiveCheckBox);
+    optionLayout->addWidget(m_wholeWordsCheckBox);
+    optionLayout->addWidget(m_regexCheckBox);
+    optionLayout->addStretch();
+    mainLayout->addLayout(optionLayout);
+
+    m_statusLabel = new QLabel;
+    mainLayout->addWidget(m_statusLabel);
+
+    // Buttons
+    QHBoxLayout *buttonLayout = new QHBoxLayout;
+    QPushButton *findNextButton = new QPushButton(i18n("Find &Next"));
+    QPushButton *findPreviousButton = new QPushButton(i18n("Find &Previous"));
+    QPushButton *replaceButton = new QPushButton(i18n("&Replace"));
+    QPushButton *replaceAllButton = new QPushButton(i18n("Replace &All"));
+    QPushButton *countButton = new QPushButton(i18n("&Count"));
+    QPushButton *closeButton = new QPushButton(i18n("Close"));
+    findNextButton->setDefault(true);
+    buttonLayout->addWidget(findNextButton);
+    buttonLayout->addWidget(findPreviousButton);
+    buttonLayout->addWidget(replaceButton);
+    buttonLayout->addWidget(replaceAllButton);
+    buttonLayout->addWidget(countButton);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(closeButton);
+    mainLayout->addLayout(buttonLayout);
+
+    connect(m_findEdit, &QLineEdit::textChanged, this, &FindReplaceManager::updateSearchFromDialog);
+    connect(m_replaceEdit, &QLineEdit::textChanged, this, &FindReplaceManager::updateSearchFromDialog);
+    connect(m_caseSensitiveCheckBox, &QCheckBox::toggled, this, &FindReplaceManager::updateSearchFromDialog);
+    connect(m_wholeWordsCheckBox, &QCheckBox::toggled, this, &FindReplaceManager::updateSearchFromDialog);
+    connect(m_regexCheckBox, &QCheckBox::toggled, this, &FindReplaceManager::updateSearchFromDialog);
+
+    connect(findNextButton, &QPushButton::clicked, this, &FindReplaceManager::findNext);
+    connect(findPreviousButton, &QPushButton::clicked, this, &FindReplaceManager::findPrevious);
+    connect(replaceButton, &QPushButton::clicked, this, &FindReplaceManager::replace);
+    connect(replaceAllButton, &QPushButton::clicked, this, &FindReplaceManager::replaceAll);
+    connect(countButton, &QPushButton::clicked, this, &FindReplaceManager::countMatches);
+    connect(closeButton, &QPushButton::clicked, m_dialog, &QDialog::hide);
+    connect(closeButton, &QPushButton::clicked, this, &FindReplaceManager::clearHighlights);
+    connect(closeButton, &QPushButton::clicked, this, &FindReplaceManager::releaseSnapshot);
+    connect(m_dialog, &QDialog::finished, this, &FindReplaceManager::clearHighlights);
+    connect(m_dialog, &QDialog::finished, this, &FindReplaceManager::releaseSnapshot);
+}
+
+void FindReplaceManager::updateSearchFromDialog()
+{
+    m_pattern = m_findEdit->text();
+    m_replacement = m_replaceEdit->text();
+    m_options.caseSensitivity = m_caseSensitiveCheckBox->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    m_options.wholeWords = m_wholeWordsCheckBox->isChecked();
+    m_options.regularExpression = m_regexCheckBox->isChecked();
+
+    if (m_options.regularExpression) {
+        const QRegularExpression regex = SearchEngine::regularExpression(m_pattern, m_options);
+        showStatus(regex.isValid() ? QString() : i18n("Invalid regular expression: %1", regex.errorString()));
+    } else {
+        showStatus(QString());
+    }
+
+    updateHighlights();
+    Q_EMIT searchChanged();
+}
+
+SearchMatch FindReplaceManager::find(QTextDocument *document, qsizetype from, bool backward)
+{
+    if (m_options.regularExpression) {
+        return SearchEngine::find(documentText(document), m_pattern, m_options, from, backward);
+    }
+    return findLiteral(document, int(from), backward);
+}
+
+SearchMatch FindReplaceManager::findLiteral(QTextDocument *document, int from, bool backward) const
+{
+    // Chunks hold whole blocks joined by line breaks, so their offsets map straight to positions
+    QTextBlock block = document->findBlock(from);
+    while (block.isValid()) {
+        QStringList blocks;
+        int chunkStart = block.position();
+        int chunkSize = 0;
+        while (block.isValid() && (blocks.isEmpty() || chunkSize < FIND_CHUNK_CHARACTERS)) {
+            blocks.append(blockText(block));
+            chunkStart = qMin(chunkStart, block.position());
+            chunkSize += block.length();
+            block = backward ? block.previous() : block.next();
+        }
+        if (backward) {
+            std::reverse(blocks.begin(), blocks.end());
+        }
+        const QString chunk = blocks.join(QLatin1Char('\n'));
+
+        const qsizetype chunkFrom = qBound<qsizetype>(0, from - chunkStart, chunk.size());
+        const SearchMatch match = SearchEngine::find(chunk, m_pattern, m_options, chunkFrom, backward);
+        if (match.isValid()) {
+            return SearchMatch{chunkStart + match.start, match.length};
+        }
+    }
+    return SearchMatch();
+}
+
+QStringView FindReplaceManager::documentText(QTextDocument *document)
+{
+    if (document != m_cachedDocument) {
+        disconnect(m_cacheConnection);
+        m_cachedDocument = document;
+        m_cachedText.clear();
+        m_cacheValid = false;
+        m_cacheConnection = connect(document, &QTextDocument::contentsChanged, this, [this]() {
+            // Callers may still hold views into the snapshot, so drop it once they are done
+            m_cacheValid = false;
+            m_releaseTimer->start(0);
+        });
+    }
+
+    if (!m_cacheValid) {
+        m_cachedText = document->toPlainText();
+        m_cacheValid = true;
+    }
+    m_releaseTimer->start(SNAPSHOT_IDLE_MSEC);
+    return m_cachedText;
+}
+
+QString FindReplaceManager::documentSnapshot(QTextDocument *document)
+{
+    documentText(document);
+    return m_cachedText;
+}
+
+void FindReplaceManager::releaseSnapshot()
+{
+    // Jobs on the thread pool keep their own reference to the text
+    m_releaseTimer->stop();
+    m_cachedText = QString();
+    m_cacheValid = false;
+}
+
+void FindReplaceManager::updateHighlights()
+{
+    if (!m_dialog || !m_dialog->isVisible()) return;
+
+    KTextEdit *textEdit = getActiveEditor();
+    if (textEdit != m_highlightedEditor) {
+        clearHighlights();
+    }
+    if (!textEdit) return;
+
+    MatchHighlighter *highlighter = MatchHighlighter::forEditor(textEdit);
+    if (textEdit != m_highlightedEditor) {
+        m_highlightedEditor = textEdit;
+        QPointer<FindReplaceManager> self(this);
+        highlighter->setSnapshotSource([self](QTextDocument *document) {
+            return self ? self->documentSnapshot(document) : document->toPlainText();
+        });
+        connect(highlighter, &MatchHighlighter::totalCountChanged, this, &FindReplaceManager::matchCountChanged,
+                Qt::UniqueConnection);
+    }
+
+    // A pattern that is still being typed as a regular expression may be invalid
+    const bool valid = !m_options.regularExpression || SearchEngine::regularExpression(m_pattern, m_options).isValid();
+    highlighter->setSearch(valid ? m_pattern : QString(), m_options);
+}
+
+void FindReplaceManager::clearHighlights()
+{
+    if (m_highlightedEditor) {
+        MatchHighlighter *highlighter = MatchHighlighter::forEditor(m_highlightedEditor);
+        disconnect(highlighter, &MatchHighlighter::totalCountChanged, this, &FindReplaceManager::matchCountChanged);
+        highlighter->clear();
+    }
+    m_highlightedEditor.clear();
+    Q_EMIT matchCountChanged(-1);
+}
+
+void FindReplaceManager::selectMatch(KTextEdit *textEdit, const SearchMatch &match)
+{
+    QTextCursor cursor(textEdit->document());
+    cursor.setPosition(match.start);
+    cursor.setPosition(match.end(), QTextCursor::KeepAnchor);
+    textEdit->setTextCursor(cursor);
+    textEdit->ensureCursorVisible();
+}
+
+void FindReplaceManager::showStatus(const QString &message)
+{
+    if (m_statusLabel) {
+        m_statusLabel->setText(message);
+    }
+}
+
+KTextEdit* FindReplaceManager::getActiveEditor() const
+{
+    QMdiArea *mdiArea = getActiveMdiArea();
+    if (mdiArea && mdiArea->activeSubWindow()) {
+        return qobject_cast<KTextEdit*>(mdiArea->activeSubWindow()->widget());
+    }
+    return nullptr;
+}
+
+QMdiArea* FindReplaceManager::getActiveMdiArea() const
+{
+    QSplitter *splitter = qobject_cast<QSplitter*>(m_tabWidget->currentWidget());
+    if (splitter) {
+        return qobject_cast<QMdiArea*>(splitter->widget(0));
+    }
+    return nullptr;
+}
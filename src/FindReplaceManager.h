@@ -0,0 +1,123 @@
+#ifndef FINDREPLACEMANAGER_H
+#define FINDREPLACEMANAGER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include "SearchEngine.h"
+
+class QTabWidget;
+class QMdiArea;
+class QDialog;
+class QLineEdit;
+class QCheckBox;
+class QLabel;
+class QTimer;
+class QTextDocument;
+class KTextEdit;
+
+// This class provides find and replace for the active document
+class FindReplaceManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FindReplaceManager(QTabWidget *tabWidget, QObject *parent = nullptr);
+
+    // Current pattern and options, as entered in the dialog
+    QString pattern() const { return m_pattern; }
+    SearchOptions options() const { return m_options; }
+
+public Q_SLOTS:
+    // Show the find dialog, optionally with the replace field focused
+    void showFindDialog();
+    void showReplaceDialog();
+
+    // Select the next or previous match in the active document, wrapping around
+    void findNext();
+    void findPrevious();
+
+    // Replace the selected match and move on to the next one
+    void replace();
+
+    // Replace every match in the active document as one edit and one undo step.
+    // The new text is built on the thread pool and only the span between the first
+    // and the last match is replaced
+    void replaceAll();
+
+    // Count the matches in the active document on the thread pool
+    void countMatches();
+
+    // Remove the match highlights from the editor showing them
+    void clearHighlights();
+
+Q_SIGNALS:
+    // Emitted when the pattern or options change
+    void searchChanged();
+
+    // Emitted with the number of matches in the highlighted document, or -1 when unknown
+    void matchCountChanged(qsizetype count);
+
+private:
+    // Create the dialog on first use
+    void createDialog();
+
+    // Read pattern and options from the dialog
+    void updateSearchFromDialog();
+
+    // Find the pattern in a document from a position, forwards or backwards
+    SearchMatch find(QTextDocument *document, qsizetype from, bool backward = false);
+
+    // Find a literal pattern a chunk of blocks at a time, without copying the whole document
+    SearchMatch findLiteral(QTextDocument *document, int from, bool backward) const;
+
+    // Plain text of a document for regular expressions, kept for the next search until
+    // the document changes or the search goes idle
+    QStringView documentText(QTextDocument *document);
+
+    // The same snapshot, shared with the match highlighter
+    QString documentSnapshot(QTextDocument *document);
+
+    // Drop the snapshot
+    void releaseSnapshot();
+
+    // Select a match in the editor
+    void selectMatch(KTextEdit *textEdit, const SearchMatch &match);
+
+    // Show a short status message in the dialog
+    void showStatus(const QString &message);
+
+    // Highlight the matches in the active editor while the dialog is open
+    void updateHighlights();
+
+    // Helper functions to get the active editor and MDI area
+    KTextEdit* getActiveEditor() const;
+    QMdiArea* getActiveMdiArea() const;
+
+    QTabWidget *m_tabWidget;
+    QString m_pattern;
+    QString m_replacement;
+    SearchOptions m_options;
+
+    // Snapshot of the searched document
+    QPointer<QTextDocument> m_cachedDocument;
+    QString m_cachedText;
+    bool m_cacheValid;
+    QMetaObject::Connection m_cacheConnection;
+    QTimer *m_releaseTimer;
+
+    bool m_replaceAllRunning;
+
+    // Editor whose matches are highlighted
+    QPointer<KTextEdit> m_highlightedEditor;
+
+    QDialog *m_dialog;
+    QLineEdit *m_findEdit;
+    QLineEdit *m_replaceEdit;
+    QCheckBox *m_caseSensitiveCheckBox;
+    QCheckBox *m_wholeWordsCheckBox;
+    QCheckBox *m_regexCheckBox;
+    QLabel *m_statusLabel;
+};
+
+#endif // FINDREPLACEMANAGER_H
@@ -0,0 +1,394 @@
+#include "HexView.h"
+#include "ReadOnlyFile.h"
+#include <QApplication>
+#include <QFileSystemWatcher>
+#include <QFontDatabase>
+#include <QInputDialog>
+#include <QKeyEvent>
+#include <QLineEdit>
+#include <QLoggingCategory>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QScrollBar>
+#include <QThreadPool>
+#include <QTimer>
+#include <KLocalizedString>
+#include <KMessageBox>
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+Q_LOGGING_CATEGORY(hexViewLog, "mudoedit.hexview")
+
+namespace {
+
+// Bytes read and searched between two looks at whether the view is still there
+const qint64 SEARCH_BLOCK_BYTES = 4 << 20;
+
+// First offset in [from, to) where the pattern starts, or -1
+qint64 searchRange(const ReadOnlyFile &file, const QByteArray &pattern, qint64 from, qint64 to)
+{
+    const std::boyer_moore_horspool_searcher searcher(pattern.cbegin(), pattern.cend());
+    QByteArray block;
+    for (qint64 blockStart = from; blockStart < to && !file.isCancelled(); blockStart += SEARCH_BLOCK_BYTES) {
+        // Blocks overlap by the pattern, so matches across their borders are found too
+        const qint64 blockEnd = qMin(to, blockStart + SEARCH_BLOCK_BYTES);
+        const qint64 length = qMin(file.size(), blockEnd + pattern.size() - 1) - blockStart;
+        block = file.read(blockStart, length);
+        const char *found = std::search(block.cbegin(), block.cend(), searcher);
+        if (found != block.cend()) return blockStart + (found - block.cbegin());
+        // Cut short; there is nothing more to read
+        if (block.size() < length) break;
+    }
+    return -1;
+}
+
+} // namespace
+
+HexView::HexView(QWidget *parent)
+    : QAbstractScrollArea(parent),
+      m_watcher(new QFileSystemWatcher(this)),
+      m_cursor(0),
+      m_matchOffset(-1),
+      m_searching(false),
+      m_rowsPerStep(1)
+{
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    setFocusPolicy(Qt::StrongFocus);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &HexView::reopenIfTruncated);
+}
+
+HexView::~HexView()
+{
+    if (m_file) {
+        m_file->cancel();
+    }
+}
+
+bool HexView::openFile(const QString &filePath)
+{
+    std::shared_ptr<ReadOnlyFile> file = ReadOnlyFile::open(filePath);
+    if (!file) return false;
+
+    if (m_file) {
+        m_file->cancel();
+    }
+    m_file = file;
+    if (!m_watcher->files().isEmpty()) {
+        m_watcher->removePaths(m_watcher->files());
+    }
+    m_watcher->addPath(filePath);
+    m_cursor = 0;
+    m_matchOffset = -1;
+    updateScrollBars();
+    viewport()->update();
+    return true;
+}
+
+void HexView::reopenIfTruncated()
+{
+    if (!m_file || !m_file->isTruncated()) return;
+
+    const QString path = filePath();
+    const qint64 cursor = m_cursor;
+    qCInfo(hexViewLog) << path << "was cut short; opening it again";
+    if (openFile(path)) {
+        setCursor(cursor);
+    } else {
+        m_file->cancel();
+        m_file.reset();
+        updateScrollBars();
+        viewport()->update();
+    }
+}
+
+QString HexView::filePath() const
+{
+    return m_file ? m_file->fileName() : QString();
+}
+
+QByteArray HexView::parsePattern(const QString &pattern)
+{
+    const QString trimmed = pattern.trimmed();
+    if (trimmed.size() >= 2 && trimmed.startsWith(QLatin1Char('"')) && trimmed.endsWith(QLatin1Char('"'))) {
+        return trimmed.mid(1, trimmed.size() - 2).toUtf8();
+    }
+
+    QString digits = trimmed;
+    digits.remove(QRegularExpression(QStringLiteral("\\s+")));
+    if (digits.startsWith(QLatin1String("0x"), Qt::CaseInsensitive)) {
+        digits.remove(0, 2);
+    }
+    static const QRegularExpression hexDigits(QStringLiteral("^(?:[0-9A-Fa-f]{2})+$"));
+    if (!hexDigits.match(digits).hasMatch()) return QByteArray();
+    return QByteArray::fromHex(digits.toLatin1());
+}
+
+qint64 HexView::rowCount() const
+{
+    return m_file ? m_file->size() / BYTES_PER_ROW + 1 : 0;
+}
+
+qint64 HexView::topRow() const
+{
+    return qint64(verticalScrollBar()->value()) * m_rowsPerStep;
+}
+
+void HexView::updateScrollBars()
+{
+    const QFontMetrics metrics = fontMetrics();
+    const int visibleRows = qMax(1, viewport()->height() / metrics.lineSpacing());
+    const qint64 rows = rowCount();
+    m_rowsPerStep = rows / std::numeric_limits<int>::max() + 1;
+    verticalScrollBar()->setRange(0, int(qMax<qint64>(0, rows - visibleRows) / m_rowsPerStep));
+    verticalScrollBar()->setPageStep(int(qMax<qint64>(1, visibleRows / m_rowsPerStep)));
+    verticalScrollBar()->setSingleStep(1);
+
+    // Offset, hex and ASCII columns, in characters
+    const int offsetDigits = m_file && m_file->size() > 0xFFFFFFFFLL ? 16 : 8;
+    const int columns = offsetDigits + 2 + BYTES_PER_ROW * 3 + 2 + BYTES_PER_ROW;
+    const int charWidth = metrics.horizontalAdvance(QLatin1Char('0'));
+    horizontalScrollBar()->setRange(0, qMax(0, columns * charWidth - viewport()->width()));
+    horizontalScrollBar()->setPageStep(viewport()->width() / 2);
+    horizontalScrollBar()->setSingleStep(charWidth * 4);
+}
+
+void HexView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void HexView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+    QPainter painter(viewport());
+    const QPalette palette = viewport()->palette();
+    painter.fillRect(viewport()->rect(), palette.color(QPalette::Base));
+    if (!m_file) return;
+
+    // The rows and scroll range no longer fit a file that was cut short
+    if (m_file->isTruncated()) {
+        QTimer::singleShot(0, this, &HexView::reopenIfTruncated);
+        return;
+    }
+
+    const QFontMetrics metrics = fontMetrics();
+    const int lineHeight = metrics.lineSpacing();
+    const int charWidth = metrics.horizontalAdvance(QLatin1Char('0'));
+    const int offsetDigits = m_file->size() > 0xFFFFFFFFLL ? 16 : 8;
+    const int hexX = (offsetDigits + 2) * charWidth - horizontalScrollBar()->value();
+    const int asciiX = hexX + (BYTES_PER_ROW * 3 + 2) * charWidth;
+    const QColor matchColor(220, 170, 40, 90);
+
+    // The rows in view, in one read; fewer bytes come back if the file was cut short meanwhile
+    const qint64 visibleRows = viewport()->height() / lineHeight + 1;
+    const qint64 firstOffset = topRow() * BYTES_PER_ROW;
+    const QByteArray bytes = m_file->read(firstOffset, visibleRows * BYTES_PER_ROW);
+    const qint64 size = firstOffset + bytes.size();
+
+    int y = 0;
+    for (qint64 row = topRow(); row < rowCount() && y < viewport()->height(); ++row) {
+        const qint64 rowStart = row * BYTES_PER_ROW;
+        painter.setPen(palette.color(QPalette::PlaceholderText));
+        painter.drawText(-horizontalScrollBar()->value(), y + metrics.ascent(),
+                         QStringLiteral("%1").arg(rowStart, offsetDigits, 16, QLatin1Char('0')));
+
+        for (int column = 0; column < BYTES_PER_ROW && rowStart + column < size; ++column) {
+            const qint64 offset = rowStart + column;
+            const uchar byte = uchar(bytes.at(offset - firstOffset));
+            const int x = hexX + (column * 3 + (column >= BYTES_PER_ROW / 2 ? 1 : 0)) * charWidth;
+            const int cx = asciiX + column * charWidth;
+
+            if (m_matchOffset >= 0 && offset >= m_matchOffset && offset < m_matchOffset + m_pattern.size()) {
+                painter.fillRect(QRect(x, y, 2 * charWidth, lineHeight), matchColor);
+                painter.fillRect(QRect(cx, y, charWidth, lineHeight), matchColor);
+            }
+            if (offset == m_cursor) {
+                painter.fillRect(QRect(x, y, 2 * charWidth, lineHeight), palette.color(QPalette::Highlight));
+                painter.fillRect(QRect(cx, y, charWidth, lineHeight), palette.color(QPalette::Highlight));
+                painter.setPen(palette.color(QPalette::HighlightedText));
+            } else {
+                painter.setPen(palette.color(byte == 0 ? QPalette::PlaceholderText : QPalette::Text));
+            }
+            painter.drawText(x, y + metrics.ascent(), QStringLiteral("%1").arg(byte, 2, 16, QLatin1Char('0')));
+            const QChar character = byte >= 0x20 && byte < 0x7F ? QChar(QLatin1Char(char(byte))) : QChar(QLatin1Char('.'));
+            painter.drawText(cx, y + metrics.ascent(), QString(character));
+        }
+        y += lineHeight;
+    }
+
+    painter.setPen(palette.color(QPalette::Mid));
+    painter.drawLine(asciiX - charWidth, 0, asciiX - charWidth, viewport()->height());
+}
+
+void HexView::setCursor(qint64 offset)
+{
+    if (!m_file) return;
+    m_cursor = qBound<qint64>(0, offset, qMax<qint64>(0, m_file->size() - 1));
+    const qint64 row = m_cursor / BYTES_PER_ROW;
+    const qint64 visibleRows = qMax(1, viewport()->height() / fontMetrics().lineSpacing());
+    if (row < topRow()) {
+        verticalScrollBar()->setValue(int(row / m_rowsPerStep));
+    } else if (row >= topRow() + visibleRows) {
+        verticalScrollBar()->setValue(int((row - visibleRows + 1 + m_rowsPerStep - 1) / m_rowsPerStep));
+    }
+    viewport()->update();
+}
+
+bool HexView::event(QEvent *event)
+{
+    // Searching belongs to the view while it has focus, not to the editor actions
+    if (event->type() == QEvent::ShortcutOverride) {
+        QKeyEvent *keyEvent = static_cast<QKeyEvent*>(event);
+        if (keyEvent->matches(QKeySequence::Find) || keyEvent->matches(QKeySequence::FindNext)) {
+            event->accept();
+            return true;
+        }
+    }
+    return QAbstractScrollArea::event(event);
+}
+
+void HexView::keyPressEvent(QKeyEvent *event)
+{
+    if (event->matches(QKeySequence::Find)) {
+        find();
+        return;
+    }
+    if (event->matches(QKeySequence::FindNext)) {
+        findNext();
+        return;
+    }
+
+    const qint64 pageBytes = qint64(qMax(1, viewport()->height() / fontMetrics().lineSpacing() - 1)) * BYTES_PER_ROW;
+    const bool control = event->modifiers() & Qt::ControlModifier;
+    switch (event->key()) {
+    case Qt::Key_Left:
+        setCursor(m_cursor - 1);
+        break;
+    case Qt::Key_Right:
+        setCursor(m_cursor + 1);
+        break;
+    case Qt::Key_Up:
+        setCursor(m_cursor - BYTES_PER_ROW);
+        break;
+    case Qt::Key_Down:
+        setCursor(m_cursor + BYTES_PER_ROW);
+        break;
+    case Qt::Key_PageUp:
+        setCursor(m_cursor - pageBytes);
+        break;
+    case Qt::Key_PageDown:
+        setCursor(m_cursor + pageBytes);
+        break;
+    case Qt::Key_Home:
+        setCursor(control ? 0 : m_cursor - m_cursor % BYTES_PER_ROW);
+        break;
+    case Qt::Key_End:
+        setCursor(control ? std::numeric_limits<qint64>::max() : m_cursor - m_cursor % BYTES_PER_ROW + BYTES_PER_ROW - 1);
+        break;
+    default:
+        QAbstractScrollArea::keyPressEvent(event);
+        return;
+    }
+    event->accept();
+}
+
+void HexView::mousePressEvent(QMouseEvent *event)
+{
+    if (!m_file) return;
+    const QFontMetrics metrics = fontMetrics();
+    const int charWidth = metrics.horizontalAdvance(QLatin1Char('0'));
+    const int offsetDigits = m_file->size() > 0xFFFFFFFFLL ? 16 : 8;
+    const QPoint position = event->position().toPoint();
+    const int x = position.x() + horizontalScrollBar()->value();
+    const qint64 row = topRow() + position.y() / metrics.lineSpacing();
+
+    // A click in the hex column or in the ASCII column picks the byte under it
+    const int hexStart = (offsetDigits + 2) * charWidth;
+    const int asciiStart = hexStart + (BYTES_PER_ROW * 3 + 2) * charWidth;
+    int column = -1;
+    if (x >= asciiStart) {
+        column = (x - asciiStart) / charWidth;
+    } else if (x >= hexStart) {
+        int cell = (x - hexStart) / charWidth;
+        if (cell >= BYTES_PER_ROW / 2 * 3) {
+            --cell;
+        }
+        column = cell / 3;
+    }
+    if (column >= 0 && column < BYTES_PER_ROW) {
+        setCursor(row * BYTES_PER_ROW + column);
+    }
+}
+
+void HexView::find()
+{
+    bool ok = false;
+    const QString text = QInputDialog::getText(this, i18n("Find Bytes"),
+                                               i18n("Bytes as hex digits, like 7f 45 4c 46, or text in quotes:"),
+                                               QLineEdit::Normal, m_patternText, &ok);
+    if (!ok || text.isEmpty()) return;
+
+    const QByteArray pattern = parsePattern(text);
+    if (pattern.isEmpty()) {
+        KMessageBox::error(this, i18n("%1 is neither hex digits nor quoted text.", text));
+        return;
+    }
+    m_patternText = text;
+    m_pattern = pattern;
+    startSearch(m_cursor);
+}
+
+void HexView::findNext()
+{
+    if (m_pattern.isEmpty()) {
+        find();
+        return;
+    }
+    startSearch(m_matchOffset == m_cursor ? m_cursor + 1 : m_cursor);
+}
+
+void HexView::startSearch(qint64 from)
+{
+    if (!m_file || m_searching) return;
+    m_searching = true;
+    QApplication::setOverrideCursor(Qt::BusyCursor);
+
+    QPointer<HexView> self(this);
+    const std::shared_ptr<ReadOnlyFile> file = m_file;
+    const QByteArray pattern = m_pattern;
+    QThreadPool::globalInstance()->start([self, file, pattern, from]() {
+        qint64 offset = searchRange(*file, pattern, qMin(from, file->size()), file->size());
+        if (offset < 0) {
+            offset = searchRange(*file, pattern, 0, qMin(from, file->size()));
+        }
+        QMetaObject::invokeMethod(qApp, [self, file, offset]() {
+            QApplication::restoreOverrideCursor();
+            if (!self) return;
+            // A search of a file that was cut short meanwhile found nothing that can be shown
+            if (self->m_file != file || file->isTruncated()) {
+                self->m_searching = false;
+                self->reopenIfTruncated();
+                return;
+            }
+            self->searchFinished(offset);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void HexView::searchFinished(qint64 offset)
+{
+    m_searching = false;
+    if (offset < 0) {
+        m_matchOffset = -1;
+        viewport()->update();
+        KMessageBox::information(this, i18n("The bytes %1 were not found.", m_patternText));
+        return;
+    }
+    qCDebug(hexViewLog) << "Found" << m_pattern.toHex(' ') << "at offset" << offset;
+    m_matchOffset = offset;
+    setCursor(offset);
+}
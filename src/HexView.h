@@ -0,0 +1,75 @@
+#ifndef HEXVIEW_H
+#define HEXVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QByteArray>
+#include <QString>
+#include <memory>
+
+class QFileSystemWatcher;
+class ReadOnlyFile;
+
+// This class shows a binary file as offsets, hex bytes and their ASCII characters. The
+// file is never loaded or decoded; only the rows in view are read and painted, so it
+// opens at once at any size. Ctrl+F searches for a byte pattern, given as hex digits or as
+// quoted text, on the thread pool from the cursor on; F3 finds the next match. A file
+// cut short is opened again
+class HexView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit HexView(QWidget *parent = nullptr);
+    ~HexView() override;
+
+    // Open a file; returns false if it cannot be opened
+    bool openFile(const QString &filePath);
+
+    QString filePath() const;
+
+    // Ask for a byte pattern and find it, or find the last one again
+    void find();
+    void findNext();
+
+    // Bytes of hex digits, or of the text between quotes; empty if it is neither
+    static QByteArray parsePattern(const QString &pattern);
+
+protected:
+    bool event(QEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+
+private:
+    // Open the file again if it became shorter than it was
+    void reopenIfTruncated();
+
+    // Search from an offset to the end, then from the start
+    void startSearch(qint64 from);
+
+    // Select a match, or report that there was none
+    void searchFinished(qint64 offset);
+
+    // Move the cursor to a byte and scroll it into view
+    void setCursor(qint64 offset);
+
+    // The first row in view; very large files scroll several rows per step
+    qint64 topRow() const;
+    qint64 rowCount() const;
+
+    void updateScrollBars();
+
+    std::shared_ptr<ReadOnlyFile> m_file;
+    QFileSystemWatcher *m_watcher;
+    qint64 m_cursor;
+    qint64 m_matchOffset;
+    QByteArray m_pattern;
+    QString m_patternText;
+    bool m_searching;
+    qint64 m_rowsPerStep;
+
+    static const int BYTES_PER_ROW = 16;
+};
+
+#endif // HEXVIEW_H
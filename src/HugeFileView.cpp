@@ -0,0 +1,393 @@
+#include "HugeFileView.h"
+#include "ReadOnlyFile.h"
+#include <QApplication>
+#include <QClipboard>
+#include <QFileSystemWatcher>
+#include <QFontDatabase>
+#include <QKeyEvent>
+#include <QLoggingCategory>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPointer>
+#include <QScrollBar>
+#include <QThreadPool>
+#include <QTimer>
+#include <KLocalizedString>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+Q_LOGGING_CATEGORY(hugeFileViewLog, "mudoedit.hugefileview")
+
+namespace {
+
+// Nobody scrolls further right than this within one line; longer lines are indexed
+const int MAX_PAINTED_BYTES = 16384;
+
+// Bytes read at once by the indexing job and by painting
+const qint64 READ_BLOCK_BYTES = 1 << 20;
+
+} // namespace
+
+HugeFileView::HugeFileView(QWidget *parent)
+    : QAbstractScrollArea(parent),
+      m_watcher(new QFileSystemWatcher(this)),
+      m_bufferStart(0),
+      m_lineCount(0),
+      m_indexedBytes(0),
+      m_indexed(false),
+      m_currentLine(-1),
+      m_linesPerStep(1)
+{
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    setFocusPolicy(Qt::StrongFocus);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, [this]() {
+        // What was read may have been written over
+        m_buffer.clear();
+        reopenIfTruncated();
+    });
+}
+
+HugeFileView::~HugeFileView()
+{
+    if (m_file) {
+        m_file->cancel();
+    }
+}
+
+QString HugeFileView::filePath() const
+{
+    return m_file ? m_file->fileName() : QString();
+}
+
+bool HugeFileView::openFile(const QString &filePath)
+{
+    std::shared_ptr<ReadOnlyFile> file = ReadOnlyFile::open(filePath);
+    if (!file) return false;
+
+    if (m_file) {
+        m_file->cancel();
+    }
+    m_file = file;
+    m_buffer.clear();
+    m_bufferStart = 0;
+    if (!m_watcher->files().isEmpty()) {
+        m_watcher->removePaths(m_watcher->files());
+    }
+    m_watcher->addPath(filePath);
+    m_checkpoints.assign(1, 0);
+    m_longLines.clear();
+    m_lineCount = 1;
+    m_indexedBytes = 0;
+    m_indexed = file->size() == 0;
+    updateScrollBars();
+    if (m_indexed) return true;
+
+    // Offsets are handed over in batches, so the view can be scrolled while the rest is indexed
+    QPointer<HugeFileView> self(this);
+    QThreadPool::globalInstance()->start([self, file]() {
+        const qint64 size = file->size();
+        const auto post = [self, file](const std::vector<qint64> &checkpoints, const std::vector<LongLine> &longLines,
+                                       qint64 lineCount, qint64 indexedBytes, bool finished) {
+            QMetaObject::invokeMethod(qApp, [self, file, checkpoints, longLines, lineCount, indexedBytes, finished]() {
+                // Batches of a file that was opened again meanwhile are dropped
+                if (self && self->m_file == file) {
+                    self->addCheckpoints(checkpoints, longLines, lineCount, indexedBytes, finished);
+                }
+            }, Qt::QueuedConnection);
+        };
+
+        QByteArray block(READ_BLOCK_BYTES, Qt::Uninitialized);
+        std::vector<qint64> checkpoints;
+        std::vector<LongLine> longLines;
+        qint64 line = 0;
+        qint64 lineBegin = 0;
+        qint64 position = 0;
+        qint64 nextBatch = INDEX_BATCH_BYTES;
+        while (position < size && !file->isCancelled()) {
+            const qint64 blockStart = position;
+            const qint64 count = file->read(blockStart, block.data(), qMin(size - blockStart, READ_BLOCK_BYTES));
+            // Cut short; the view opens it again
+            if (count <= 0) return;
+
+            const char *data = block.constData();
+            const qint64 blockEnd = blockStart + count;
+            while (position < blockEnd) {
+                const void *lineBreak = std::memchr(data + (position - blockStart), '\n', size_t(blockEnd - position));
+                if (!lineBreak) {
+                    position = blockEnd;
+                    break;
+                }
+                const qint64 end = blockStart + (static_cast<const char*>(lineBreak) - data);
+                if (end - lineBegin >= MAX_PAINTED_BYTES) {
+                    longLines.push_back({lineBegin, end});
+                }
+                position = end + 1;
+                lineBegin = position;
+                if (++line % LINES_PER_CHECKPOINT == 0) {
+                    checkpoints.push_back(position);
+                }
+            }
+            if (lineBegin >= nextBatch) {
+                post(checkpoints, longLines, line + 1, lineBegin, false);
+                checkpoints.clear();
+                longLines.clear();
+                nextBatch = lineBegin + INDEX_BATCH_BYTES;
+            }
+        }
+        if (!file->isCancelled()) {
+            if (size - lineBegin >= MAX_PAINTED_BYTES) {
+                longLines.push_back({lineBegin, size});
+            }
+            post(checkpoints, longLines, line + 1, size, true);
+        }
+    });
+    return true;
+}
+
+void HugeFileView::addCheckpoints(const std::vector<qint64> &checkpoints, const std::vector<LongLine> &longLines,
+                                  qint64 lineCount, qint64 indexedBytes, bool finished)
+{
+    m_checkpoints.insert(m_checkpoints.end(), checkpoints.cbegin(), checkpoints.cend());
+    m_longLines.insert(m_longLines.end(), longLines.cbegin(), longLines.cend());
+    m_lineCount = lineCount;
+    m_indexedBytes = indexedBytes;
+    m_indexed = finished;
+    if (finished) {
+        qCDebug(hugeFileViewLog) << "Indexed" << m_lineCount << "lines of" << filePath() << "with"
+                                 << m_checkpoints.size() << "checkpoints and" << m_longLines.size() << "long lines";
+    }
+    updateScrollBars();
+    viewport()->update();
+}
+
+QByteArrayView HugeFileView::bytesAt(qint64 offset, qint64 length) const
+{
+    // The lines in view lie next to each other, so a paint mostly takes one read
+    if (offset < m_bufferStart || offset + length > m_bufferStart + m_buffer.size()) {
+        m_buffer = m_file->read(offset, qMax(length, READ_BLOCK_BYTES));
+        m_bufferStart = offset;
+    }
+    const QByteArrayView buffered(m_buffer);
+    return buffered.sliced(offset - m_bufferStart).first(qMin<qint64>(length, m_buffer.size() - (offset - m_bufferStart)));
+}
+
+qint64 HugeFileView::lineEnd(qint64 start) const
+{
+    const qint64 size = m_file->size();
+    if (start >= size) return size;
+    const qint64 length = qMin<qint64>(size - start, MAX_PAINTED_BYTES);
+    const QByteArrayView bytes = bytesAt(start, length);
+    const void *lineBreak = std::memchr(bytes.data(), '\n', size_t(bytes.size()));
+    if (lineBreak) return start + (static_cast<const char*>(lineBreak) - bytes.data());
+    // Cut short; nothing after this can be read
+    if (bytes.size() < length) return size;
+
+    // Longer lines were indexed; one that is not yet is the last one indexing has reached
+    const auto longLine = std::lower_bound(m_longLines.cbegin(), m_longLines.cend(), start,
+                                           [](const LongLine &line, qint64 offset) { return line.start < offset; });
+    return longLine != m_longLines.cend() && longLine->start == start ? longLine->end : size;
+}
+
+qint64 HugeFileView::lineStart(qint64 line) const
+{
+    const size_t checkpoint = qMin(size_t(line / LINES_PER_CHECKPOINT), m_checkpoints.size() - 1);
+    qint64 start = m_checkpoints[checkpoint];
+    for (qint64 skipped = qint64(checkpoint) * LINES_PER_CHECKPOINT; skipped < line; ++skipped) {
+        start = qMin(lineEnd(start) + 1, m_file->size());
+    }
+    return start;
+}
+
+QString HugeFileView::lineText(qint64 start, qint64 end) const
+{
+    QByteArrayView bytes = bytesAt(start, qMin<qint64>(end - start, MAX_PAINTED_BYTES));
+    if (!bytes.isEmpty() && end - start == bytes.size() && bytes.back() == '\r') {
+        bytes.chop(1);
+    }
+    QString text = QString::fromUtf8(bytes);
+    return text.replace(QLatin1Char('\t'), QStringLiteral("    "));
+}
+
+void HugeFileView::reopenIfTruncated()
+{
+    if (!m_file || !m_file->isTruncated()) return;
+
+    const QString path = filePath();
+    qCInfo(hugeFileViewLog) << path << "was cut short; opening it again";
+    m_currentLine = -1;
+    if (!openFile(path)) {
+        m_file->cancel();
+        m_file.reset();
+        m_checkpoints.clear();
+        m_longLines.clear();
+        m_lineCount = 0;
+        updateScrollBars();
+    }
+    viewport()->update();
+}
+
+qint64 HugeFileView::topLine() const
+{
+    return qint64(verticalScrollBar()->value()) * m_linesPerStep;
+}
+
+int HugeFileView::visibleRows() const
+{
+    return qMax(1, viewport()->height() / fontMetrics().lineSpacing());
+}
+
+void HugeFileView::updateScrollBars()
+{
+    const QFontMetrics metrics = fontMetrics();
+    const int rows = visibleRows();
+
+    // Rounded up, so the last lines can still be scrolled into view
+    const qint64 top = topLine();
+    const qint64 linesPerStep = m_lineCount / std::numeric_limits<int>::max() + 1;
+    const bool rescaled = linesPerStep != m_linesPerStep;
+    m_linesPerStep = linesPerStep;
+    verticalScrollBar()->setRange(0, int((qMax<qint64>(0, m_lineCount - rows) + m_linesPerStep - 1) / m_linesPerStep));
+    verticalScrollBar()->setPageStep(int(qMax<qint64>(1, rows / m_linesPerStep)));
+    verticalScrollBar()->setSingleStep(1);
+    if (rescaled) {
+        scrollToLine(top);
+    }
+    horizontalScrollBar()->setPageStep(viewport()->width() / 2);
+    horizontalScrollBar()->setSingleStep(metrics.horizontalAdvance(QLatin1Char('0')) * 4);
+}
+
+void HugeFileView::scrollToLine(qint64 line)
+{
+    verticalScrollBar()->setValue(int(qMax<qint64>(0, line) / m_linesPerStep));
+}
+
+void HugeFileView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void HugeFileView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+    QPainter painter(viewport());
+    const QPalette palette = viewport()->palette();
+    painter.fillRect(viewport()->rect(), palette.color(QPalette::Base));
+    if (!m_file) return;
+    // The index no longer fits a file that was cut short
+    if (m_file->isTruncated()) {
+        QTimer::singleShot(0, this, &HugeFileView::reopenIfTruncated);
+        return;
+    }
+
+    const QFontMetrics metrics = fontMetrics();
+    const int lineHeight = metrics.lineSpacing();
+    const int digitWidth = metrics.horizontalAdvance(QLatin1Char('0'));
+    const int gutterWidth = digitWidth * int(QString::number(m_lineCount).size() + 2);
+    const int width = viewport()->width();
+    const int scrollX = horizontalScrollBar()->value();
+
+    // Only the first line in view is looked up; the others follow from it
+    int widest = 0;
+    int y = 0;
+    qint64 line = topLine();
+    qint64 start = lineStart(line);
+    while (line < m_lineCount && y < viewport()->height()) {
+        const qint64 end = lineEnd(start);
+        if (line == m_currentLine) {
+            painter.fillRect(QRect(0, y, width, lineHeight), palette.color(QPalette::AlternateBase));
+        }
+        painter.setPen(palette.color(QPalette::PlaceholderText));
+        painter.drawText(QRect(0, y, gutterWidth - digitWidth, lineHeight),
+                         Qt::AlignRight | Qt::AlignVCenter, QString::number(line + 1));
+
+        const QString text = lineText(start, end);
+        const QRect textRect(gutterWidth, y, width - gutterWidth, lineHeight);
+        painter.save();
+        painter.setClipRect(textRect);
+        painter.setPen(palette.color(QPalette::Text));
+        painter.drawText(textRect.x() - scrollX, y + metrics.ascent(), text);
+        painter.restore();
+        widest = qMax(widest, metrics.horizontalAdvance(text));
+
+        if (end >= m_file->size()) break;
+        start = end + 1;
+        ++line;
+        y += lineHeight;
+    }
+
+    if (!m_indexed) {
+        const QString progress = i18n("Indexing lines... %1%", int(m_indexedBytes * 100 / qMax<qint64>(1, m_file->size())));
+        const QRect progressRect = metrics.boundingRect(progress).adjusted(-digitWidth, 0, digitWidth, 0);
+        const QRect box(width - progressRect.width() - digitWidth, viewport()->height() - lineHeight - digitWidth,
+                        progressRect.width(), lineHeight);
+        painter.fillRect(box, palette.color(QPalette::ToolTipBase));
+        painter.setPen(palette.color(QPalette::ToolTipText));
+        painter.drawText(box, Qt::AlignCenter, progress);
+    }
+
+    // Only the lines in view are measured, so the range grows as wider ones scroll in
+    const int maximum = widest + digitWidth - (width - gutterWidth);
+    if (maximum > horizontalScrollBar()->maximum()) {
+        horizontalScrollBar()->setMaximum(maximum);
+    }
+}
+
+void HugeFileView::keyPressEvent(QKeyEvent *event)
+{
+    if (event->matches(QKeySequence::Copy)) {
+        if (m_file && m_currentLine >= 0 && !m_file->isTruncated()) {
+            const qint64 start = lineStart(m_currentLine);
+            QApplication::clipboard()->setText(lineText(start, lineEnd(start)));
+        }
+        event->accept();
+        return;
+    }
+
+    const int rows = visibleRows();
+    const qint64 pageRows = qMax(1, rows - 1);
+    qint64 line = qMax<qint64>(m_currentLine, topLine());
+    switch (event->key()) {
+    case Qt::Key_Up:
+        line -= 1;
+        break;
+    case Qt::Key_Down:
+        line += 1;
+        break;
+    case Qt::Key_PageUp:
+        line -= pageRows;
+        break;
+    case Qt::Key_PageDown:
+        line += pageRows;
+        break;
+    case Qt::Key_Home:
+        line = 0;
+        break;
+    case Qt::Key_End:
+        line = m_lineCount - 1;
+        break;
+    default:
+        QAbstractScrollArea::keyPressEvent(event);
+        return;
+    }
+
+    m_currentLine = qBound<qint64>(0, line, m_lineCount - 1);
+    const qint64 top = topLine();
+    if (m_currentLine < top) {
+        scrollToLine(m_currentLine);
+    } else if (m_currentLine >= top + rows) {
+        verticalScrollBar()->setValue(int((m_currentLine - rows + m_linesPerStep) / m_linesPerStep));
+    }
+    viewport()->update();
+    event->accept();
+}
+
+void HugeFileView::mousePressEvent(QMouseEvent *event)
+{
+    const qint64 line = topLine() + event->position().toPoint().y() / fontMetrics().lineSpacing();
+    if (line < m_lineCount) {
+        m_currentLine = line;
+        viewport()->update();
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef HUGEFILEVIEW_H
+#define HUGEFILEVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <memory>
+#include <vector>
+
+class QFileSystemWatcher;
+class ReadOnlyFile;
+
+// This class shows a file too large to load as a document, read-only. Only the lines in
+// view are read, decoded and painted, so opening takes the same time for any size. The
+// lines are indexed on the thread pool, keeping only the offset of every
+// LINES_PER_CHECKPOINT-th line and the end of every line too long to paint whole, so
+// finding a line never reads more than a painted line's worth; the scroll range grows
+// as the index does. A file cut short is opened and indexed again
+class HugeFileView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit HugeFileView(QWidget *parent = nullptr);
+    ~HugeFileView() override;
+
+    // Open a file and start indexing its lines; returns false if it cannot be opened
+    bool openFile(const QString &filePath);
+
+    QString filePath() const;
+
+    // Lines found so far, and whether that is all of them
+    qint64 lineCount() const { return m_lineCount; }
+    bool isIndexed() const { return m_indexed; }
+
+    // Scroll a 0-based line to the top of the view
+    void scrollToLine(qint64 line);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+
+private:
+    // A line too long to paint whole, from its start to its line break
+    struct LongLine {
+        qint64 start;
+        qint64 end;
+    };
+
+    // Take a batch of line offsets from the indexing job
+    void addCheckpoints(const std::vector<qint64> &checkpoints, const std::vector<LongLine> &longLines,
+                        qint64 lineCount, qint64 indexedBytes, bool finished);
+
+    // Open and index the file again if it became shorter than it was
+    void reopenIfTruncated();
+
+    // Up to length bytes at an offset, read through a buffer kept between calls
+    QByteArrayView bytesAt(qint64 offset, qint64 length) const;
+
+    // Offset of the start of a line, found from the checkpoint before it
+    qint64 lineStart(qint64 line) const;
+
+    // Offset of the line break ending the line that starts at an offset, or the file size
+    qint64 lineEnd(qint64 start) const;
+
+    // The start of a line as it is painted
+    QString lineText(qint64 start, qint64 end) const;
+
+    // The first line in view; files with more lines than a scroll bar holds scroll several per step
+    qint64 topLine() const;
+    int visibleRows() const;
+
+    void updateScrollBars();
+
+    std::shared_ptr<ReadOnlyFile> m_file;
+    QFileSystemWatcher *m_watcher;
+    mutable QByteArray m_buffer;
+    mutable qint64 m_bufferStart;
+    std::vector<qint64> m_checkpoints;
+    std::vector<LongLine> m_longLines;
+    qint64 m_lineCount;
+    qint64 m_indexedBytes;
+    bool m_indexed;
+    qint64 m_currentLine;
+    qint64 m_linesPerStep;
+
+    // Every this many lines the offset of a line is kept
+    static const int LINES_PER_CHECKPOINT = 64;
+
+    // Bytes indexed between two batches handed to the view
+    static const qint64 INDEX_BATCH_BYTES = 64 << 20;
+
+};
+
+#endif // HUGEFILEVIEW_H
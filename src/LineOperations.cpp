@@ -0,0 +1,497 @@
+#include "LineOperations.h"
+#include "BulkEdit.h"
+#include "ClipboardTransfer.h"
+#include "MemoryBudgetManager.h"
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QInputDialog>
+#include <QLineEdit>
+#include <QLocale>
+#include <QLoggingCategory>
+#include <QMdiArea>
+#include <QMdiSubWindow>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRandomGenerator>
+#include <QSet>
+#include <QSplitter>
+#include <QTabWidget>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <KLocalizedString>
+#include <KMessageBox>
+#include <KTextEdit>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+Q_LOGGING_CATEGORY(lineOperationsLog, "mudoedit.lineoperations")
+
+namespace {
+
+// Fewer items than this are not worth handing to another thread
+const qsizetype MIN_RANGE_ITEMS = 16384;
+
+// A line and what it is sorted by
+struct Line {
+    QStringView text;
+    QStringView key;
+    double number = 0;
+    bool numeric = false;
+};
+
+// Lines with a number come first in numeric order, then the rest by text
+bool lineLessThan(const Line &a, const Line &b)
+{
+    if (a.numeric != b.numeric) return a.numeric;
+    if (a.numeric && a.number != b.number) return a.number < b.number;
+    return a.key.compare(b.key) < 0;
+}
+
+struct ParallelWork {
+    std::function<void(qsizetype)> work;
+    qsizetype count = 0;
+    std::atomic<qsizetype> next{0};
+    std::atomic<qsizetype> done{0};
+    QMutex mutex;
+    QWaitCondition finished;
+};
+
+void runItems(ParallelWork &state)
+{
+    for (qsizetype item = state.next.fetch_add(1); item < state.count; item = state.next.fetch_add(1)) {
+        state.work(item);
+        if (state.done.fetch_add(1) + 1 == state.count) {
+            QMutexLocker locker(&state.mutex);
+            state.finished.wakeAll();
+        }
+    }
+}
+
+// Run work for every item in [0, count). The calling thread takes items too, so this
+// finishes even when every pool thread is busy, including with the caller itself
+void parallelFor(qsizetype count, std::function<void(qsizetype)> work)
+{
+    if (count <= 0) return;
+
+    // Helpers that start late find no items left and never touch the work
+    std::shared_ptr<ParallelWork> state = std::make_shared<ParallelWork>();
+    state->work = std::move(work);
+    state->count = count;
+    const qsizetype helpers = qMin<qsizetype>(count, QThread::idealThreadCount()) - 1;
+    for (qsizetype i = 0; i < helpers; ++i) {
+        QThreadPool::globalInstance()->start([state]() {
+            runItems(*state);
+        });
+    }
+    runItems(*state);
+
+    QMutexLocker locker(&state->mutex);
+    while (state->done.load() < count) {
+        state->finished.wait(&state->mutex);
+    }
+}
+
+// Run work(begin, end) over consecutive ranges covering [0, count)
+void parallelRanges(qsizetype count, const std::function<void(qsizetype, qsizetype)> &work)
+{
+    const qsizetype ranges = qBound<qsizetype>(1, count / MIN_RANGE_ITEMS, QThread::idealThreadCount() * 4);
+    parallelFor(ranges, [&](qsizetype range) {
+        work(count * range / ranges, count * (range + 1) / ranges);
+    });
+}
+
+// Sort runs of the lines in parallel, then merge neighbouring runs pairwise in parallel
+void parallelSort(std::vector<Line> &lines)
+{
+    const qsizetype count = qsizetype(lines.size());
+    const qsizetype runs = qBound<qsizetype>(1, count / MIN_RANGE_ITEMS, QThread::idealThreadCount());
+    if (runs == 1) {
+        std::stable_sort(lines.begin(), lines.end(), lineLessThan);
+        return;
+    }
+
+    std::vector<qsizetype> bounds;
+    for (qsizetype run = 0; run <= runs; ++run) {
+        bounds.push_back(count * run / runs);
+    }
+    parallelFor(runs, [&](qsizetype run) {
+        std::stable_sort(lines.begin() + bounds[run], lines.begin() + bounds[run + 1], lineLessThan);
+    });
+
+    std::vector<Line> buffer(lines.size());
+    std::vector<Line> *from = &lines;
+    std::vector<Line> *to = &buffer;
+    while (bounds.size() > 2) {
+        const qsizetype current = qsizetype(bounds.size()) - 1;
+        const qsizetype pairs = (current + 1) / 2;
+        parallelFor(pairs, [&](qsizetype pair) {
+            const qsizetype low = bounds[2 * pair];
+            const qsizetype middle = bounds[qMin(2 * pair + 1, current)];
+            const qsizetype high = bounds[qMin(2 * pair + 2, current)];
+            std::merge(from->begin() + low, from->begin() + middle, from->begin() + middle, from->begin() + high,
+                       to->begin() + low, lineLessThan);
+        });
+
+        std::vector<qsizetype> merged;
+        for (qsizetype pair = 0; pair < pairs; ++pair) {
+            merged.push_back(bounds[2 * pair]);
+        }
+        merged.push_back(count);
+        bounds.swap(merged);
+        std::swap(from, to);
+    }
+    if (from != &lines) {
+        lines.swap(buffer);
+    }
+}
+
+// Read the number at the start of the text; with whole set nothing but spaces may follow it
+bool parseNumber(QStringView text, bool whole, double *number)
+{
+    const qsizetype size = text.size();
+    qsizetype start = 0;
+    while (start < size && text[start].isSpace()) ++start;
+
+    qsizetype end = start;
+    if (end < size && (text[end] == QLatin1Char('-') || text[end] == QLatin1Char('+'))) ++end;
+    qsizetype digits = 0;
+    while (end < size && text[end].isDigit()) { ++end; ++digits; }
+    if (end < size && text[end] == QLatin1Char('.')) {
+        ++end;
+        while (end < size && text[end].isDigit()) { ++end; ++digits; }
+    }
+    if (digits == 0) return false;
+    if (end < size && (text[end] == QLatin1Char('e') || text[end] == QLatin1Char('E'))) {
+        qsizetype exponent = end + 1;
+        if (exponent < size && (text[exponent] == QLatin1Char('-') || text[exponent] == QLatin1Char('+'))) ++exponent;
+        if (exponent < size && text[exponent].isDigit()) {
+            end = exponent;
+            while (end < size && text[end].isDigit()) ++end;
+        }
+    }
+    if (whole && !text.mid(end).trimmed().isEmpty()) return false;
+
+    bool ok = false;
+    *number = text.mid(start, end - start).toDouble(&ok);
+    return ok;
+}
+
+// The field of a line counted from 1; runs of whitespace separate fields if the separator is null
+QStringView fieldOf(QStringView line, int field, QChar separator)
+{
+    const qsizetype size = line.size();
+    qsizetype position = 0;
+    for (int current = 1; ; ++current) {
+        if (separator.isNull()) {
+            while (position < size && line[position].isSpace()) ++position;
+        }
+        qsizetype end = position;
+        while (end < size && (separator.isNull() ? !line[end].isSpace() : line[end] != separator)) ++end;
+        if (current == field) return line.mid(position, end - position);
+        if (end >= size) return QStringView();
+        position = end + 1;
+    }
+}
+
+// Drop the lines not marked to keep, keeping the order of the others
+void compact(std::vector<Line> &lines, const std::vector<char> &keep)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (keep[i]) {
+            lines[kept++] = lines[i];
+        }
+    }
+    lines.resize(kept);
+}
+
+} // namespace
+
+LineOperations::LineOperations(QTabWidget *tabWidget, QObject *parent)
+    : QObject(parent),
+      m_tabWidget(tabWidget),
+      m_operation(LineOperation::Sort),
+      m_generation(0),
+      m_start(0),
+      m_end(0),
+      m_revision(0),
+      m_wasReadOnly(false),
+      m_copyTime(0)
+{
+}
+
+LineOperations::~LineOperations()
+{
+    release();
+}
+
+LineOperations::Result LineOperations::process(QStringView text, const Options &options)
+{
+    // Index the lines as views into the text
+    std::vector<Line> lines;
+    for (qsizetype position = 0; ; ) {
+        qsizetype end = position;
+        while (end < text.size() && text[end] != QChar::ParagraphSeparator && text[end] != QLatin1Char('\n')) ++end;
+        Line line;
+        line.text = text.mid(position, end - position);
+        line.key = line.text;
+        lines.push_back(line);
+        if (end >= text.size()) break;
+        position = end + 1;
+    }
+
+    // The empty line after a final newline belongs at the end whatever happens to the others
+    const bool finalNewline = lines.size() > 1 && lines.back().text.isEmpty();
+    if (finalNewline) {
+        lines.pop_back();
+    }
+
+    Result result;
+    result.linesBefore = qsizetype(lines.size());
+    const qsizetype count = qsizetype(lines.size());
+
+    switch (options.operation) {
+    case LineOperation::Sort:
+        parallelSort(lines);
+        break;
+    case LineOperation::SortNumerically:
+        parallelRanges(count, [&](qsizetype begin, qsizetype end) {
+            for (qsizetype i = begin; i < end; ++i) {
+                lines[i].numeric = parseNumber(lines[i].text, false, &lines[i].number);
+            }
+        });
+        parallelSort(lines);
+        break;
+    case LineOperation::SortByField:
+        parallelRanges(count, [&](qsizetype begin, qsizetype end) {
+            for (qsizetype i = begin; i < end; ++i) {
+                lines[i].key = fieldOf(lines[i].text, options.field, options.separator);
+                lines[i].numeric = parseNumber(lines[i].key, true, &lines[i].number);
+            }
+        });
+        parallelSort(lines);
+        break;
+    case LineOperation::Unique: {
+        // Every shard keeps the first of its own lines, so the shards never share a set
+        std::vector<size_t> hashes(lines.size());
+        parallelRanges(count, [&](qsizetype begin, qsizetype end) {
+            for (qsizetype i = begin; i < end; ++i) {
+                hashes[i] = qHash(lines[i].text);
+            }
+        });
+        const qsizetype shards = qMax(1, QThread::idealThreadCount());
+        std::vector<char> keep(lines.size(), 0);
+        parallelFor(shards, [&](qsizetype shard) {
+            QSet<QStringView> seen;
+            for (qsizetype i = 0; i < count; ++i) {
+                if (qsizetype(hashes[i] % size_t(shards)) != shard) continue;
+                const qsizetype before = seen.size();
+                seen.insert(lines[i].text);
+                keep[i] = seen.size() != before;
+            }
+        });
+        compact(lines, keep);
+        break;
+    }
+    case LineOperation::Reverse:
+        std::reverse(lines.begin(), lines.end());
+        break;
+    case LineOperation::Shuffle: {
+        QRandomGenerator generator(QRandomGenerator::global()->generate());
+        std::shuffle(lines.begin(), lines.end(), generator);
+        break;
+    }
+    case LineOperation::KeepMatching:
+    case LineOperation::RemoveMatching: {
+        const bool keepMatches = options.operation == LineOperation::KeepMatching;
+        std::vector<char> keep(lines.size(), 0);
+        parallelRanges(count, [&](qsizetype begin, qsizetype end) {
+            for (qsizetype i = begin; i < end; ++i) {
+                keep[i] = options.pattern.match(lines[i].text).hasMatch() == keepMatches;
+            }
+        });
+        compact(lines, keep);
+        break;
+    }
+    }
+
+    result.linesAfter = qsizetype(lines.size());
+
+    qsizetype length = 0;
+    for (const Line &line : lines) {
+        length += line.text.size() + 1;
+    }
+    result.text.reserve(length);
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (i > 0) {
+            result.text.append(QLatin1Char('\n'));
+        }
+        result.text.append(lines[i].text);
+    }
+    if (finalNewline && !lines.empty()) {
+        result.text.append(QLatin1Char('\n'));
+    }
+    return result;
+}
+
+void LineOperations::run(LineOperation operation)
+{
+    QMdiArea *mdiArea = getActiveMdiArea();
+    if (!mdiArea || !mdiArea->activeSubWindow()) return;
+    KTextEdit *textEdit = qobject_cast<KTextEdit*>(mdiArea->activeSubWindow()->widget());
+    if (!textEdit) return;
+
+    if (m_textEdit) {
+        KMessageBox::information(m_tabWidget, i18n("Another line operation is still running."));
+        return;
+    }
+    if (ClipboardTransfer::isPasting(textEdit)) {
+        KMessageBox::information(m_tabWidget, i18n("Wait for the paste to finish before changing the lines."));
+        return;
+    }
+
+    Options options;
+    options.operation = operation;
+    bool ok = true;
+    if (operation == LineOperation::SortByField) {
+        // A number, optionally followed by the separator, as in "3," for the third comma-separated field
+        const QString field = QInputDialog::getText(m_tabWidget, i18n("Sort by Field"),
+                                                    i18n("Field number, followed by its separator if it is not whitespace:"),
+                                                    QLineEdit::Normal, QStringLiteral("1"), &ok).trimmed();
+        if (!ok) return;
+        qsizetype digits = 0;
+        while (digits < field.size() && field[digits].isDigit()) ++digits;
+        options.field = QStringView(field).left(digits).toInt();
+        if (options.field < 1 || field.size() - digits > 1) {
+            KMessageBox::error(m_tabWidget, i18n("%1 is not a field number with an optional separator.", field));
+            return;
+        }
+        if (digits < field.size()) {
+            options.separator = field[digits];
+        }
+    } else if (operation == LineOperation::KeepMatching || operation == LineOperation::RemoveMatching) {
+        const QString pattern = QInputDialog::getText(m_tabWidget,
+                                                      operation == LineOperation::KeepMatching ? i18n("Keep Matching Lines")
+                                                                                               : i18n("Remove Matching Lines"),
+                                                      i18n("Regular expression:"), QLineEdit::Normal, QString(), &ok);
+        if (!ok || pattern.isEmpty()) return;
+        options.pattern = QRegularExpression(pattern);
+        if (!options.pattern.isValid()) {
+            KMessageBox::error(m_tabWidget, i18n("The regular expression is not valid: %1", options.pattern.errorString()));
+            return;
+        }
+        options.pattern.optimize();
+    }
+
+    start(textEdit, options);
+}
+
+void LineOperations::start(KTextEdit *textEdit, const Options &options)
+{
+    if (!MemoryBudgetManager::ensureResident(textEdit)) return;
+
+    QTextDocument *document = textEdit->document();
+    const QTextCursor selection = textEdit->textCursor();
+    if (selection.hasSelection()) {
+        // Whole lines; a selection ending at the start of a line leaves that line out
+        const QTextBlock first = document->findBlock(selection.selectionStart());
+        QTextBlock last = document->findBlock(selection.selectionEnd());
+        if (last != first && selection.selectionEnd() == last.position()) {
+            last = last.previous();
+        }
+        m_start = first.position();
+        m_end = last.position() + last.length() - 1;
+    } else {
+        m_start = 0;
+        m_end = document->characterCount() - 1;
+    }
+
+    // The only copy of the lines the operations see; everything else is views into it
+    QElapsedTimer timer;
+    timer.start();
+    QTextCursor cursor(document);
+    cursor.setPosition(m_start);
+    cursor.setPosition(m_end, QTextCursor::KeepAnchor);
+    std::shared_ptr<const QString> text = std::make_shared<const QString>(cursor.selectedText());
+    m_copyTime = timer.elapsed();
+
+    m_textEdit = textEdit;
+    m_operation = options.operation;
+    m_revision = document->revision();
+    // Unloading it meanwhile would leave the result nothing to be applied to
+    m_wasReadOnly = textEdit->isReadOnly();
+    textEdit->setReadOnly(true);
+    MemoryBudgetManager::pin(textEdit);
+    const int generation = ++m_generation;
+
+    Q_EMIT statusMessage(i18n("Processing lines..."));
+
+    QPointer<LineOperations> self(this);
+    QThreadPool::globalInstance()->start([self, text, options, generation]() {
+        QElapsedTimer timer;
+        timer.start();
+        const Result result = process(*text, options);
+        const qint64 processTime = timer.elapsed();
+
+        QMetaObject::invokeMethod(qApp, [self, generation, result, processTime]() {
+            if (self) {
+                self->applyResult(generation, result, processTime);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void LineOperations::applyResult(int generation, const Result &result, qint64 processTime)
+{
+    if (generation != m_generation) return;
+
+    KTextEdit *textEdit = m_textEdit;
+    const bool unchanged = textEdit && textEdit->document()->revision() == m_revision;
+    release();
+    if (!textEdit) return;
+    if (!unchanged) {
+        Q_EMIT statusMessage(i18n("The document changed while the lines were processed; they were left alone."));
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!BulkEdit::replaceRange(textEdit, m_start, m_end, result.text)) {
+        Q_EMIT statusMessage(i18n("A paste is running; the lines were left alone."));
+        return;
+    }
+    const qint64 applyTime = timer.elapsed();
+
+    qCDebug(lineOperationsLog) << "Operation" << int(m_operation) << "on" << result.linesBefore << "lines: copied in"
+                               << m_copyTime << "ms, processed in" << processTime << "ms, applied in" << applyTime << "ms";
+
+    const QLocale locale;
+    Q_EMIT statusMessage(i18n("%1 lines in, %2 out: copied in %3 ms, processed in %4 ms, applied in %5 ms",
+                                  locale.toString(result.linesBefore), locale.toString(result.linesAfter),
+                                  m_copyTime, processTime, applyTime));
+}
+
+void LineOperations::release()
+{
+    if (m_textEdit) {
+        m_textEdit->setReadOnly(m_wasReadOnly);
+        MemoryBudgetManager::unpin(m_textEdit);
+    }
+    m_textEdit = nullptr;
+}
+
+QMdiArea* LineOperations::getActiveMdiArea() const
+{
+    QSplitter *splitter = qobject_cast<QSplitter*>(m_tabWidget->currentWidget());
+    if (splitter) {
+        return qobject_cast<QMdiArea*>(splitter->widget(0));
+    }
+    return nullptr;
+}
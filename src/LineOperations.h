@@ -0,0 +1,89 @@
+#ifndef LINEOPERATIONS_H
+#define LINEOPERATIONS_H
+
+#include <QObject>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QString>
+
+class QTabWidget;
+class QMdiArea;
+class KTextEdit;
+
+// The operations that rearrange or drop whole lines
+enum class LineOperation {
+    Sort,
+    SortNumerically,
+    SortByField,
+    Unique,
+    Reverse,
+    Shuffle,
+    KeepMatching,
+    RemoveMatching
+};
+
+// This class runs line operations on the selected lines, or on the whole document.
+// The lines are split into an index of views over one copy of the text, which the
+// operations sort and filter in parallel on the thread pool; the result replaces the
+// lines as one undo step
+class LineOperations : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        LineOperation operation = LineOperation::Sort;
+
+        // Field to sort by, counted from 1, and what separates fields; whitespace if null
+        int field = 1;
+        QChar separator;
+
+        // Lines kept or removed by the filters
+        QRegularExpression pattern;
+    };
+
+    struct Result {
+        QString text;
+        qsizetype linesBefore = 0;
+        qsizetype linesAfter = 0;
+    };
+
+    explicit LineOperations(QTabWidget *tabWidget, QObject *parent = nullptr);
+    ~LineOperations() override;
+
+    // Apply an operation to lines separated by newlines or paragraph separators; a final
+    // empty line stays last. Runs on the calling thread with help from the global pool
+    static Result process(QStringView text, const Options &options);
+
+public Q_SLOTS:
+    // Ask for what the operation needs and run it on the active editor
+    void run(LineOperation operation);
+
+Q_SIGNALS:
+    // Emitted when an operation starts and with its timings once it was applied
+    void statusMessage(const QString &message);
+
+private:
+    // Start an operation on the worker pool
+    void start(KTextEdit *textEdit, const Options &options);
+
+    // Replace the lines with the result if the document was left alone
+    void applyResult(int generation, const Result &result, qint64 processTime);
+
+    // Make the editor writable again
+    void release();
+
+    QMdiArea* getActiveMdiArea() const;
+
+    QTabWidget *m_tabWidget;
+    QPointer<KTextEdit> m_textEdit;
+    LineOperation m_operation;
+    int m_generation;
+    int m_start;
+    int m_end;
+    int m_revision;
+    bool m_wasReadOnly;
+    qint64 m_copyTime;
+};
+
+#endif // LINEOPERATIONS_H
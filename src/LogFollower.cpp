@@ -0,0 +1,220 @@
+#include "LogFollower.h"
+#include "ClipboardTransfer.h"
+#include "EncodingDetector.h"
+#include "MemoryBudgetManager.h"
+#include <QApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QLoggingCategory>
+#include <QMdiSubWindow>
+#include <QScrollBar>
+#include <QStringDecoder>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QThreadPool>
+#include <QTimer>
+#include <KLocalizedString>
+#include <KTextEdit>
+
+Q_LOGGING_CATEGORY(logFollowerLog, "mudoedit.logfollower")
+
+struct LogFollower::ReadState {
+    QStringDecoder decoder{QStringDecoder::Utf8};
+    QByteArray head;
+    bool pendingCarriageReturn = false;
+};
+
+LogFollower* LogFollower::follow(QMdiSubWindow *subWindow, qint64 offset)
+{
+    if (LogFollower *follower = forWindow(subWindow)) return follower;
+
+    KTextEdit *textEdit = qobject_cast<KTextEdit*>(subWindow->widget());
+    const QString filePath = subWindow->property("fullFilePath").toString();
+    if (!textEdit || filePath.isEmpty() || !MemoryBudgetManager::ensureResident(textEdit)) return nullptr;
+    return new LogFollower(subWindow, textEdit, filePath, offset);
+}
+
+LogFollower* LogFollower::forWindow(QMdiSubWindow *subWindow)
+{
+    return subWindow->findChild<LogFollower*>(QString(), Qt::FindDirectChildrenOnly);
+}
+
+LogFollower::LogFollower(QMdiSubWindow *subWindow, KTextEdit *textEdit, const QString &filePath, qint64 offset)
+    : QObject(subWindow),
+      m_subWindow(subWindow),
+      m_textEdit(textEdit),
+      m_filePath(filePath),
+      m_watcher(new QFileSystemWatcher(this)),
+      m_pollTimer(new QTimer(this)),
+      m_state(std::make_shared<ReadState>()),
+      m_offset(offset),
+      m_reading(false),
+      m_readAgain(false),
+      m_missing(false),
+      m_stickToEnd(true),
+      m_wasReadOnly(textEdit->isReadOnly()),
+      m_wasUndoRedoEnabled(textEdit->document()->isUndoRedoEnabled())
+{
+    // Appended bytes are in the encoding the file was loaded with
+    const QByteArray encoding = EncodingDetector::formatOf(subWindow).encoding;
+    QStringDecoder decoder(encoding.constData());
+    if (decoder.isValid()) {
+        m_state->decoder = std::move(decoder);
+    } else {
+        qCWarning(logFollowerLog) << "Cannot decode" << encoding << "- following" << m_filePath << "as UTF-8";
+    }
+
+    // Remember how the file starts, to tell it from a new file under the same name
+    QFile file(m_filePath);
+    if (file.open(QIODevice::ReadOnly)) {
+        m_state->head = file.read(HEAD_BYTES);
+    }
+
+    // Appended text is not the user's to undo, and the history would grow with the log
+    m_textEdit->setReadOnly(true);
+    m_textEdit->document()->setUndoRedoEnabled(false);
+    MemoryBudgetManager::pin(m_textEdit);
+    m_subWindow->setProperty("following", true);
+    m_subWindow->setProperty("externallyModified", false);
+
+    // Stay at the end while the user leaves the view there
+    QScrollBar *scrollBar = m_textEdit->verticalScrollBar();
+    connect(scrollBar, &QScrollBar::valueChanged, this, [this, scrollBar](int value) {
+        m_stickToEnd = value >= scrollBar->maximum();
+    });
+    connect(scrollBar, &QScrollBar::rangeChanged, this, [this, scrollBar](int minimum, int maximum) {
+        Q_UNUSED(minimum)
+        if (m_stickToEnd) {
+            scrollBar->setValue(maximum);
+        }
+    });
+    scrollBar->setValue(scrollBar->maximum());
+
+    m_watcher->addPath(m_filePath);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &LogFollower::readAppended);
+    m_pollTimer->setInterval(POLL_INTERVAL);
+    connect(m_pollTimer, &QTimer::timeout, this, &LogFollower::readAppended);
+    m_pollTimer->start();
+
+    qCDebug(logFollowerLog) << "Following" << m_filePath << "from offset" << m_offset;
+    readAppended();
+}
+
+LogFollower::~LogFollower()
+{
+    // The editor is gone already if its window is being closed
+    if (m_textEdit) {
+        m_textEdit->setReadOnly(m_wasReadOnly);
+        m_textEdit->document()->setUndoRedoEnabled(m_wasUndoRedoEnabled);
+        MemoryBudgetManager::unpin(m_textEdit);
+    }
+    m_subWindow->setProperty("following", false);
+    qCDebug(logFollowerLog) << "Stopped following" << m_filePath << "at offset" << m_offset;
+}
+
+void LogFollower::readAppended()
+{
+    if (m_reading) {
+        m_readAgain = true;
+        return;
+    }
+    m_reading = true;
+    m_readAgain = false;
+
+    QPointer<LogFollower> self(this);
+    const std::shared_ptr<ReadState> state = m_state;
+    const QString filePath = m_filePath;
+    qint64 offset = m_offset;
+    QThreadPool::globalInstance()->start([self, state, filePath, offset]() mutable {
+        ReadResult result;
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            result.missing = true;
+            result.offset = offset;
+        } else {
+            // Shorter than what we read, or starting differently: truncated or rotated
+            const qint64 size = file.size();
+            const QByteArray head = file.read(HEAD_BYTES);
+            const qsizetype common = qMin(head.size(), state->head.size());
+            if (size < offset || head.left(common) != state->head.left(common)) {
+                result.restarted = true;
+                offset = 0;
+                state->decoder.resetState();
+                state->pendingCarriageReturn = false;
+            }
+            state->head = head;
+
+            QByteArray bytes;
+            if (file.seek(offset)) {
+                bytes = file.read(qMin<qint64>(READ_CHUNK_BYTES, size - offset));
+            }
+            result.offset = offset + bytes.size();
+            result.more = result.offset < size;
+
+            // Line breaks as a text mode read would give them; a carriage return at the
+            // end of a chunk waits for the next one to see whether a line feed follows
+            result.text = state->decoder.decode(bytes);
+            if (state->pendingCarriageReturn) {
+                result.text.prepend(QLatin1Char('\r'));
+                state->pendingCarriageReturn = false;
+            }
+            if (result.text.endsWith(QLatin1Char('\r'))) {
+                result.text.chop(1);
+                state->pendingCarriageReturn = true;
+            }
+            result.text.replace(QStringLiteral("\r\n"), QStringLiteral("\n"));
+        }
+
+        QMetaObject::invokeMethod(qApp, [self, result]() {
+            if (self) {
+                self->applyRead(result);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void LogFollower::applyRead(const ReadResult &result)
+{
+    m_reading = false;
+    if (!m_textEdit) return;
+    const QString fileName = QFileInfo(m_filePath).fileName();
+
+    if (result.missing) {
+        if (!m_missing) {
+            m_missing = true;
+            Q_EMIT statusMessage(i18n("%1 is gone; waiting for it to come back", fileName));
+        }
+        return;
+    }
+    m_missing = false;
+
+    // A file replaced by a rename is a new file to the watcher
+    if (!m_watcher->files().contains(m_filePath)) {
+        m_watcher->addPath(m_filePath);
+    }
+
+    QTextDocument *document = m_textEdit->document();
+    if (result.restarted || !result.text.isEmpty()) {
+        ClipboardTransfer::detach(document);
+    }
+    if (result.restarted) {
+        QTextCursor cursor(document);
+        cursor.select(QTextCursor::Document);
+        cursor.removeSelectedText();
+        qCDebug(logFollowerLog) << m_filePath << "was truncated or rotated at offset" << m_offset;
+        Q_EMIT statusMessage(i18n("%1 was truncated or rotated; reading it from the start", fileName));
+    }
+    if (!result.text.isEmpty()) {
+        QTextCursor cursor(document);
+        cursor.movePosition(QTextCursor::End);
+        cursor.insertText(result.text);
+    }
+    document->setModified(false);
+    m_offset = result.offset;
+
+    // Catch up in steps, letting the view paint and take input in between
+    if (result.more || m_readAgain) {
+        QTimer::singleShot(0, this, &LogFollower::readAppended);
+    }
+}
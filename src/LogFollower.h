@@ -0,0 +1,89 @@
+#ifndef LOGFOLLOWER_H
+#define LOGFOLLOWER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <memory>
+
+class QFileSystemWatcher;
+class QMdiSubWindow;
+class QTimer;
+class KTextEdit;
+
+// This class keeps a document in step with a file that only grows, like a log. It reads
+// the bytes appended since the last known offset on a worker and adds them to the end
+// of the document, so only the new blocks are laid out, highlighted and indexed. The
+// view stays at the end unless the user scrolled away from it. A file that shrank or
+// starts differently than before was truncated or rotated and is read again from its
+// start. The bytes are decoded in the encoding the file was loaded with. While following,
+// the document is read-only, keeps no undo history and stays loaded
+class LogFollower : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Start following the file of a window whose document holds its first offset bytes
+    static LogFollower* follow(QMdiSubWindow *subWindow, qint64 offset);
+
+    // The follower of a window, or nullptr if it is not followed
+    static LogFollower* forWindow(QMdiSubWindow *subWindow);
+
+    // Stops following and gives the editor back its read-only and undo state
+    ~LogFollower() override;
+
+    QString filePath() const { return m_filePath; }
+
+    // Bytes of the file the document holds so far
+    qint64 offset() const { return m_offset; }
+
+Q_SIGNALS:
+    // Emitted when the file was truncated, rotated or removed
+    void statusMessage(const QString &message);
+
+private:
+    LogFollower(QMdiSubWindow *subWindow, KTextEdit *textEdit, const QString &filePath, qint64 offset);
+
+    // Decoder state shared with the read in flight, which may outlive the follower
+    struct ReadState;
+
+    // What a read found on the worker
+    struct ReadResult {
+        QString text;
+        qint64 offset = 0;
+        bool restarted = false;
+        bool missing = false;
+        bool more = false;
+    };
+
+    // Start a read of what was appended, unless one is running
+    void readAppended();
+
+    // Add what a read found to the end of the document
+    void applyRead(const ReadResult &result);
+
+    QMdiSubWindow *m_subWindow;
+    QPointer<KTextEdit> m_textEdit;
+    QString m_filePath;
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_pollTimer;
+    std::shared_ptr<ReadState> m_state;
+    qint64 m_offset;
+    bool m_reading;
+    bool m_readAgain;
+    bool m_missing;
+    bool m_stickToEnd;
+    bool m_wasReadOnly;
+    bool m_wasUndoRedoEnabled;
+
+    // Bytes read and inserted per step, so a fast writer cannot stall the view
+    static const int READ_CHUNK_BYTES = 1 << 20;
+
+    // Bytes at the start of the file that tell a rotated file from the followed one
+    static const int HEAD_BYTES = 256;
+
+    // Interval of the check that catches changes the file system does not report
+    static const int POLL_INTERVAL = 1000;
+};
+
+#endif // LOGFOLLOWER_H
@@ -8,8 +8,24 @@
 #include "MenuManager.h"
 #include "ToolbarManager.h"
 #include "ZoomManager.h"
+#include "MemoryInspector.h"
+#include "MemoryBudgetManager.h"
+#include "FindReplaceManager.h"
+#include "FindInFilesManager.h"
+#include "QuickOpenManager.h"
+#include "WordIndex.h"
+#include "WordCompleter.h"
+#include "OutlineManager.h"
+#include "CommandFilter.h"
+#include "LineOperations.h"
+#include "DiffManager.h"
+#include "FileWatcher.h"
+#include "FilterManager.h"
+#include "MultiCursor.h"
+#include "ClipboardTransfer.h"
 #include <KLocalizedString>
 #include <KMessageBox>
+#include <KTextEdit>
 #include <QApplication>
 #include <QVBoxLayout>
 #include <QFileDialog>
@@ -30,6 +46,8 @@
 #include <KActionCollection>
 #include <QScreen>
 #include <QInputDialog>
+#include <QLabel>
+#include <QStatusBar>
 #include <QTabBar> 
 
 Q_LOGGING_CATEGORY(mainWindowLog, "mudoedit.mainwindow")
@@ -47,7 +65,20 @@ MainWindow::MainWindow(QWidget *parent)
       m_menuManager(nullptr),
       m_toolbarManager(nullptr),
       m_zoomManager(nullptr),
-      m_toggleMenuBarAction(nullptr)
+      m_memoryInspector(nullptr),
+      m_memoryBudgetManager(nullptr),
+      m_findReplaceManager(nullptr),
+      m_findInFilesManager(nullptr),
+      m_quickOpenManager(nullptr),
+      m_wordIndex(nullptr),
+      m_outlineManager(nullptr),
+      m_commandFilter(nullptr),
+      m_lineOperations(nullptr),
+      m_diffManager(nullptr),
+      m_fileWatcher(nullptr),
+      m_filterManager(nullptr),
+      m_toggleMenuBarAction(nullptr),
+      m_matchCountLabel(nullptr)
 {
     qCDebug(mainWindowLog) << QStringLiteral("Starting MainWindow constructor");
 
@@ -114,6 +145,18 @@ MainWindow::~MainWindow()
     delete m_menuManager;
     delete m_toolbarManager;
     delete m_zoomManager;
+    delete m_memoryBudgetManager;
+    delete m_memoryInspector;
+    delete m_findReplaceManager;
+    delete m_findInFilesManager;
+    delete m_quickOpenManager;
+    delete m_wordIndex;
+    delete m_outlineManager;
+    delete m_commandFilter;
+    delete m_lineOperations;
+    delete m_diffManager;
+    delete m_fileWatcher;
+    delete m_filterManager;
 
     saveWindowGeometry();
 
@@ -174,6 +217,11 @@ void MainWindow::addNewTab()
     splitter->setSizes(QList<int>() << width());
     splitter->setStretchFactor(0, 1);
 
+    // Add the outline panel after the MDI Area
+    if (m_outlineManager) {
+        m_outlineManager->addPanel(splitter);
+    }
+
     // Add the splitter to a new tab
     int tabIndex = m_tabWidget->count();
     QString tabName = (tabIndex == 0) ? QStringLiteral("Default") : QStringLiteral("Tab %1").arg(tabIndex);
@@ -250,7 +298,19 @@ void MainWindow::setupComponents()
      // Initialize manager classes
     m_menuManager = new MenuManager(this, actionCollection(), m_documentManager, m_editOps, m_windowMgmt, m_settingsManagement);
     m_toolbarManager = new ToolbarManager(this, actionCollection());
-    m_zoomManager = new ZoomManager(m_tabWidget, this);
+    m_zoomManager = new ZoomManager(m_tabWidget, m_settingsManagement, this);
+    m_memoryInspector = new MemoryInspector(m_tabWidget, this);
+    m_memoryBudgetManager = new MemoryBudgetManager(m_tabWidget, m_settingsManagement, m_memoryInspector, this);
+    m_findReplaceManager = new FindReplaceManager(m_tabWidget, this);
+    m_findInFilesManager = new FindInFilesManager(m_tabWidget, m_documentManager, this);
+    m_quickOpenManager = new QuickOpenManager(m_tabWidget, m_documentManager, this);
+    m_wordIndex = new WordIndex(this);
+    m_outlineManager = new OutlineManager(m_tabWidget, m_settingsManagement, this);
+    m_commandFilter = new CommandFilter(m_tabWidget, this);
+    m_lineOperations = new LineOperations(m_tabWidget, this);
+    m_diffManager = new DiffManager(m_tabWidget, this);
+    m_fileWatcher = new FileWatcher(m_tabWidget, m_documentManager, this);
+    m_filterManager = new FilterManager(m_tabWidget, this);
 
     // Set up menus and toolbar
     m_menuManager->setupMenus();
@@ -258,7 +318,10 @@ void MainWindow::setupComponents()
 
 // Check if all components were initialized successfully
     if (!m_fileIO || !m_documentManager || !m_autoSaveManager || !m_editOps || !m_windowMgmt || !m_settingsManagement || 
-        !m_menuManager || !m_toolbarManager || !m_zoomManager) {
+        !m_menuManager || !m_toolbarManager || !m_zoomManager || !m_memoryInspector || !m_memoryBudgetManager ||
+        !m_findReplaceManager || !m_findInFilesManager || !m_quickOpenManager || !m_wordIndex || !m_outlineManager ||
+        !m_commandFilter || !m_lineOperations || !m_diffManager || !m_fileWatcher ||
+        !m_filterManager) {
         qCCritical(mainWindowLog) << QStringLiteral("Failed to initialize one or more components");
     } else {
         qCDebug(mainWindowLog) << QStringLiteral("All components initialized successfully");
@@ -266,10 +329,51 @@ void MainWindow::setupComponents()
 
     // Connect signals and slots
     connect(m_documentManager, &DocumentManager::fileOpened, m_menuManager, &MenuManager::updateRecentFilesMenu);
+
+    // Give the tabs created before the outline manager their panels
+    for (int i = 0; i < m_tabWidget->count(); ++i) {
+        if (QSplitter *splitter = qobject_cast<QSplitter*>(m_tabWidget->widget(i))) {
+            m_outlineManager->addPanel(splitter);
+        }
+    }
+
+    // Count the words of every editor for completion
+    connect(m_documentManager, &DocumentManager::editorCreated, m_wordIndex, &WordIndex::addEditor);
+
+    // Let every editor take multiple cursors
+    connect(m_documentManager, &DocumentManager::editorCreated, this, &MultiCursor::attach);
+
+    // Move large selections and pastes through the clipboard without blocking
+    connect(m_documentManager, &DocumentManager::editorCreated, this, &ClipboardTransfer::attach);
+
+    // Zoom every editor with Ctrl+wheel
+    connect(m_documentManager, &DocumentManager::editorCreated, m_zoomManager, &ZoomManager::addEditor);
     
     // Connect the settingsChanged signal to updateTabBarVisibility
     connect(m_settingsManagement, &SettingsManagement::settingsChanged, this, &MainWindow::updateTabBarVisibility);
 
+    // Show the match count of the highlighted search in the status bar
+    m_matchCountLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(m_matchCountLabel);
+    connect(m_findReplaceManager, &FindReplaceManager::matchCountChanged, this, &MainWindow::updateMatchCount);
+
+    // Report the timings of line operations
+    connect(m_lineOperations, &LineOperations::statusMessage, this, [this](const QString &message) {
+        statusBar()->showMessage(message, 10000);
+    });
+
+    // Watch the files of open documents for changes by other programs
+    connect(m_documentManager, &DocumentManager::fileOpened, m_fileWatcher, &FileWatcher::watchFile);
+    connect(m_documentManager, &DocumentManager::fileSaved, m_fileWatcher, &FileWatcher::watchFile);
+    connect(m_fileWatcher, &FileWatcher::statusMessage, this, [this](const QString &message) {
+        statusBar()->showMessage(message, 10000);
+    });
+
+    // Tell when a document could not be saved in its own encoding
+    connect(m_documentManager, &DocumentManager::statusMessage, this, [this](const QString &message) {
+        statusBar()->showMessage(message, 10000);
+    });
+
 }
 
 void MainWindow::closeEvent(QCloseEvent *event)
@@ -399,6 +503,13 @@ void MainWindow::toggleSyntaxHighlighting(bool enabled)
     m_settingsManagement->saveSettings();
 }
 
+void MainWindow::toggleOutline(bool enabled)
+{
+    m_settingsManagement->setOutlineVisible(enabled);
+    m_settingsManagement->saveSettings();
+    m_outlineManager->setPanelsVisible(enabled);
+}
+
 void MainWindow::zoomIn()
 {
     m_zoomManager->zoomIn();
@@ -409,6 +520,87 @@ void MainWindow::zoomOut()
     m_zoomManager->zoomOut();
 }
 
+void MainWindow::resetZoom()
+{
+    m_zoomManager->resetZoom();
+}
+
+void MainWindow::showMemoryInspector()
+{
+    m_memoryInspector->showInspector();
+}
+
+void MainWindow::showFindDialog()
+{
+    m_findReplaceManager->showFindDialog();
+}
+
+void MainWindow::showReplaceDialog()
+{
+    m_findReplaceManager->showReplaceDialog();
+}
+
+void MainWindow::findNext()
+{
+    m_findReplaceManager->findNext();
+}
+
+void MainWindow::findPrevious()
+{
+    m_findReplaceManager->findPrevious();
+}
+
+void MainWindow::showFindInFiles()
+{
+    m_findInFilesManager->showDialog();
+}
+
+void MainWindow::showQuickOpen()
+{
+    m_quickOpenManager->showPalette();
+}
+
+void MainWindow::completeWord()
+{
+    QMdiArea *mdiArea = getActiveMdiArea();
+    if (!mdiArea || !mdiArea->activeSubWindow()) return;
+
+    KTextEdit *textEdit = qobject_cast<KTextEdit*>(mdiArea->activeSubWindow()->widget());
+    if (WordCompleter *completer = textEdit ? WordCompleter::forEditor(textEdit) : nullptr) {
+        completer->complete();
+    }
+}
+
+void MainWindow::filterThroughCommand()
+{
+    m_commandFilter->filterThroughCommand();
+}
+
+void MainWindow::runLineOperation(LineOperation operation)
+{
+    m_lineOperations->run(operation);
+}
+
+void MainWindow::compareWithSaved()
+{
+    m_diffManager->compareWithSaved();
+}
+
+void MainWindow::compareWithDocument()
+{
+    m_diffManager->compareWithDocument();
+}
+
+void MainWindow::toggleFollow()
+{
+    m_fileWatcher->toggleFollow();
+}
+
+void MainWindow::showFilter()
+{
+    m_filterManager->showFilter();
+}
+
 void MainWindow::openFile(const QString &filePath)
 {
     qCDebug(mainWindowLog) << "Attempting to open file:" << filePath;
@@ -565,3 +757,11 @@ int MainWindow::getTabCount() const
     return m_tabWidget->count();
 }
 
+void MainWindow::updateMatchCount(qsizetype count)
+{
+    if (count < 0) {
+        m_matchCountLabel->clear();
+    } else {
+        m_matchCountLabel->setText(i18np("%1 match", "%1 matches", count));
+    }
+}
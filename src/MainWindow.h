@@ -17,6 +17,20 @@ class SettingsManagement;
 class MenuManager;
 class ToolbarManager;
 class ZoomManager;
+class MemoryInspector;
+class MemoryBudgetManager;
+class FindReplaceManager;
+class FindInFilesManager;
+class QuickOpenManager;
+class WordIndex;
+class OutlineManager;
+class CommandFilter;
+class LineOperations;
+class DiffManager;
+class FileWatcher;
+class FilterManager;
+enum class LineOperation;
+class QLabel;
 
 // Declare a logging category for the main window
 Q_DECLARE_LOGGING_CATEGORY(mainWindowLog)
@@ -39,11 +53,47 @@ public:
     // Methods for zoom operations
     void zoomIn();
     void zoomOut();
+    void resetZoom();
+    
+    // Method to show the per-document memory inspector
+    void showMemoryInspector();
+    
+    // Methods for find and replace
+    void showFindDialog();
+    void showReplaceDialog();
+    void findNext();
+    void findPrevious();
+    void showFindInFiles();
+    
+    // Method to show the quick-open palette
+    void showQuickOpen();
+    
+    // Method to complete the word before the cursor
+    void completeWord();
+    
+    // Method to replace the selection or document with the output of a command
+    void filterThroughCommand();
+    
+    // Method to sort, deduplicate or filter the selected lines, or all of them
+    void runLineOperation(LineOperation operation);
+    
+    // Methods to compare the active document with its saved version or another document
+    void compareWithSaved();
+    void compareWithDocument();
+    
+    // Method to keep appending what is written to the file of the active document
+    void toggleFollow();
+    
+    // Method to show only the lines of the active document that match a pattern
+    void showFilter();
     
     // Methods for toggling spell check and syntax highlighting
     void toggleSpellCheck(bool enabled);
     void toggleSyntaxHighlighting(bool enabled);
     
+    // Method to show or hide the outline panels
+    void toggleOutline(bool enabled);
+    
     // Method to add a new tab
     void addNewTab();
     
@@ -92,6 +142,18 @@ private:
     MenuManager *m_menuManager;
     ToolbarManager *m_toolbarManager;
     ZoomManager *m_zoomManager;
+    MemoryInspector *m_memoryInspector;
+    MemoryBudgetManager *m_memoryBudgetManager;
+    FindReplaceManager *m_findReplaceManager;
+    FindInFilesManager *m_findInFilesManager;
+    QuickOpenManager *m_quickOpenManager;
+    WordIndex *m_wordIndex;
+    OutlineManager *m_outlineManager;
+    CommandFilter *m_commandFilter;
+    LineOperations *m_lineOperations;
+    DiffManager *m_diffManager;
+    FileWatcher *m_fileWatcher;
+    FilterManager *m_filterManager;
     
     // Menubar toggle
     void setupMenuBarToggle();
@@ -103,6 +165,10 @@ private:
     
     QAction *m_toggleMenuBarAction;
     
+    // Status bar readout of the number of search matches
+    QLabel *m_matchCountLabel;
+    void updateMatchCount(qsizetype count);
+    
     // New methods for tab management
     void setupTabContextMenu();
     void renameTab();
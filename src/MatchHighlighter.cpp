@@ -0,0 +1,279 @@
+#include "MatchHighlighter.h"
+#include "ExtraSelections.h"
+#include <QApplication>
+#include <QEvent>
+#include <QPointer>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QThreadPool>
+#include <QTimer>
+#include <QLoggingCategory>
+#include <KTextEdit>
+
+Q_LOGGING_CATEGORY(matchHighlighterLog, "mudoedit.matchhighlighter")
+
+namespace {
+
+// Blocks searched above and below the visible ones, so small scrolls need no rescan
+const int MARGIN_BLOCKS = 50;
+
+// Never paint more than this many matches at once, e.g. for a one-letter pattern
+const int MAX_PAINTED_MATCHES = 5000;
+
+// Delays that coalesce bursts of scrolling and typing
+const int RESCAN_DELAY = 30;
+const int COUNT_DELAY = 300;
+
+} // namespace
+
+MatchHighlighter* MatchHighlighter::forEditor(KTextEdit *textEdit)
+{
+    MatchHighlighter *highlighter = textEdit->findChild<MatchHighlighter*>(QString(), Qt::FindDirectChildrenOnly);
+    if (!highlighter) {
+        highlighter = new MatchHighlighter(textEdit);
+    }
+    return highlighter;
+}
+
+MatchHighlighter::MatchHighlighter(KTextEdit *textEdit)
+    : QObject(textEdit),
+      m_textEdit(textEdit),
+      m_rescanTimer(new QTimer(this)),
+      m_countTimer(new QTimer(this)),
+      m_scannedFirstBlock(-1),
+      m_scannedLastBlock(-1),
+      m_totalCount(-1),
+      m_countGeneration(0),
+      m_blockCountsValid(false)
+{
+    m_rescanTimer->setSingleShot(true);
+    m_rescanTimer->setInterval(RESCAN_DELAY);
+    connect(m_rescanTimer, &QTimer::timeout, this, &MatchHighlighter::rescan);
+
+    m_countTimer->setSingleShot(true);
+    m_countTimer->setInterval(COUNT_DELAY);
+    connect(m_countTimer, &QTimer::timeout, this, &MatchHighlighter::startCount);
+
+    m_textEdit->viewport()->installEventFilter(this);
+    connect(m_textEdit->verticalScrollBar(), &QScrollBar::valueChanged, this, &MatchHighlighter::viewportMoved);
+    connect(m_textEdit->document(), &QTextDocument::contentsChange, this, &MatchHighlighter::contentsChanged);
+}
+
+void MatchHighlighter::setSearch(const QString &pattern, const SearchOptions &options)
+{
+    if (pattern.isEmpty()) {
+        clear();
+        return;
+    }
+    if (pattern == m_pattern && options.caseSensitivity == m_options.caseSensitivity
+        && options.regularExpression == m_options.regularExpression && options.wholeWords == m_options.wholeWords) {
+        return;
+    }
+
+    m_pattern = pattern;
+    m_options = options;
+    m_blockCountsValid = false;
+    rescan();
+    startCount();
+}
+
+void MatchHighlighter::clear()
+{
+    m_pattern.clear();
+    m_rescanTimer->stop();
+    m_countTimer->stop();
+    m_scannedFirstBlock = m_scannedLastBlock = -1;
+    m_blockCountsValid = false;
+    m_blockCounts.clear();
+    applySelections({});
+
+    // Drop the result of a count that is still running
+    ++m_countGeneration;
+    if (m_totalCount != -1) {
+        m_totalCount = -1;
+        Q_EMIT totalCountChanged(m_totalCount);
+    }
+}
+
+bool MatchHighlighter::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_textEdit->viewport() && event->type() == QEvent::Resize) {
+        viewportMoved();
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void MatchHighlighter::viewportMoved()
+{
+    if (m_pattern.isEmpty()) return;
+
+    const QRect rect = m_textEdit->viewport()->rect();
+    const int firstVisible = m_textEdit->cursorForPosition(rect.topLeft()).blockNumber();
+    const int lastVisible = m_textEdit->cursorForPosition(rect.bottomRight()).blockNumber();
+    if (m_scannedFirstBlock < 0 || firstVisible < m_scannedFirstBlock || lastVisible > m_scannedLastBlock) {
+        m_rescanTimer->start();
+    }
+}
+
+void MatchHighlighter::contentsChanged(int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved)
+    if (m_pattern.isEmpty()) return;
+
+    // The painted selections move with the text; only edits at or before the
+    // scanned blocks can change which matches they contain
+    const int changedBlock = m_textEdit->document()->findBlock(position).blockNumber();
+    if (m_scannedFirstBlock < 0 || changedBlock <= m_scannedLastBlock) {
+        m_rescanTimer->start();
+    }
+
+    // Any edit may change the total
+    if (m_blockCountsValid && updateBlockCounts(position, charsAdded)) return;
+    invalidateCount();
+}
+
+void MatchHighlighter::invalidateCount()
+{
+    ++m_countGeneration;
+    m_blockCountsValid = false;
+    if (m_totalCount != -1) {
+        m_totalCount = -1;
+        Q_EMIT totalCountChanged(m_totalCount);
+    }
+    m_countTimer->start();
+}
+
+bool MatchHighlighter::updateBlockCounts(int position, int charsAdded)
+{
+    QTextDocument *document = m_textEdit->document();
+    const QTextBlock first = document->findBlock(position);
+    const QTextBlock last = document->findBlock(qMin(position + charsAdded, document->characterCount() - 1));
+    if (!first.isValid() || !last.isValid()) return false;
+
+    // The old blocks first to oldLastNumber became the blocks first to lastNumber
+    const int firstNumber = first.blockNumber();
+    const int lastNumber = last.blockNumber();
+    const int oldLastNumber = lastNumber - (document->blockCount() - int(m_blockCounts.size()));
+    if (oldLastNumber < firstNumber - 1 || oldLastNumber >= int(m_blockCounts.size())) return false;
+
+    std::vector<int> counts;
+    counts.reserve(size_t(lastNumber - firstNumber + 1));
+    for (QTextBlock block = first; block.isValid(); block = block.next()) {
+        counts.push_back(int(SearchEngine::countMatches(block.text(), m_pattern, m_options)));
+        if (block == last) break;
+    }
+
+    qsizetype total = m_totalCount;
+    for (int number = firstNumber; number <= oldLastNumber; ++number) {
+        total -= m_blockCounts[size_t(number)];
+    }
+    for (const int count : counts) {
+        total += count;
+    }
+    m_blockCounts.erase(m_blockCounts.begin() + firstNumber, m_blockCounts.begin() + oldLastNumber + 1);
+    m_blockCounts.insert(m_blockCounts.begin() + firstNumber, counts.cbegin(), counts.cend());
+
+    if (total != m_totalCount) {
+        m_totalCount = total;
+        Q_EMIT totalCountChanged(m_totalCount);
+    }
+    return true;
+}
+
+void MatchHighlighter::rescan()
+{
+    if (m_pattern.isEmpty()) return;
+
+    QTextDocument *document = m_textEdit->document();
+    const QRect rect = m_textEdit->viewport()->rect();
+    const int firstVisible = m_textEdit->cursorForPosition(rect.topLeft()).blockNumber();
+    const int lastVisible = m_textEdit->cursorForPosition(rect.bottomRight()).blockNumber();
+    m_scannedFirstBlock = qMax(0, firstVisible - MARGIN_BLOCKS);
+    m_scannedLastBlock = qMin(document->blockCount() - 1, lastVisible + MARGIN_BLOCKS);
+
+    // Gather the text of the range; block separators become one character, as in the document
+    QTextBlock block = document->findBlockByNumber(m_scannedFirstBlock);
+    const int rangeStart = block.position();
+    QString text;
+    for (int number = m_scannedFirstBlock; block.isValid() && number <= m_scannedLastBlock; block = block.next(), ++number) {
+        text += block.text();
+        text += QLatin1Char('\n');
+    }
+
+    QTextCharFormat format;
+    QColor background = m_textEdit->palette().color(QPalette::Highlight);
+    background.setAlpha(80);
+    format.setBackground(background);
+    format.setProperty(MatchHighlightProperty, true);
+
+    QList<QTextEdit::ExtraSelection> selections;
+    SearchEngine::forEachMatch(text, m_pattern, m_options, [&](const SearchMatch &match) {
+        QTextEdit::ExtraSelection selection;
+        selection.cursor = QTextCursor(document);
+        selection.cursor.setPosition(rangeStart + int(match.start));
+        selection.cursor.setPosition(rangeStart + int(match.end()), QTextCursor::KeepAnchor);
+        selection.format = format;
+        selections.append(selection);
+        return selections.size() < MAX_PAINTED_MATCHES;
+    });
+
+    qCDebug(matchHighlighterLog) << "Painted" << selections.size() << "matches in blocks"
+                                 << m_scannedFirstBlock << "to" << m_scannedLastBlock;
+    applySelections(selections);
+}
+
+void MatchHighlighter::startCount()
+{
+    if (m_pattern.isEmpty()) return;
+
+    const quint64 generation = ++m_countGeneration;
+    const QString pattern = m_pattern;
+    const SearchOptions options = m_options;
+    QPointer<MatchHighlighter> self(this);
+
+    if (!options.regularExpression) {
+        // Raw text keeps one paragraph separator between blocks, so its lines are the blocks
+        const QString text = m_textEdit->document()->toRawText();
+        const int blockCount = m_textEdit->document()->blockCount();
+        QThreadPool::globalInstance()->start([self, generation, text, blockCount, pattern, options]() {
+            std::vector<int> counts;
+            counts.reserve(size_t(blockCount));
+            qsizetype total = 0;
+            for (QStringView line : QStringView(text).split(QChar::ParagraphSeparator)) {
+                counts.push_back(int(SearchEngine::countMatches(line, pattern, options)));
+                total += counts.back();
+            }
+            QMetaObject::invokeMethod(qApp, [self, generation, counts = std::move(counts), total]() mutable {
+                if (self && self->m_countGeneration == generation
+                    && int(counts.size()) == self->m_textEdit->document()->blockCount()) {
+                    self->m_blockCounts = std::move(counts);
+                    self->m_blockCountsValid = true;
+                    self->m_totalCount = total;
+                    Q_EMIT self->totalCountChanged(total);
+                }
+            }, Qt::QueuedConnection);
+        });
+        return;
+    }
+
+    // Regular expressions may match across line breaks, so they count over the whole text
+    QTextDocument *document = m_textEdit->document();
+    const QString text = m_snapshotSource ? m_snapshotSource(document) : document->toPlainText();
+    QThreadPool::globalInstance()->start([self, generation, text, pattern, options]() {
+        const qsizetype count = SearchEngine::countMatches(text, pattern, options);
+        QMetaObject::invokeMethod(qApp, [self, generation, count]() {
+            // Ignore counts of an older pattern or text
+            if (self && self->m_countGeneration == generation) {
+                self->m_totalCount = count;
+                Q_EMIT self->totalCountChanged(count);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void MatchHighlighter::applySelections(const QList<QTextEdit::ExtraSelection> &selections)
+{
+    ExtraSelections::replace(m_textEdit, MatchHighlightProperty, selections);
+}
@@ -0,0 +1,97 @@
+#ifndef MATCHHIGHLIGHTER_H
+#define MATCHHIGHLIGHTER_H
+
+#include <QObject>
+#include <QString>
+#include <QTextEdit>
+#include <QTextFormat>
+#include "SearchEngine.h"
+#include <functional>
+#include <vector>
+
+class QTextDocument;
+class QTimer;
+class KTextEdit;
+
+// This class highlights the matches of a search in an editor. Only the visible blocks
+// plus a margin are searched and painted, and they are searched again as the view
+// scrolls or the text around them changes. The total count is computed in the background;
+// literal matches never cross a line break, so their count is kept per block and only
+// the edited blocks are counted again
+class MatchHighlighter : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Marks the extra selections that belong to the match highlighter
+    static const int MatchHighlightProperty = QTextFormat::UserProperty + 1;
+
+    // Get the highlighter of an editor, creating it on first use
+    static MatchHighlighter* forEditor(KTextEdit *textEdit);
+
+    // Highlight the matches of a pattern; an empty pattern clears the highlights
+    void setSearch(const QString &pattern, const SearchOptions &options);
+
+    // Remove all highlights
+    void clear();
+
+    // Where the whole text comes from to count the matches of a regular expression; a
+    // fresh copy of the document is taken if there is no source
+    void setSnapshotSource(const std::function<QString(QTextDocument*)> &source) { m_snapshotSource = source; }
+
+    // Total number of matches in the document, or -1 while it is being counted
+    qsizetype totalCount() const { return m_totalCount; }
+
+Q_SIGNALS:
+    // Emitted when the total count is known, or -1 when it becomes unknown
+    void totalCountChanged(qsizetype count);
+
+protected:
+    // Rescan when the viewport is resized
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    explicit MatchHighlighter(KTextEdit *textEdit);
+
+    // Rescan soon if the visible blocks are no longer covered by the last scan
+    void viewportMoved();
+
+    // Rescan soon if an edit touched the scanned blocks
+    void contentsChanged(int position, int charsRemoved, int charsAdded);
+
+    // Search the visible blocks plus the margin and paint the matches
+    void rescan();
+
+    // Count all matches on the thread pool
+    void startCount();
+
+    // Count the blocks an edit touched again; false if the edit does not fit the counts
+    bool updateBlockCounts(int position, int charsAdded);
+
+    // Forget the count and count again soon
+    void invalidateCount();
+
+    // Replace our extra selections, keeping those of others
+    void applySelections(const QList<QTextEdit::ExtraSelection> &selections);
+
+    KTextEdit *m_textEdit;
+    QString m_pattern;
+    SearchOptions m_options;
+    QTimer *m_rescanTimer;
+    QTimer *m_countTimer;
+
+    // Block range covered by the last scan
+    int m_scannedFirstBlock;
+    int m_scannedLastBlock;
+
+    qsizetype m_totalCount;
+    quint64 m_countGeneration;
+
+    // Matches of a literal pattern in each block, valid once the first count is in
+    std::vector<int> m_blockCounts;
+    bool m_blockCountsValid;
+
+    std::function<QString(QTextDocument*)> m_snapshotSource;
+};
+
+#endif // MATCHHIGHLIGHTER_H
@@ -0,0 +1,305 @@
+#include "MemoryBudgetManager.h"
+#include "MemoryInspector.h"
+#include "SettingsManagement.h"
+#include "FileIO.h"
+#include "ClipboardTransfer.h"
+#include <QApplication>
+#include <QTabWidget>
+#include <QMdiArea>
+#include <QMdiSubWindow>
+#include <QSplitter>
+#include <QScrollBar>
+#include <QSyntaxHighlighter>
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QTextLayout>
+#include <QTextCursor>
+#include <QStandardPaths>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <QUuid>
+#include <QDateTime>
+#include <QEvent>
+#include <QLoggingCategory>
+#include <KTextEdit>
+#include <KLocalizedString>
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(memoryBudgetLog, "mudoedit.memorybudgetmanager")
+
+namespace {
+
+// Properties recorded on an editor while its content is unloaded
+const char EVICTED_PROPERTY[] = "evicted";
+const char SWAP_FILE_PROPERTY[] = "evictedSwapFile";
+const char WAS_MODIFIED_PROPERTY[] = "evictedModified";
+const char WAS_READ_ONLY_PROPERTY[] = "evictedReadOnly";
+const char CURSOR_PROPERTY[] = "evictedCursor";
+const char SCROLL_PROPERTY[] = "evictedScroll";
+const char FORMATS_RELEASED_PROPERTY[] = "formatsReleased";
+
+// Property recorded on a subwindow each time its document is used
+const char LAST_USED_PROPERTY[] = "lastUsed";
+
+// Number of views that need an editor to stay loaded
+const char PIN_COUNT_PROPERTY[] = "pinCount";
+
+void rehighlight(KTextEdit *textEdit)
+{
+    const QList<QSyntaxHighlighter*> highlighters = textEdit->findChildren<QSyntaxHighlighter*>();
+    for (QSyntaxHighlighter *highlighter : highlighters) {
+        highlighter->rehighlight();
+    }
+}
+
+}
+
+MemoryBudgetManager::MemoryBudgetManager(QTabWidget *tabWidget, SettingsManagement *settingsManagement,
+                                         MemoryInspector *memoryInspector, QObject *parent)
+    : QObject(parent),
+      m_tabWidget(tabWidget),
+      m_settingsManagement(settingsManagement),
+      m_memoryInspector(memoryInspector),
+      m_enforceTimer(new QTimer(this))
+{
+    connect(qApp, &QApplication::focusChanged, this, &MemoryBudgetManager::focusChanged);
+    connect(m_enforceTimer, &QTimer::timeout, this, &MemoryBudgetManager::enforceBudget);
+    connect(m_settingsManagement, &SettingsManagement::settingsChanged, this, &MemoryBudgetManager::enforceBudget);
+    m_enforceTimer->start(ENFORCE_INTERVAL);
+}
+
+MemoryBudgetManager::~MemoryBudgetManager()
+{
+    // Swap files only live as long as the session that created them
+    QDir(swapDirectory()).removeRecursively();
+}
+
+bool MemoryBudgetManager::isEvicted(KTextEdit *textEdit)
+{
+    return textEdit->property(EVICTED_PROPERTY).toBool();
+}
+
+bool MemoryBudgetManager::ensureResident(KTextEdit *textEdit)
+{
+    if (textEdit->property(FORMATS_RELEASED_PROPERTY).toBool()) {
+        textEdit->setProperty(FORMATS_RELEASED_PROPERTY, false);
+        rehighlight(textEdit);
+    }
+
+    if (!isEvicted(textEdit)) {
+        return true;
+    }
+
+    QString content;
+    const QString swapFile = textEdit->property(SWAP_FILE_PROPERTY).toString();
+    if (!swapFile.isEmpty()) {
+        QFile file(swapFile);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qCWarning(memoryBudgetLog) << "Could not read swap file:" << swapFile;
+            return false;
+        }
+        content = QString::fromUtf8(qUncompress(file.readAll()));
+        file.close();
+        file.remove();
+    } else {
+        QMdiSubWindow *window = qobject_cast<QMdiSubWindow*>(textEdit->parent());
+        const QString filePath = window ? window->property("fullFilePath").toString() : QString();
+        FileIO fileIO;
+        if (filePath.isEmpty() || !fileIO.isFileReadable(filePath)) {
+            qCWarning(memoryBudgetLog) << "Could not reload unloaded document:" << filePath;
+            return false;
+        }
+        content = fileIO.readFile(filePath);
+    }
+
+    textEdit->setPlainText(content);
+    textEdit->setReadOnly(textEdit->property(WAS_READ_ONLY_PROPERTY).toBool());
+    textEdit->document()->setModified(textEdit->property(WAS_MODIFIED_PROPERTY).toBool());
+
+    QTextCursor cursor(textEdit->document());
+    cursor.setPosition(qMin(textEdit->property(CURSOR_PROPERTY).toInt(), textEdit->document()->characterCount() - 1));
+    textEdit->setTextCursor(cursor);
+    textEdit->verticalScrollBar()->setValue(textEdit->property(SCROLL_PROPERTY).toInt());
+
+    textEdit->setProperty(EVICTED_PROPERTY, false);
+    textEdit->setProperty(SWAP_FILE_PROPERTY, QVariant());
+    qCDebug(memoryBudgetLog) << "Reloaded unloaded document" << (swapFile.isEmpty() ? QStringLiteral("from disk") : swapFile);
+    return true;
+}
+
+void MemoryBudgetManager::pin(KTextEdit *textEdit)
+{
+    textEdit->setProperty(PIN_COUNT_PROPERTY, textEdit->property(PIN_COUNT_PROPERTY).toInt() + 1);
+}
+
+void MemoryBudgetManager::unpin(KTextEdit *textEdit)
+{
+    textEdit->setProperty(PIN_COUNT_PROPERTY, qMax(0, textEdit->property(PIN_COUNT_PROPERTY).toInt() - 1));
+}
+
+void MemoryBudgetManager::enforceBudget()
+{
+    const qint64 budget = qint64(m_settingsManagement->memoryBudget()) * 1024 * 1024;
+    if (budget <= 0) return;
+
+    struct Candidate
+    {
+        QMdiSubWindow *window;
+        KTextEdit *textEdit;
+        qint64 lastUsed;
+    };
+
+    QList<Candidate> candidates;
+    qint64 total = 0;
+    for (int i = 0; i < m_tabWidget->count(); ++i) {
+        QMdiArea *mdiArea = getMdiArea(i);
+        if (!mdiArea) continue;
+
+        for (QMdiSubWindow *window : mdiArea->subWindowList()) {
+            KTextEdit *textEdit = qobject_cast<KTextEdit*>(window->widget());
+            if (!textEdit) continue;
+
+            total += MemoryInspector::estimateUsage(textEdit).totalBytes();
+            if (m_memoryInspector->isBackgroundWindow(window) && !textEdit->isVisible() && !isEvicted(textEdit)
+                && !ClipboardTransfer::isPasting(textEdit)
+                && textEdit->property(PIN_COUNT_PROPERTY).toInt() == 0) {
+                candidates.append({window, textEdit, window->property(LAST_USED_PROPERTY).toLongLong()});
+            }
+        }
+    }
+
+    if (total <= budget) return;
+    qCDebug(memoryBudgetLog) << "Estimated document memory" << total << "exceeds budget" << budget;
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        return a.lastUsed < b.lastUsed;
+    });
+
+    // First drop what can be recomputed cheaply: layouts and highlighting of hidden documents
+    for (const Candidate &candidate : std::as_const(candidates)) {
+        if (total <= budget) return;
+        total -= releaseFormatting(candidate.textEdit);
+    }
+
+    // Then unload the text itself, oldest first
+    for (const Candidate &candidate : std::as_const(candidates)) {
+        if (total <= budget) return;
+        total -= evictText(candidate.window, candidate.textEdit);
+    }
+}
+
+bool MemoryBudgetManager::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::Show) {
+        KTextEdit *textEdit = qobject_cast<KTextEdit*>(watched);
+        if (textEdit && textEdit->property(FORMATS_RELEASED_PROPERTY).toBool()) {
+            textEdit->setProperty(FORMATS_RELEASED_PROPERTY, false);
+            textEdit->removeEventFilter(this);
+            rehighlight(textEdit);
+        }
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void MemoryBudgetManager::focusChanged(QWidget *old, QWidget *now)
+{
+    Q_UNUSED(old);
+
+    KTextEdit *textEdit = nullptr;
+    for (QWidget *widget = now; widget && !textEdit; widget = widget->parentWidget()) {
+        textEdit = qobject_cast<KTextEdit*>(widget);
+    }
+    if (!textEdit) return;
+
+    if (QMdiSubWindow *window = qobject_cast<QMdiSubWindow*>(textEdit->parent())) {
+        window->setProperty(LAST_USED_PROPERTY, QDateTime::currentMSecsSinceEpoch());
+    }
+
+    if (!ensureResident(textEdit)) {
+        qCWarning(memoryBudgetLog) << "Document stays unloaded, its content could not be restored";
+    }
+}
+
+qint64 MemoryBudgetManager::releaseFormatting(KTextEdit *textEdit)
+{
+    if (textEdit->isVisible() || textEdit->property(FORMATS_RELEASED_PROPERTY).toBool()) {
+        return 0;
+    }
+
+    const DocumentMemoryUsage usage = MemoryInspector::estimateUsage(textEdit);
+    QTextDocument *document = textEdit->document();
+    for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+        if (QTextLayout *layout = block.layout()) {
+            layout->clearFormats();
+        }
+    }
+    m_memoryInspector->releaseLayout(textEdit);
+
+    textEdit->setProperty(FORMATS_RELEASED_PROPERTY, true);
+    textEdit->installEventFilter(this);
+    return usage.layoutBytes + usage.highlightBytes + usage.spellCheckBytes;
+}
+
+qint64 MemoryBudgetManager::evictText(QMdiSubWindow *window, KTextEdit *textEdit)
+{
+    // Background windows may still be on screen when tiled or cascaded, and a paste holds
+    // an edit block open on the document until it is done
+    if (textEdit->isVisible() || ClipboardTransfer::isPasting(textEdit)) {
+        return 0;
+    }
+
+    const bool modified = textEdit->document()->isModified();
+    const QString filePath = window->property("fullFilePath").toString();
+    QString swapFile;
+
+    if (modified) {
+        // Modified text only exists in memory, so keep a compressed copy on disk
+        QDir().mkpath(swapDirectory());
+        swapFile = QDir(swapDirectory()).filePath(QUuid::createUuid().toString(QUuid::WithoutBraces) + QLatin1String(".swap"));
+        QFile file(swapFile);
+        if (!file.open(QIODevice::WriteOnly) || file.write(qCompress(textEdit->toPlainText().toUtf8())) < 0) {
+            qCWarning(memoryBudgetLog) << "Could not write swap file:" << swapFile;
+            file.remove();
+            return 0;
+        }
+    } else if (filePath.isEmpty() || !QFileInfo::exists(filePath)) {
+        // Nothing to reload an unsaved, unmodified document from
+        return 0;
+    }
+
+    const DocumentMemoryUsage usage = MemoryInspector::estimateUsage(textEdit);
+
+    textEdit->setProperty(WAS_MODIFIED_PROPERTY, modified);
+    textEdit->setProperty(WAS_READ_ONLY_PROPERTY, textEdit->isReadOnly());
+    textEdit->setProperty(CURSOR_PROPERTY, textEdit->textCursor().position());
+    textEdit->setProperty(SCROLL_PROPERTY, textEdit->verticalScrollBar()->value());
+    textEdit->setProperty(SWAP_FILE_PROPERTY, swapFile);
+    textEdit->setProperty(EVICTED_PROPERTY, true);
+
+    // Replacing the text cannot keep the undo history, so say that it is gone
+    const bool hadUndoHistory = textEdit->document()->isUndoAvailable() || textEdit->document()->isRedoAvailable();
+    ClipboardTransfer::detach(textEdit->document());
+    textEdit->setPlainText(hadUndoHistory
+        ? i18n("This document was unloaded to save memory and its undo history was discarded. Click here to reload it.")
+        : i18n("This document was unloaded to save memory. Click here to reload it."));
+    textEdit->setReadOnly(true);
+    textEdit->document()->setModified(modified);
+
+    qCDebug(memoryBudgetLog) << "Unloaded document" << window->windowTitle() << (modified ? swapFile : filePath);
+    return usage.textBytes + usage.undoBytes;
+}
+
+QString MemoryBudgetManager::swapDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/swap");
+}
+
+QMdiArea* MemoryBudgetManager::getMdiArea(int index) const
+{
+    QSplitter *splitter = qobject_cast<QSplitter*>(m_tabWidget->widget(index));
+    if (splitter) {
+        return qobject_cast<QMdiArea*>(splitter->widget(0));
+    }
+    return nullptr;
+}
@@ -0,0 +1,69 @@
+#ifndef MEMORYBUDGETMANAGER_H
+#define MEMORYBUDGETMANAGER_H
+
+#include <QObject>
+#include <QTimer>
+
+class QTabWidget;
+class QMdiArea;
+class QMdiSubWindow;
+class KTextEdit;
+class SettingsManagement;
+class MemoryInspector;
+
+// This class keeps open documents within a memory budget by unloading the
+// least recently used background documents and reloading them on activation
+class MemoryBudgetManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MemoryBudgetManager(QTabWidget *tabWidget, SettingsManagement *settingsManagement,
+                                 MemoryInspector *memoryInspector, QObject *parent = nullptr);
+    ~MemoryBudgetManager();
+
+    // Whether the text of an editor has been replaced by the unloaded placeholder
+    static bool isEvicted(KTextEdit *textEdit);
+
+    // Bring back everything that was dropped from an editor; returns false if the content could not be restored
+    static bool ensureResident(KTextEdit *textEdit);
+
+    // Keep an editor loaded while something else shows its text; pins are counted
+    static void pin(KTextEdit *textEdit);
+    static void unpin(KTextEdit *textEdit);
+
+public Q_SLOTS:
+    // Unload background documents until the estimated usage fits the budget
+    void enforceBudget();
+
+protected:
+    // Rehighlight hidden editors whose formats were dropped once they are shown again
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    // Record use of the document that received focus and make sure it is loaded
+    void focusChanged(QWidget *old, QWidget *now);
+
+    // Drop the layout and highlighter formats of a hidden editor
+    qint64 releaseFormatting(KTextEdit *textEdit);
+
+    // Replace the text of a hidden editor by a placeholder, keeping modified text in a swap
+    // file; the undo history does not survive this
+    qint64 evictText(QMdiSubWindow *window, KTextEdit *textEdit);
+
+    // Directory holding swap files of unloaded modified documents
+    static QString swapDirectory();
+
+    // Helper function to get the MDI area of a tab
+    QMdiArea* getMdiArea(int index) const;
+
+    QTabWidget *m_tabWidget;
+    SettingsManagement *m_settingsManagement;
+    MemoryInspector *m_memoryInspector;
+    QTimer *m_enforceTimer;
+
+    // Interval of the periodic budget check in milliseconds
+    static const int ENFORCE_INTERVAL = 30000;
+};
+
+#endif // MEMORYBUDGETMANAGER_H
@@ -0,0 +1,292 @@
+#include "MemoryInspector.h"
+#include <QTabWidget>
+#include <QMdiArea>
+#include <QMdiSubWindow>
+#include <QSplitter>
+#include <QDialog>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QTextLayout>
+#include <QFile>
+#include <QEvent>
+#include <QLoggingCategory>
+#include <KTextEdit>
+#include <KFormat>
+#include <KLocalizedString>
+#include <KMessageBox>
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+Q_LOGGING_CATEGORY(memoryInspectorLog, "mudoedit.memoryinspector")
+
+namespace {
+
+// Rough per-item costs of QTextDocument internals, used for the estimates below
+constexpr qint64 BLOCK_OVERHEAD = 96;      // fragment map entry, block data and layout object
+constexpr qint64 LINE_OVERHEAD = 48;       // one QScriptLine
+constexpr qint64 GLYPH_BYTES = 24;         // glyph index, advance, offset and attributes per character
+constexpr qint64 FORMAT_RANGE_BYTES = sizeof(QTextLayout::FormatRange) + 32;
+constexpr qint64 UNDO_STEP_BYTES = 64;     // one QTextUndoCommand
+constexpr qint64 SPELL_BLOCK_BYTES = 16;   // per-block state kept by the spell-check highlighter
+
+const char RELEASED_LAYOUT_PROPERTY[] = "layoutReleased";
+
+}
+
+MemoryInspector::MemoryInspector(QTabWidget *tabWidget, QObject *parent)
+    : QObject(parent),
+      m_tabWidget(tabWidget),
+      m_dialog(nullptr),
+      m_usageTree(nullptr),
+      m_totalsLabel(nullptr)
+{
+}
+
+DocumentMemoryUsage MemoryInspector::estimateUsage(KTextEdit *textEdit)
+{
+    DocumentMemoryUsage usage;
+    QTextDocument *document = textEdit->document();
+
+    usage.textBytes = document->characterCount() * qint64(sizeof(QChar));
+    usage.undoBytes = (document->availableUndoSteps() + document->availableRedoSteps()) * UNDO_STEP_BYTES;
+
+    for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+        usage.textBytes += BLOCK_OVERHEAD;
+
+        QTextLayout *layout = block.layout();
+        if (!layout) continue;
+
+        const int lineCount = layout->lineCount();
+        if (lineCount > 0) {
+            usage.layoutBytes += lineCount * LINE_OVERHEAD + block.length() * GLYPH_BYTES;
+        }
+
+        // Highlighter output lives in the layout's additional formats; the spell checker
+        // marks misspelled words with its own underline style
+        const QList<QTextLayout::FormatRange> formats = layout->formats();
+        for (const QTextLayout::FormatRange &range : formats) {
+            if (range.format.underlineStyle() == QTextCharFormat::SpellCheckUnderline) {
+                usage.spellCheckBytes += FORMAT_RANGE_BYTES;
+            } else {
+                usage.highlightBytes += FORMAT_RANGE_BYTES;
+            }
+        }
+    }
+
+    if (textEdit->checkSpellingEnabled()) {
+        usage.spellCheckBytes += document->blockCount() * SPELL_BLOCK_BYTES;
+    }
+
+    return usage;
+}
+
+QList<DocumentMemoryUsage> MemoryInspector::collectUsage() const
+{
+    QList<DocumentMemoryUsage> result;
+    for (int i = 0; i < m_tabWidget->count(); ++i) {
+        QMdiArea *mdiArea = getMdiArea(i);
+        if (!mdiArea) continue;
+
+        for (QMdiSubWindow *window : mdiArea->subWindowList()) {
+            if (KTextEdit *textEdit = qobject_cast<KTextEdit*>(window->widget())) {
+                DocumentMemoryUsage usage = estimateUsage(textEdit);
+                usage.title = window->windowTitle();
+                usage.tabName = m_tabWidget->tabText(i);
+                usage.background = isBackgroundWindow(window);
+                result.append(usage);
+            }
+        }
+    }
+    return result;
+}
+
+qint64 MemoryInspector::processResidentBytes()
+{
+#ifdef Q_OS_LINUX
+    // The second field of statm is the resident set size in pages
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (statm.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> fields = statm.readAll().split(' ');
+        if (fields.size() > 1) {
+            bool ok = false;
+            const qint64 pages = fields.at(1).toLongLong(&ok);
+            if (ok) {
+                return pages * sysconf(_SC_PAGESIZE);
+            }
+        }
+    }
+#endif
+    return -1;
+}
+
+bool MemoryInspector::releaseLayout(KTextEdit *textEdit)
+{
+    // A visible editor would immediately lay itself out again
+    if (textEdit->isVisible()) {
+        return false;
+    }
+
+    QTextDocument *document = textEdit->document();
+    for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+        if (QTextLayout *layout = block.layout()) {
+            layout->clearLayout();
+        }
+    }
+
+    if (!textEdit->property(RELEASED_LAYOUT_PROPERTY).toBool()) {
+        textEdit->setProperty(RELEASED_LAYOUT_PROPERTY, true);
+        textEdit->installEventFilter(this);
+    }
+    return true;
+}
+
+int MemoryInspector::releaseBackgroundCaches()
+{
+    int released = 0;
+    for (int i = 0; i < m_tabWidget->count(); ++i) {
+        QMdiArea *mdiArea = getMdiArea(i);
+        if (!mdiArea) continue;
+
+        for (QMdiSubWindow *window : mdiArea->subWindowList()) {
+            KTextEdit *textEdit = qobject_cast<KTextEdit*>(window->widget());
+            if (!textEdit || !isBackgroundWindow(window)) continue;
+
+            textEdit->document()->clearUndoRedoStacks();
+            releaseLayout(textEdit);
+            ++released;
+        }
+    }
+    qCDebug(memoryInspectorLog) << "Released caches of" << released << "background documents";
+    return released;
+}
+
+bool MemoryInspector::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::Show) {
+        KTextEdit *textEdit = qobject_cast<KTextEdit*>(watched);
+        if (textEdit && textEdit->property(RELEASED_LAYOUT_PROPERTY).toBool()) {
+            textEdit->setProperty(RELEASED_LAYOUT_PROPERTY, false);
+            textEdit->removeEventFilter(this);
+            QTextDocument *document = textEdit->document();
+            document->markContentsDirty(0, document->characterCount());
+        }
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+bool MemoryInspector::isBackgroundWindow(QMdiSubWindow *window) const
+{
+    QMdiArea *currentArea = getMdiArea(m_tabWidget->currentIndex());
+    return window->mdiArea() != currentArea || currentArea->activeSubWindow() != window;
+}
+
+void MemoryInspector::showInspector()
+{
+    if (m_dialog) {
+        refreshInspector();
+        m_dialog->raise();
+        m_dialog->activateWindow();
+        return;
+    }
+
+    m_dialog = new QDialog(m_tabWidget);
+    m_dialog->setWindowTitle(i18n("Memory Inspector"));
+    m_dialog->setAttribute(Qt::WA_DeleteOnClose);
+    m_dialog->resize(800, 400);
+    connect(m_dialog, &QObject::destroyed, this, [this]() {
+        m_dialog = nullptr;
+        m_usageTree = nullptr;
+        m_totalsLabel = nullptr;
+    });
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(m_dialog);
+
+    m_usageTree = new QTreeWidget;
+    m_usageTree->setRootIsDecorated(false);
+    m_usageTree->setHeaderLabels({i18n("Document"), i18n("Tab"), i18n("Text"), i18n("Layout"),
+                                  i18n("Undo"), i18n("Highlighting"), i18n("Spell Check"), i18n("Total")});
+    m_usageTree->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    mainLayout->addWidget(m_usageTree);
+
+    m_totalsLabel = new QLabel;
+    mainLayout->addWidget(m_totalsLabel);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout;
+    QPushButton *refreshButton = new QPushButton(QIcon::fromTheme(QStringLiteral("view-refresh")), i18n("Refresh"));
+    QPushButton *releaseButton = new QPushButton(QIcon::fromTheme(QStringLiteral("edit-clear")), i18n("Release Background Caches"));
+    QPushButton *closeButton = new QPushButton(i18n("Close"));
+
+    connect(refreshButton, &QPushButton::clicked, this, &MemoryInspector::refreshInspector);
+    connect(releaseButton, &QPushButton::clicked, this, [this]() {
+        int ret = KMessageBox::warningContinueCancel(m_dialog,
+            i18n("This discards the undo history of every document except the active one. Continue?"),
+            i18n("Release Background Caches"));
+        if (ret == KMessageBox::Continue) {
+            releaseBackgroundCaches();
+            refreshInspector();
+        }
+    });
+    connect(closeButton, &QPushButton::clicked, m_dialog, &QDialog::close);
+
+    buttonLayout->addWidget(refreshButton);
+    buttonLayout->addWidget(releaseButton);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(closeButton);
+    mainLayout->addLayout(buttonLayout);
+
+    refreshInspector();
+    m_dialog->show();
+}
+
+void MemoryInspector::refreshInspector()
+{
+    if (!m_usageTree) return;
+
+    QList<DocumentMemoryUsage> usageList = collectUsage();
+    std::sort(usageList.begin(), usageList.end(), [](const DocumentMemoryUsage &a, const DocumentMemoryUsage &b) {
+        return a.totalBytes() > b.totalBytes();
+    });
+
+    KFormat format;
+    qint64 documentsTotal = 0;
+    m_usageTree->clear();
+    for (const DocumentMemoryUsage &usage : std::as_const(usageList)) {
+        QTreeWidgetItem *item = new QTreeWidgetItem(m_usageTree);
+        item->setText(0, usage.background ? usage.title : i18n("%1 (active)", usage.title));
+        item->setText(1, usage.tabName);
+        item->setText(2, format.formatByteSize(usage.textBytes));
+        item->setText(3, format.formatByteSize(usage.layoutBytes));
+        item->setText(4, format.formatByteSize(usage.undoBytes));
+        item->setText(5, format.formatByteSize(usage.highlightBytes));
+        item->setText(6, format.formatByteSize(usage.spellCheckBytes));
+        item->setText(7, format.formatByteSize(usage.totalBytes()));
+        for (int column = 2; column <= 7; ++column) {
+            item->setTextAlignment(column, Qt::AlignRight | Qt::AlignVCenter);
+        }
+        documentsTotal += usage.totalBytes();
+    }
+
+    const qint64 residentBytes = processResidentBytes();
+    const QString residentText = residentBytes < 0 ? i18n("unavailable") : format.formatByteSize(residentBytes);
+    m_totalsLabel->setText(i18np("%1 document, estimated %2. Process resident memory: %3",
+                                 "%1 documents, estimated %2. Process resident memory: %3",
+                                 usageList.size(), format.formatByteSize(documentsTotal), residentText));
+}
+
+QMdiArea* MemoryInspector::getMdiArea(int index) const
+{
+    QSplitter *splitter = qobject_cast<QSplitter*>(m_tabWidget->widget(index));
+    if (splitter) {
+        return qobject_cast<QMdiArea*>(splitter->widget(0));
+    }
+    return nullptr;
+}
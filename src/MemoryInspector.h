@@ -0,0 +1,81 @@
+#ifndef MEMORYINSPECTOR_H
+#define MEMORYINSPECTOR_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+
+class QTabWidget;
+class QMdiArea;
+class QMdiSubWindow;
+class QTreeWidget;
+class QLabel;
+class QDialog;
+class KTextEdit;
+
+// Estimated memory held by a single open document, broken down by component
+struct DocumentMemoryUsage
+{
+    QString title;
+    QString tabName;
+    bool background = false;
+    qint64 textBytes = 0;
+    qint64 layoutBytes = 0;
+    qint64 undoBytes = 0;
+    qint64 highlightBytes = 0;
+    qint64 spellCheckBytes = 0;
+
+    qint64 totalBytes() const
+    {
+        return textBytes + layoutBytes + undoBytes + highlightBytes + spellCheckBytes;
+    }
+};
+
+// This class estimates per-document memory usage and can release caches of background documents
+class MemoryInspector : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MemoryInspector(QTabWidget *tabWidget, QObject *parent = nullptr);
+
+    // Estimate the memory used by one editor
+    static DocumentMemoryUsage estimateUsage(KTextEdit *textEdit);
+
+    // Collect estimates for every open document in every tab
+    QList<DocumentMemoryUsage> collectUsage() const;
+
+    // Resident memory of the whole process in bytes, or -1 if unavailable
+    static qint64 processResidentBytes();
+
+    // Drop the laid-out lines of a hidden editor; they are rebuilt when it is shown again
+    bool releaseLayout(KTextEdit *textEdit);
+
+    // Release layouts and undo history of all documents the user is not working in
+    int releaseBackgroundCaches();
+
+    // Whether the window is not the active one of the visible tab
+    bool isBackgroundWindow(QMdiSubWindow *window) const;
+
+public Q_SLOTS:
+    // Show the memory inspector dialog
+    void showInspector();
+
+protected:
+    // Relayout editors whose layout was released once they become visible
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    // Refill the dialog with fresh estimates
+    void refreshInspector();
+
+    // Helper function to get the MDI area of a tab
+    QMdiArea* getMdiArea(int index) const;
+
+    QTabWidget *m_tabWidget;
+    QDialog *m_dialog;
+    QTreeWidget *m_usageTree;
+    QLabel *m_totalsLabel;
+};
+
+#endif // MEMORYINSPECTOR_H
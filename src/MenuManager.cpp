@@ -4,6 +4,8 @@
 #include "EditOperations.h"
 #include "WindowManagement.h"
 #include "SettingsManagement.h"
+#include "LineOperations.h"
+#include <KLazyLocalizedString>
 #include <KLocalizedString>
 #include <KStandardAction>
 #include <KToggleAction>
@@ -56,6 +58,12 @@ void MenuManager::setupFileMenu()
     m_actionCollection->addAction(QStringLiteral("file_save_all"), saveAllAction);
     connect(saveAllAction, &QAction::triggered, m_documentManager, &DocumentManager::saveAllFiles);
 
+    // Create "Quick Open" action for the fuzzy file finder
+    QAction* quickOpenAction = new QAction(QIcon::fromTheme(QStringLiteral("quickopen")), i18n("&Quick Open..."), this);
+    m_actionCollection->addAction(QStringLiteral("file_quick_open"), quickOpenAction);
+    m_actionCollection->setDefaultShortcut(quickOpenAction, QKeySequence(Qt::CTRL | Qt::Key_P));
+    connect(quickOpenAction, &QAction::triggered, m_mainWindow, &MainWindow::showQuickOpen);
+
     // Set up recent files menu
     m_recentFilesMenu = new KRecentFilesAction(i18n("Recent Files"), this);
     m_actionCollection->addAction(QStringLiteral("recent_files"), m_recentFilesMenu);
@@ -77,6 +85,66 @@ void MenuManager::setupEditMenu()
     KStandardAction::cut(m_editOps, &EditOperations::cut, m_actionCollection);
     KStandardAction::copy(m_editOps, &EditOperations::copy, m_actionCollection);
     KStandardAction::paste(m_editOps, &EditOperations::paste, m_actionCollection);
+
+    // Create find and replace actions
+    KStandardAction::find(m_mainWindow, &MainWindow::showFindDialog, m_actionCollection);
+    KStandardAction::findNext(m_mainWindow, &MainWindow::findNext, m_actionCollection);
+    KStandardAction::findPrev(m_mainWindow, &MainWindow::findPrevious, m_actionCollection);
+    KStandardAction::replace(m_mainWindow, &MainWindow::showReplaceDialog, m_actionCollection);
+
+    QAction* findInFilesAction = new QAction(QIcon::fromTheme(QStringLiteral("edit-find")), i18n("Find in &Files..."), this);
+    m_actionCollection->addAction(QStringLiteral("edit_find_in_files"), findInFilesAction);
+    m_actionCollection->setDefaultShortcut(findInFilesAction, QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_F));
+    connect(findInFilesAction, &QAction::triggered, m_mainWindow, &MainWindow::showFindInFiles);
+
+    QAction* completeWordAction = new QAction(QIcon::fromTheme(QStringLiteral("code-context")), i18n("Complete &Word"), this);
+    m_actionCollection->addAction(QStringLiteral("edit_complete_word"), completeWordAction);
+    m_actionCollection->setDefaultShortcut(completeWordAction, QKeySequence(Qt::CTRL | Qt::Key_Space));
+    connect(completeWordAction, &QAction::triggered, m_mainWindow, &MainWindow::completeWord);
+
+    QAction* filterCommandAction = new QAction(QIcon::fromTheme(QStringLiteral("system-run")), i18n("Filter Through &Command..."), this);
+    m_actionCollection->addAction(QStringLiteral("edit_filter_command"), filterCommandAction);
+    m_actionCollection->setDefaultShortcut(filterCommandAction, QKeySequence(Qt::CTRL | Qt::Key_Backslash));
+    connect(filterCommandAction, &QAction::triggered, m_mainWindow, &MainWindow::filterThroughCommand);
+
+    QAction* selectOccurrencesAction = new QAction(i18n("Select All &Occurrences"), this);
+    m_actionCollection->addAction(QStringLiteral("edit_select_all_occurrences"), selectOccurrencesAction);
+    m_actionCollection->setDefaultShortcut(selectOccurrencesAction, QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_L));
+    connect(selectOccurrencesAction, &QAction::triggered, m_editOps, &EditOperations::selectAllOccurrences);
+
+    QAction* cursorAboveAction = new QAction(i18n("Add Cursor &Above"), this);
+    m_actionCollection->addAction(QStringLiteral("edit_add_cursor_above"), cursorAboveAction);
+    m_actionCollection->setDefaultShortcut(cursorAboveAction, QKeySequence(Qt::CTRL | Qt::ALT | Qt::Key_Up));
+    connect(cursorAboveAction, &QAction::triggered, m_editOps, &EditOperations::addCursorAbove);
+
+    QAction* cursorBelowAction = new QAction(i18n("Add Cursor &Below"), this);
+    m_actionCollection->addAction(QStringLiteral("edit_add_cursor_below"), cursorBelowAction);
+    m_actionCollection->setDefaultShortcut(cursorBelowAction, QKeySequence(Qt::CTRL | Qt::ALT | Qt::Key_Down));
+    connect(cursorBelowAction, &QAction::triggered, m_editOps, &EditOperations::addCursorBelow);
+
+    // Line operations, listed in the Lines submenu of Edit
+    const struct {
+        const char *name;
+        KLazyLocalizedString text;
+        LineOperation operation;
+    } lineActions[] = {
+        {"lines_sort", kli18n("&Sort"), LineOperation::Sort},
+        {"lines_sort_numerically", kli18n("Sort &Numerically"), LineOperation::SortNumerically},
+        {"lines_sort_by_field", kli18n("Sort by &Field..."), LineOperation::SortByField},
+        {"lines_unique", kli18n("Remove &Duplicates"), LineOperation::Unique},
+        {"lines_reverse", kli18n("&Reverse"), LineOperation::Reverse},
+        {"lines_shuffle", kli18n("Sh&uffle"), LineOperation::Shuffle},
+        {"lines_keep_matching", kli18n("&Keep Matching Lines..."), LineOperation::KeepMatching},
+        {"lines_remove_matching", kli18n("Remove &Matching Lines..."), LineOperation::RemoveMatching},
+    };
+    for (const auto &lineAction : lineActions) {
+        QAction* action = new QAction(lineAction.text.toString(), this);
+        m_actionCollection->addAction(QLatin1String(lineAction.name), action);
+        const LineOperation operation = lineAction.operation;
+        connect(action, &QAction::triggered, m_mainWindow, [this, operation]() {
+            m_mainWindow->runLineOperation(operation);
+        });
+    }
 }
 
 void MenuManager::setupViewMenu()
@@ -91,6 +159,7 @@ void MenuManager::setupViewMenu()
     // Add zoom actions
     KStandardAction::zoomIn(m_mainWindow, &MainWindow::zoomIn, m_actionCollection);
     KStandardAction::zoomOut(m_mainWindow, &MainWindow::zoomOut, m_actionCollection);
+    KStandardAction::actualSize(m_mainWindow, &MainWindow::resetZoom, m_actionCollection);
 
     // Add spell check toggle action
     KToggleAction* spellCheckAction = new KToggleAction(QIcon::fromTheme(QStringLiteral("tools-check-spelling")), i18n("Enable &Spell Checking"), this);
@@ -106,6 +175,40 @@ void MenuManager::setupViewMenu()
     syntaxHighlightAction->setChecked(m_settingsManagement->isSyntaxHighlightingEnabled());
     connect(syntaxHighlightAction, &QAction::toggled, m_mainWindow, &MainWindow::toggleSyntaxHighlighting);
     viewMenu->addAction(syntaxHighlightAction);
+
+    // Add outline panel toggle action
+    KToggleAction* outlineAction = new KToggleAction(QIcon::fromTheme(QStringLiteral("view-list-tree")), i18n("Show &Outline"), this);
+    m_actionCollection->addAction(QStringLiteral("view_outline"), outlineAction);
+    m_actionCollection->setDefaultShortcut(outlineAction, QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_O));
+    outlineAction->setChecked(m_settingsManagement->isOutlineVisible());
+    connect(outlineAction, &KToggleAction::triggered, m_mainWindow, &MainWindow::toggleOutline);
+    viewMenu->addAction(outlineAction);
+
+    // Add compare actions
+    QAction* compareSavedAction = new QAction(QIcon::fromTheme(QStringLiteral("document-compare")), i18n("Compare with &Saved Version"), this);
+    m_actionCollection->addAction(QStringLiteral("view_compare_saved"), compareSavedAction);
+    m_actionCollection->setDefaultShortcut(compareSavedAction, QKeySequence(Qt::CTRL | Qt::ALT | Qt::Key_D));
+    connect(compareSavedAction, &QAction::triggered, m_mainWindow, &MainWindow::compareWithSaved);
+    viewMenu->addSeparator();
+    viewMenu->addAction(compareSavedAction);
+
+    QAction* compareDocumentAction = new QAction(QIcon::fromTheme(QStringLiteral("document-compare")), i18n("Compare with &Document..."), this);
+    m_actionCollection->addAction(QStringLiteral("view_compare_document"), compareDocumentAction);
+    connect(compareDocumentAction, &QAction::triggered, m_mainWindow, &MainWindow::compareWithDocument);
+    viewMenu->addAction(compareDocumentAction);
+
+    // Add filter action
+    QAction* filterAction = new QAction(QIcon::fromTheme(QStringLiteral("view-filter")), i18n("&Filter Lines..."), this);
+    m_actionCollection->addAction(QStringLiteral("view_filter"), filterAction);
+    connect(filterAction, &QAction::triggered, m_mainWindow, &MainWindow::showFilter);
+
+    // Add follow action
+    QAction* followAction = new QAction(QIcon::fromTheme(QStringLiteral("go-bottom")), i18n("Fo&llow File"), this);
+    m_actionCollection->addAction(QStringLiteral("view_follow"), followAction);
+    connect(followAction, &QAction::triggered, m_mainWindow, &MainWindow::toggleFollow);
+    viewMenu->addSeparator();
+    viewMenu->addAction(filterAction);
+    viewMenu->addAction(followAction);
 }
 
 void MenuManager::setupWindowMenu()
@@ -133,6 +236,12 @@ void MenuManager::setupWindowMenu()
     m_actionCollection->addAction(QStringLiteral("window_close_all"), closeAllAction);
     connect(closeAllAction, &QAction::triggered, m_windowMgmt, &WindowManagement::closeAllWindows);
     windowMenu->addAction(closeAllAction);
+
+    QAction* memoryInspectorAction = new QAction(QIcon::fromTheme(QStringLiteral("utilities-system-monitor")), i18n("Memory &Inspector..."), this);
+    m_actionCollection->addAction(QStringLiteral("window_memory_inspector"), memoryInspectorAction);
+    connect(memoryInspectorAction, &QAction::triggered, m_mainWindow, &MainWindow::showMemoryInspector);
+    windowMenu->addSeparator();
+    windowMenu->addAction(memoryInspectorAction);
     
     // Add tab management actions
     windowMenu->addSeparator();
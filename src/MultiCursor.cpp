@@ -0,0 +1,698 @@
+#include "MultiCursor.h"
+#include "ClipboardTransfer.h"
+#include "ExtraSelections.h"
+#include "SearchEngine.h"
+#include <QApplication>
+#include <QClipboard>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QLoggingCategory>
+#include <KTextEdit>
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(multiCursorLog, "mudoedit.multicursor")
+
+void MultiCursor::attach(KTextEdit *textEdit)
+{
+    forEditor(textEdit);
+}
+
+MultiCursor* MultiCursor::forEditor(KTextEdit *textEdit)
+{
+    MultiCursor *multiCursor = textEdit->findChild<MultiCursor*>(QString(), Qt::FindDirectChildrenOnly);
+    if (!multiCursor) {
+        multiCursor = new MultiCursor(textEdit);
+    }
+    return multiCursor;
+}
+
+MultiCursor::MultiCursor(KTextEdit *textEdit)
+    : QObject(textEdit),
+      m_textEdit(textEdit),
+      m_overlay(new QWidget(textEdit)),
+      m_primary(0),
+      m_applying(false),
+      m_columnMode(false),
+      m_columnDragging(false),
+      m_columnAnchorBlock(0),
+      m_columnAnchorColumn(0),
+      m_columnBlock(0),
+      m_columnColumn(0)
+{
+    // The overlay lies over the viewport rather than in it, so scrolling doesn't move it
+    m_overlay->setAttribute(Qt::WA_TransparentForMouseEvents);
+    m_overlay->hide();
+    m_overlay->installEventFilter(this);
+    m_textEdit->installEventFilter(this);
+    m_textEdit->viewport()->installEventFilter(this);
+
+    // Edits and cursor moves that are not ours leave just the editor's cursor
+    connect(m_textEdit->document(), &QTextDocument::contentsChange, this, [this]() {
+        if (!m_applying) {
+            clear();
+        }
+    });
+    connect(m_textEdit, &QTextEdit::cursorPositionChanged, this, [this]() {
+        if (!m_applying) {
+            clear();
+        }
+    });
+
+    const auto viewportMoved = [this]() {
+        if (isActive()) {
+            updateSelections();
+            m_overlay->update();
+        }
+    };
+    connect(m_textEdit->verticalScrollBar(), &QScrollBar::valueChanged, this, viewportMoved);
+    connect(m_textEdit->horizontalScrollBar(), &QScrollBar::valueChanged, this, viewportMoved);
+}
+
+void MultiCursor::selectAllOccurrences()
+{
+    // A word taken from under the cursor only matches as a whole word
+    QTextCursor cursor = m_textEdit->textCursor();
+    SearchOptions options;
+    options.caseSensitivity = Qt::CaseSensitive;
+    if (!cursor.hasSelection()) {
+        cursor.select(QTextCursor::WordUnderCursor);
+        options.wholeWords = true;
+    }
+    QString needle = cursor.selectedText();
+    needle.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    if (needle.isEmpty()) return;
+
+    const QString text = m_textEdit->document()->toPlainText();
+    std::vector<Caret> carets;
+    int primary = 0;
+    SearchEngine::forEachMatch(text, needle, options, [&](const SearchMatch &match) {
+        if (match.start == cursor.selectionStart()) {
+            primary = int(carets.size());
+        }
+        carets.push_back({int(match.start), int(match.end())});
+        return carets.size() < size_t(MAX_CURSORS);
+    });
+    if (carets.empty()) return;
+
+    qCDebug(multiCursorLog) << "Selected" << carets.size() << "occurrences of" << needle;
+    m_columnMode = false;
+    setCarets(std::move(carets), primary);
+}
+
+void MultiCursor::addCursorAbove()
+{
+    std::vector<Caret> carets = currentCarets();
+    QTextDocument *document = m_textEdit->document();
+
+    // The new cursor selects the same columns as the topmost one
+    const Caret top = carets.front();
+    const QTextBlock block = document->findBlock(top.position);
+    const QTextBlock above = block.previous();
+    if (!above.isValid()) return;
+
+    const int length = above.length() - 1;
+    carets.push_back({above.position() + qMin(top.anchor - block.position(), length),
+                      above.position() + qMin(top.position - block.position(), length)});
+    const int primary = int(carets.size()) - 1;
+    m_columnMode = false;
+    setCarets(std::move(carets), primary);
+}
+
+void MultiCursor::addCursorBelow()
+{
+    std::vector<Caret> carets = currentCarets();
+    QTextDocument *document = m_textEdit->document();
+
+    const Caret bottom = carets.back();
+    const QTextBlock block = document->findBlock(bottom.position);
+    const QTextBlock below = block.next();
+    if (!below.isValid()) return;
+
+    const int length = below.length() - 1;
+    carets.push_back({below.position() + qMin(bottom.anchor - block.position(), length),
+                      below.position() + qMin(bottom.position - block.position(), length)});
+    const int primary = int(carets.size()) - 1;
+    m_columnMode = false;
+    setCarets(std::move(carets), primary);
+}
+
+void MultiCursor::insertText(const QString &text)
+{
+    std::vector<Edit> edits;
+    for (const Caret &caret : currentCarets()) {
+        edits.push_back({caret.start(), caret.end(), text});
+    }
+    applyEdits(std::move(edits));
+}
+
+void MultiCursor::copy()
+{
+    if (!isActive()) {
+        ClipboardTransfer::forEditor(m_textEdit)->copy();
+        return;
+    }
+
+    QStringList parts;
+    QTextCursor cursor(m_textEdit->document());
+    for (const Caret &caret : m_carets) {
+        if (caret.hasSelection()) {
+            cursor.setPosition(caret.anchor);
+            cursor.setPosition(caret.position, QTextCursor::KeepAnchor);
+            parts.append(cursor.selectedText().replace(QChar::ParagraphSeparator, QLatin1Char('\n')));
+        }
+    }
+    if (!parts.isEmpty()) {
+        QApplication::clipboard()->setText(parts.join(QLatin1Char('\n')));
+    }
+}
+
+void MultiCursor::cut()
+{
+    if (!isActive()) {
+        ClipboardTransfer::forEditor(m_textEdit)->cut();
+        return;
+    }
+
+    copy();
+    std::vector<Edit> edits;
+    for (const Caret &caret : m_carets) {
+        edits.push_back({caret.start(), caret.end(), QString()});
+    }
+    applyEdits(std::move(edits));
+}
+
+void MultiCursor::paste()
+{
+    if (!isActive()) {
+        ClipboardTransfer::forEditor(m_textEdit)->paste();
+        return;
+    }
+
+    const QString text = QApplication::clipboard()->text();
+    if (text.isEmpty()) return;
+
+    QStringList lines = text.split(QLatin1Char('\n'));
+    if (lines.size() > 1 && lines.last().isEmpty()) {
+        lines.removeLast();
+    }
+    const bool perCursor = lines.size() == qsizetype(m_carets.size());
+
+    std::vector<Edit> edits;
+    for (size_t i = 0; i < m_carets.size(); ++i) {
+        edits.push_back({m_carets[i].start(), m_carets[i].end(), perCursor ? lines.at(qsizetype(i)) : text});
+    }
+    applyEdits(std::move(edits));
+}
+
+void MultiCursor::clear()
+{
+    m_columnMode = false;
+    m_columnDragging = false;
+    if (m_carets.empty()) return;
+
+    m_carets.clear();
+    syncView();
+}
+
+bool MultiCursor::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_overlay) {
+        if (event->type() == QEvent::Paint) {
+            paintCarets();
+            return true;
+        }
+    } else if (watched == m_textEdit->viewport()) {
+        switch (event->type()) {
+        case QEvent::Resize:
+            if (isActive()) {
+                syncView();
+            }
+            break;
+        case QEvent::MouseButtonPress:
+            return mousePressed(static_cast<QMouseEvent*>(event));
+        case QEvent::MouseMove:
+            if (m_columnDragging) {
+                int block = 0;
+                int column = 0;
+                columnAt(static_cast<QMouseEvent*>(event)->position().toPoint(), &block, &column);
+                setColumnSelection(m_columnAnchorBlock, m_columnAnchorColumn, block, column);
+                return true;
+            }
+            break;
+        case QEvent::MouseButtonRelease:
+            if (m_columnDragging) {
+                m_columnDragging = false;
+                return true;
+            }
+            break;
+        default:
+            break;
+        }
+    } else if (watched == m_textEdit) {
+        if (event->type() == QEvent::ShortcutOverride && isActive()
+            && static_cast<QKeyEvent*>(event)->key() == Qt::Key_Escape) {
+            event->accept();
+            return true;
+        }
+        if (event->type() == QEvent::KeyPress) {
+            return keyPressed(static_cast<QKeyEvent*>(event));
+        }
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+bool MultiCursor::keyPressed(QKeyEvent *event)
+{
+    const Qt::KeyboardModifiers modifiers = event->modifiers() & ~Qt::KeypadModifier;
+    const int key = event->key();
+    const bool arrow = key == Qt::Key_Up || key == Qt::Key_Down || key == Qt::Key_Left || key == Qt::Key_Right;
+
+    if (arrow && modifiers == (Qt::AltModifier | Qt::ShiftModifier)) {
+        extendColumnSelection(key);
+        return true;
+    }
+
+    // With one cursor these take the large clipboard path too
+    if (event->matches(QKeySequence::Copy)) {
+        copy();
+        return true;
+    }
+    if (event->matches(QKeySequence::Cut)) {
+        if (m_textEdit->isReadOnly()) return false;
+        cut();
+        return true;
+    }
+    if (event->matches(QKeySequence::Paste)) {
+        if (m_textEdit->isReadOnly()) return false;
+        paste();
+        return true;
+    }
+    if (!isActive()) return false;
+
+    if (event->matches(QKeySequence::Undo) || event->matches(QKeySequence::Redo)
+        || event->matches(QKeySequence::SelectAll)) {
+        clear();
+        return false;
+    }
+
+    switch (key) {
+    case Qt::Key_Escape:
+        clear();
+        return true;
+    case Qt::Key_Backspace:
+        deleteCharacters(true);
+        return true;
+    case Qt::Key_Delete:
+        deleteCharacters(false);
+        return true;
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        insertText(QString(QLatin1Char('\n')));
+        return true;
+    case Qt::Key_Tab:
+        insertText(QString(QLatin1Char('\t')));
+        return true;
+    case Qt::Key_Up:
+    case Qt::Key_Down:
+    case Qt::Key_Left:
+    case Qt::Key_Right:
+    case Qt::Key_Home:
+    case Qt::Key_End:
+        if (modifiers & ~(Qt::ShiftModifier | Qt::ControlModifier)) return false;
+        moveCursors(key, modifiers & Qt::ShiftModifier, modifiers & Qt::ControlModifier);
+        return true;
+    default:
+        break;
+    }
+
+    const QString text = event->text();
+    if (!text.isEmpty() && text.at(0).isPrint()
+        && !(modifiers & (Qt::ControlModifier | Qt::AltModifier | Qt::MetaModifier))) {
+        insertText(text);
+        return true;
+    }
+    return false;
+}
+
+bool MultiCursor::mousePressed(QMouseEvent *event)
+{
+    if (event->button() != Qt::LeftButton) return false;
+    const QPoint point = event->position().toPoint();
+
+    // Alt+Shift drags a column selection
+    if (event->modifiers() == (Qt::AltModifier | Qt::ShiftModifier)) {
+        int block = 0;
+        int column = 0;
+        columnAt(point, &block, &column);
+        m_columnDragging = true;
+        setColumnSelection(block, column, block, column);
+        m_textEdit->setFocus();
+        return true;
+    }
+
+    // Alt+click adds a cursor, or removes the one clicked on
+    if (event->modifiers() == Qt::AltModifier) {
+        const int position = m_textEdit->cursorForPosition(point).position();
+        std::vector<Caret> carets = currentCarets();
+        int primary = currentPrimary();
+        const auto existing = std::find_if(carets.begin(), carets.end(), [position](const Caret &caret) {
+            return caret.position == position;
+        });
+        if (existing != carets.end() && carets.size() > 1) {
+            const int index = int(existing - carets.begin());
+            carets.erase(existing);
+            primary = index < primary ? primary - 1 : qMin(primary, int(carets.size()) - 1);
+        } else {
+            carets.push_back({position, position});
+            primary = int(carets.size()) - 1;
+        }
+        m_columnMode = false;
+        setCarets(std::move(carets), primary);
+        m_textEdit->setFocus();
+        return true;
+    }
+    return false;
+}
+
+void MultiCursor::applyEdits(std::vector<Edit> edits)
+{
+    if (edits.empty() || m_textEdit->isReadOnly()) return;
+
+    // Neighbouring cursors may reach for the same characters; remove them only once
+    for (size_t i = 1; i < edits.size(); ++i) {
+        edits[i].start = qMax(edits[i].start, edits[i - 1].end);
+        edits[i].end = qMax(edits[i].end, edits[i].start);
+    }
+
+    ClipboardTransfer::detach(m_textEdit->document());
+    const int primary = currentPrimary();
+    m_applying = true;
+
+    // Our selections are cursors the document would have to move on every edit below
+    ExtraSelections::replace(m_textEdit, MultiCursorProperty, {});
+
+    // Last to first, so the positions of the edits still to come stay valid
+    QTextCursor cursor(m_textEdit->document());
+    cursor.beginEditBlock();
+    for (auto edit = edits.rbegin(); edit != edits.rend(); ++edit) {
+        if (edit->start == edit->end && edit->text.isEmpty()) continue;
+        cursor.setPosition(edit->start);
+        cursor.setPosition(edit->end, QTextCursor::KeepAnchor);
+        if (edit->text.isEmpty()) {
+            cursor.removeSelectedText();
+        } else {
+            cursor.insertText(edit->text);
+        }
+    }
+    cursor.endEditBlock();
+
+    // Every cursor ends up after its own text, shifted by the edits before it
+    std::vector<Caret> carets;
+    carets.reserve(edits.size());
+    int delta = 0;
+    for (const Edit &edit : edits) {
+        const int position = edit.start + delta + int(edit.text.size());
+        carets.push_back({position, position});
+        delta += int(edit.text.size()) - (edit.end - edit.start);
+    }
+
+    m_applying = false;
+    m_columnMode = false;
+    setCarets(std::move(carets), primary);
+}
+
+void MultiCursor::deleteCharacters(bool backward)
+{
+    QTextCursor cursor(m_textEdit->document());
+    std::vector<Edit> edits;
+    for (const Caret &caret : currentCarets()) {
+        if (caret.hasSelection()) {
+            edits.push_back({caret.start(), caret.end(), QString()});
+        } else {
+            cursor.setPosition(caret.position);
+            cursor.movePosition(backward ? QTextCursor::PreviousCharacter : QTextCursor::NextCharacter);
+            edits.push_back({qMin(cursor.position(), caret.position), qMax(cursor.position(), caret.position), QString()});
+        }
+    }
+    applyEdits(std::move(edits));
+}
+
+void MultiCursor::moveCursors(int key, bool keepAnchor, bool byWord)
+{
+    QTextDocument *document = m_textEdit->document();
+    QTextCursor cursor(document);
+    std::vector<Caret> carets = currentCarets();
+    for (Caret &caret : carets) {
+        int position = caret.position;
+        if (!keepAnchor && !byWord && caret.hasSelection() && (key == Qt::Key_Left || key == Qt::Key_Right)) {
+            position = key == Qt::Key_Left ? caret.start() : caret.end();
+        } else if (key == Qt::Key_Up || key == Qt::Key_Down) {
+            const QTextBlock block = document->findBlock(position);
+            const QTextBlock target = key == Qt::Key_Up ? block.previous() : block.next();
+            if (target.isValid()) {
+                position = target.position() + qMin(position - block.position(), target.length() - 1);
+            }
+        } else {
+            QTextCursor::MoveOperation operation = QTextCursor::NoMove;
+            switch (key) {
+            case Qt::Key_Left:
+                operation = byWord ? QTextCursor::WordLeft : QTextCursor::PreviousCharacter;
+                break;
+            case Qt::Key_Right:
+                operation = byWord ? QTextCursor::WordRight : QTextCursor::NextCharacter;
+                break;
+            case Qt::Key_Home:
+                operation = byWord ? QTextCursor::Start : QTextCursor::StartOfBlock;
+                break;
+            case Qt::Key_End:
+                operation = byWord ? QTextCursor::End : QTextCursor::EndOfBlock;
+                break;
+            }
+            cursor.setPosition(position);
+            cursor.movePosition(operation);
+            position = cursor.position();
+        }
+        caret.position = position;
+        if (!keepAnchor) {
+            caret.anchor = position;
+        }
+    }
+    m_columnMode = false;
+    setCarets(std::move(carets), currentPrimary());
+}
+
+void MultiCursor::setColumnSelection(int anchorBlock, int anchorColumn, int block, int column)
+{
+    QTextDocument *document = m_textEdit->document();
+    const int first = qMin(anchorBlock, block);
+    const int last = qMax(anchorBlock, block);
+
+    // Lines shorter than the rectangle get what they have of it
+    std::vector<Caret> carets;
+    carets.reserve(size_t(last - first + 1));
+    int primary = 0;
+    QTextBlock current = document->findBlockByNumber(first);
+    for (int number = first; current.isValid() && number <= last; current = current.next(), ++number) {
+        const int length = current.length() - 1;
+        if (number == block) {
+            primary = int(carets.size());
+        }
+        carets.push_back({current.position() + qMin(anchorColumn, length), current.position() + qMin(column, length)});
+    }
+    if (carets.empty()) return;
+
+    setCarets(std::move(carets), primary);
+    m_columnMode = true;
+    m_columnAnchorBlock = anchorBlock;
+    m_columnAnchorColumn = anchorColumn;
+    m_columnBlock = block;
+    m_columnColumn = column;
+}
+
+void MultiCursor::extendColumnSelection(int key)
+{
+    QTextDocument *document = m_textEdit->document();
+    if (!m_columnMode) {
+        const Caret caret = currentCarets()[size_t(currentPrimary())];
+        const QTextBlock block = document->findBlock(caret.position);
+        m_columnAnchorBlock = m_columnBlock = block.blockNumber();
+        m_columnAnchorColumn = m_columnColumn = caret.position - block.position();
+    }
+
+    int block = m_columnBlock;
+    int column = m_columnColumn;
+    switch (key) {
+    case Qt::Key_Up:
+        block = qMax(0, block - 1);
+        break;
+    case Qt::Key_Down:
+        block = qMin(document->blockCount() - 1, block + 1);
+        break;
+    case Qt::Key_Left:
+        column = qMax(0, column - 1);
+        break;
+    case Qt::Key_Right:
+        ++column;
+        break;
+    }
+    setColumnSelection(m_columnAnchorBlock, m_columnAnchorColumn, block, column);
+}
+
+void MultiCursor::columnAt(const QPoint &point, int *block, int *column) const
+{
+    const QTextCursor cursor = m_textEdit->cursorForPosition(point);
+    *block = cursor.blockNumber();
+    *column = cursor.positionInBlock();
+
+    if (*column == cursor.block().length() - 1) {
+        const int space = qMax(1, m_textEdit->fontMetrics().horizontalAdvance(QLatin1Char(' ')));
+        const int beyond = point.x() - m_textEdit->cursorRect(cursor).x();
+        if (beyond > space / 2) {
+            *column += (beyond + space / 2) / space;
+        }
+    }
+}
+
+void MultiCursor::setCarets(std::vector<Caret> carets, int primary)
+{
+    if (carets.empty()) {
+        clear();
+        return;
+    }
+    const int primaryPosition = carets[size_t(qBound(0, primary, int(carets.size()) - 1))].position;
+
+    std::sort(carets.begin(), carets.end(), [](const Caret &a, const Caret &b) {
+        return a.start() < b.start() || (a.start() == b.start() && a.end() < b.end());
+    });
+
+    // Overlapping cursors, and a bare cursor touching a selection, become one
+    std::vector<Caret> merged;
+    merged.reserve(carets.size());
+    for (const Caret &caret : carets) {
+        if (!merged.empty()) {
+            Caret &last = merged.back();
+            if (caret.start() < last.end() || caret.start() == last.start()
+                || (caret.start() == last.end() && (!caret.hasSelection() || !last.hasSelection()))) {
+                const int start = last.start();
+                const int end = qMax(last.end(), caret.end());
+                const bool forward = last.anchor <= last.position;
+                last.anchor = forward ? start : end;
+                last.position = forward ? end : start;
+                continue;
+            }
+        }
+        merged.push_back(caret);
+    }
+    if (merged.size() > size_t(MAX_CURSORS)) {
+        merged.resize(size_t(MAX_CURSORS));
+    }
+
+    const auto found = std::lower_bound(merged.begin(), merged.end(), primaryPosition, [](const Caret &caret, int position) {
+        return caret.end() < position;
+    });
+    m_primary = found == merged.end() ? int(merged.size()) - 1 : int(found - merged.begin());
+    const Caret primaryCaret = merged[size_t(m_primary)];
+    if (merged.size() == 1) {
+        merged.clear();
+        m_primary = 0;
+    }
+    m_carets = std::move(merged);
+
+    m_applying = true;
+    QTextCursor cursor(m_textEdit->document());
+    cursor.setPosition(primaryCaret.anchor);
+    cursor.setPosition(primaryCaret.position, QTextCursor::KeepAnchor);
+    m_textEdit->setTextCursor(cursor);
+    m_textEdit->ensureCursorVisible();
+    m_applying = false;
+
+    syncView();
+}
+
+void MultiCursor::syncView()
+{
+    m_overlay->setVisible(isActive());
+    if (isActive()) {
+        m_overlay->setGeometry(m_textEdit->viewport()->geometry());
+        m_overlay->raise();
+        m_overlay->update();
+    }
+    updateSelections();
+}
+
+void MultiCursor::updateSelections()
+{
+    QList<QTextEdit::ExtraSelection> selections;
+    if (isActive()) {
+        QTextCharFormat format;
+        format.setBackground(m_textEdit->palette().color(QPalette::Highlight));
+        format.setForeground(m_textEdit->palette().color(QPalette::HighlightedText));
+        format.setProperty(MultiCursorProperty, true);
+
+        int begin = 0;
+        int end = 0;
+        visibleRange(&begin, &end);
+        for (int i = begin; i < end; ++i) {
+            if (i == m_primary || !m_carets[size_t(i)].hasSelection()) continue;
+            QTextEdit::ExtraSelection selection;
+            selection.cursor = QTextCursor(m_textEdit->document());
+            selection.cursor.setPosition(m_carets[size_t(i)].anchor);
+            selection.cursor.setPosition(m_carets[size_t(i)].position, QTextCursor::KeepAnchor);
+            selection.format = format;
+            selections.append(selection);
+        }
+    }
+    ExtraSelections::replace(m_textEdit, MultiCursorProperty, selections);
+}
+
+void MultiCursor::paintCarets()
+{
+    if (!isActive()) return;
+
+    QPainter painter(m_overlay);
+    const QColor color = m_textEdit->palette().color(QPalette::Text);
+    const int width = qMax(1, m_textEdit->cursorWidth());
+    QTextCursor cursor(m_textEdit->document());
+
+    int begin = 0;
+    int end = 0;
+    visibleRange(&begin, &end);
+    for (int i = begin; i < end; ++i) {
+        // The editor draws its own cursor while it has the focus
+        if (i == m_primary && m_textEdit->hasFocus()) continue;
+        cursor.setPosition(m_carets[size_t(i)].position);
+        const QRect rect = m_textEdit->cursorRect(cursor);
+        painter.fillRect(QRect(rect.x(), rect.y(), width, rect.height()), color);
+    }
+}
+
+std::vector<MultiCursor::Caret> MultiCursor::currentCarets() const
+{
+    if (isActive()) {
+        return m_carets;
+    }
+    const QTextCursor cursor = m_textEdit->textCursor();
+    return {Caret{cursor.anchor(), cursor.position()}};
+}
+
+void MultiCursor::visibleRange(int *begin, int *end) const
+{
+    const QRect rect = m_textEdit->viewport()->rect();
+    const int top = m_textEdit->cursorForPosition(rect.topLeft()).block().position();
+    const QTextBlock bottomBlock = m_textEdit->cursorForPosition(rect.bottomRight()).block();
+    const int bottom = bottomBlock.position() + bottomBlock.length();
+
+    const auto first = std::lower_bound(m_carets.begin(), m_carets.end(), top, [](const Caret &caret, int position) {
+        return caret.end() < position;
+    });
+    const auto last = std::upper_bound(first, m_carets.end(), bottom, [](int position, const Caret &caret) {
+        return position < caret.start();
+    });
+    *begin = int(first - m_carets.begin());
+    *end = int(last - m_carets.begin());
+}
@@ -0,0 +1,146 @@
+#ifndef MULTICURSOR_H
+#define MULTICURSOR_H
+
+#include <QObject>
+#include <QString>
+#include <QTextFormat>
+#include <vector>
+
+class QKeyEvent;
+class QMouseEvent;
+class QPoint;
+class QWidget;
+class KTextEdit;
+
+// This class gives an editor several cursors, added one by one, for all occurrences of
+// a word or as a column selection. The cursors are kept as plain positions rather than
+// QTextCursors, which the document would have to move on every edit. A keystroke is
+// applied to all of them as one edit block, so the document is laid out once and the
+// change is one undo step; only the cursors in view are painted
+class MultiCursor : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Marks the extra selections that belong to the cursors
+    static const int MultiCursorProperty = QTextFormat::UserProperty + 2;
+
+    // Give an editor multiple cursors; does nothing if it already has them
+    static void attach(KTextEdit *textEdit);
+
+    // Get the multiple cursors of an editor, creating them on first use
+    static MultiCursor* forEditor(KTextEdit *textEdit);
+
+    // Whether the editor has more than its own cursor
+    bool isActive() const { return m_carets.size() > 1; }
+    int cursorCount() const { return isActive() ? int(m_carets.size()) : 1; }
+
+    // Put a cursor on every occurrence of the selection, or of the word at the cursor
+    void selectAllOccurrences();
+
+    // Add a cursor on the line above the topmost or below the bottommost cursor
+    void addCursorAbove();
+    void addCursorBelow();
+
+    // Type text at every cursor, replacing their selections
+    void insertText(const QString &text);
+
+    // Clipboard operations on all selections; pasting gives every cursor its own line
+    // of the clipboard when there are as many lines as cursors
+    void copy();
+    void cut();
+    void paste();
+
+    // Go back to the editor's own cursor
+    void clear();
+
+protected:
+    // Apply keys and mouse gestures to all cursors
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    struct Caret {
+        int anchor;
+        int position;
+
+        int start() const { return qMin(anchor, position); }
+        int end() const { return qMax(anchor, position); }
+        bool hasSelection() const { return anchor != position; }
+    };
+
+    // A replacement of the characters between start and end made for one cursor
+    struct Edit {
+        int start;
+        int end;
+        QString text;
+    };
+
+    explicit MultiCursor(KTextEdit *textEdit);
+
+    // Handle a key for all cursors; returns false to leave it to the editor
+    bool keyPressed(QKeyEvent *event);
+
+    // Handle adding cursors and column selection with the mouse
+    bool mousePressed(QMouseEvent *event);
+
+    // Apply one edit per cursor, in the order of the cursors, as one edit block
+    void applyEdits(std::vector<Edit> edits);
+
+    // Delete the selections, or the character before or after each cursor
+    void deleteCharacters(bool backward);
+
+    // Move every cursor; Up and Down keep the column within the line
+    void moveCursors(int key, bool keepAnchor, bool byWord);
+
+    // Select the same columns on every line from one corner of a rectangle to the other
+    void setColumnSelection(int anchorBlock, int anchorColumn, int block, int column);
+
+    // Extend the column selection with the keyboard
+    void extendColumnSelection(int key);
+
+    // Block number and column under a point of the viewport; past the end of a line the
+    // column keeps counting in spaces
+    void columnAt(const QPoint &point, int *block, int *column) const;
+
+    // Sort and merge cursors, move the editor's cursor to the primary one and show the others
+    void setCarets(std::vector<Caret> carets, int primary);
+
+    // Show or hide the cursors other than the editor's own
+    void syncView();
+
+    // Paint the selections of the cursors in view
+    void updateSelections();
+
+    // Paint the cursors in view on the overlay
+    void paintCarets();
+
+    // The cursors, or just the editor's own one when inactive, and which one is primary
+    std::vector<Caret> currentCarets() const;
+    int currentPrimary() const { return isActive() ? m_primary : 0; }
+
+    // Indexes of the cursors touching the visible part of the document, end exclusive
+    void visibleRange(int *begin, int *end) const;
+
+    KTextEdit *m_textEdit;
+    QWidget *m_overlay;
+
+    // Sorted, non-overlapping cursors including the primary one; empty when inactive
+    std::vector<Caret> m_carets;
+    int m_primary;
+
+    // Set while our own edits and cursor moves are applied
+    bool m_applying;
+
+    // The rectangle of the column selection, if the cursors came from one
+    bool m_columnMode;
+    bool m_columnDragging;
+    int m_columnAnchorBlock;
+    int m_columnAnchorColumn;
+    int m_columnBlock;
+    int m_columnColumn;
+
+    // Upper bound on the cursors, e.g. when selecting all occurrences of a letter
+    static const int MAX_CURSORS = 100000;
+};
+
+#endif // MULTICURSOR_H
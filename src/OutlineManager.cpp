@@ -0,0 +1,49 @@
+#include "OutlineManager.h"
+#include "OutlinePanel.h"
+#include "SettingsManagement.h"
+#include <QMdiArea>
+#include <QMdiSubWindow>
+#include <QSplitter>
+#include <QTabWidget>
+#include <KTextEdit>
+
+OutlineManager::OutlineManager(QTabWidget *tabWidget, SettingsManagement *settingsManagement, QObject *parent)
+    : QObject(parent),
+      m_tabWidget(tabWidget),
+      m_settingsManagement(settingsManagement)
+{
+}
+
+void OutlineManager::addPanel(QSplitter *splitter)
+{
+    QMdiArea *mdiArea = qobject_cast<QMdiArea*>(splitter->widget(0));
+    if (!mdiArea || splitter->findChild<OutlinePanel*>(QString(), Qt::FindDirectChildrenOnly)) return;
+
+    OutlinePanel *panel = new OutlinePanel(splitter);
+    splitter->addWidget(panel);
+    splitter->setStretchFactor(1, 0);
+    const int width = splitter->width() > PANEL_WIDTH ? splitter->width() : m_tabWidget->width();
+    splitter->setSizes(QList<int>() << width - PANEL_WIDTH << PANEL_WIDTH);
+    panel->setVisible(m_settingsManagement->isOutlineVisible());
+
+    // The area reports no active window while the main window is inactive; keep the outline then
+    connect(mdiArea, &QMdiArea::subWindowActivated, panel, [panel](QMdiSubWindow *window) {
+        if (window) {
+            panel->setEditor(qobject_cast<KTextEdit*>(window->widget()));
+        }
+    });
+    if (mdiArea->activeSubWindow()) {
+        panel->setEditor(qobject_cast<KTextEdit*>(mdiArea->activeSubWindow()->widget()));
+    }
+}
+
+void OutlineManager::setPanelsVisible(bool visible)
+{
+    for (int i = 0; i < m_tabWidget->count(); ++i) {
+        QSplitter *splitter = qobject_cast<QSplitter*>(m_tabWidget->widget(i));
+        OutlinePanel *panel = splitter ? splitter->findChild<OutlinePanel*>(QString(), Qt::FindDirectChildrenOnly) : nullptr;
+        if (panel) {
+            panel->setVisible(visible);
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef OUTLINEMANAGER_H
+#define OUTLINEMANAGER_H
+
+#include <QObject>
+
+class QTabWidget;
+class QSplitter;
+class SettingsManagement;
+
+// This class gives every tab an outline panel next to its MDI area that follows the
+// active document of the tab
+class OutlineManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit OutlineManager(QTabWidget *tabWidget, SettingsManagement *settingsManagement, QObject *parent = nullptr);
+
+    // Add a panel to the splitter of a tab; the MDI area stays the first widget
+    void addPanel(QSplitter *splitter);
+
+public Q_SLOTS:
+    // Show or hide the panels of all tabs
+    void setPanelsVisible(bool visible);
+
+private:
+    QTabWidget *m_tabWidget;
+    SettingsManagement *m_settingsManagement;
+
+    // Initial width of a panel
+    static const int PANEL_WIDTH = 220;
+};
+
+#endif // OUTLINEMANAGER_H
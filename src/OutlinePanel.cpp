@@ -0,0 +1,138 @@
+#include "OutlinePanel.h"
+#include "DocumentOutline.h"
+#include <QListWidget>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QVBoxLayout>
+#include <KLocalizedString>
+#include <KTextEdit>
+
+namespace {
+
+// Blocks searched around the recorded line when the symbol has moved since the last scan
+const int JUMP_SEARCH_BLOCKS = 100;
+
+// Item data of a symbol
+const int LINE_ROLE = Qt::UserRole;
+const int COLUMN_ROLE = Qt::UserRole + 1;
+
+} // namespace
+
+OutlinePanel::OutlinePanel(QWidget *parent)
+    : QWidget(parent),
+      m_list(new QListWidget(this)),
+      m_stale(false)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(m_list);
+
+    m_list->setUniformItemSizes(true);
+    connect(m_list, &QListWidget::itemActivated, this, &OutlinePanel::jumpTo);
+    connect(m_list, &QListWidget::itemClicked, this, &OutlinePanel::jumpTo);
+}
+
+void OutlinePanel::setEditor(KTextEdit *textEdit)
+{
+    if (textEdit == m_textEdit && (m_outline || !isVisible())) return;
+
+    if (m_outline) {
+        disconnect(m_outline, nullptr, this, nullptr);
+    }
+    m_outline = nullptr;
+    m_textEdit = textEdit;
+
+    if (isVisible()) {
+        attach();
+    } else {
+        m_stale = true;
+    }
+}
+
+void OutlinePanel::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    if (m_stale) {
+        attach();
+    }
+}
+
+void OutlinePanel::attach()
+{
+    m_stale = false;
+    if (m_textEdit && !m_outline) {
+        m_outline = DocumentOutline::forEditor(m_textEdit);
+        connect(m_outline, &DocumentOutline::symbolsChanged, this, &OutlinePanel::refresh);
+
+        // Closing the document clears the panel
+        connect(m_outline, &QObject::destroyed, this, [this]() {
+            m_list->clear();
+        });
+    }
+    refresh();
+}
+
+void OutlinePanel::refresh()
+{
+    if (!isVisible()) {
+        m_stale = true;
+        return;
+    }
+
+    const int scrollPosition = m_list->verticalScrollBar()->value();
+    m_list->setUpdatesEnabled(false);
+    m_list->clear();
+    if (m_outline) {
+        const QIcon classIcon = QIcon::fromTheme(QStringLiteral("code-class"));
+        const QIcon functionIcon = QIcon::fromTheme(QStringLiteral("code-function"));
+        for (const SymbolScanner::Symbol &symbol : m_outline->symbols()) {
+            QListWidgetItem *item = new QListWidgetItem(symbol.kind == SymbolScanner::Kind::Class ? classIcon : functionIcon,
+                                                        symbol.name, m_list);
+            item->setData(LINE_ROLE, symbol.line);
+            item->setData(COLUMN_ROLE, symbol.column);
+            item->setToolTip(i18n("Line %1", symbol.line + 1));
+        }
+    }
+    m_list->verticalScrollBar()->setValue(scrollPosition);
+    m_list->setUpdatesEnabled(true);
+}
+
+void OutlinePanel::jumpTo(QListWidgetItem *item)
+{
+    if (!item || !m_textEdit) return;
+
+    const QString name = item->text();
+    const int line = item->data(LINE_ROLE).toInt();
+    const int column = item->data(COLUMN_ROLE).toInt();
+    QTextDocument *document = m_textEdit->document();
+
+    // Edits made since the last scan may have moved the symbol a few lines
+    const auto definesSymbol = [&](const QTextBlock &block) {
+        return block.isValid() && block.text().indexOf(name) >= 0;
+    };
+    QTextBlock target = document->findBlockByNumber(line);
+    int offset = column;
+    if (!(target.isValid() && QStringView(target.text()).mid(column).startsWith(name))) {
+        QTextBlock found;
+        for (int distance = 0; distance <= JUMP_SEARCH_BLOCKS && !found.isValid(); ++distance) {
+            if (definesSymbol(document->findBlockByNumber(line - distance))) {
+                found = document->findBlockByNumber(line - distance);
+            } else if (definesSymbol(document->findBlockByNumber(line + distance))) {
+                found = document->findBlockByNumber(line + distance);
+            }
+        }
+        if (found.isValid()) {
+            target = found;
+        }
+        offset = qMax(0, int(target.text().indexOf(name)));
+    }
+    if (!target.isValid()) return;
+
+    QTextCursor cursor(target);
+    cursor.setPosition(target.position() + offset);
+    m_textEdit->setTextCursor(cursor);
+    m_textEdit->ensureCursorVisible();
+    m_textEdit->setFocus();
+}
@@ -0,0 +1,44 @@
+#ifndef OUTLINEPANEL_H
+#define OUTLINEPANEL_H
+
+#include <QWidget>
+#include <QPointer>
+
+class QListWidget;
+class QListWidgetItem;
+class KTextEdit;
+class DocumentOutline;
+
+// This class lists the classes and functions of one editor next to the MDI area of a
+// tab. The outline of the editor is only created and kept while the panel is shown
+class OutlinePanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit OutlinePanel(QWidget *parent = nullptr);
+
+    // Show the outline of an editor, or nothing
+    void setEditor(KTextEdit *textEdit);
+
+protected:
+    // Catch up with the editor that became active while the panel was hidden
+    void showEvent(QShowEvent *event) override;
+
+private:
+    // Start following the outline of the current editor
+    void attach();
+
+    // Fill the list from the outline
+    void refresh();
+
+    // Move the cursor of the editor to a symbol
+    void jumpTo(QListWidgetItem *item);
+
+    QPointer<KTextEdit> m_textEdit;
+    QPointer<DocumentOutline> m_outline;
+    QListWidget *m_list;
+    bool m_stale;
+};
+
+#endif // OUTLINEPANEL_H
@@ -0,0 +1,578 @@
+#include "QuickOpenManager.h"
+#include "DocumentManager.h"
+#include <QApplication>
+#include <QTabWidget>
+#include <QMdiArea>
+#include <QMdiSubWindow>
+#include <QSplitter>
+#include <QDialog>
+#include <QVBoxLayout>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QLabel>
+#include <QKeyEvent>
+#include <QFileSystemWatcher>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QDir>
+#include <QDirIterator>
+#include <QPointer>
+#include <QSet>
+#include <QSettings>
+#include <QThreadPool>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <KLocalizedString>
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(quickOpenLog, "mudoedit.quickopenmanager")
+
+namespace {
+
+// Stop crawling after this many files
+const qsizetype MAX_CANDIDATES = 1000000;
+
+// Watch at most this many folders; each one takes a kernel watch
+const qsizetype MAX_WATCHED_FOLDERS = 10000;
+
+// Crawled files are handed to the GUI thread in batches of this size
+const int CRAWL_BATCH_SIZE = 5000;
+
+// Rows shown in the palette
+const int MAX_RESULTS = 50;
+
+// Recently used files that are remembered and ranked higher
+const int MAX_RECENT_FILES = 100;
+const int RECENCY_BONUS = 60;
+
+// Time in milliseconds the recently used files wait to be saved, so opening many files writes once
+const int SAVE_DELAY = 2000;
+
+inline QString folderOf(const QString &path, int nameStart)
+{
+    return path.left(nameStart - 1);
+}
+
+inline QChar foldChar(QChar c)
+{
+    const char16_t u = c.unicode();
+    if (u >= u'A' && u <= u'Z') return QChar(char16_t(u + (u'a' - u'A')));
+    return u < 128 ? c : c.toLower();
+}
+
+inline bool isSeparator(QChar c)
+{
+    return c == QLatin1Char('/') || c == QLatin1Char('_') || c == QLatin1Char('-')
+        || c == QLatin1Char('.') || c == QLatin1Char(' ');
+}
+
+} // namespace
+
+QuickOpenManager::QuickOpenManager(QTabWidget *tabWidget, DocumentManager *documentManager, QObject *parent)
+    : QObject(parent),
+      m_tabWidget(tabWidget),
+      m_documentManager(documentManager),
+      m_watcher(new QFileSystemWatcher(this)),
+      m_saveTimer(new QTimer(this)),
+      m_generation(0),
+      m_pendingCrawls(0),
+      m_removedCount(0),
+      m_palette(nullptr),
+      m_queryEdit(nullptr),
+      m_resultList(nullptr),
+      m_statusLabel(nullptr)
+{
+    loadRecentFiles();
+    connect(m_documentManager, &DocumentManager::fileOpened, this, &QuickOpenManager::addRecentFile);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &QuickOpenManager::directoryChanged);
+
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(SAVE_DELAY);
+    connect(m_saveTimer, &QTimer::timeout, this, &QuickOpenManager::saveRecentFiles);
+}
+
+QuickOpenManager::~QuickOpenManager()
+{
+    if (m_crawlCancelled) {
+        *m_crawlCancelled = true;
+    }
+    if (m_saveTimer->isActive()) {
+        saveRecentFiles();
+    }
+}
+
+quint64 QuickOpenManager::characterMask(QStringView text)
+{
+    // One bit per letter and digit, a few for path punctuation and one for everything else
+    quint64 mask = 0;
+    for (QChar c : text) {
+        const char16_t u = foldChar(c).unicode();
+        if (u >= u'a' && u <= u'z') {
+            mask |= quint64(1) << (u - u'a');
+        } else if (u >= u'0' && u <= u'9') {
+            mask |= quint64(1) << (26 + u - u'0');
+        } else if (u == u'.') {
+            mask |= quint64(1) << 36;
+        } else if (u == u'_') {
+            mask |= quint64(1) << 37;
+        } else if (u == u'-') {
+            mask |= quint64(1) << 38;
+        } else if (u == u'/') {
+            mask |= quint64(1) << 39;
+        } else if (u >= 128) {
+            mask |= quint64(1) << 63;
+        } else {
+            mask |= quint64(1) << 62;
+        }
+    }
+    return mask;
+}
+
+int QuickOpenManager::fuzzyScore(QStringView path, int nameStart, QStringView query)
+{
+    // Greedy subsequence match rewarding consecutive characters and word starts,
+    // penalizing gaps; the query is expected in lower case
+    auto match = [&](qsizetype from) {
+        int score = 0;
+        qsizetype matched = 0;
+        qsizetype last = -1;
+        for (qsizetype i = from; i < path.size() && matched < query.size(); ++i) {
+            if (foldChar(path.at(i)) != query.at(matched)) continue;
+
+            score += 10;
+            if (last >= 0 && i == last + 1) {
+                score += 15;
+            } else if (last >= 0) {
+                score -= int(qMin<qsizetype>(i - last - 1, 10));
+            }
+            if (i == 0 || i == nameStart || isSeparator(path.at(i - 1))
+                || (path.at(i - 1).isLower() && path.at(i).isUpper())) {
+                score += 20;
+            }
+            last = i;
+            ++matched;
+        }
+        return matched == query.size() ? score : -1;
+    };
+
+    // A match in the file name beats one spread over the folders, and short names win
+    const int nameScore = match(nameStart);
+    if (nameScore >= 0) {
+        return nameScore + 100 - int(qMin<qsizetype>(path.size() - nameStart, 50));
+    }
+    const int pathScore = match(0);
+    return pathScore < 0 ? -1 : pathScore - int(qMin<qsizetype>(path.size(), 200) / 4);
+}
+
+void QuickOpenManager::showPalette()
+{
+    createPalette();
+
+    // Without a document there is no project to guess, and the whole home folder is too much to crawl
+    QString rootPath = projectRoot();
+    if (rootPath.isEmpty()) {
+        rootPath = QFileDialog::getExistingDirectory(m_tabWidget, i18n("Quick Open Folder"), QDir::homePath());
+    }
+    if (!rootPath.isEmpty() && rootPath != m_rootPath) {
+        crawl(rootPath);
+    }
+
+    // Center the palette over the top of the editor
+    QWidget *window = m_tabWidget->window();
+    m_palette->resize(qMin(700, window->width() - 40), 400);
+    m_palette->move(window->geometry().center().x() - m_palette->width() / 2, window->geometry().top() + 60);
+
+    m_queryEdit->clear();
+    updateResults();
+    m_palette->show();
+    m_palette->raise();
+    m_palette->activateWindow();
+    m_queryEdit->setFocus();
+}
+
+void QuickOpenManager::addRecentFile(const QString &filePath)
+{
+    m_recentFiles.removeAll(filePath);
+    m_recentFiles.prepend(filePath);
+    while (m_recentFiles.size() > MAX_RECENT_FILES) {
+        m_recentFiles.removeLast();
+    }
+    m_saveTimer->start();
+}
+
+bool QuickOpenManager::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == m_queryEdit && event->type() == QEvent::KeyPress) {
+        const int key = static_cast<QKeyEvent*>(event)->key();
+        if (key == Qt::Key_Up || key == Qt::Key_Down || key == Qt::Key_PageUp || key == Qt::Key_PageDown) {
+            QCoreApplication::sendEvent(m_resultList, event);
+            return true;
+        }
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void QuickOpenManager::createPalette()
+{
+    if (m_palette) return;
+
+    m_palette = new QDialog(m_tabWidget);
+    m_palette->setWindowTitle(i18n("Quick Open"));
+
+    QVBoxLayout *layout = new QVBoxLayout(m_palette);
+    m_queryEdit = new QLineEdit;
+    m_queryEdit->setPlaceholderText(i18n("Type part of a file name or path"));
+    m_queryEdit->installEventFilter(this);
+    layout->addWidget(m_queryEdit);
+
+    m_resultList = new QListWidget;
+    m_resultList->setUniformItemSizes(true);
+    layout->addWidget(m_resultList, 1);
+
+    m_statusLabel = new QLabel;
+    layout->addWidget(m_statusLabel);
+
+    connect(m_queryEdit, &QLineEdit::textChanged, this, &QuickOpenManager::updateResults);
+    connect(m_queryEdit, &QLineEdit::returnPressed, this, &QuickOpenManager::openSelected);
+    connect(m_resultList, &QListWidget::itemActivated, this, &QuickOpenManager::openSelected);
+}
+
+QString QuickOpenManager::projectRoot() const
+{
+    QString folder;
+    QSplitter *splitter = qobject_cast<QSplitter*>(m_tabWidget->currentWidget());
+    QMdiArea *mdiArea = splitter ? qobject_cast<QMdiArea*>(splitter->widget(0)) : nullptr;
+    if (mdiArea && mdiArea->activeSubWindow()) {
+        const QString filePath = mdiArea->activeSubWindow()->property("fullFilePath").toString();
+        if (!filePath.isEmpty()) {
+            folder = QFileInfo(filePath).absolutePath();
+        }
+    }
+    if (folder.isEmpty()) {
+        return m_rootPath;
+    }
+
+    // Prefer the root of the checkout the document belongs to
+    for (QDir directory(folder);;) {
+        if (directory.exists(QStringLiteral(".git")) || directory.exists(QStringLiteral(".hg"))
+            || directory.exists(QStringLiteral(".svn"))) {
+            return directory.absolutePath();
+        }
+        if (!directory.cdUp()) break;
+    }
+    return folder;
+}
+
+void QuickOpenManager::crawl(const QString &rootPath)
+{
+    qCDebug(quickOpenLog) << "Crawling" << rootPath;
+
+    // Stop the tasks still crawling the previous folder
+    if (m_crawlCancelled) {
+        *m_crawlCancelled = true;
+    }
+    m_crawlCancelled = std::make_shared<std::atomic<bool>>(false);
+
+    m_rootPath = rootPath;
+    ++m_generation;
+    m_candidates.clear();
+    m_masks.clear();
+    m_indexByPath.clear();
+    m_indexesByFolder.clear();
+    m_crawledFolders.clear();
+    m_removedCount = 0;
+    const QStringList watched = m_watcher->directories();
+    if (!watched.isEmpty()) {
+        m_watcher->removePaths(watched);
+    }
+
+    // The root is listed on its own; each folder below it is crawled by its own task
+    m_pendingCrawls = 0;
+    crawlDirectory(rootPath, false);
+}
+
+void QuickOpenManager::crawlDirectory(const QString &directory, bool recursive)
+{
+    ++m_pendingCrawls;
+    const quint64 generation = m_generation;
+    const std::shared_ptr<std::atomic<bool>> cancelled = m_crawlCancelled;
+    QPointer<QuickOpenManager> self(this);
+
+    QThreadPool::globalInstance()->start([self, generation, cancelled, directory, recursive]() {
+        QList<Candidate> candidates;
+        QStringList directories{directory};
+        QStringList subdirectories;
+
+        auto post = [&](bool done) {
+            QMetaObject::invokeMethod(qApp, [self, generation, candidates, directories, subdirectories, done]() {
+                if (!self || generation != self->m_generation) return;
+                if (!*cancelled) {
+                    for (const QString &subdirectory : subdirectories) {
+                        self->crawlDirectory(subdirectory, true);
+                    }
+                }
+                if (done) {
+                    --self->m_pendingCrawls;
+                }
+                self->addCandidates(generation, candidates, directories);
+            }, Qt::QueuedConnection);
+            candidates.clear();
+            directories.clear();
+            subdirectories.clear();
+        };
+
+        QDirIterator it(directory, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Readable,
+                        recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+        while (it.hasNext() && !*cancelled) {
+            const QString path = it.next();
+            if (it.fileInfo().isDir()) {
+                (recursive ? directories : subdirectories).append(path);
+                continue;
+            }
+            candidates.append(Candidate{path, int(path.lastIndexOf(QLatin1Char('/')) + 1)});
+            if (candidates.size() >= CRAWL_BATCH_SIZE) {
+                post(false);
+            }
+        }
+        post(true);
+    });
+}
+
+void QuickOpenManager::addCandidates(quint64 generation, const QList<Candidate> &candidates, const QStringList &directories)
+{
+    if (generation != m_generation) return;
+
+    for (const Candidate &candidate : candidates) {
+        if (m_candidates.size() >= MAX_CANDIDATES) {
+            // Enough to choose from; the rest of the folder is not crawled
+            if (!*m_crawlCancelled) {
+                qCDebug(quickOpenLog) << "Stopped crawling" << m_rootPath << "at" << MAX_CANDIDATES << "files";
+                *m_crawlCancelled = true;
+            }
+            break;
+        }
+        if (m_indexByPath.contains(candidate.path)) continue;
+
+        m_indexByPath.insert(candidate.path, m_candidates.size());
+        m_indexesByFolder[folderOf(candidate.path, candidate.nameStart)].append(m_candidates.size());
+        m_candidates.append(candidate);
+        m_masks.push_back(characterMask(candidate.path));
+    }
+
+    QStringList watch;
+    for (const QString &directory : directories) {
+        m_crawledFolders.insert(directory);
+        if (m_crawledFolders.size() <= MAX_WATCHED_FOLDERS) {
+            watch.append(directory);
+        }
+    }
+    if (!watch.isEmpty()) {
+        const QStringList failed = m_watcher->addPaths(watch);
+        if (!failed.isEmpty()) {
+            qCDebug(quickOpenLog) << "Could not watch" << failed.size() << "folders";
+        }
+    }
+
+    if (m_palette && m_palette->isVisible()) {
+        updateResults();
+    }
+}
+
+void QuickOpenManager::directoryChanged(const QString &path)
+{
+    // Forget the files of this folder that are gone; a folder that is gone takes all its files
+    const QDir directory(path);
+    const QString prefix = path + QLatin1Char('/');
+    if (!directory.exists()) {
+        m_watcher->removePath(path);
+        for (auto it = m_indexesByFolder.begin(); it != m_indexesByFolder.end();) {
+            if (it.key() != path && !it.key().startsWith(prefix)) {
+                ++it;
+                continue;
+            }
+            for (qsizetype index : std::as_const(it.value())) {
+                removeCandidate(index);
+            }
+            it = m_indexesByFolder.erase(it);
+        }
+        for (auto it = m_crawledFolders.begin(); it != m_crawledFolders.end();) {
+            it = (*it == path || it->startsWith(prefix)) ? m_crawledFolders.erase(it) : std::next(it);
+        }
+    } else {
+        QSet<QString> present;
+        const QStringList entries = directory.entryList(QDir::Files | QDir::NoDotAndDotDot | QDir::Readable);
+        for (const QString &entry : entries) {
+            present.insert(directory.filePath(entry));
+        }
+
+        QList<qsizetype> kept;
+        for (qsizetype index : m_indexesByFolder.take(path)) {
+            if (present.contains(m_candidates.at(index).path)) {
+                kept.append(index);
+            } else {
+                removeCandidate(index);
+            }
+        }
+        if (!kept.isEmpty()) {
+            m_indexesByFolder.insert(path, kept);
+        }
+
+        // New files are added here, new folders are crawled
+        QList<Candidate> added;
+        for (const QString &filePath : std::as_const(present)) {
+            if (!m_indexByPath.contains(filePath)) {
+                added.append(Candidate{filePath, int(prefix.size())});
+            }
+        }
+        addCandidates(m_generation, added, QStringList());
+
+        const QStringList subdirectories = directory.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Readable);
+        for (const QString &subdirectory : subdirectories) {
+            const QString subdirectoryPath = directory.filePath(subdirectory);
+            if (!m_crawledFolders.contains(subdirectoryPath) && !*m_crawlCancelled) {
+                crawlDirectory(subdirectoryPath, true);
+            }
+        }
+    }
+
+    // Compact once most of the list is holes
+    if (m_removedCount > m_candidates.size() / 2) {
+        QList<Candidate> candidates;
+        candidates.reserve(m_candidates.size() - m_removedCount);
+        m_masks.clear();
+        m_indexByPath.clear();
+        m_indexesByFolder.clear();
+        for (const Candidate &candidate : std::as_const(m_candidates)) {
+            if (candidate.path.isEmpty()) continue;
+            m_indexByPath.insert(candidate.path, candidates.size());
+            m_indexesByFolder[folderOf(candidate.path, candidate.nameStart)].append(candidates.size());
+            candidates.append(candidate);
+            m_masks.push_back(characterMask(candidate.path));
+        }
+        m_candidates = std::move(candidates);
+        m_removedCount = 0;
+    }
+}
+
+void QuickOpenManager::removeCandidate(qsizetype index)
+{
+    Candidate &candidate = m_candidates[index];
+    m_indexByPath.remove(candidate.path);
+    candidate.path.clear();
+    m_masks[size_t(index)] = 0;
+    ++m_removedCount;
+}
+
+void QuickOpenManager::updateResults()
+{
+    if (!m_palette) return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const QString query = m_queryEdit->text().trimmed().toLower();
+    m_resultList->clear();
+
+    QStringList results;
+    if (query.isEmpty()) {
+        // Without a query, offer the recently used files
+        for (const QString &filePath : std::as_const(m_recentFiles)) {
+            if (results.size() >= MAX_RESULTS) break;
+            if (QFileInfo::exists(filePath)) {
+                results.append(filePath);
+            }
+        }
+    } else {
+        QHash<QString, int> recency;
+        for (int i = 0; i < m_recentFiles.size(); ++i) {
+            recency.insert(m_recentFiles.at(i), RECENCY_BONUS * (m_recentFiles.size() - i) / m_recentFiles.size());
+        }
+
+        struct Ranked
+        {
+            int score;
+            QString path;
+        };
+        std::vector<Ranked> ranked;
+        auto consider = [&](const QString &path, int nameStart) {
+            const int score = fuzzyScore(path, nameStart, query);
+            if (score >= 0) {
+                ranked.push_back(Ranked{score + recency.value(path), path});
+            }
+        };
+
+        // The mask test rejects most paths with a few instructions each and vectorizes well;
+        // only the survivors are scored
+        const quint64 queryMask = characterMask(query);
+        const quint64 *masks = m_masks.data();
+        const size_t count = m_masks.size();
+        for (size_t i = 0; i < count; ++i) {
+            if ((masks[i] & queryMask) == queryMask) {
+                const Candidate &candidate = m_candidates.at(qsizetype(i));
+                consider(candidate.path, candidate.nameStart);
+            }
+        }
+
+        // Recent files outside the project take part too
+        for (const QString &filePath : std::as_const(m_recentFiles)) {
+            if (!m_indexByPath.contains(filePath) && (characterMask(filePath) & queryMask) == queryMask) {
+                consider(filePath, int(filePath.lastIndexOf(QLatin1Char('/')) + 1));
+            }
+        }
+
+        const size_t shown = qMin<size_t>(ranked.size(), MAX_RESULTS);
+        std::partial_sort(ranked.begin(), ranked.begin() + shown, ranked.end(), [](const Ranked &a, const Ranked &b) {
+            return a.score != b.score ? a.score > b.score : a.path.size() < b.path.size();
+        });
+        for (size_t i = 0; i < shown; ++i) {
+            results.append(ranked[i].path);
+        }
+    }
+
+    const QString prefix = m_rootPath + QLatin1Char('/');
+    for (const QString &filePath : std::as_const(results)) {
+        QListWidgetItem *item = new QListWidgetItem(filePath.startsWith(prefix) ? filePath.mid(prefix.size()) : filePath);
+        item->setData(Qt::UserRole, filePath);
+        item->setToolTip(filePath);
+        m_resultList->addItem(item);
+    }
+    if (m_resultList->count() > 0) {
+        m_resultList->setCurrentRow(0);
+    }
+
+    const QString files = i18np("%1 file", "%1 files", m_candidates.size() - m_removedCount);
+    if (m_rootPath.isEmpty()) {
+        m_statusLabel->setText(i18n("No folder chosen, only recently used files are found"));
+    } else {
+        m_statusLabel->setText(m_pendingCrawls > 0 ? i18n("Indexing %1... %2", m_rootPath, files)
+                                                   : i18n("%1 in %2", files, m_rootPath));
+    }
+
+    qCDebug(quickOpenLog) << "Ranked" << m_candidates.size() << "files for" << query
+                          << "in" << timer.nsecsElapsed() / 1000 << "us";
+}
+
+void QuickOpenManager::openSelected()
+{
+    QListWidgetItem *item = m_resultList->currentItem();
+    if (!item) return;
+
+    const QString filePath = item->data(Qt::UserRole).toString();
+    m_palette->hide();
+    if (m_documentManager->openOrFocusFile(filePath)) {
+        addRecentFile(filePath);
+    }
+}
+
+void QuickOpenManager::loadRecentFiles()
+{
+    QSettings settings(QStringLiteral("erateth"), QStringLiteral("mudoedit"));
+    m_recentFiles = settings.value(QStringLiteral("quickOpenRecentFiles")).toStringList();
+}
+
+void QuickOpenManager::saveRecentFiles() const
+{
+    QSettings settings(QStringLiteral("erateth"), QStringLiteral("mudoedit"));
+    settings.setValue(QStringLiteral("quickOpenRecentFiles"), m_recentFiles);
+}
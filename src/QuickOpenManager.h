@@ -0,0 +1,124 @@
+#ifndef QUICKOPENMANAGER_H
+#define QUICKOPENMANAGER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringView>
+#include <QStringList>
+#include <QSet>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class QTabWidget;
+class QMdiArea;
+class QDialog;
+class QLineEdit;
+class QListWidget;
+class QLabel;
+class QFileSystemWatcher;
+class QTimer;
+class DocumentManager;
+
+// This class provides a quick-open palette that finds files below the current project
+// folder by fuzzy matching. The file list is crawled in parallel in the background, up to
+// a limit, and kept current from file system notifications
+class QuickOpenManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QuickOpenManager(QTabWidget *tabWidget, DocumentManager *documentManager, QObject *parent = nullptr);
+    ~QuickOpenManager() override;
+
+    // A file found by the crawler
+    struct Candidate
+    {
+        QString path;
+        int nameStart = 0;     // start of the file name in the path
+    };
+
+    // Bit mask of the characters in a text, used to skip paths that cannot match
+    static quint64 characterMask(QStringView text);
+
+    // Score how well a query matches a path as a subsequence, or -1 if it does not
+    static int fuzzyScore(QStringView path, int nameStart, QStringView query);
+
+public Q_SLOTS:
+    // Show the palette for the project of the active document
+    void showPalette();
+
+    // Remember a file as recently used
+    void addRecentFile(const QString &filePath);
+
+protected:
+    // Move through the results with the arrow keys while typing
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    // Create the palette on first use
+    void createPalette();
+
+    // Folder to search: the version control root above the active document, or its folder.
+    // Without a document it is the last folder searched, or empty
+    QString projectRoot() const;
+
+    // Start crawling a folder tree, replacing the current file list
+    void crawl(const QString &rootPath);
+
+    // Crawl one folder tree on the thread pool
+    void crawlDirectory(const QString &directory, bool recursive);
+
+    // Add crawled files and watch their folders (GUI thread)
+    void addCandidates(quint64 generation, const QList<Candidate> &candidates, const QStringList &directories);
+
+    // Update the file list after a change notification
+    void directoryChanged(const QString &path);
+
+    // Leave a hole in the file list that no query can match
+    void removeCandidate(qsizetype index);
+
+    // Rank the files for the text in the palette
+    void updateResults();
+
+    // Open the selected result
+    void openSelected();
+
+    // Load and save the recently used files; saving waits for a pause in file opening
+    void loadRecentFiles();
+    void saveRecentFiles() const;
+
+    QTabWidget *m_tabWidget;
+    DocumentManager *m_documentManager;
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_saveTimer;
+
+    QString m_rootPath;
+    quint64 m_generation;
+    int m_pendingCrawls;
+
+    // Set to stop the tasks of the current crawl
+    std::shared_ptr<std::atomic<bool>> m_crawlCancelled;
+
+    // The file list; the masks are kept apart so the prefilter is a tight loop over one array
+    QList<Candidate> m_candidates;
+    std::vector<quint64> m_masks;
+    QHash<QString, qsizetype> m_indexByPath;
+    qsizetype m_removedCount;
+
+    // The files of each folder, so a change notification only looks at that folder
+    QHash<QString, QList<qsizetype>> m_indexesByFolder;
+    QSet<QString> m_crawledFolders;
+
+    // Most recently used first
+    QStringList m_recentFiles;
+
+    QDialog *m_palette;
+    QLineEdit *m_queryEdit;
+    QListWidget *m_resultList;
+    QLabel *m_statusLabel;
+};
+
+#endif // QUICKOPENMANAGER_H
@@ -0,0 +1,62 @@
+#include "ReadOnlyFile.h"
+#include <QLoggingCategory>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+Q_LOGGING_CATEGORY(readOnlyFileLog, "mudoedit.readonlyfile")
+
+std::shared_ptr<ReadOnlyFile> ReadOnlyFile::open(const QString &filePath)
+{
+    std::shared_ptr<ReadOnlyFile> file(new ReadOnlyFile);
+    file->m_file.setFileName(filePath);
+    if (!file->m_file.open(QIODevice::ReadOnly)) {
+        qCWarning(readOnlyFileLog) << "Could not open" << filePath << file->m_file.errorString();
+        return nullptr;
+    }
+    file->m_size = file->m_file.size();
+    return file;
+}
+
+qint64 ReadOnlyFile::read(qint64 offset, char *data, qint64 length) const
+{
+    if (offset < 0 || length <= 0) return 0;
+
+#ifdef Q_OS_UNIX
+    // pread leaves the file position alone, so several threads can read at once
+    qint64 total = 0;
+    while (total < length) {
+        const ssize_t count = pread(m_file.handle(), data + total, size_t(length - total), off_t(offset + total));
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) break;
+        total += count;
+    }
+    return total;
+#else
+    QMutexLocker locker(&m_mutex);
+    if (!m_file.seek(offset)) return 0;
+    return qMax<qint64>(0, m_file.read(data, length));
+#endif
+}
+
+QByteArray ReadOnlyFile::read(qint64 offset, qint64 length) const
+{
+    QByteArray bytes(qMax<qint64>(0, length), Qt::Uninitialized);
+    bytes.truncate(read(offset, bytes.data(), bytes.size()));
+    return bytes;
+}
+
+bool ReadOnlyFile::isTruncated() const
+{
+#ifdef Q_OS_UNIX
+    // The open handle still refers to the same file after it is renamed or replaced
+    struct stat status;
+    return fstat(m_file.handle(), &status) == 0 && status.st_size < m_size;
+#else
+    QMutexLocker locker(&m_mutex);
+    return m_file.size() < m_size;
+#endif
+}
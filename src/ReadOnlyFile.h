@@ -0,0 +1,47 @@
+#ifndef READONLYFILE_H
+#define READONLYFILE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <memory>
+
+// This class reads parts of a file too large to load, from any thread. Views share it
+// with their jobs on the thread pool through a shared pointer, so the file stays open
+// until the last one is done. Reads copy the bytes out at an offset; a file that is
+// cut short meanwhile only makes them come back short, where a memory mapping of it
+// would crash the process on the first page past its new end
+class ReadOnlyFile
+{
+public:
+    // Open a file; nullptr if it cannot be opened
+    static std::shared_ptr<ReadOnlyFile> open(const QString &filePath);
+
+    // The size of the file when it was opened
+    qint64 size() const { return m_size; }
+    QString fileName() const { return m_file.fileName(); }
+
+    // Read up to length bytes at an offset; fewer at the end of the file or if it was cut short
+    qint64 read(qint64 offset, char *data, qint64 length) const;
+    QByteArray read(qint64 offset, qint64 length) const;
+
+    // Whether the file is shorter now than when it was opened
+    bool isTruncated() const;
+
+    // Ask the jobs reading the file to stop
+    void cancel() { m_cancelled = true; }
+    bool isCancelled() const { return m_cancelled; }
+
+private:
+    ReadOnlyFile() = default;
+
+    // Without positional reads, the position of the file is shared and has to be locked
+    mutable QFile m_file;
+    mutable QMutex m_mutex;
+    qint64 m_size = 0;
+    std::atomic<bool> m_cancelled{false};
+};
+
+#endif // READONLYFILE_H
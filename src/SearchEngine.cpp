@@ -0,0 +1,334 @@
+#include "SearchEngine.h"
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtAlgorithms>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MUDOEDIT_SEARCH_SSE2
+#endif
+
+namespace {
+
+// Unchanged characters between two matches that are still copied into one range of a
+// replace all, and the size from which a range is closed
+const qsizetype REPLACE_GAP_CHARACTERS = 4096;
+const qsizetype REPLACE_RANGE_CHARACTERS = 1 << 20;
+
+// Find a needle by comparing its first and last unit against a whole vector of
+// candidate positions at once; only positions where both match are verified
+template<typename Char>
+qsizetype findFirstLast(const Char *haystack, qsizetype size, const Char *needle, qsizetype needleSize, qsizetype from)
+{
+    if (needleSize == 0) {
+        return from <= size ? from : -1;
+    }
+    if (from < 0 || needleSize > size - from) {
+        return -1;
+    }
+
+    const Char first = needle[0];
+    const Char last = needle[needleSize - 1];
+    const qsizetype lastStart = size - needleSize;
+    const size_t middleBytes = needleSize > 2 ? size_t(needleSize - 2) * sizeof(Char) : 0;
+    qsizetype i = from;
+
+#ifdef MUDOEDIT_SEARCH_SSE2
+    constexpr qsizetype lanes = 16 / sizeof(Char);
+    const __m128i firstVector = sizeof(Char) == 1 ? _mm_set1_epi8(char(first)) : _mm_set1_epi16(short(first));
+    const __m128i lastVector = sizeof(Char) == 1 ? _mm_set1_epi8(char(last)) : _mm_set1_epi16(short(last));
+
+    for (; i + lanes - 1 <= lastStart; i += lanes) {
+        const __m128i firstBlock = _mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack + i));
+        const __m128i lastBlock = _mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack + i + needleSize - 1));
+        __m128i equal;
+        if constexpr (sizeof(Char) == 1) {
+            equal = _mm_and_si128(_mm_cmpeq_epi8(firstBlock, firstVector), _mm_cmpeq_epi8(lastBlock, lastVector));
+        } else {
+            equal = _mm_and_si128(_mm_cmpeq_epi16(firstBlock, firstVector), _mm_cmpeq_epi16(lastBlock, lastVector));
+        }
+
+        // movemask yields one bit per byte, so two bits per UTF-16 lane
+        uint mask = uint(_mm_movemask_epi8(equal));
+        while (mask) {
+            const uint bit = qCountTrailingZeroBits(mask);
+            const qsizetype position = i + bit / sizeof(Char);
+            if (std::memcmp(haystack + position + 1, needle + 1, middleBytes) == 0) {
+                return position;
+            }
+            mask &= ~((sizeof(Char) == 1 ? 1u : 3u) << bit);
+        }
+    }
+#endif
+
+    for (; i <= lastStart; ++i) {
+        if (haystack[i] == first && haystack[i + needleSize - 1] == last
+            && std::memcmp(haystack + i + 1, needle + 1, middleBytes) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Whether every character that folds to the same as an ASCII character is its upper or
+// lower case form; 'k' and 's' also fold from the Kelvin sign and the long s
+bool hasTwoCaseForms(char16_t c)
+{
+    return c < 0x80 && c != u'k' && c != u'K' && c != u's' && c != u'S';
+}
+
+// The case-insensitive counterpart of findFirstLast: candidates are positions whose first
+// and last unit equal either case of the needle's, and they are verified with a folded compare
+qsizetype findFirstLastFolded(QStringView haystack, QStringView needle, qsizetype from)
+{
+    const qsizetype size = haystack.size();
+    const qsizetype needleSize = needle.size();
+    if (from < 0 || needleSize > size - from) {
+        return -1;
+    }
+
+    const char16_t *data = haystack.utf16();
+    const char16_t firstLower = QChar::toLower(needle.front().unicode());
+    const char16_t firstUpper = QChar::toUpper(needle.front().unicode());
+    const char16_t lastLower = QChar::toLower(needle.back().unicode());
+    const char16_t lastUpper = QChar::toUpper(needle.back().unicode());
+    const qsizetype lastStart = size - needleSize;
+    const auto matchesAt = [&](qsizetype position) {
+        return haystack.sliced(position, needleSize).compare(needle, Qt::CaseInsensitive) == 0;
+    };
+    qsizetype i = from;
+
+#ifdef MUDOEDIT_SEARCH_SSE2
+    const __m128i firstLowerVector = _mm_set1_epi16(short(firstLower));
+    const __m128i firstUpperVector = _mm_set1_epi16(short(firstUpper));
+    const __m128i lastLowerVector = _mm_set1_epi16(short(lastLower));
+    const __m128i lastUpperVector = _mm_set1_epi16(short(lastUpper));
+
+    for (; i + 7 <= lastStart; i += 8) {
+        const __m128i firstBlock = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i lastBlock = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + needleSize - 1));
+        const __m128i firstEqual = _mm_or_si128(_mm_cmpeq_epi16(firstBlock, firstLowerVector),
+                                                _mm_cmpeq_epi16(firstBlock, firstUpperVector));
+        const __m128i lastEqual = _mm_or_si128(_mm_cmpeq_epi16(lastBlock, lastLowerVector),
+                                               _mm_cmpeq_epi16(lastBlock, lastUpperVector));
+
+        uint mask = uint(_mm_movemask_epi8(_mm_and_si128(firstEqual, lastEqual)));
+        while (mask) {
+            const uint bit = qCountTrailingZeroBits(mask);
+            const qsizetype position = i + bit / 2;
+            if (matchesAt(position)) {
+                return position;
+            }
+            mask &= ~(3u << bit);
+        }
+    }
+#endif
+
+    for (; i <= lastStart; ++i) {
+        const char16_t first = data[i];
+        const char16_t last = data[i + needleSize - 1];
+        if ((first == firstLower || first == firstUpper) && (last == lastLower || last == lastUpper) && matchesAt(i)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool isWordCharacter(QChar c)
+{
+    return c.isLetterOrNumber() || c == QLatin1Char('_');
+}
+
+// Cache of compiled expressions, shared by the GUI and worker threads
+constexpr int REGEX_CACHE_SIZE = 32;
+QMutex regexCacheMutex;
+QHash<QString, QRegularExpression> regexCache;
+
+}
+
+qsizetype SearchEngine::findLiteral(QStringView haystack, QStringView needle, qsizetype from, Qt::CaseSensitivity caseSensitivity)
+{
+    if (caseSensitivity == Qt::CaseInsensitive) {
+        // The vector filter needs ends whose case forms are exactly two known units
+        if (needle.isEmpty() || !hasTwoCaseForms(needle.front().unicode()) || !hasTwoCaseForms(needle.back().unicode())) {
+            return haystack.indexOf(needle, from, Qt::CaseInsensitive);
+        }
+        return findFirstLastFolded(haystack, needle, from);
+    }
+    return findFirstLast(haystack.utf16(), haystack.size(), needle.utf16(), needle.size(), from);
+}
+
+qsizetype SearchEngine::findBytes(QByteArrayView haystack, QByteArrayView needle, qsizetype from)
+{
+    return findFirstLast(haystack.data(), haystack.size(), needle.data(), needle.size(), from);
+}
+
+QRegularExpression SearchEngine::regularExpression(const QString &pattern, const SearchOptions &options)
+{
+    QString source = options.regularExpression ? pattern : QRegularExpression::escape(pattern);
+    if (options.wholeWords) {
+        source = QLatin1String("\\b(?:") + source + QLatin1String(")\\b");
+    }
+
+    QRegularExpression::PatternOptions patternOptions = QRegularExpression::UseUnicodePropertiesOption;
+    if (options.caseSensitivity == Qt::CaseInsensitive) {
+        patternOptions |= QRegularExpression::CaseInsensitiveOption;
+    }
+
+    const QString key = QString::number(int(patternOptions)) + QLatin1Char(':') + source;
+    QMutexLocker locker(&regexCacheMutex);
+    auto it = regexCache.constFind(key);
+    if (it != regexCache.constEnd()) {
+        return it.value();
+    }
+
+    QRegularExpression regex(source, patternOptions);
+    // Compile (and JIT) now instead of on the first match
+    regex.optimize();
+    if (regexCache.size() >= REGEX_CACHE_SIZE) {
+        regexCache.clear();
+    }
+    regexCache.insert(key, regex);
+    return regex;
+}
+
+SearchMatch SearchEngine::find(QStringView text, const QString &pattern, const SearchOptions &options,
+                               qsizetype from, bool backward)
+{
+    if (pattern.isEmpty()) return SearchMatch();
+
+    if (options.regularExpression || (options.wholeWords && backward)) {
+        const QRegularExpression regex = regularExpression(pattern, options);
+        if (!regex.isValid()) return SearchMatch();
+
+        if (!backward) {
+            QRegularExpressionMatchIterator it = regex.globalMatch(text, from);
+            while (it.hasNext()) {
+                const QRegularExpressionMatch match = it.next();
+                if (match.capturedLength() > 0) {
+                    return SearchMatch{match.capturedStart(), match.capturedLength()};
+                }
+            }
+            return SearchMatch();
+        }
+
+        // Regular expressions only run forwards; keep the last match ending before the position
+        SearchMatch last;
+        forEachMatch(text, pattern, options, [&last, from](const SearchMatch &match) {
+            if (match.end() > from) return false;
+            last = match;
+            return true;
+        });
+        return last;
+    }
+
+    if (backward) {
+        const qsizetype start = from - pattern.size();
+        if (start < 0) return SearchMatch();
+        const qsizetype position = text.lastIndexOf(QStringView(pattern), start, options.caseSensitivity);
+        return position >= 0 ? SearchMatch{position, pattern.size()} : SearchMatch();
+    }
+
+    qsizetype position = from;
+    while ((position = findLiteral(text, pattern, position, options.caseSensitivity)) >= 0) {
+        if (!options.wholeWords || isWholeWord(text, position, pattern.size())) {
+            return SearchMatch{position, pattern.size()};
+        }
+        ++position;
+    }
+    return SearchMatch();
+}
+
+qsizetype SearchEngine::countMatches(QStringView text, const QString &pattern, const SearchOptions &options)
+{
+    qsizetype count = 0;
+    forEachMatch(text, pattern, options, [&count](const SearchMatch &) {
+        ++count;
+        return true;
+    });
+    return count;
+}
+
+ReplaceResult SearchEngine::replaceAll(QStringView text, const QString &pattern, const SearchOptions &options,
+                                       const QString &replacement)
+{
+    ReplaceResult result;
+    auto append = [&](qsizetype start, qsizetype end, QStringView replacementText) {
+        // A match far from the last one, or a range grown large, starts a new range
+        if (result.ranges.empty() || start - result.ranges.back().end > REPLACE_GAP_CHARACTERS
+            || result.ranges.back().text.size() >= REPLACE_RANGE_CHARACTERS) {
+            result.ranges.push_back({start, start, QString()});
+        }
+        ReplacedRange &range = result.ranges.back();
+        range.text.append(text.sliced(range.end, start - range.end));
+        range.text.append(replacementText);
+        range.end = end;
+        ++result.count;
+    };
+
+    if (options.regularExpression) {
+        // Captures can differ per match, so expand the replacement each time
+        const QRegularExpression regex = regularExpression(pattern, options);
+        QRegularExpressionMatchIterator it = regex.globalMatch(text);
+        while (it.hasNext()) {
+            const QRegularExpressionMatch match = it.next();
+            if (match.capturedLength() == 0) continue;
+            append(match.capturedStart(), match.capturedEnd(), expandReplacement(match, replacement));
+        }
+    } else {
+        forEachMatch(text, pattern, options, [&](const SearchMatch &match) {
+            append(match.start, match.end(), replacement);
+            return true;
+        });
+    }
+
+    return result;
+}
+
+QString SearchEngine::expandReplacement(const QRegularExpressionMatch &match, const QString &replacement)
+{
+    if (!replacement.contains(QLatin1Char('\\'))) {
+        return replacement;
+    }
+
+    QString result;
+    result.reserve(replacement.size());
+    for (qsizetype i = 0; i < replacement.size(); ++i) {
+        const QChar c = replacement.at(i);
+        if (c == QLatin1Char('\\') && i + 1 < replacement.size()) {
+            const QChar next = replacement.at(i + 1);
+            if (next.isDigit()) {
+                result += match.captured(next.digitValue());
+                ++i;
+                continue;
+            }
+            if (next == QLatin1Char('\\')) {
+                result += next;
+                ++i;
+                continue;
+            }
+            if (next == QLatin1Char('n')) {
+                result += QLatin1Char('\n');
+                ++i;
+                continue;
+            }
+            if (next == QLatin1Char('t')) {
+                result += QLatin1Char('\t');
+                ++i;
+                continue;
+            }
+        }
+        result += c;
+    }
+    return result;
+}
+
+bool SearchEngine::isWholeWord(QStringView text, qsizetype start, qsizetype length)
+{
+    const bool startsWord = start == 0 || !isWordCharacter(text.at(start - 1));
+    const bool endsWord = start + length >= text.size() || !isWordCharacter(text.at(start + length));
+    return startsWord && endsWord;
+}
@@ -0,0 +1,113 @@
+#ifndef SEARCHENGINE_H
+#define SEARCHENGINE_H
+
+#include <QString>
+#include <QStringView>
+#include <QByteArrayView>
+#include <QRegularExpression>
+#include <vector>
+
+// Options shared by every kind of search in the editor
+struct SearchOptions
+{
+    Qt::CaseSensitivity caseSensitivity = Qt::CaseInsensitive;
+    bool regularExpression = false;
+    bool wholeWords = false;
+};
+
+// A match inside a searched text
+struct SearchMatch
+{
+    qsizetype start = -1;
+    qsizetype length = 0;
+
+    bool isValid() const { return start >= 0; }
+    qsizetype end() const { return start + length; }
+};
+
+// A stretch of a text that changes, with its new text
+struct ReplacedRange
+{
+    qsizetype start = 0;    // start of the first match of the stretch in the original text
+    qsizetype end = 0;      // end of its last match
+    QString text;           // replacement for the text between start and end
+};
+
+// Result of replacing every match in a text. Matches close together share a range;
+// the unchanged text between matches far apart is not copied. With matches all over
+// the text, the ranges together approach its size
+struct ReplaceResult
+{
+    std::vector<ReplacedRange> ranges;
+    qsizetype count = 0;
+
+    bool isEmpty() const { return count == 0; }
+};
+
+// This class implements the text search primitives used by find/replace and related tools.
+// Literal searches scan the raw buffer with SIMD where available, regular expressions are
+// JIT-compiled once and cached
+class SearchEngine
+{
+public:
+    // Find a literal in UTF-16 text, returns -1 if there is none
+    static qsizetype findLiteral(QStringView haystack, QStringView needle, qsizetype from = 0,
+                                 Qt::CaseSensitivity caseSensitivity = Qt::CaseSensitive);
+
+    // Find a byte sequence in a raw buffer such as a memory-mapped file, returns -1 if there is none
+    static qsizetype findBytes(QByteArrayView haystack, QByteArrayView needle, qsizetype from = 0);
+
+    // Get the compiled regular expression for a pattern; literal patterns are escaped
+    static QRegularExpression regularExpression(const QString &pattern, const SearchOptions &options);
+
+    // Find the next (or previous) match of a pattern starting at a position
+    static SearchMatch find(QStringView text, const QString &pattern, const SearchOptions &options,
+                            qsizetype from, bool backward = false);
+
+    // Count all matches of a pattern
+    static qsizetype countMatches(QStringView text, const QString &pattern, const SearchOptions &options);
+
+    // Call a function for every match of a pattern in order; stop early when it returns false
+    template<typename Callback>
+    static void forEachMatch(QStringView text, const QString &pattern, const SearchOptions &options, Callback callback);
+
+    // Replace every match in one pass, building only the ranges that change
+    static ReplaceResult replaceAll(QStringView text, const QString &pattern, const SearchOptions &options,
+                                    const QString &replacement);
+
+    // Build the replacement text of a regular expression match, expanding \0 to \9
+    static QString expandReplacement(const QRegularExpressionMatch &match, const QString &replacement);
+
+private:
+    // Whether a match is delimited by non-word characters
+    static bool isWholeWord(QStringView text, qsizetype start, qsizetype length);
+};
+
+template<typename Callback>
+void SearchEngine::forEachMatch(QStringView text, const QString &pattern, const SearchOptions &options, Callback callback)
+{
+    if (pattern.isEmpty()) return;
+
+    if (options.regularExpression) {
+        const QRegularExpression regex = regularExpression(pattern, options);
+        QRegularExpressionMatchIterator it = regex.globalMatch(text);
+        while (it.hasNext()) {
+            const QRegularExpressionMatch match = it.next();
+            if (match.capturedLength() == 0) continue;
+            if (!callback(SearchMatch{match.capturedStart(), match.capturedLength()})) return;
+        }
+        return;
+    }
+
+    qsizetype position = 0;
+    while ((position = findLiteral(text, pattern, position, options.caseSensitivity)) >= 0) {
+        if (!options.wholeWords || isWholeWord(text, position, pattern.size())) {
+            if (!callback(SearchMatch{position, pattern.size()})) return;
+            position += pattern.size();
+        } else {
+            ++position;
+        }
+    }
+}
+
+#endif // SEARCHENGINE_H
@@ -0,0 +1,65 @@
+#include "SearchResultModel.h"
+
+SearchResultModel::SearchResultModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int SearchResultModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_hits.size();
+}
+
+QVariant SearchResultModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_hits.size()) {
+        return QVariant();
+    }
+
+    const FileSearchHit &hit = m_hits.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole: {
+        // Files inside the searched folder are shown relative to it
+        QString path = hit.filePath;
+        if (!m_rootPath.isEmpty() && path.startsWith(m_rootPath + QLatin1Char('/'))) {
+            path = path.mid(m_rootPath.size() + 1);
+        }
+        return QStringLiteral("%1:%2: %3").arg(path).arg(hit.line).arg(hit.lineText.trimmed());
+    }
+    case Qt::ToolTipRole:
+        return hit.filePath;
+    case FilePathRole:
+        return hit.filePath;
+    case LineRole:
+        return hit.line;
+    case ColumnRole:
+        return hit.column;
+    case LengthRole:
+        return hit.length;
+    default:
+        return QVariant();
+    }
+}
+
+void SearchResultModel::appendHits(const QList<FileSearchHit> &hits)
+{
+    if (hits.isEmpty()) return;
+
+    beginInsertRows(QModelIndex(), m_hits.size(), m_hits.size() + hits.size() - 1);
+    m_hits.append(hits);
+    endInsertRows();
+}
+
+void SearchResultModel::clear()
+{
+    beginResetModel();
+    m_hits.clear();
+    endResetModel();
+}
+
+void SearchResultModel::setRootPath(const QString &rootPath)
+{
+    beginResetModel();
+    m_rootPath = rootPath;
+    endResetModel();
+}
@@ -0,0 +1,55 @@
+#ifndef SEARCHRESULTMODEL_H
+#define SEARCHRESULTMODEL_H
+
+#include <QAbstractListModel>
+#include <QList>
+#include <QString>
+
+// A single line matching a search in some file
+struct FileSearchHit
+{
+    QString filePath;
+    int line = 0;        // 1-based line number
+    int column = 0;      // 0-based UTF-16 column of the match
+    int length = 0;      // UTF-16 length of the match
+    QString lineText;
+};
+
+// This class holds search hits for display in a list view. Hits are appended in
+// batches as worker threads deliver them, and only visible rows are ever rendered
+class SearchResultModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    // Extra roles exposing the parts of a hit
+    enum Roles {
+        FilePathRole = Qt::UserRole + 1,
+        LineRole,
+        ColumnRole,
+        LengthRole
+    };
+
+    explicit SearchResultModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    // Append a batch of hits
+    void appendHits(const QList<FileSearchHit> &hits);
+
+    // Remove all hits
+    void clear();
+
+    // Directory that displayed paths are shown relative to
+    void setRootPath(const QString &rootPath);
+
+    // Get a hit by row
+    const FileSearchHit& hit(int row) const { return m_hits.at(row); }
+
+private:
+    QList<FileSearchHit> m_hits;
+    QString m_rootPath;
+};
+
+#endif // SEARCHRESULTMODEL_H
@@ -1,5 +1,6 @@
 #include "SettingsManagement.h"
-#include "SyntaxHighlighter.h"
+#include "DeferredLayout.h"
+#include "ZoomManager.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLabel>
@@ -19,7 +20,8 @@
 SettingsManagement::SettingsManagement(QTabWidget *tabWidget, QSettings *settings, QObject *parent)
     : QObject(parent), m_tabWidget(tabWidget), m_settings(settings),
       m_currentFont(QFont()), m_spellCheckEnabled(true), m_syntaxHighlightingEnabled(true),
-      m_tabBarVisible(true)
+      m_tabBarVisible(true), m_outlineVisible(true), m_memoryBudget(DEFAULT_MEMORY_BUDGET),
+      m_hugeFileThreshold(DEFAULT_HUGE_FILE_THRESHOLD), m_trimTrailingWhitespace(false), m_ensureFinalNewline(false)
 {
     loadSettings();
 }
@@ -33,6 +35,11 @@ void SettingsManagement::loadSettings()
     m_spellCheckEnabled = m_settings->value(QStringLiteral("spellCheckEnabled"), true).toBool();
     m_syntaxHighlightingEnabled = m_settings->value(QStringLiteral("syntaxHighlightingEnabled"), true).toBool();
     m_tabBarVisible = m_settings->value(QStringLiteral("tabBarVisible"), true).toBool();
+    m_outlineVisible = m_settings->value(QStringLiteral("outlineVisible"), true).toBool();
+    m_memoryBudget = m_settings->value(QStringLiteral("memoryBudgetMB"), DEFAULT_MEMORY_BUDGET).toInt();
+    m_hugeFileThreshold = m_settings->value(QStringLiteral("hugeFileThresholdMB"), DEFAULT_HUGE_FILE_THRESHOLD).toInt();
+    m_trimTrailingWhitespace = m_settings->value(QStringLiteral("trimTrailingWhitespace"), false).toBool();
+    m_ensureFinalNewline = m_settings->value(QStringLiteral("ensureFinalNewline"), false).toBool();
 }
 
 void SettingsManagement::saveSettings()
@@ -42,6 +49,11 @@ void SettingsManagement::saveSettings()
     m_settings->setValue(QStringLiteral("spellCheckEnabled"), m_spellCheckEnabled);
     m_settings->setValue(QStringLiteral("syntaxHighlightingEnabled"), m_syntaxHighlightingEnabled);
     m_settings->setValue(QStringLiteral("tabBarVisible"), m_tabBarVisible);
+    m_settings->setValue(QStringLiteral("outlineVisible"), m_outlineVisible);
+    m_settings->setValue(QStringLiteral("memoryBudgetMB"), m_memoryBudget);
+    m_settings->setValue(QStringLiteral("hugeFileThresholdMB"), m_hugeFileThreshold);
+    m_settings->setValue(QStringLiteral("trimTrailingWhitespace"), m_trimTrailingWhitespace);
+    m_settings->setValue(QStringLiteral("ensureFinalNewline"), m_ensureFinalNewline);
 }
 
 void SettingsManagement::applySettings()
@@ -55,19 +67,11 @@ void SettingsManagement::applySettings()
 
         for (QMdiSubWindow *window : mdiArea->subWindowList()) {
             if (KTextEdit *textEdit = qobject_cast<KTextEdit*>(window->widget())) {
-                textEdit->setFont(m_currentFont);
-                textEdit->setCheckSpellingEnabled(m_spellCheckEnabled);
-
-                if (m_syntaxHighlightingEnabled) {
-                    if (textEdit->findChild<SyntaxHighlighter*>()) {
-                        delete textEdit->findChild<SyntaxHighlighter*>();
-                    }
-                    new SyntaxHighlighter(textEdit->document());
-                } else {
-                    if (SyntaxHighlighter *highlighter = textEdit->findChild<SyntaxHighlighter*>()) {
-                        delete highlighter;
-                    }
-                }
+                // Editors the user cannot see pick up the changes when they are shown
+                DeferredLayout *deferredLayout = DeferredLayout::forEditor(textEdit);
+                deferredLayout->setSpellCheckingEnabled(m_spellCheckEnabled);
+                deferredLayout->setSyntaxHighlightingEnabled(m_syntaxHighlightingEnabled);
+                deferredLayout->setFont(ZoomManager::zoomedFont(m_currentFont, ZoomManager::zoomLevel(textEdit)));
             }
         }
     }
@@ -111,19 +115,55 @@ void SettingsManagement::showSettingsDialog()
     m_tabBarVisibilityCheckBox = new QCheckBox(tr("Show Tab Bar"));
     m_tabBarVisibilityCheckBox->setChecked(m_tabBarVisible);
 
+    // Cleanup done while saving; the documents themselves are left as they are
+    QCheckBox *trimTrailingWhitespaceBox = new QCheckBox(tr("Remove Trailing Whitespace on Save"));
+    trimTrailingWhitespaceBox->setChecked(m_trimTrailingWhitespace);
+
+    QCheckBox *ensureFinalNewlineBox = new QCheckBox(tr("End Files with a Newline on Save"));
+    ensureFinalNewlineBox->setChecked(m_ensureFinalNewline);
+
+    // Memory budget for open documents
+    QHBoxLayout *memoryBudgetLayout = new QHBoxLayout;
+    QLabel *memoryBudgetLabel = new QLabel(tr("Memory budget for documents:"));
+    m_memoryBudgetSpinBox = new QSpinBox;
+    m_memoryBudgetSpinBox->setRange(0, 65536);
+    m_memoryBudgetSpinBox->setSingleStep(64);
+    m_memoryBudgetSpinBox->setSuffix(tr(" MB"));
+    m_memoryBudgetSpinBox->setSpecialValueText(tr("Unlimited"));
+    m_memoryBudgetSpinBox->setValue(m_memoryBudget);
+    memoryBudgetLayout->addWidget(memoryBudgetLabel);
+    memoryBudgetLayout->addWidget(m_memoryBudgetSpinBox);
+
+    // Size from which files open in the read-only viewer
+    QHBoxLayout *hugeFileThresholdLayout = new QHBoxLayout;
+    QLabel *hugeFileThresholdLabel = new QLabel(tr("Open read-only from file size:"));
+    m_hugeFileThresholdSpinBox = new QSpinBox;
+    m_hugeFileThresholdSpinBox->setRange(0, 1048576);
+    m_hugeFileThresholdSpinBox->setSingleStep(64);
+    m_hugeFileThresholdSpinBox->setSuffix(tr(" MB"));
+    m_hugeFileThresholdSpinBox->setSpecialValueText(tr("Never"));
+    m_hugeFileThresholdSpinBox->setValue(m_hugeFileThreshold);
+    hugeFileThresholdLayout->addWidget(hugeFileThresholdLabel);
+    hugeFileThresholdLayout->addWidget(m_hugeFileThresholdSpinBox);
+
     // OK and Cancel buttons
     QHBoxLayout *buttonLayout = new QHBoxLayout;
     QPushButton *okButton = new QPushButton(tr("OK"));
     QPushButton *cancelButton = new QPushButton(tr("Cancel"));
     
-    connect(okButton, &QPushButton::clicked, this, [this, spellCheckBox]() {
+    connect(okButton, &QPushButton::clicked, this, [this, spellCheckBox, trimTrailingWhitespaceBox, ensureFinalNewlineBox]() {
         m_currentFont = m_fontComboBox->currentFont();
         m_currentFont.setPointSize(m_fontSizeSpinBox->value());
         m_spellCheckEnabled = spellCheckBox->isChecked();
         m_syntaxHighlightingEnabled = m_syntaxHighlightingCheckBox->isChecked();
         m_tabBarVisible = m_tabBarVisibilityCheckBox->isChecked();
+        m_memoryBudget = m_memoryBudgetSpinBox->value();
+        m_hugeFileThreshold = m_hugeFileThresholdSpinBox->value();
+        m_trimTrailingWhitespace = trimTrailingWhitespaceBox->isChecked();
+        m_ensureFinalNewline = ensureFinalNewlineBox->isChecked();
         saveSettings();
         applySettings();
+        Q_EMIT settingsChanged();
         m_dialog->accept();
     });
     
@@ -136,6 +176,10 @@ void SettingsManagement::showSettingsDialog()
     mainLayout->addWidget(spellCheckBox);
     mainLayout->addWidget(m_syntaxHighlightingCheckBox);
     mainLayout->addWidget(m_tabBarVisibilityCheckBox);
+    mainLayout->addWidget(trimTrailingWhitespaceBox);
+    mainLayout->addWidget(ensureFinalNewlineBox);
+    mainLayout->addLayout(memoryBudgetLayout);
+    mainLayout->addLayout(hugeFileThresholdLayout);
     mainLayout->addLayout(buttonLayout);
     
     m_dialog->exec();
@@ -32,6 +32,23 @@ public:
     bool isTabBarVisible() const { return m_tabBarVisible; }
     void setTabBarVisible(bool visible) { m_tabBarVisible = visible; }
 
+    bool isOutlineVisible() const { return m_outlineVisible; }
+    void setOutlineVisible(bool visible) { m_outlineVisible = visible; }
+
+    // Memory budget for open documents in megabytes, 0 means unlimited
+    int memoryBudget() const { return m_memoryBudget; }
+    void setMemoryBudget(int megabytes) { m_memoryBudget = megabytes; }
+
+    // Files from this size in megabytes on open in the read-only viewer, 0 means never
+    int hugeFileThreshold() const { return m_hugeFileThreshold; }
+    void setHugeFileThreshold(int megabytes) { m_hugeFileThreshold = megabytes; }
+
+    // Whitespace cleanup done to lines as files are saved
+    bool trimTrailingWhitespace() const { return m_trimTrailingWhitespace; }
+    void setTrimTrailingWhitespace(bool enabled) { m_trimTrailingWhitespace = enabled; }
+    bool ensureFinalNewline() const { return m_ensureFinalNewline; }
+    void setEnsureFinalNewline(bool enabled) { m_ensureFinalNewline = enabled; }
+
 Q_SIGNALS:
     void settingsChanged();
 
@@ -43,12 +60,25 @@ private:
     bool m_syntaxHighlightingEnabled;
 
     bool m_tabBarVisible;
+    bool m_outlineVisible;
+    int m_memoryBudget;
+    int m_hugeFileThreshold;
+    bool m_trimTrailingWhitespace;
+    bool m_ensureFinalNewline;
 
     QDialog *m_dialog;
     QFontComboBox *m_fontComboBox;
     QSpinBox *m_fontSizeSpinBox;
     QCheckBox *m_syntaxHighlightingCheckBox;
     QCheckBox *m_tabBarVisibilityCheckBox;
+    QSpinBox *m_memoryBudgetSpinBox;
+    QSpinBox *m_hugeFileThresholdSpinBox;
+
+    // Default memory budget for open documents in megabytes
+    static const int DEFAULT_MEMORY_BUDGET = 1024;
+
+    // Default size in megabytes from which files open in the read-only viewer
+    static const int DEFAULT_HUGE_FILE_THRESHOLD = 256;
 };
 
 #endif // SETTINGSMANAGEMENT_H
\ No newline at end of file
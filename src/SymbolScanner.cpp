@@ -0,0 +1,169 @@
+#include "SymbolScanner.h"
+#include "Tokenizer.h"
+#include <QVarLengthArray>
+
+namespace {
+
+// Words that introduce a type or namespace name
+const QLatin1String CLASS_KEYWORDS[] = {
+    QLatin1String("class"), QLatin1String("struct"), QLatin1String("union"), QLatin1String("enum"),
+    QLatin1String("namespace"), QLatin1String("interface")
+};
+
+// Words that introduce a function name in scripting languages
+const QLatin1String FUNCTION_KEYWORDS[] = {
+    QLatin1String("def"), QLatin1String("function"), QLatin1String("func"), QLatin1String("fn"), QLatin1String("sub")
+};
+
+// Words followed by a parenthesis that do not define a function
+const QLatin1String STATEMENT_KEYWORDS[] = {
+    QLatin1String("if"), QLatin1String("else"), QLatin1String("for"), QLatin1String("foreach"),
+    QLatin1String("while"), QLatin1String("do"), QLatin1String("switch"), QLatin1String("case"),
+    QLatin1String("return"), QLatin1String("catch"), QLatin1String("throw"), QLatin1String("new"),
+    QLatin1String("delete"), QLatin1String("sizeof"), QLatin1String("alignof"), QLatin1String("decltype"),
+    QLatin1String("typeof"), QLatin1String("static_assert"), QLatin1String("defined"), QLatin1String("emit"),
+    QLatin1String("using"), QLatin1String("typedef"), QLatin1String("goto"), QLatin1String("await"),
+    QLatin1String("co_await"), QLatin1String("co_return")
+};
+
+template<size_t N>
+bool isOneOf(QStringView word, const QLatin1String (&keywords)[N])
+{
+    for (const QLatin1String &keyword : keywords) {
+        if (word == keyword) return true;
+    }
+    return false;
+}
+
+// Upper case names such as Q_OBJECT or EXPORT_API are macros
+bool isMacroName(QStringView word)
+{
+    if (word.size() < 2) return false;
+    for (const QChar c : word) {
+        if (c.isLower()) return false;
+    }
+    return true;
+}
+
+// Characters allowed before a function name: a return type and qualifiers
+bool isTypeCharacter(QChar c)
+{
+    return Tokenizer::isWordCharacter(c) || c.isSpace() || c == QLatin1Char('*') || c == QLatin1Char('&')
+        || c == QLatin1Char(':') || c == QLatin1Char('<') || c == QLatin1Char('>') || c == QLatin1Char(',')
+        || c == QLatin1Char('[') || c == QLatin1Char(']');
+}
+
+} // namespace
+
+QList<SymbolScanner::Symbol> SymbolScanner::scanLine(QStringView line)
+{
+    QList<Symbol> symbols;
+
+    // Ignore trailing comments, comment lines and preprocessor lines
+    const qsizetype comment = line.indexOf(u"//");
+    const QStringView code = comment >= 0 ? line.left(comment) : line;
+    const QStringView trimmed = code.trimmed();
+    if (trimmed.isEmpty() || trimmed.startsWith(u"/*") || trimmed.startsWith(u'*') || trimmed.startsWith(u'#')) {
+        return symbols;
+    }
+
+    struct Word
+    {
+        qsizetype start;
+        qsizetype length;
+    };
+    QVarLengthArray<Word, 32> words;
+    Tokenizer::forEachWord(code, [&words](qsizetype start, qsizetype length) {
+        words.append(Word{start, length});
+    });
+    const auto wordAt = [&](qsizetype i) { return code.mid(words[i].start, words[i].length); };
+
+    // A keyword directly followed by a name
+    for (qsizetype i = 0; i + 1 < words.size(); ++i) {
+        const QStringView keyword = wordAt(i);
+        const bool classKeyword = isOneOf(keyword, CLASS_KEYWORDS);
+        if (!classKeyword && !isOneOf(keyword, FUNCTION_KEYWORDS)) continue;
+
+        // Skip export macros and the "class" of "enum class"
+        qsizetype next = i + 1;
+        while (classKeyword && next + 1 < words.size() && (isMacroName(wordAt(next)) || isOneOf(wordAt(next), CLASS_KEYWORDS))) {
+            ++next;
+        }
+        const qsizetype keywordEnd = words[i].start + words[i].length;
+        const qsizetype nameStart = words[next].start;
+        const qsizetype nameEnd = nameStart + words[next].length;
+        bool adjacent = true;
+        for (qsizetype p = keywordEnd; p < nameStart; ++p) {
+            if (!code[p].isSpace() && !Tokenizer::isWordCharacter(code[p])) {
+                adjacent = false;
+                break;
+            }
+        }
+        if (!adjacent) continue;
+
+        const QStringView rest = code.mid(nameEnd).trimmed();
+        if (classKeyword) {
+            // "template <class T>" names a parameter, "class Foo;" only declares one
+            if (rest.startsWith(u'>') || rest.startsWith(u',') || rest.startsWith(u'=') || rest.startsWith(u')')) continue;
+            if (trimmed.endsWith(u';') && !trimmed.contains(u'{')) continue;
+            symbols.append(Symbol{code.mid(nameStart, nameEnd - nameStart).toString(), Kind::Class, 0, int(nameStart)});
+        } else if (rest.startsWith(u'(')) {
+            symbols.append(Symbol{code.mid(nameStart, nameEnd - nameStart).toString(), Kind::Function, 0, int(nameStart)});
+        }
+        return symbols;
+    }
+
+    // A C-like definition: a return type, a possibly qualified name and a parameter list
+    const qsizetype paren = code.indexOf(u'(');
+    if (paren <= 0) return symbols;
+
+    qsizetype nameEnd = paren;
+    while (nameEnd > 0 && code[nameEnd - 1].isSpace()) {
+        --nameEnd;
+    }
+    if (nameEnd == 0 || !Tokenizer::isWordCharacter(code[nameEnd - 1])) return symbols;
+    const qsizetype nameStart = Tokenizer::wordStart(code, nameEnd);
+    if (nameStart == nameEnd) return symbols;
+    const QStringView baseName = code.mid(nameStart, nameEnd - nameStart);
+    if (isOneOf(baseName, STATEMENT_KEYWORDS) || isMacroName(baseName)) return symbols;
+
+    // Include the qualification, e.g. "MainWindow::setupUi" or "Parser::~Parser"
+    qsizetype qualifiedStart = nameStart;
+    bool destructor = false;
+    if (qualifiedStart > 0 && code[qualifiedStart - 1] == QLatin1Char('~')) {
+        --qualifiedStart;
+        destructor = true;
+    }
+    QStringView lastQualifier;
+    while (qualifiedStart >= 2 && code[qualifiedStart - 1] == QLatin1Char(':') && code[qualifiedStart - 2] == QLatin1Char(':')) {
+        const qsizetype qualifierEnd = qualifiedStart - 2;
+        const qsizetype qualifierStart = Tokenizer::wordStart(code, qualifierEnd);
+        if (qualifierStart == qualifierEnd) break;
+        if (lastQualifier.isEmpty()) {
+            lastQualifier = code.mid(qualifierStart, qualifierEnd - qualifierStart);
+        }
+        qualifiedStart = qualifierStart;
+    }
+
+    // Whatever precedes the name must look like a return type, which rules out
+    // assignments, member calls, nested calls and member initializers
+    const QStringView prefix = code.left(qualifiedStart).trimmed();
+    if (prefix.startsWith(u':') || prefix.startsWith(u',')) return symbols;
+    for (const QChar c : prefix) {
+        if (!isTypeCharacter(c)) return symbols;
+    }
+    bool statement = false;
+    Tokenizer::forEachWord(prefix, [&](qsizetype start, qsizetype length) {
+        statement = statement || isOneOf(prefix.mid(start, length), STATEMENT_KEYWORDS);
+    });
+    if (statement) return symbols;
+
+    // Without a return type only out-of-line constructors and destructors are definitions
+    if (prefix.isEmpty() && !destructor && lastQualifier != baseName) return symbols;
+
+    // Declarations and calls end with a semicolon, unless the body is on the same line
+    if (trimmed.endsWith(u';') && !trimmed.contains(u'{')) return symbols;
+
+    symbols.append(Symbol{code.mid(qualifiedStart, nameEnd - qualifiedStart).toString(), Kind::Function, 0, int(qualifiedStart)});
+    return symbols;
+}
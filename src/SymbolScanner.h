@@ -0,0 +1,33 @@
+#ifndef SYMBOLSCANNER_H
+#define SYMBOLSCANNER_H
+
+#include <QList>
+#include <QString>
+#include <QStringView>
+
+// This class finds the classes and functions defined on a line of source code. It is
+// a line-at-a-time heuristic over the tokenizer's words, not a parser, so any range of
+// lines can be scanned again on its own after an edit
+class SymbolScanner
+{
+public:
+    enum class Kind
+    {
+        Class,
+        Function
+    };
+
+    // A symbol and where it is defined
+    struct Symbol
+    {
+        QString name;
+        Kind kind = Kind::Function;
+        int line = 0;       // block number, filled in by the outline
+        int column = 0;
+    };
+
+    // Symbols defined on one line
+    static QList<Symbol> scanLine(QStringView line);
+};
+
+#endif // SYMBOLSCANNER_H
@@ -1,4 +1,7 @@
 #include "SyntaxHighlighter.h"
+#include "Tokenizer.h"
+#include <QVarLengthArray>
+#include <algorithm>
 
 SyntaxHighlighter::SyntaxHighlighter(QTextDocument *parent)
     : QSyntaxHighlighter(parent)
@@ -6,6 +9,20 @@ SyntaxHighlighter::SyntaxHighlighter(QTextDocument *parent)
     setupHighlightingRules();
 }
 
+namespace {
+
+// Sorted, so a word can be looked up by binary search
+const QLatin1String KEYWORDS[] = {
+    QLatin1String("class"), QLatin1String("const"), QLatin1String("define"), QLatin1String("endif"),
+    QLatin1String("enum"), QLatin1String("explicit"), QLatin1String("friend"), QLatin1String("ifdef"),
+    QLatin1String("ifndef"), QLatin1String("include"), QLatin1String("inline"), QLatin1String("namespace"),
+    QLatin1String("operator"), QLatin1String("private"), QLatin1String("protected"), QLatin1String("public"),
+    QLatin1String("signals"), QLatin1String("slots"), QLatin1String("static"), QLatin1String("virtual"),
+    QLatin1String("volatile")
+};
+
+} // namespace
+
 void SyntaxHighlighter::setupHighlightingRules()
 {
     HighlightingRule rule;
@@ -13,27 +30,10 @@ void SyntaxHighlighter::setupHighlightingRules()
     // Keyword format
     keywordFormat.setForeground(Qt::darkBlue);
     keywordFormat.setFontWeight(QFont::Bold);
-    const QString keywordPatterns[] = {
-        QStringLiteral("\\bclass\\b"), QStringLiteral("\\bconst\\b"), QStringLiteral("\\benum\\b"),
-        QStringLiteral("\\bexplicit\\b"), QStringLiteral("\\bfriend\\b"), QStringLiteral("\\binline\\b"),
-        QStringLiteral("\\bnamespace\\b"), QStringLiteral("\\boperator\\b"), QStringLiteral("\\bprivate\\b"),
-        QStringLiteral("\\bprotected\\b"), QStringLiteral("\\bpublic\\b"), QStringLiteral("\\bsignals\\b"),
-        QStringLiteral("\\bslots\\b"), QStringLiteral("\\bstatic\\b"), QStringLiteral("\\bvirtual\\b"),
-        QStringLiteral("\\bvolatile\\b"), QStringLiteral("\\binclude\\b"), QStringLiteral("\\bdefine\\b"),
-        QStringLiteral("\\bifdef\\b"), QStringLiteral("\\bifndef\\b"), QStringLiteral("\\bendif\\b")
-    };
-    for (const QString &pattern : keywordPatterns) {
-        rule.pattern = QRegularExpression(pattern);
-        rule.format = keywordFormat;
-        highlightingRules.append(rule);
-    }
 
     // Class format
     classFormat.setFontWeight(QFont::Bold);
     classFormat.setForeground(Qt::darkMagenta);
-    rule.pattern = QRegularExpression(QStringLiteral("\\bQ[A-Za-z]+\\b"));
-    rule.format = classFormat;
-    highlightingRules.append(rule);
 
     // Single line comment format
     singleLineCommentFormat.setForeground(Qt::red);
@@ -50,13 +50,44 @@ void SyntaxHighlighter::setupHighlightingRules()
     // Function format
     functionFormat.setFontItalic(true);
     functionFormat.setForeground(Qt::blue);
-    rule.pattern = QRegularExpression(QStringLiteral("\\b[A-Za-z0-9_]+(?=\\()"));
-    rule.format = functionFormat;
-    highlightingRules.append(rule);
+}
+
+bool SyntaxHighlighter::isKeyword(QStringView word)
+{
+    const auto it = std::lower_bound(std::begin(KEYWORDS), std::end(KEYWORDS), word,
+                                     [](QLatin1String keyword, QStringView w) { return w.compare(keyword) > 0; });
+    return it != std::end(KEYWORDS) && word.compare(*it) == 0;
+}
+
+bool SyntaxHighlighter::isClassName(QStringView word)
+{
+    if (word.size() < 2 || word.front() != QLatin1Char('Q')) {
+        return false;
+    }
+    for (const QChar c : word) {
+        if (c.unicode() >= 0x80 || !c.isLetter()) {
+            return false;
+        }
+    }
+    return true;
 }
 
 void SyntaxHighlighter::highlightBlock(const QString &text)
 {
+    // Keywords and class names first, so comments and strings paint over them
+    QVarLengthArray<std::pair<qsizetype, qsizetype>, 16> functionNames;
+    Tokenizer::forEachWord(text, [&](qsizetype start, qsizetype length) {
+        const QStringView word = QStringView(text).mid(start, length);
+        if (isKeyword(word)) {
+            setFormat(int(start), int(length), keywordFormat);
+        } else if (isClassName(word)) {
+            setFormat(int(start), int(length), classFormat);
+        }
+        if (start + length < text.size() && text.at(start + length) == QLatin1Char('(')) {
+            functionNames.append({start, length});
+        }
+    });
+
     for (const HighlightingRule &rule : std::as_const(highlightingRules)) {
         QRegularExpressionMatchIterator matchIterator = rule.pattern.globalMatch(text);
         while (matchIterator.hasNext()) {
@@ -64,4 +95,9 @@ void SyntaxHighlighter::highlightBlock(const QString &text)
             setFormat(match.capturedStart(), match.capturedLength(), rule.format);
         }
     }
-}
\ No newline at end of file
+
+    // Function names last, as before
+    for (const auto &name : std::as_const(functionNames)) {
+        setFormat(int(name.first), int(name.second), functionFormat);
+    }
+}
@@ -4,6 +4,7 @@
 #include <QSyntaxHighlighter>
 #include <QTextCharFormat>
 #include <QRegularExpression>
+#include <QStringView>
 
 // This class implements syntax highlighting for the text editor
 class SyntaxHighlighter : public QSyntaxHighlighter
@@ -19,6 +20,10 @@ protected:
     void highlightBlock(const QString &text) override;
 
 private:
+    // Whether a word is a keyword or a Qt class name
+    static bool isKeyword(QStringView word);
+    static bool isClassName(QStringView word);
+
     // Structure to hold highlighting rules
     struct HighlightingRule
     {
@@ -34,7 +39,7 @@ private:
     QTextCharFormat quotationFormat;
     QTextCharFormat functionFormat;
 
-    // Method to set up the highlighting rules
+    // Method to set up the highlighting rules; keywords, class and function names come from the tokenizer
     void setupHighlightingRules();
 };
 
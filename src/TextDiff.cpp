@@ -0,0 +1,213 @@
+#include "TextDiff.h"
+#include <QSet>
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Every split looks this many edits deep before it settles for a good enough one; this
+// keeps very different texts near linear time while local edits still diff exactly
+const int MAX_SPLIT_COST = 256;
+
+// Myers' linear space diff over two sequences of line hashes. Matched pairs are
+// collected in no particular order; the caller sorts them
+class Differ
+{
+public:
+    Differ(const std::vector<size_t> &a, const std::vector<size_t> &b, std::vector<std::pair<int, int>> *matches)
+        : m_a(a), m_b(b), m_matches(matches)
+    {
+    }
+
+    void diff(int a0, int a1, int b0, int b1)
+    {
+        // The right half is handled by the loop, so only the left halves nest
+        while (true) {
+            while (a0 < a1 && b0 < b1 && m_a[size_t(a0)] == m_b[size_t(b0)]) {
+                m_matches->emplace_back(a0++, b0++);
+            }
+            while (a0 < a1 && b0 < b1 && m_a[size_t(a1 - 1)] == m_b[size_t(b1 - 1)]) {
+                m_matches->emplace_back(--a1, --b1);
+            }
+            if (a0 == a1 || b0 == b1) return;
+
+            int x = 0;
+            int y = 0;
+            if (!split(a0, a1, b0, b1, &x, &y)) return;
+            diff(a0, x, b0, y);
+            a0 = x;
+            b0 = y;
+        }
+    }
+
+private:
+    // Find where a shortest edit path crosses the middle, following it from both ends;
+    // past the cost limit, take the point the forward search got furthest to instead
+    bool split(int a0, int a1, int b0, int b1, int *splitA, int *splitB)
+    {
+        const int n = a1 - a0;
+        const int m = b1 - b0;
+        const int maxD = (n + m + 1) / 2;
+        const int limit = qMin(maxD, MAX_SPLIT_COST);
+        const int offset = limit + 1;
+        const int length = 2 * limit + 3;
+        m_forward.assign(size_t(length), -1);
+        m_backward.assign(size_t(length), -1);
+        m_forward[size_t(offset + 1)] = 0;
+        m_backward[size_t(offset + 1)] = 0;
+
+        const int delta = n - m;
+        const bool front = (delta & 1) != 0;
+        int k1Start = 0;
+        int k1End = 0;
+        int k2Start = 0;
+        int k2End = 0;
+        int bestX = 0;
+        int bestY = 0;
+
+        const auto accept = [&](int x, int y) {
+            // Never split off nothing, or the loop above would not get anywhere
+            if (x + y <= 0 || (x >= n && y >= m)) return false;
+            *splitA = a0 + x;
+            *splitB = b0 + y;
+            return true;
+        };
+
+        for (int d = 0; d < limit; ++d) {
+            for (int k1 = -d + k1Start; k1 <= d - k1End; k1 += 2) {
+                const int k1Offset = offset + k1;
+                int x1 = (k1 == -d || (k1 != d && m_forward[size_t(k1Offset - 1)] < m_forward[size_t(k1Offset + 1)]))
+                    ? m_forward[size_t(k1Offset + 1)] : m_forward[size_t(k1Offset - 1)] + 1;
+                int y1 = x1 - k1;
+                while (x1 < n && y1 < m && m_a[size_t(a0 + x1)] == m_b[size_t(b0 + y1)]) {
+                    ++x1;
+                    ++y1;
+                }
+                m_forward[size_t(k1Offset)] = x1;
+                if (x1 > n) {
+                    k1End += 2;
+                } else if (y1 > m) {
+                    k1Start += 2;
+                } else {
+                    if (x1 + y1 > bestX + bestY) {
+                        bestX = x1;
+                        bestY = y1;
+                    }
+                    const int k2Offset = offset + delta - k1;
+                    if (front && k2Offset >= 0 && k2Offset < length && m_backward[size_t(k2Offset)] != -1
+                        && x1 >= n - m_backward[size_t(k2Offset)]) {
+                        return accept(x1, y1);
+                    }
+                }
+            }
+
+            for (int k2 = -d + k2Start; k2 <= d - k2End; k2 += 2) {
+                const int k2Offset = offset + k2;
+                int x2 = (k2 == -d || (k2 != d && m_backward[size_t(k2Offset - 1)] < m_backward[size_t(k2Offset + 1)]))
+                    ? m_backward[size_t(k2Offset + 1)] : m_backward[size_t(k2Offset - 1)] + 1;
+                int y2 = x2 - k2;
+                while (x2 < n && y2 < m && m_a[size_t(a1 - 1 - x2)] == m_b[size_t(b1 - 1 - y2)]) {
+                    ++x2;
+                    ++y2;
+                }
+                m_backward[size_t(k2Offset)] = x2;
+                if (x2 > n) {
+                    k2End += 2;
+                } else if (y2 > m) {
+                    k2Start += 2;
+                } else {
+                    const int k1Offset = offset + delta - k2;
+                    if (!front && k1Offset >= 0 && k1Offset < length && m_forward[size_t(k1Offset)] != -1) {
+                        const int x1 = m_forward[size_t(k1Offset)];
+                        const int y1 = offset + x1 - k1Offset;
+                        if (x1 >= n - x2) {
+                            return accept(x1, y1);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Without the limit the paths would have met; nothing in common otherwise
+        return limit < maxD && accept(bestX, bestY);
+    }
+
+    const std::vector<size_t> &m_a;
+    const std::vector<size_t> &m_b;
+    std::vector<std::pair<int, int>> *m_matches;
+    std::vector<int> m_forward;
+    std::vector<int> m_backward;
+};
+
+} // namespace
+
+QList<TextDiff::Hunk> TextDiff::compute(const std::vector<size_t> &oldLines, const std::vector<size_t> &newLines)
+{
+    const int oldCount = int(oldLines.size());
+    const int newCount = int(newLines.size());
+
+    // Edits are usually local, so most lines match at the ends
+    int prefix = 0;
+    while (prefix < oldCount && prefix < newCount && oldLines[size_t(prefix)] == newLines[size_t(prefix)]) {
+        ++prefix;
+    }
+    int suffix = 0;
+    while (suffix < oldCount - prefix && suffix < newCount - prefix
+           && oldLines[size_t(oldCount - 1 - suffix)] == newLines[size_t(newCount - 1 - suffix)]) {
+        ++suffix;
+    }
+
+    // A line that occurs on one side only can never be matched, so the diff need not see it
+    QSet<size_t> oldSet;
+    QSet<size_t> newSet;
+    oldSet.reserve(oldCount - prefix - suffix);
+    newSet.reserve(newCount - prefix - suffix);
+    for (int i = prefix; i < oldCount - suffix; ++i) {
+        oldSet.insert(oldLines[size_t(i)]);
+    }
+    for (int i = prefix; i < newCount - suffix; ++i) {
+        newSet.insert(newLines[size_t(i)]);
+    }
+    std::vector<size_t> a;
+    std::vector<size_t> b;
+    std::vector<int> aLines;
+    std::vector<int> bLines;
+    for (int i = prefix; i < oldCount - suffix; ++i) {
+        if (newSet.contains(oldLines[size_t(i)])) {
+            a.push_back(oldLines[size_t(i)]);
+            aLines.push_back(i);
+        }
+    }
+    for (int i = prefix; i < newCount - suffix; ++i) {
+        if (oldSet.contains(newLines[size_t(i)])) {
+            b.push_back(newLines[size_t(i)]);
+            bLines.push_back(i);
+        }
+    }
+
+    std::vector<std::pair<int, int>> matches;
+    if (!a.empty() && !b.empty()) {
+        Differ differ(a, b, &matches);
+        differ.diff(0, int(a.size()), 0, int(b.size()));
+        std::sort(matches.begin(), matches.end());
+    }
+
+    // Everything between two matched lines is a hunk
+    QList<Hunk> hunks;
+    int oldPosition = prefix;
+    int newPosition = prefix;
+    const auto addHunk = [&](int oldEnd, int newEnd) {
+        if (oldEnd > oldPosition || newEnd > newPosition) {
+            hunks.append({oldPosition, oldEnd - oldPosition, newPosition, newEnd - newPosition});
+        }
+    };
+    for (const auto &match : matches) {
+        const int oldLine = aLines[size_t(match.first)];
+        const int newLine = bLines[size_t(match.second)];
+        addHunk(oldLine, newLine);
+        oldPosition = oldLine + 1;
+        newPosition = newLine + 1;
+    }
+    addHunk(oldCount - suffix, newCount - suffix);
+    return hunks;
+}
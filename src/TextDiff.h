@@ -0,0 +1,32 @@
+#ifndef TEXTDIFF_H
+#define TEXTDIFF_H
+
+#include <QHashFunctions>
+#include <QList>
+#include <QStringView>
+#include <vector>
+
+// This class computes which lines differ between two texts. Lines are compared by their
+// hashes, so the texts themselves are not needed while diffing. Common lines at both
+// ends and lines that occur on one side only are set aside first; what is left is
+// diffed with Myers' algorithm in linear space, with a cap on the cost of each split
+// so that very different texts still finish quickly with a good, if not minimal, diff
+class TextDiff
+{
+public:
+    // A run of lines of the old text replaced by a run of lines of the new text; one of
+    // the counts may be zero for pure insertions and deletions
+    struct Hunk {
+        int oldStart;
+        int oldCount;
+        int newStart;
+        int newCount;
+    };
+
+    static size_t hashLine(QStringView line) { return qHash(line, 0); }
+
+    // The hunks that turn the old lines into the new lines, in order
+    static QList<Hunk> compute(const std::vector<size_t> &oldLines, const std::vector<size_t> &newLines);
+};
+
+#endif // TEXTDIFF_H
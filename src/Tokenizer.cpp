@@ -0,0 +1,15 @@
+#include "Tokenizer.h"
+
+qsizetype Tokenizer::wordStart(QStringView text, qsizetype position)
+{
+    qsizetype start = qMin(position, text.size());
+    while (start > 0 && isWordCharacter(text[start - 1])) {
+        --start;
+    }
+
+    // Numbers are not words
+    if (start < position && text[start].isDigit()) {
+        return position;
+    }
+    return start;
+}
@@ -0,0 +1,47 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <QChar>
+#include <QStringView>
+
+// This class splits text into words the way the syntax highlighter and the word index
+// see them: runs of letters, digits and underscores that do not start with a digit
+class Tokenizer
+{
+public:
+    // Whether a character can be part of a word
+    static bool isWordCharacter(QChar c)
+    {
+        const char16_t u = c.unicode();
+        if (u < 0x80) {
+            return (u >= u'a' && u <= u'z') || (u >= u'A' && u <= u'Z') || (u >= u'0' && u <= u'9') || u == u'_';
+        }
+        return c.isLetterOrNumber();
+    }
+
+    // Call function(start, length) for every word in a line of text
+    template<typename Function>
+    static void forEachWord(QStringView text, Function function)
+    {
+        const qsizetype size = text.size();
+        qsizetype i = 0;
+        while (i < size) {
+            if (!isWordCharacter(text[i])) {
+                ++i;
+                continue;
+            }
+            const qsizetype start = i;
+            while (i < size && isWordCharacter(text[i])) {
+                ++i;
+            }
+            if (!text[start].isDigit()) {
+                function(start, i - start);
+            }
+        }
+    }
+
+    // Start of the word that ends at a position, or the position itself if there is none
+    static qsizetype wordStart(QStringView text, qsizetype position);
+};
+
+#endif // TOKENIZER_H
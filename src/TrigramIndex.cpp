@@ -0,0 +1,680 @@
+#include "TrigramIndex.h"
+#include <QApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QPointer>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+Q_LOGGING_CATEGORY(trigramIndexLog, "mudoedit.trigramindex")
+
+namespace {
+
+const char INDEX_MAGIC[4] = {'M', 'T', 'R', 'I'};
+const quint32 INDEX_VERSION = 1;
+
+// Larger files are not indexed and always searched
+const qint64 MAX_INDEXED_FILE_SIZE = 64 * 1024 * 1024;
+
+// Files containing a NUL byte in their first bytes are binary and never searched
+const qint64 BINARY_SAMPLE_SIZE = 8192;
+
+// Rebuild once this many files changed since the last build
+const int REBUILD_THRESHOLD = 1000;
+
+// Modifications in place are not reported for folders, so compare the tree now and then
+const int REFRESH_INTERVAL = 5 * 60 * 1000;
+
+enum FileFlag : quint32 {
+    UnindexedFile = 1,
+    BinaryFile = 2
+};
+
+// On-disk layout: header, file records, trigram records sorted by trigram,
+// posting lists of file numbers, and the UTF-8 paths (starting with the root)
+struct IndexHeader
+{
+    char magic[4];
+    quint32 version;
+    quint32 fileCount;
+    quint32 trigramCount;
+    quint64 filesOffset;
+    quint64 trigramsOffset;
+    quint64 postingsOffset;
+    quint64 stringsOffset;
+    quint64 stringsSize;
+    quint32 rootLength;
+    quint32 reserved;
+};
+
+struct FileRecord
+{
+    quint64 pathOffset;
+    quint32 pathLength;
+    quint32 flags;
+    qint64 size;
+    qint64 modified;
+};
+
+struct TrigramRecord
+{
+    quint32 trigram;
+    quint32 count;
+    quint64 first;
+};
+
+// Trigrams are indexed with ASCII letters folded to lower case, so one index serves
+// case-sensitive and case-insensitive searches
+inline quint32 foldByte(uchar c)
+{
+    return (c >= 'A' && c <= 'Z') ? quint32(c + ('a' - 'A')) : quint32(c);
+}
+
+// Whether every offset and length in an index stays inside it, so that a truncated or
+// corrupt file is rebuilt instead of read out of bounds. The file ids in the posting
+// lists are checked as they are used
+bool hasValidLayout(const uchar *data, qint64 size)
+{
+    const IndexHeader *header = reinterpret_cast<const IndexHeader*>(data);
+    const quint64 fileSize = quint64(size);
+
+    // The sections follow one another in this order, as buildIndexFile writes them
+    if (header->filesOffset != sizeof(IndexHeader)
+        || header->fileCount > (fileSize - header->filesOffset) / sizeof(FileRecord)) {
+        return false;
+    }
+    const quint64 trigramsOffset = header->filesOffset + quint64(header->fileCount) * sizeof(FileRecord);
+    if (header->trigramsOffset != trigramsOffset
+        || header->trigramCount > (fileSize - trigramsOffset) / sizeof(TrigramRecord)) {
+        return false;
+    }
+    const quint64 postingsOffset = trigramsOffset + quint64(header->trigramCount) * sizeof(TrigramRecord);
+    if (header->postingsOffset != postingsOffset
+        || header->stringsOffset < postingsOffset || header->stringsOffset > fileSize
+        || (header->stringsOffset - postingsOffset) % sizeof(quint32) != 0
+        || header->stringsSize != fileSize - header->stringsOffset
+        || header->rootLength > header->stringsSize) {
+        return false;
+    }
+
+    const quint64 postingCount = (header->stringsOffset - postingsOffset) / sizeof(quint32);
+    const TrigramRecord *trigrams = reinterpret_cast<const TrigramRecord*>(data + trigramsOffset);
+    for (quint32 i = 0; i < header->trigramCount; ++i) {
+        if (trigrams[i].first > postingCount || trigrams[i].count > postingCount - trigrams[i].first) {
+            return false;
+        }
+    }
+
+    const FileRecord *records = reinterpret_cast<const FileRecord*>(data + header->filesOffset);
+    for (quint32 i = 0; i < header->fileCount; ++i) {
+        if (records[i].pathOffset > header->stringsSize || records[i].pathLength > header->stringsSize - records[i].pathOffset) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Build the index of a folder and write it to a file. Returns false if it was cancelled or failed
+bool buildIndexFile(const QString &rootPath, const QString &indexPath, const std::atomic<bool> &cancelled,
+                    QStringList &directories)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QList<FileRecord> records;
+    QByteArray strings = rootPath.toUtf8();
+    const quint32 rootLength = quint32(strings.size());
+    std::unordered_map<quint32, std::vector<quint32>> postings;
+
+    // A bit per possible trigram to find the distinct trigrams of one file
+    std::vector<quint64> seen(size_t(1) << 18);
+    std::vector<quint32> keys;
+
+    directories.append(rootPath);
+    QDirIterator it(rootPath, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Readable,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        if (cancelled) return false;
+
+        const QString path = it.next();
+        const QFileInfo info = it.fileInfo();
+        if (info.isDir()) {
+            directories.append(path);
+            continue;
+        }
+
+        const QByteArray utf8Path = path.toUtf8();
+        FileRecord record = {};
+        record.pathOffset = quint64(strings.size());
+        record.pathLength = quint32(utf8Path.size());
+        record.size = info.size();
+        record.modified = info.lastModified().toMSecsSinceEpoch();
+        strings.append(utf8Path);
+        const quint32 fileNumber = quint32(records.size());
+
+        QFile file(path);
+        if (record.size > MAX_INDEXED_FILE_SIZE || !file.open(QIODevice::ReadOnly)) {
+            record.flags |= UnindexedFile;
+        } else if (record.size > 0) {
+            QByteArray buffer;
+            const uchar *data = file.map(0, record.size);
+            qint64 size = record.size;
+            if (!data) {
+                buffer = file.readAll();
+                data = reinterpret_cast<const uchar*>(buffer.constData());
+                size = buffer.size();
+            }
+
+            if (std::memchr(data, 0, size_t(qMin(size, BINARY_SAMPLE_SIZE)))) {
+                record.flags |= BinaryFile;
+            } else {
+                // Roll a 24-bit key over the bytes; trigrams never span a line break,
+                // since every search matches within a line
+                keys.clear();
+                quint32 key = 0;
+                qint64 lastBreak = -1;
+                for (qint64 i = 0; i < size; ++i) {
+                    const uchar c = data[i];
+                    key = ((key << 8) | foldByte(c)) & 0xFFFFFF;
+                    if (c == '\n' || c == '\r') {
+                        lastBreak = i;
+                        continue;
+                    }
+                    if (i - 2 <= lastBreak) continue;
+                    quint64 &word = seen[key >> 6];
+                    const quint64 bit = quint64(1) << (key & 63);
+                    if (!(word & bit)) {
+                        word |= bit;
+                        keys.push_back(key);
+                    }
+                }
+                for (quint32 k : keys) {
+                    postings[k].push_back(fileNumber);
+                    seen[k >> 6] = 0;
+                }
+            }
+        }
+        records.append(record);
+    }
+
+    // Sort the trigram table so queries can binary search it
+    std::vector<quint32> trigrams;
+    trigrams.reserve(postings.size());
+    quint64 postingCount = 0;
+    for (const auto &entry : postings) {
+        trigrams.push_back(entry.first);
+        postingCount += entry.second.size();
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+
+    IndexHeader header = {};
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.fileCount = quint32(records.size());
+    header.trigramCount = quint32(trigrams.size());
+    header.filesOffset = sizeof(IndexHeader);
+    header.trigramsOffset = header.filesOffset + quint64(records.size()) * sizeof(FileRecord);
+    header.postingsOffset = header.trigramsOffset + quint64(trigrams.size()) * sizeof(TrigramRecord);
+    header.stringsOffset = header.postingsOffset + postingCount * sizeof(quint32);
+    header.stringsSize = quint64(strings.size());
+    header.rootLength = rootLength;
+
+    QDir().mkpath(QFileInfo(indexPath).absolutePath());
+    QSaveFile out(indexPath);
+    if (!out.open(QIODevice::WriteOnly)) {
+        qCWarning(trigramIndexLog) << "Could not write index" << indexPath << out.errorString();
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(records.constData()), records.size() * qint64(sizeof(FileRecord)));
+    quint64 first = 0;
+    for (quint32 trigram : trigrams) {
+        const TrigramRecord trigramRecord = {trigram, quint32(postings[trigram].size()), first};
+        out.write(reinterpret_cast<const char*>(&trigramRecord), sizeof(trigramRecord));
+        first += trigramRecord.count;
+    }
+    for (quint32 trigram : trigrams) {
+        const std::vector<quint32> &files = postings[trigram];
+        out.write(reinterpret_cast<const char*>(files.data()), qint64(files.size() * sizeof(quint32)));
+    }
+    out.write(strings);
+
+    if (cancelled) {
+        out.cancelWriting();
+        return false;
+    }
+    if (!out.commit()) {
+        qCWarning(trigramIndexLog) << "Could not write index" << indexPath << out.errorString();
+        return false;
+    }
+
+    qCDebug(trigramIndexLog) << "Indexed" << records.size() << "files with" << trigrams.size()
+                             << "trigrams below" << rootPath << "in" << timer.elapsed() << "ms";
+    return true;
+}
+
+// Literal runs that every match of a regular expression must contain. This is
+// conservative: anything it does not understand ends the current run
+QStringList requiredLiterals(const QString &pattern)
+{
+    QStringList literals;
+    QString run;
+    auto endRun = [&]() {
+        if (!run.isEmpty()) {
+            literals.append(run);
+            run.clear();
+        }
+    };
+
+    int depth = 0;
+    for (qsizetype i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern.at(i);
+        if (c == QLatin1Char('|')) {
+            // An alternative means none of the literals is required
+            return QStringList();
+        }
+        if (c == QLatin1Char('\\') && i + 1 < pattern.size()) {
+            const QChar next = pattern.at(++i);
+            if (!next.isLetterOrNumber()) {
+                if (depth == 0) {
+                    run.append(next);  // an escaped metacharacter
+                }
+                continue;
+            }
+
+            // A class such as \d, an anchor, a back reference or a character code;
+            // skip the arguments of the escapes that take some
+            endRun();
+            const char16_t kind = next.unicode();
+            if (i + 1 < pattern.size() && pattern.at(i + 1) == QLatin1Char('{')) {
+                while (i < pattern.size() && pattern.at(i) != QLatin1Char('}')) ++i;
+            } else if (kind == u'x') {
+                for (int digits = 0; digits < 2 && i + 1 < pattern.size() && std::isxdigit(uchar(pattern.at(i + 1).toLatin1())); ++digits) ++i;
+            } else if (kind == u'c' || kind == u'p' || kind == u'P') {
+                ++i;
+            } else if (next.isDigit()) {
+                while (i + 1 < pattern.size() && pattern.at(i + 1).isDigit()) ++i;
+            }
+            continue;
+        }
+        if (c == QLatin1Char('(')) {
+            ++depth;
+            endRun();
+            continue;
+        }
+        if (c == QLatin1Char(')')) {
+            depth = qMax(0, depth - 1);
+            continue;
+        }
+        if (depth > 0) continue;   // literals inside groups are skipped
+        if (c == QLatin1Char('[')) {
+            // Skip the character class
+            endRun();
+            ++i;
+            if (i < pattern.size() && pattern.at(i) == QLatin1Char('^')) ++i;
+            if (i < pattern.size() && pattern.at(i) == QLatin1Char(']')) ++i;
+            while (i < pattern.size() && pattern.at(i) != QLatin1Char(']')) {
+                if (pattern.at(i) == QLatin1Char('\\')) ++i;
+                ++i;
+            }
+            continue;
+        }
+        if (c == QLatin1Char('?') || c == QLatin1Char('*') || c == QLatin1Char('{')) {
+            // The previous character is optional
+            run.chop(1);
+            endRun();
+            if (c == QLatin1Char('{')) {
+                while (i < pattern.size() && pattern.at(i) != QLatin1Char('}')) ++i;
+            }
+            continue;
+        }
+        if (c == QLatin1Char('+')) {
+            // The previous character is required, but what follows may not be next to it
+            endRun();
+            continue;
+        }
+        if (c == QLatin1Char('.') || c == QLatin1Char('^') || c == QLatin1Char('$')) {
+            endRun();
+            continue;
+        }
+        run.append(c);
+    }
+    endRun();
+    return literals;
+}
+
+} // namespace
+
+TrigramIndex::TrigramIndex(const QString &rootPath, QObject *parent)
+    : QObject(parent),
+      m_rootPath(QDir::cleanPath(rootPath)),
+      m_indexPath(indexFilePath(rootPath)),
+      m_watcher(new QFileSystemWatcher(this)),
+      m_refreshTimer(new QTimer(this)),
+      m_indexFile(nullptr),
+      m_data(nullptr),
+      m_dataSize(0),
+      m_building(false),
+      m_refreshing(false),
+      m_cancelled(std::make_shared<std::atomic<bool>>(false))
+{
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &TrigramIndex::directoryChanged);
+
+    m_refreshTimer->setInterval(REFRESH_INTERVAL);
+    connect(m_refreshTimer, &QTimer::timeout, this, &TrigramIndex::refresh);
+    m_refreshTimer->start();
+
+    // Use the index of an earlier session, after checking what changed since
+    if (load()) {
+        refresh();
+    } else {
+        rebuild();
+    }
+}
+
+TrigramIndex::~TrigramIndex()
+{
+    *m_cancelled = true;
+    unload();
+}
+
+QString TrigramIndex::indexFilePath(const QString &rootPath)
+{
+    const QByteArray hash = QCryptographicHash::hash(QDir::cleanPath(rootPath).toUtf8(), QCryptographicHash::Sha1);
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QLatin1String("/trigrams/")
+        + QString::fromLatin1(hash.toHex()) + QLatin1String(".idx");
+}
+
+bool TrigramIndex::load()
+{
+    unload();
+
+    QFile *file = new QFile(m_indexPath);
+    if (!file->open(QIODevice::ReadOnly) || file->size() < qint64(sizeof(IndexHeader))) {
+        delete file;
+        return false;
+    }
+    const qint64 size = file->size();
+    const uchar *data = file->map(0, size);
+    if (!data) {
+        delete file;
+        return false;
+    }
+
+    // Reject indexes of another version or folder, and truncated or corrupt files
+    const IndexHeader *header = reinterpret_cast<const IndexHeader*>(data);
+    const bool valid = std::memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0
+        && header->version == INDEX_VERSION
+        && hasValidLayout(data, size)
+        && QString::fromUtf8(reinterpret_cast<const char*>(data + header->stringsOffset), header->rootLength) == m_rootPath;
+    if (!valid) {
+        qCDebug(trigramIndexLog) << "Ignoring outdated index" << m_indexPath;
+        delete file;
+        return false;
+    }
+
+    m_indexFile = file;
+    m_data = data;
+    m_dataSize = size;
+
+    const FileRecord *records = reinterpret_cast<const FileRecord*>(data + header->filesOffset);
+    const char *strings = reinterpret_cast<const char*>(data + header->stringsOffset);
+    m_stamps.reserve(header->fileCount);
+    for (quint32 i = 0; i < header->fileCount; ++i) {
+        const QString path = QString::fromUtf8(strings + records[i].pathOffset, records[i].pathLength);
+        m_stamps.insert(path, FileStamp{records[i].size, records[i].modified});
+        if (records[i].flags & UnindexedFile) {
+            m_unindexedFiles.append(path);
+        }
+    }
+
+    qCDebug(trigramIndexLog) << "Loaded index of" << m_rootPath << "with" << header->fileCount << "files";
+    return true;
+}
+
+void TrigramIndex::unload()
+{
+    delete m_indexFile;   // unmaps the index
+    m_indexFile = nullptr;
+    m_data = nullptr;
+    m_dataSize = 0;
+    m_stamps.clear();
+    m_unindexedFiles.clear();
+}
+
+QList<quint32> TrigramIndex::requiredTrigrams(const QString &pattern, const SearchOptions &options)
+{
+    const QStringList literals = options.regularExpression ? requiredLiterals(pattern) : QStringList{pattern};
+
+    // Inline options such as (?i) can switch off case sensitivity anywhere
+    const bool caseSensitive = options.caseSensitivity == Qt::CaseSensitive
+        && !(options.regularExpression && pattern.contains(QLatin1String("(?")));
+
+    QList<quint32> trigrams;
+    for (const QString &literal : literals) {
+        const QByteArray bytes = literal.toUtf8();
+        for (qsizetype i = 0; i + 2 < bytes.size(); ++i) {
+            const uchar a = uchar(bytes.at(i));
+            const uchar b = uchar(bytes.at(i + 1));
+            const uchar c = uchar(bytes.at(i + 2));
+            // Case folding of non-ASCII characters changes their bytes, so they cannot be used
+            if (!caseSensitive && (a >= 0x80 || b >= 0x80 || c >= 0x80)) continue;
+            trigrams.append(foldByte(a) << 16 | foldByte(b) << 8 | foldByte(c));
+        }
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
+}
+
+std::optional<QStringList> TrigramIndex::candidateFiles(const QString &pattern, const SearchOptions &options)
+{
+    if (!m_data) return std::nullopt;
+
+    const QList<quint32> trigrams = requiredTrigrams(pattern, options);
+    if (trigrams.isEmpty()) return std::nullopt;
+
+    const IndexHeader *header = reinterpret_cast<const IndexHeader*>(m_data);
+    const TrigramRecord *table = reinterpret_cast<const TrigramRecord*>(m_data + header->trigramsOffset);
+    const TrigramRecord *tableEnd = table + header->trigramCount;
+    const quint32 *postings = reinterpret_cast<const quint32*>(m_data + header->postingsOffset);
+
+    // Intersect the posting lists, shortest first so the intermediate result stays small
+    std::vector<const TrigramRecord*> lists;
+    for (quint32 trigram : trigrams) {
+        const TrigramRecord *record = std::lower_bound(table, tableEnd, trigram,
+            [](const TrigramRecord &r, quint32 value) { return r.trigram < value; });
+        if (record == tableEnd || record->trigram != trigram) {
+            lists.clear();
+            break;
+        }
+        lists.push_back(record);
+    }
+
+    std::vector<quint32> files;
+    if (!lists.empty()) {
+        std::sort(lists.begin(), lists.end(), [](const TrigramRecord *a, const TrigramRecord *b) {
+            return a->count < b->count;
+        });
+        files.assign(postings + lists.front()->first, postings + lists.front()->first + lists.front()->count);
+        std::vector<quint32> intersection;
+        for (size_t i = 1; i < lists.size() && !files.empty(); ++i) {
+            const quint32 *begin = postings + lists[i]->first;
+            intersection.clear();
+            std::set_intersection(files.begin(), files.end(), begin, begin + lists[i]->count,
+                                  std::back_inserter(intersection));
+            files.swap(intersection);
+        }
+    }
+
+    const FileRecord *records = reinterpret_cast<const FileRecord*>(m_data + header->filesOffset);
+    const char *strings = reinterpret_cast<const char*>(m_data + header->stringsOffset);
+    QStringList candidates;
+    candidates.reserve(qsizetype(files.size()) + m_unindexedFiles.size() + m_changedFiles.size());
+    for (quint32 file : files) {
+        if (file >= header->fileCount) {
+            qCWarning(trigramIndexLog) << "Corrupt posting list in" << m_indexPath << "- rebuilding";
+            QTimer::singleShot(0, this, &TrigramIndex::rebuild);
+            return std::nullopt;
+        }
+        candidates.append(QString::fromUtf8(strings + records[file].pathOffset, records[file].pathLength));
+    }
+    candidates += m_unindexedFiles;
+
+    // Files that changed since the build may contain anything
+    if (!m_changedFiles.isEmpty()) {
+        const QSet<QString> found(candidates.cbegin(), candidates.cend());
+        for (const QString &path : m_changedFiles) {
+            if (!found.contains(path)) {
+                candidates.append(path);
+            }
+        }
+    }
+
+    qCDebug(trigramIndexLog) << "Index narrowed the search for" << pattern << "to" << candidates.size()
+                             << "of" << header->fileCount << "files";
+    return candidates;
+}
+
+void TrigramIndex::rebuild()
+{
+    if (m_building) return;
+    m_building = true;
+
+    const QString rootPath = m_rootPath;
+    const QString indexPath = m_indexPath;
+    std::shared_ptr<std::atomic<bool>> cancelled = m_cancelled;
+    QPointer<TrigramIndex> self(this);
+
+    QThreadPool::globalInstance()->start([self, rootPath, indexPath, cancelled]() {
+        QStringList directories;
+        const bool built = buildIndexFile(rootPath, indexPath, *cancelled, directories);
+        QMetaObject::invokeMethod(qApp, [self, built, directories]() {
+            if (!self) return;
+            self->m_building = false;
+            if (!built || !self->load()) return;
+
+            // The build saw the current state of every file
+            self->m_changedFiles.clear();
+            self->watchDirectories(directories);
+            Q_EMIT self->ready();
+        }, Qt::QueuedConnection);
+    });
+}
+
+void TrigramIndex::refresh()
+{
+    if (!m_data || m_building || m_refreshing) return;
+    m_refreshing = true;
+
+    const QString rootPath = m_rootPath;
+    const QHash<QString, FileStamp> stamps = m_stamps;
+    std::shared_ptr<std::atomic<bool>> cancelled = m_cancelled;
+    QPointer<TrigramIndex> self(this);
+
+    // Only metadata is read here, which is much cheaper than reading the files
+    QThreadPool::globalInstance()->start([self, rootPath, stamps, cancelled]() {
+        QStringList changed;
+        QStringList directories{rootPath};
+        QDirIterator it(rootPath, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Readable,
+                        QDirIterator::Subdirectories);
+        while (it.hasNext() && !*cancelled) {
+            const QString path = it.next();
+            const QFileInfo info = it.fileInfo();
+            if (info.isDir()) {
+                directories.append(path);
+                continue;
+            }
+            const auto stamp = stamps.constFind(path);
+            if (stamp == stamps.constEnd() || stamp->size != info.size()
+                || stamp->modified != info.lastModified().toMSecsSinceEpoch()) {
+                changed.append(path);
+            }
+        }
+
+        QMetaObject::invokeMethod(qApp, [self, changed, directories]() {
+            if (!self) return;
+            self->m_refreshing = false;
+            self->watchDirectories(directories);
+            self->addChangedFiles(changed);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void TrigramIndex::directoryChanged(const QString &path)
+{
+    if (!m_data) return;
+
+    const QDir directory(path);
+    if (!directory.exists()) {
+        m_watcher->removePath(path);
+        return;
+    }
+
+    QStringList changed;
+    bool newDirectories = false;
+    const QFileInfoList entries = directory.entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Readable);
+    const QStringList watched = m_watcher->directories();
+    for (const QFileInfo &info : entries) {
+        const QString filePath = info.filePath();
+        if (info.isDir()) {
+            newDirectories = newDirectories || !watched.contains(filePath);
+            continue;
+        }
+        const auto stamp = m_stamps.constFind(filePath);
+        if (stamp == m_stamps.constEnd() || stamp->size != info.size()
+            || stamp->modified != info.lastModified().toMSecsSinceEpoch()) {
+            changed.append(filePath);
+        }
+    }
+    addChangedFiles(changed);
+
+    // New folders may already contain files; pick them up with a full comparison
+    if (newDirectories) {
+        refresh();
+    }
+}
+
+void TrigramIndex::watchDirectories(const QStringList &directories)
+{
+    const QStringList watched = m_watcher->directories();
+    const QSet<QString> watchedSet(watched.cbegin(), watched.cend());
+    QStringList added;
+    for (const QString &directory : directories) {
+        if (!watchedSet.contains(directory)) {
+            added.append(directory);
+        }
+    }
+    if (added.isEmpty()) return;
+
+    const QStringList failed = m_watcher->addPaths(added);
+    if (!failed.isEmpty()) {
+        // Usually the inotify watch limit; the periodic refresh still catches these changes
+        qCWarning(trigramIndexLog) << "Could not watch" << failed.size() << "folders below" << m_rootPath;
+    }
+}
+
+void TrigramIndex::addChangedFiles(const QStringList &filePaths)
+{
+    for (const QString &path : filePaths) {
+        m_changedFiles.insert(path);
+    }
+    if (m_changedFiles.size() >= REBUILD_THRESHOLD) {
+        qCDebug(trigramIndexLog) << m_changedFiles.size() << "files changed below" << m_rootPath << "- rebuilding";
+        rebuild();
+    }
+}
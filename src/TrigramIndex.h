@@ -0,0 +1,100 @@
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include "SearchEngine.h"
+
+class QFile;
+class QFileSystemWatcher;
+class QTimer;
+
+// This class maintains an on-disk index of the byte trigrams in every file below a
+// folder. The index is built in the background, memory-mapped for queries, and kept
+// current from file system notifications: files that changed since the last build
+// are searched directly until there are enough of them to make a rebuild worthwhile
+class TrigramIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TrigramIndex(const QString &rootPath, QObject *parent = nullptr);
+    ~TrigramIndex() override;
+
+    QString rootPath() const { return m_rootPath; }
+
+    // Whether an index is loaded and can answer queries
+    bool isReady() const { return m_data != nullptr; }
+
+    // Whether the index is being (re)built
+    bool isBuilding() const { return m_building; }
+
+    // Files that may contain a match, or nothing if the pattern has no trigrams to filter on
+    // or the index turns out to be corrupt, in which case it is rebuilt
+    std::optional<QStringList> candidateFiles(const QString &pattern, const SearchOptions &options);
+
+    // Trigrams that every match of a pattern must contain, sorted
+    static QList<quint32> requiredTrigrams(const QString &pattern, const SearchOptions &options);
+
+    // Location of the index of a folder
+    static QString indexFilePath(const QString &rootPath);
+
+public Q_SLOTS:
+    // Build the index from scratch in the background
+    void rebuild();
+
+Q_SIGNALS:
+    // Emitted when a newly built index has been loaded
+    void ready();
+
+private:
+    // Size and modification time of a file when it was indexed
+    struct FileStamp
+    {
+        qint64 size = 0;
+        qint64 modified = 0;
+    };
+
+    // Map the index file, returns false if it is missing or does not belong to this folder
+    bool load();
+    void unload();
+
+    // Compare the files of a folder with the index after a change notification
+    void directoryChanged(const QString &path);
+
+    // Compare the whole tree with the index in the background
+    void refresh();
+
+    // Watch the given folders for changes
+    void watchDirectories(const QStringList &directories);
+
+    // Record files that differ from the index and rebuild once there are too many
+    void addChangedFiles(const QStringList &filePaths);
+
+    QString m_rootPath;
+    QString m_indexPath;
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_refreshTimer;
+
+    // The mapped index
+    QFile *m_indexFile;
+    const uchar *m_data;
+    qint64 m_dataSize;
+    QHash<QString, FileStamp> m_stamps;
+    QStringList m_unindexedFiles;
+
+    // Files changed or created since the index was built
+    QSet<QString> m_changedFiles;
+
+    bool m_building;
+    bool m_refreshing;
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+#endif // TRIGRAMINDEX_H
@@ -26,11 +26,14 @@ void WindowManagement::cascadeWindows()
 
 void WindowManagement::minimizeAllWindows()
 {
-    // Minimize all windows in the active MDI area
+    // Minimize all windows in the active MDI area. Minimized editors are hidden and
+    // lay themselves out again only when restored, so just hold back repaints meanwhile
     if (QMdiArea *mdiArea = getActiveMdiArea()) {
+        mdiArea->setUpdatesEnabled(false);
         for (QMdiSubWindow *window : mdiArea->subWindowList()) {
             window->showMinimized();
         }
+        mdiArea->setUpdatesEnabled(true);
     }
 }
 
@@ -0,0 +1,182 @@
+#include "WordCompleter.h"
+#include "ClipboardTransfer.h"
+#include "WordIndex.h"
+#include "Tokenizer.h"
+#include <QAbstractItemView>
+#include <QCompleter>
+#include <QElapsedTimer>
+#include <QKeyEvent>
+#include <QScrollBar>
+#include <QStringListModel>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTimer>
+#include <QLoggingCategory>
+#include <KTextEdit>
+
+Q_LOGGING_CATEGORY(wordCompleterLog, "mudoedit.wordcompleter")
+
+namespace {
+
+// Characters of a word typed before the popup opens by itself
+const int AUTO_POPUP_LENGTH = 3;
+
+// Completions listed in the popup
+const int MAX_COMPLETIONS = 50;
+
+} // namespace
+
+void WordCompleter::attach(KTextEdit *textEdit, WordIndex *wordIndex)
+{
+    if (!forEditor(textEdit)) {
+        new WordCompleter(textEdit, wordIndex);
+    }
+}
+
+WordCompleter* WordCompleter::forEditor(KTextEdit *textEdit)
+{
+    return textEdit->findChild<WordCompleter*>(QString(), Qt::FindDirectChildrenOnly);
+}
+
+WordCompleter::WordCompleter(KTextEdit *textEdit, WordIndex *wordIndex)
+    : QObject(textEdit),
+      m_textEdit(textEdit),
+      m_wordIndex(wordIndex),
+      m_completer(new QCompleter(this)),
+      m_model(new QStringListModel(this)),
+      m_updateTimer(new QTimer(this))
+{
+    // The index has already filtered and ranked the words, so show them as they are
+    m_completer->setModel(m_model);
+    m_completer->setWidget(m_textEdit);
+    m_completer->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+    m_completer->setMaxVisibleItems(10);
+    connect(m_completer, QOverload<const QString &>::of(&QCompleter::activated), this, &WordCompleter::insertCompletion);
+
+    // Installed after the completer's own filter, so it sees the keys first
+    m_completer->popup()->installEventFilter(this);
+    m_textEdit->installEventFilter(this);
+
+    // Update once the key has been handled by the editor
+    m_updateTimer->setSingleShot(true);
+    m_updateTimer->setInterval(0);
+    connect(m_updateTimer, &QTimer::timeout, this, [this]() {
+        updatePopup(false);
+    });
+}
+
+void WordCompleter::complete()
+{
+    updatePopup(true);
+}
+
+bool WordCompleter::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() != QEvent::KeyPress) {
+        return QObject::eventFilter(watched, event);
+    }
+    QKeyEvent *keyEvent = static_cast<QKeyEvent*>(event);
+
+    if (watched == m_completer->popup()) {
+        switch (keyEvent->key()) {
+        case Qt::Key_Return:
+        case Qt::Key_Enter:
+        case Qt::Key_Tab: {
+            const QModelIndex current = m_completer->popup()->currentIndex();
+            if (current.isValid()) {
+                insertCompletion(current.data().toString());
+                return true;
+            }
+            m_completer->popup()->hide();
+            break;
+        }
+        case Qt::Key_Escape:
+            m_completer->popup()->hide();
+            return true;
+        case Qt::Key_Up:
+        case Qt::Key_Down:
+        case Qt::Key_PageUp:
+        case Qt::Key_PageDown:
+            break;
+        default:
+            // The completer passes the key on to the editor; follow the word afterwards
+            m_updateTimer->start();
+            break;
+        }
+    } else if (watched == m_textEdit) {
+        const QString text = keyEvent->text();
+        if (!text.isEmpty() && Tokenizer::isWordCharacter(text.at(0))
+            && !(keyEvent->modifiers() & (Qt::ControlModifier | Qt::AltModifier))) {
+            m_updateTimer->start();
+        }
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void WordCompleter::updatePopup(bool requested)
+{
+    QAbstractItemView *popup = m_completer->popup();
+    int start = 0;
+    const QString prefix = currentPrefix(&start);
+    if (!m_wordIndex || m_textEdit->isReadOnly() || prefix.isEmpty()
+        || (!requested && !popup->isVisible() && prefix.size() < AUTO_POPUP_LENGTH)) {
+        popup->hide();
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QStringList words;
+    for (const WordIndex::Completion &completion : m_wordIndex->completions(prefix, MAX_COMPLETIONS + 1)) {
+        // The word being typed is in the index too
+        if (completion.word != prefix && words.size() < MAX_COMPLETIONS) {
+            words.append(completion.word);
+        }
+    }
+    qCDebug(wordCompleterLog) << "Found" << words.size() << "completions for" << prefix << "in" << timer.nsecsElapsed() / 1000 << "us";
+
+    if (words.isEmpty()) {
+        popup->hide();
+        return;
+    }
+
+    m_model->setStringList(words);
+
+    // Open the popup under the start of the word
+    QTextCursor cursor = m_textEdit->textCursor();
+    cursor.setPosition(cursor.block().position() + start);
+    QRect rect = m_textEdit->cursorRect(cursor);
+    rect.setWidth(popup->sizeHintForColumn(0) + popup->verticalScrollBar()->sizeHint().width());
+    m_completer->complete(rect);
+    popup->setCurrentIndex(m_model->index(0, 0));
+}
+
+void WordCompleter::insertCompletion(const QString &completion)
+{
+    int start = 0;
+    currentPrefix(&start);
+
+    // Replace the whole prefix, so the case of the completion wins
+    QTextCursor cursor = m_textEdit->textCursor();
+    cursor.setPosition(cursor.block().position() + start, QTextCursor::KeepAnchor);
+    ClipboardTransfer::detach(m_textEdit->document());
+    cursor.insertText(completion);
+    m_textEdit->setTextCursor(cursor);
+    m_completer->popup()->hide();
+}
+
+QString WordCompleter::currentPrefix(int *start) const
+{
+    const QTextCursor cursor = m_textEdit->textCursor();
+    const QString text = cursor.block().text();
+    const int position = cursor.positionInBlock();
+    *start = position;
+
+    // Nothing to complete within a selection or in the middle of a word
+    if (cursor.hasSelection() || (position < text.size() && Tokenizer::isWordCharacter(text.at(position)))) {
+        return QString();
+    }
+
+    *start = int(Tokenizer::wordStart(text, position));
+    return text.mid(*start, position - *start);
+}
@@ -0,0 +1,53 @@
+#ifndef WORDCOMPLETER_H
+#define WORDCOMPLETER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QString>
+
+class QCompleter;
+class QStringListModel;
+class QTimer;
+class KTextEdit;
+class WordIndex;
+
+// This class shows a popup with words from the word index while typing in an editor.
+// It opens by itself once a few characters of a word are typed, or on request
+class WordCompleter : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Offer completions in an editor
+    static void attach(KTextEdit *textEdit, WordIndex *wordIndex);
+
+    // Get the completer of an editor, or nullptr if it has none
+    static WordCompleter* forEditor(KTextEdit *textEdit);
+
+    // Show the completions of the word before the cursor, however short it is
+    void complete();
+
+protected:
+    // Follow typing in the editor and handle the accepting keys in the popup
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    WordCompleter(KTextEdit *textEdit, WordIndex *wordIndex);
+
+    // Show, update or hide the popup for the word before the cursor
+    void updatePopup(bool requested);
+
+    // Replace the word before the cursor by a completion
+    void insertCompletion(const QString &completion);
+
+    // The word before the cursor and its start in the block
+    QString currentPrefix(int *start) const;
+
+    KTextEdit *m_textEdit;
+    QPointer<WordIndex> m_wordIndex;
+    QCompleter *m_completer;
+    QStringListModel *m_model;
+    QTimer *m_updateTimer;
+};
+
+#endif // WORDCOMPLETER_H
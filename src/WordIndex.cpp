@@ -0,0 +1,438 @@
+#include "WordIndex.h"
+#include "Tokenizer.h"
+#include "WordCompleter.h"
+#include "MemoryBudgetManager.h"
+#include <QApplication>
+#include <QLoggingCategory>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QThreadPool>
+#include <QTimer>
+#include <KTextEdit>
+#include <algorithm>
+
+Q_LOGGING_CATEGORY(wordIndexLog, "mudoedit.wordindex")
+
+namespace {
+
+// Shorter words are not worth completing, longer ones are rarely words
+const int MIN_WORD_LENGTH = 3;
+const int MAX_WORD_LENGTH = 100;
+
+// Larger documents, such as big logs, are left out of the index
+const int MAX_INDEXED_CHARACTERS = 16 * 1024 * 1024;
+
+// Edits touching more blocks than this are tokenized on the thread pool
+const int MAX_SYNC_BLOCKS = 1000;
+
+// Blocks given their words per event loop iteration when a full pass is applied
+const int APPLY_SLICE_BLOCKS = 20000;
+
+// Delay before new words are merged into the sorted array and unused ones dropped
+const int COMPACT_DELAY = 2000;
+
+// New words are searched linearly, so merge early when there are many
+const size_t MAX_RECENT_WORDS = 4096;
+
+} // namespace
+
+// The interned words and their counts. Blocks hold references into it, so it stays
+// alive after the index is deleted until the last block of the last document is gone
+struct WordTable
+{
+    struct Entry
+    {
+        QString word;
+        QString key;    // case-folded word, the sort key
+        int count = 0;  // occurrences in blocks
+    };
+
+    std::vector<Entry> entries;
+    QHash<QString, int> ids;
+    std::vector<int> freeIds;
+
+    // Word ids sorted by key, and the ids added since the last merge
+    std::vector<int> sorted;
+    std::vector<int> recent;
+
+    qsizetype blockCount = 0;
+    bool orphaned = false;
+
+    // Id of a word, adding it without occurrences if it is new
+    int intern(const QString &word)
+    {
+        const auto it = ids.constFind(word);
+        if (it != ids.constEnd()) {
+            return it.value();
+        }
+
+        int id;
+        if (!freeIds.empty()) {
+            id = freeIds.back();
+            freeIds.pop_back();
+        } else {
+            id = int(entries.size());
+            entries.emplace_back();
+        }
+        entries[id] = Entry{word, word.toCaseFolded(), 0};
+        ids.insert(word, id);
+        recent.push_back(id);
+        return id;
+    }
+};
+
+namespace {
+
+// The words one block contributes to the counts
+class WordBlockData : public QTextBlockUserData
+{
+public:
+    WordBlockData(WordTable *table, std::vector<int> &&ids)
+        : m_table(table),
+          m_ids(std::move(ids))
+    {
+        ++m_table->blockCount;
+        for (int id : m_ids) {
+            ++m_table->entries[id].count;
+        }
+    }
+
+    ~WordBlockData() override
+    {
+        for (int id : m_ids) {
+            --m_table->entries[id].count;
+        }
+        if (--m_table->blockCount == 0 && m_table->orphaned) {
+            delete m_table;
+        }
+    }
+
+private:
+    WordTable *m_table;
+    std::vector<int> m_ids;
+};
+
+} // namespace
+
+WordIndex::WordIndex(QObject *parent)
+    : QObject(parent),
+      m_table(new WordTable),
+      m_compactTimer(new QTimer(this))
+{
+    m_compactTimer->setSingleShot(true);
+    m_compactTimer->setInterval(COMPACT_DELAY);
+    connect(m_compactTimer, &QTimer::timeout, this, &WordIndex::compact);
+}
+
+WordIndex::~WordIndex()
+{
+    // Documents that are still open release their words when they are closed
+    if (m_table->blockCount == 0) {
+        delete m_table;
+    } else {
+        m_table->orphaned = true;
+    }
+}
+
+QList<WordIndex::Completion> WordIndex::completions(QStringView prefix, int maximum) const
+{
+    QList<Completion> result;
+    if (prefix.isEmpty() || maximum <= 0) {
+        return result;
+    }
+
+    const WordTable *table = m_table;
+    const QString key = prefix.toString().toCaseFolded();
+    std::vector<int> matches;
+
+    const auto first = std::lower_bound(table->sorted.begin(), table->sorted.end(), key,
+                                        [table](int id, const QString &k) { return table->entries[id].key < k; });
+    for (auto it = first; it != table->sorted.end() && table->entries[*it].key.startsWith(key); ++it) {
+        if (table->entries[*it].count > 0) {
+            matches.push_back(*it);
+        }
+    }
+    for (int id : table->recent) {
+        if (table->entries[id].count > 0 && table->entries[id].key.startsWith(key)) {
+            matches.push_back(id);
+        }
+    }
+
+    // Most frequent first; words that match the case of the prefix win ties
+    const auto better = [table, prefix](int a, int b) {
+        const WordTable::Entry &x = table->entries[a];
+        const WordTable::Entry &y = table->entries[b];
+        if (x.count != y.count) {
+            return x.count > y.count;
+        }
+        const bool xCase = x.word.startsWith(prefix);
+        const bool yCase = y.word.startsWith(prefix);
+        if (xCase != yCase) {
+            return xCase;
+        }
+        return x.word < y.word;
+    };
+    const size_t count = qMin(matches.size(), size_t(maximum));
+    std::partial_sort(matches.begin(), matches.begin() + count, matches.end(), better);
+
+    result.reserve(qsizetype(count));
+    for (size_t i = 0; i < count; ++i) {
+        const WordTable::Entry &entry = table->entries[matches[i]];
+        result.append(Completion{entry.word, entry.count});
+    }
+    return result;
+}
+
+qsizetype WordIndex::wordCount() const
+{
+    return m_table->ids.size();
+}
+
+void WordIndex::addEditor(KTextEdit *textEdit)
+{
+    addDocument(textEdit->document(), textEdit);
+    WordCompleter::attach(textEdit, this);
+}
+
+void WordIndex::addDocument(QTextDocument *document, KTextEdit *textEdit)
+{
+    if (m_documents.contains(document)) return;
+
+    TrackedDocument tracked;
+    tracked.textEdit = textEdit;
+    m_documents.insert(document, tracked);
+
+    connect(document, &QTextDocument::contentsChange, this, [this, document](int position, int charsRemoved, int charsAdded) {
+        contentsChanged(document, position, charsRemoved, charsAdded);
+    });
+    connect(document, &QObject::destroyed, this, [this, document]() {
+        m_documents.remove(document);
+    });
+
+    scheduleFullPass(document);
+}
+
+bool WordIndex::isIndexable(QTextDocument *document) const
+{
+    const TrackedDocument tracked = m_documents.value(document);
+    if (tracked.textEdit && MemoryBudgetManager::isEvicted(tracked.textEdit)) {
+        return false;
+    }
+    return document->characterCount() <= MAX_INDEXED_CHARACTERS;
+}
+
+void WordIndex::contentsChanged(QTextDocument *document, int position, int charsRemoved, int charsAdded)
+{
+    Q_UNUSED(charsRemoved)
+
+    if (!isIndexable(document)) {
+        // Text reloaded into an unloaded editor arrives before the editor is marked as loaded
+        if (charsAdded > 0) {
+            scheduleFullPass(document);
+        }
+        return;
+    }
+
+    // Removed blocks have already taken their words with them
+    const QTextBlock first = document->findBlock(position);
+    const QTextBlock last = document->findBlock(position + charsAdded);
+    if (!first.isValid()) return;
+
+    if (!last.isValid() || last.blockNumber() - first.blockNumber() > MAX_SYNC_BLOCKS) {
+        // The blocks in between are new; only the two ends can hold words from before the edit
+        indexBlock(first);
+        if (last.isValid()) {
+            indexBlock(last);
+        }
+        scheduleFullPass(document);
+        return;
+    }
+
+    for (QTextBlock block = first; block.isValid(); block = block.next()) {
+        indexBlock(block);
+        if (block == last) break;
+    }
+    scheduleCompact();
+}
+
+void WordIndex::indexBlock(const QTextBlock &block)
+{
+    const QString text = block.text();
+    std::vector<int> ids;
+    Tokenizer::forEachWord(text, [&](qsizetype start, qsizetype length) {
+        if (length >= MIN_WORD_LENGTH && length <= MAX_WORD_LENGTH) {
+            ids.push_back(m_table->intern(text.mid(start, length)));
+        }
+    });
+
+    // The new data counts its words before the old data releases its own
+    QTextBlock target(block);
+    target.setUserData(ids.empty() ? nullptr : new WordBlockData(m_table, std::move(ids)));
+}
+
+void WordIndex::scheduleFullPass(QTextDocument *document)
+{
+    auto it = m_documents.find(document);
+    if (it == m_documents.end() || it->passScheduled) return;
+    it->passScheduled = true;
+
+    // Wait for the rest of the current edit, e.g. all of setPlainText
+    QPointer<QTextDocument> guard(document);
+    QTimer::singleShot(0, this, [this, guard]() {
+        if (guard) {
+            startFullPass(guard);
+        }
+    });
+}
+
+void WordIndex::startFullPass(QTextDocument *document)
+{
+    auto it = m_documents.find(document);
+    if (it == m_documents.end()) return;
+    it->passScheduled = false;
+    const quint64 generation = ++it->generation;
+    if (!isIndexable(document)) return;
+
+    // Raw text keeps the block separators apart from line separators inside a block
+    const int revision = document->revision();
+    const QString text = document->toRawText();
+    QPointer<WordIndex> self(this);
+    QPointer<QTextDocument> guard(document);
+
+    QThreadPool::globalInstance()->start([self, guard, generation, revision, text]() {
+        auto result = std::make_shared<DocumentWords>();
+        QHash<QString, int> numbers;
+        result->offsets.push_back(0);
+
+        const QStringView all(text);
+        qsizetype lineStart = 0;
+        for (;;) {
+            qsizetype lineEnd = all.indexOf(QChar::ParagraphSeparator, lineStart);
+            if (lineEnd < 0) {
+                lineEnd = all.size();
+            }
+            const QStringView line = all.mid(lineStart, lineEnd - lineStart);
+            Tokenizer::forEachWord(line, [&](qsizetype start, qsizetype length) {
+                if (length < MIN_WORD_LENGTH || length > MAX_WORD_LENGTH) return;
+                const QString word = line.mid(start, length).toString();
+                int number = numbers.value(word, -1);
+                if (number < 0) {
+                    number = int(result->words.size());
+                    numbers.insert(word, number);
+                    result->words.append(word);
+                }
+                result->wordNumbers.push_back(number);
+            });
+            result->offsets.push_back(int(result->wordNumbers.size()));
+
+            if (lineEnd == all.size()) break;
+            lineStart = lineEnd + 1;
+        }
+
+        QMetaObject::invokeMethod(qApp, [self, guard, generation, revision, result]() {
+            if (self && guard) {
+                self->applyFullPass(guard, generation, revision, result, 0);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void WordIndex::applyFullPass(QTextDocument *document, quint64 generation, int revision,
+                              std::shared_ptr<const DocumentWords> result, int firstBlock)
+{
+    const auto it = m_documents.constFind(document);
+    if (it == m_documents.constEnd() || it->generation != generation) return;
+
+    // Edits since the snapshot shift the blocks; start over, keeping the blocks done so far
+    if (document->revision() != revision) {
+        scheduleFullPass(document);
+        return;
+    }
+    if (result->offsets.size() != size_t(document->blockCount()) + 1) {
+        qCWarning(wordIndexLog) << "Snapshot has" << result->offsets.size() - 1 << "blocks, document has" << document->blockCount();
+        return;
+    }
+
+    // Interned ids are cached for this slice only, since unused words may be dropped between slices
+    std::vector<int> ids(result->words.size(), -1);
+    const int lastBlock = qMin(document->blockCount(), firstBlock + APPLY_SLICE_BLOCKS);
+    int number = firstBlock;
+    for (QTextBlock block = document->findBlockByNumber(firstBlock); block.isValid() && number < lastBlock;
+         block = block.next(), ++number) {
+        // Blocks with data were edited after the snapshot was queued, or done by an earlier pass
+        if (block.userData()) continue;
+
+        const int begin = result->offsets[size_t(number)];
+        const int end = result->offsets[size_t(number) + 1];
+        if (begin == end) continue;
+
+        std::vector<int> blockIds;
+        blockIds.reserve(size_t(end - begin));
+        for (int i = begin; i < end; ++i) {
+            const int local = result->wordNumbers[size_t(i)];
+            if (ids[size_t(local)] < 0) {
+                ids[size_t(local)] = m_table->intern(result->words.at(local));
+            }
+            blockIds.push_back(ids[size_t(local)]);
+        }
+        block.setUserData(new WordBlockData(m_table, std::move(blockIds)));
+    }
+
+    if (number < document->blockCount()) {
+        QPointer<QTextDocument> guard(document);
+        QTimer::singleShot(0, this, [this, guard, generation, revision, result, number]() {
+            if (guard) {
+                applyFullPass(guard, generation, revision, result, number);
+            }
+        });
+        return;
+    }
+
+    compact();
+    qCDebug(wordIndexLog) << "Indexed" << document->blockCount() << "blocks," << wordCount() << "distinct words in total";
+    Q_EMIT documentIndexed(document);
+}
+
+void WordIndex::scheduleCompact()
+{
+    if (m_table->recent.size() > MAX_RECENT_WORDS) {
+        compact();
+    } else if (!m_compactTimer->isActive()) {
+        m_compactTimer->start();
+    }
+}
+
+void WordIndex::compact()
+{
+    m_compactTimer->stop();
+    WordTable *table = m_table;
+
+    // Drop the words no block uses any more, e.g. the prefixes of a word as it was typed
+    std::vector<int> unusedIds;
+    const auto dropUnused = [table, &unusedIds](std::vector<int> &list) {
+        list.erase(std::remove_if(list.begin(), list.end(), [table, &unusedIds](int id) {
+            if (table->entries[id].count > 0) return false;
+            unusedIds.push_back(id);
+            return true;
+        }), list.end());
+    };
+    dropUnused(table->sorted);
+    dropUnused(table->recent);
+    for (int id : unusedIds) {
+        table->ids.remove(table->entries[id].word);
+        table->entries[id] = WordTable::Entry();
+        table->freeIds.push_back(id);
+    }
+
+    // Merge the new words into the sorted array
+    const auto lessThan = [table](int a, int b) {
+        const WordTable::Entry &x = table->entries[a];
+        const WordTable::Entry &y = table->entries[b];
+        return x.key < y.key || (x.key == y.key && x.word < y.word);
+    };
+    std::sort(table->recent.begin(), table->recent.end(), lessThan);
+    const auto middle = qsizetype(table->sorted.size());
+    table->sorted.insert(table->sorted.end(), table->recent.begin(), table->recent.end());
+    std::inplace_merge(table->sorted.begin(), table->sorted.begin() + middle, table->sorted.end(), lessThan);
+    table->recent.clear();
+}
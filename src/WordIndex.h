@@ -0,0 +1,101 @@
+#ifndef WORDINDEX_H
+#define WORDINDEX_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <memory>
+#include <vector>
+
+class QTextBlock;
+class QTextDocument;
+class QTimer;
+class KTextEdit;
+struct WordTable;
+
+// This class counts the words of all open documents for completion. Every block
+// remembers the words it contributed, so an edit only tokenizes the blocks it touched
+// and a removed block takes its words out of the counts again. Whole documents are
+// tokenized on the thread pool. Lookups are a binary search in an array sorted by
+// case-folded word, so they do not depend on the number of open documents
+class WordIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit WordIndex(QObject *parent = nullptr);
+    ~WordIndex() override;
+
+    // A completion candidate and the number of times it occurs
+    struct Completion
+    {
+        QString word;
+        int count = 0;
+    };
+
+    // The most frequent words starting with a prefix, ignoring case
+    QList<Completion> completions(QStringView prefix, int maximum) const;
+
+    // Number of distinct words in use
+    qsizetype wordCount() const;
+
+    // Count the words of a document; the editor, if any, is checked for unloaded text
+    void addDocument(QTextDocument *document, KTextEdit *textEdit = nullptr);
+
+public Q_SLOTS:
+    // Count the words of an editor and offer completions in it
+    void addEditor(KTextEdit *textEdit);
+
+Q_SIGNALS:
+    // Emitted when the background pass over a document has been applied
+    void documentIndexed(QTextDocument *document);
+
+private:
+    // State of a document whose words are counted
+    struct TrackedDocument
+    {
+        QPointer<KTextEdit> textEdit;
+        quint64 generation = 0;
+        bool passScheduled = false;
+    };
+
+    // Result of tokenizing a whole document: the distinct words, and for every block a
+    // slice of word numbers given by the offsets
+    struct DocumentWords
+    {
+        QStringList words;
+        std::vector<int> offsets;
+        std::vector<int> wordNumbers;
+    };
+
+    // Whether the words of a document should be counted right now
+    bool isIndexable(QTextDocument *document) const;
+
+    // Tokenize the blocks touched by an edit, or schedule a full pass for large ones
+    void contentsChanged(QTextDocument *document, int position, int charsRemoved, int charsAdded);
+
+    // Replace the words of one block
+    void indexBlock(const QTextBlock &block);
+
+    // Tokenize a whole document on the thread pool
+    void scheduleFullPass(QTextDocument *document);
+    void startFullPass(QTextDocument *document);
+
+    // Attach the result of a full pass to the blocks that have no words yet, a slice at a time
+    void applyFullPass(QTextDocument *document, quint64 generation, int revision,
+                       std::shared_ptr<const DocumentWords> result, int firstBlock);
+
+    // Drop unused words and merge new ones into the sorted array
+    void compact();
+    void scheduleCompact();
+
+    WordTable *m_table;
+    QTimer *m_compactTimer;
+    QHash<QTextDocument*, TrackedDocument> m_documents;
+};
+
+#endif // WORDINDEX_H
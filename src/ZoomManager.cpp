@@ -1,41 +1,140 @@
 #include "ZoomManager.h"
+#include "DeferredLayout.h"
+#include "SettingsManagement.h"
 #include <QTabWidget>
 #include <QMdiArea>
 #include <QMdiSubWindow>
 #include <KTextEdit>
 #include <QSplitter>
+#include <QTimer>
+#include <QWheelEvent>
+#include <QtMath>
 
-ZoomManager::ZoomManager(QTabWidget* tabWidget, QObject* parent)
+namespace {
+
+// Property holding the zoom level of an editor, also saved with the session
+const char ZOOM_LEVEL_PROPERTY[] = "zoomLevel";
+
+}
+
+ZoomManager::ZoomManager(QTabWidget* tabWidget, SettingsManagement* settingsManagement, QObject* parent)
     : QObject(parent),
       m_tabWidget(tabWidget),
-      m_zoomFactor(1.0)
+      m_settingsManagement(settingsManagement),
+      m_applyTimer(new QTimer(this)),
+      m_wheelRemainder(0)
+{
+    m_applyTimer->setSingleShot(true);
+    m_applyTimer->setInterval(APPLY_DELAY);
+    connect(m_applyTimer, &QTimer::timeout, this, &ZoomManager::applyZoom);
+}
+
+QFont ZoomManager::zoomedFont(const QFont &baseFont, int zoomLevel)
+{
+    QFont font = baseFont;
+    if (zoomLevel != 0) {
+        font.setPointSizeF(baseFont.pointSizeF() * qPow(ZOOM_STEP, zoomLevel));
+    }
+    return font;
+}
+
+int ZoomManager::zoomLevel(KTextEdit* textEdit)
+{
+    return textEdit->property(ZOOM_LEVEL_PROPERTY).toInt();
+}
+
+void ZoomManager::restoreZoomLevel(KTextEdit* textEdit, int zoomLevel)
+{
+    textEdit->setProperty(ZOOM_LEVEL_PROPERTY, qBound(MIN_ZOOM_LEVEL, zoomLevel, MAX_ZOOM_LEVEL));
+}
+
+void ZoomManager::setZoomLevel(KTextEdit* textEdit, int zoomLevel)
+{
+    zoomLevel = qBound(MIN_ZOOM_LEVEL, zoomLevel, MAX_ZOOM_LEVEL);
+    if (zoomLevel == ZoomManager::zoomLevel(textEdit)) return;
+
+    textEdit->setProperty(ZOOM_LEVEL_PROPERTY, zoomLevel);
+    if (!m_pendingEditors.contains(textEdit)) {
+        m_pendingEditors.append(textEdit);
+    }
+    m_applyTimer->start();
+}
+
+void ZoomManager::addEditor(KTextEdit* textEdit)
 {
+    // Ctrl+wheel would otherwise reach KTextEdit, which rescales its current font on every notch.
+    // Wheel events go to the viewport, so only its events are filtered
+    textEdit->viewport()->installEventFilter(this);
 }
 
 void ZoomManager::zoomIn()
 {
-    m_zoomFactor *= 1.1;
-    applyZoom();
+    if (KTextEdit* textEdit = getActiveEditor()) {
+        setZoomLevel(textEdit, zoomLevel(textEdit) + 1);
+    }
 }
 
 void ZoomManager::zoomOut()
 {
-    m_zoomFactor *= 0.9;
-    applyZoom();
+    if (KTextEdit* textEdit = getActiveEditor()) {
+        setZoomLevel(textEdit, zoomLevel(textEdit) - 1);
+    }
+}
+
+void ZoomManager::resetZoom()
+{
+    if (KTextEdit* textEdit = getActiveEditor()) {
+        setZoomLevel(textEdit, 0);
+    }
 }
 
-void ZoomManager::applyZoom()
+bool ZoomManager::eventFilter(QObject* watched, QEvent* event)
 {
-    QMdiArea* mdiArea = getActiveMdiArea();
-    if (!mdiArea) return;
+    if (event->type() != QEvent::Wheel) {
+        return false;
+    }
+
+    QWheelEvent* wheelEvent = static_cast<QWheelEvent*>(event);
+    if (!(wheelEvent->modifiers() & Qt::ControlModifier)) {
+        return false;
+    }
+
+    KTextEdit* textEdit = nullptr;
+    for (QObject* object = watched; object && !textEdit; object = object->parent()) {
+        textEdit = qobject_cast<KTextEdit*>(object);
+    }
+    if (!textEdit) {
+        return false;
+    }
 
-    for (QMdiSubWindow* window : mdiArea->subWindowList()) {
-        if (KTextEdit* textEdit = qobject_cast<KTextEdit*>(window->widget())) {
-            QFont font = textEdit->font();
-            font.setPointSizeF(font.pointSizeF() * m_zoomFactor);
-            textEdit->setFont(font);
+    // Accumulate high-resolution deltas so touchpads zoom one step per notch as well
+    m_wheelRemainder += wheelEvent->angleDelta().y();
+    const int steps = m_wheelRemainder / QWheelEvent::DefaultDeltasPerStep;
+    m_wheelRemainder %= QWheelEvent::DefaultDeltasPerStep;
+    if (steps != 0) {
+        setZoomLevel(textEdit, zoomLevel(textEdit) + steps);
+    }
+    return true;
+}
+
+void ZoomManager::applyZoom()
+{
+    const QFont baseFont = m_settingsManagement->currentFont();
+    for (const QPointer<KTextEdit>& textEdit : std::as_const(m_pendingEditors)) {
+        if (textEdit) {
+            DeferredLayout::forEditor(textEdit)->setFont(zoomedFont(baseFont, zoomLevel(textEdit)));
         }
     }
+    m_pendingEditors.clear();
+}
+
+KTextEdit* ZoomManager::getActiveEditor() const
+{
+    QMdiArea* mdiArea = getActiveMdiArea();
+    if (mdiArea && mdiArea->activeSubWindow()) {
+        return qobject_cast<KTextEdit*>(mdiArea->activeSubWindow()->widget());
+    }
+    return nullptr;
 }
 
 QMdiArea* ZoomManager::getActiveMdiArea() const
@@ -45,4 +144,4 @@ QMdiArea* ZoomManager::getActiveMdiArea() const
         return qobject_cast<QMdiArea*>(splitter->widget(0));
     }
     return nullptr;
-}
\ No newline at end of file
+}
@@ -2,35 +2,75 @@
 #define ZOOMMANAGER_H
 
 #include <QObject>
+#include <QFont>
+#include <QList>
+#include <QPointer>
 
 class QTabWidget;
+class QTimer;
 class KTextEdit;
-class QMdiArea;  // Add this forward declaration
+class QMdiArea;
+class SettingsManagement;
 
-// This class manages zoom functionality for the text editor
+// This class manages per-document zoom levels for the text editor
 class ZoomManager : public QObject
 {
     Q_OBJECT
 
 public:
-    // Constructor takes a pointer to the tab widget
-    explicit ZoomManager(QTabWidget* tabWidget, QObject* parent = nullptr);
+    // Constructor takes a pointer to the tab widget and the settings holding the base font
+    explicit ZoomManager(QTabWidget* tabWidget, SettingsManagement* settingsManagement, QObject* parent = nullptr);
+
+    // Font for a zoom level, derived from the base font so steps never compound
+    static QFont zoomedFont(const QFont &baseFont, int zoomLevel);
+
+    // Zoom level of a document, 0 meaning the base font size
+    static int zoomLevel(KTextEdit* textEdit);
+
+    // Record a saved zoom level; the font follows with the next applySettings
+    static void restoreZoomLevel(KTextEdit* textEdit, int zoomLevel);
+
+    // Change the zoom level of a document; rapid changes are applied together
+    void setZoomLevel(KTextEdit* textEdit, int zoomLevel);
 
 public Q_SLOTS:
+    // Zoom an editor with Ctrl+wheel
+    void addEditor(KTextEdit* textEdit);
+
     // Slot to handle zooming in
     void zoomIn();
     // Slot to handle zooming out
     void zoomOut();
+    // Slot to return to the base font size
+    void resetZoom();
+
+protected:
+    // Turn Ctrl+wheel over an editor into zoom steps
+    bool eventFilter(QObject* watched, QEvent* event) override;
 
 private:
-    // Helper function to apply zoom to all open documents
+    // Helper function to apply pending zoom levels in one relayout per document
     void applyZoom();
 
+    // Helper function to get the active editor
+    KTextEdit* getActiveEditor() const;
+
     // Helper function to get the active MDI area
     QMdiArea* getActiveMdiArea() const;
 
     QTabWidget* m_tabWidget;
-    qreal m_zoomFactor;
+    SettingsManagement* m_settingsManagement;
+    QTimer* m_applyTimer;
+    QList<QPointer<KTextEdit>> m_pendingEditors;
+    int m_wheelRemainder;
+
+    // Zoom level limits and the scale of one step
+    static constexpr int MIN_ZOOM_LEVEL = -8;
+    static constexpr int MAX_ZOOM_LEVEL = 24;
+    static constexpr qreal ZOOM_STEP = 1.1;
+
+    // Time in milliseconds during which zoom steps are coalesced
+    static const int APPLY_DELAY = 40;
 };
 
-#endif // ZOOMMANAGER_H
\ No newline at end of file
+#endif // ZOOMMANAGER_H